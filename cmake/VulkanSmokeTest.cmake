@@ -0,0 +1,77 @@
+# Vulkan smoke test (ctest -R vulkan_smoke)
+#
+# Renders one headless frame with BlackHoleVK and checks the image and the
+# metrics snapshot. ctest runs it with VK_ICD_FILENAMES pointing at lavapipe:
+#   cmake -DBLACKHOLE_VK=<BlackHoleVK> -DOUT_DIR=<dir> -P VulkanSmokeTest.cmake
+
+set(WIDTH 96)
+set(HEIGHT 64)
+set(MAX_ITERATIONS 256)             # Default (High) quality preset
+
+file(REMOVE_RECURSE ${OUT_DIR})
+file(MAKE_DIRECTORY ${OUT_DIR})
+
+execute_process(
+    COMMAND ${BLACKHOLE_VK} --size ${WIDTH}x${HEIGHT} --frames 1 --device cpu
+            --out ${OUT_DIR}/frame --metrics-file ${OUT_DIR}/metrics.prom
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "BlackHoleVK failed: ${result}")
+endif()
+
+# --- Image: binary PPM of the requested size ---
+
+set(image ${OUT_DIR}/frame_0000.ppm)
+if(NOT EXISTS ${image})
+    message(FATAL_ERROR "BlackHoleVK wrote no ${image}")
+endif()
+set(header "P6\n${WIDTH} ${HEIGHT}\n255\n")
+string(LENGTH "${header}" headerLength)
+file(READ ${image} actualHeader LIMIT ${headerLength})
+if(NOT actualHeader STREQUAL header)
+    message(FATAL_ERROR "${image}: unexpected PPM header")
+endif()
+file(SIZE ${image} size)
+math(EXPR expectedSize "${headerLength} + ${WIDTH} * ${HEIGHT} * 3")
+if(NOT size EQUAL expectedSize)
+    message(FATAL_ERROR "${image}: ${size} bytes, expected ${expectedSize}")
+endif()
+
+# The default scene has both a black shadow and a bright disk and photon
+# ring; a blank, saturated or NaN frame fails one of the two counts
+file(READ ${image} pixels OFFSET ${headerLength} HEX)
+string(REGEX MATCHALL ".." channels "${pixels}")
+set(dark ${channels})
+list(FILTER dark INCLUDE REGEX "^0")            # Below 16
+list(LENGTH dark darkCount)
+set(bright ${channels})
+list(FILTER bright INCLUDE REGEX "^[c-f]")      # 192 and above
+list(LENGTH bright brightCount)
+if(darkCount EQUAL 0 OR brightCount EQUAL 0)
+    message(FATAL_ERROR "${image}: ${darkCount} dark and ${brightCount} bright channel values, expected both")
+endif()
+
+# --- Metrics: frame stats read back from the scene pass ---
+
+file(READ ${OUT_DIR}/metrics.prom metrics)
+math(EXPR rays "${WIDTH} * ${HEIGHT}")
+math(EXPR tiles "((${WIDTH} + 7) / 8) * ((${HEIGHT} + 7) / 8)")
+foreach(line "blackhole_frames_total 1" "blackhole_rays_total ${rays}" "blackhole_tiles_total ${tiles}")
+    string(FIND "${metrics}" "\n${line}\n" position)
+    if(position LESS 0)
+        message(FATAL_ERROR "metrics.prom: no \"${line}\"")
+    endif()
+endforeach()
+
+# Every ray takes at least one step and at most max_iterations
+if(NOT metrics MATCHES "\nblackhole_ray_steps_total ([0-9]+)\n")
+    message(FATAL_ERROR "metrics.prom: no blackhole_ray_steps_total")
+endif()
+set(steps ${CMAKE_MATCH_1})
+math(EXPR maxSteps "${rays} * ${MAX_ITERATIONS}")
+if(steps LESS rays OR steps GREATER maxSteps)
+    message(FATAL_ERROR "metrics.prom: ${steps} ray steps for ${rays} rays")
+endif()
+
+message(STATUS "vulkan_smoke: ${WIDTH}x${HEIGHT}, ${darkCount} dark and ${brightCount} bright values, ${steps} ray steps")
@@ -19,9 +19,10 @@
  *    - Angular momentum L (from axial Killing vector)
  *    - Impact parameter b = L/E
  * 
- * 3. Integration Methods:
+ * 3. Integration Methods (Geodesic.h, one per pipeline):
  *    - Verlet Integration: Second-order symplectic integrator for stability
  *    - RK4 (Runge-Kutta 4th Order): Higher accuracy for complex trajectories
+ *    - Yoshida 4th and 6th order: symplectic compositions of Verlet
  * 
  * 4. Relativistic Effects:
  *    - Gravitational Lensing: Light bending due to spacetime curvature
@@ -56,6 +57,9 @@
 #include <metal_stdlib>
 using namespace metal;
 
+#include "Noise.h"
+#include "../src/Geodesic.h"
+
 // Physical constants (natural units: G = M = c = 1)
 constant float G = 1.0;     // Gravitational constant (normalized)
 constant float M = 1.0;     // Black hole mass (normalized)
@@ -97,6 +101,8 @@ struct Uniforms {
     float disk_inner_multiplier;
     float disk_inner_softness;
     float disk_color_mix;
+    float disk_noise_lod_bias;
+    bool  spectral_mode;
     
     // Scientific parameters (padding for alignment)
     int integration_method;
@@ -127,93 +133,40 @@ struct Uniforms {
     int max_iterations;
     float step_size;
     bool adaptive_stepping;
+    int render_tier;
+    int critical_samples;
+    float critical_band;
+    
+    // Particle system
+    bool particle_lensing;
+    bool particle_spawning;
+    bool particle_trails;
+    uint max_particles;
+    float particle_emission_rate;
+    float particle_lifetime;
+    float particle_size;
+    float particle_turbulence;
+    float particle_magnetism;
+    float particle_collision_damping;
+    float spawning_radius_min;
+    float spawning_radius_max;
+    float trail_length;
+    uint particle_seed;
+    uint particle_step;
 };
 
+// Mirrors the render tiers in ShaderTypes.h
+#define RENDER_TIER_PREVIEW 0
+#define RENDER_TIER_STANDARD 1
+#define RENDER_TIER_REFERENCE 2
+
 //==============================================================================
 // PROCEDURAL NOISE
 //==============================================================================
 
-/**
- * 3D Simplex Noise
- * 
- * Generates smooth pseudo-random values for accretion disk turbulence.
- * Provides continuous gradient noise with good visual properties.
- * 
- * Implementation: Stefan Gustavson's optimized simplex noise
- * Complexity: O(1) - constant time per evaluation
- */
-
-float4 permute(float4 x) { 
-    return fmod(((x*34.0)+1.0)*x, 289.0); 
-}
-
-float4 taylorInvSqrt(float4 r) { 
-    return 1.79284291400159 - 0.85373472095314 * r; 
-}
-
-float snoise(float3 v) {
-    const float2 C = float2(1.0/6.0, 1.0/3.0);
-    const float4 D = float4(0.0, 0.5, 1.0, 2.0);
-
-    // First corner
-    float3 i = floor(v + dot(v, C.yyy));
-    float3 x0 = v - i + dot(i, C.xxx);
-
-    // Other corners
-    float3 g = step(x0.yzx, x0.xyz);
-    float3 l = 1.0 - g;
-    float3 i1 = min(g.xyz, l.zxy);
-    float3 i2 = max(g.xyz, l.zxy);
-
-    float3 x1 = x0 - i1 + 1.0 * C.xxx;
-    float3 x2 = x0 - i2 + 2.0 * C.xxx;
-    float3 x3 = x0 - 1.0 + 3.0 * C.xxx;
-
-    // Permutations
-    i = fmod(i, 289.0);
-    float4 p = permute(permute(permute(
-        i.z + float4(0.0, i1.z, i2.z, 1.0))
-        + i.y + float4(0.0, i1.y, i2.y, 1.0))
-        + i.x + float4(0.0, i1.x, i2.x, 1.0));
-
-    // Gradients
-    float n_ = 1.0/7.0;
-    float3 ns = n_ * D.wyz - D.xzx;
-
-    float4 j = p - 49.0 * floor(p * ns.z * ns.z);
-
-    float4 x_ = floor(j * ns.z);
-    float4 y_ = floor(j - 7.0 * x_);
-
-    float4 x = x_ * ns.x + ns.yyyy;
-    float4 y = y_ * ns.x + ns.yyyy;
-    float4 h = 1.0 - abs(x) - abs(y);
-
-    float4 b0 = float4(x.xy, y.xy);
-    float4 b1 = float4(x.zw, y.zw);
-
-    float4 s0 = floor(b0)*2.0 + 1.0;
-    float4 s1 = floor(b1)*2.0 + 1.0;
-    float4 sh = -step(h, float4(0.0));
-
-    float4 a0 = b0.xzyw + s0.xzyw*sh.xxyy;
-    float4 a1 = b1.xzyw + s1.xzyw*sh.zzww;
-
-    float3 p0 = float3(a0.xy, h.x);
-    float3 p1 = float3(a0.zw, h.y);
-    float3 p2 = float3(a1.xy, h.z);
-    float3 p3 = float3(a1.zw, h.w);
-
-    float4 norm = taylorInvSqrt(float4(dot(p0,p0), dot(p1,p1), dot(p2,p2), dot(p3,p3)));
-    p0 *= norm.x;
-    p1 *= norm.y;
-    p2 *= norm.z;
-    p3 *= norm.w;
-
-    float4 m = max(0.6 - float4(dot(x0,x0), dot(x1,x1), dot(x2,x2), dot(x3,x3)), 0.0);
-    m = m * m;
-    return 42.0 * dot(m*m, float4(dot(p0,x0), dot(p1,x1), dot(p2,x2), dot(p3,x3)));
-}
+// 3D simplex noise with integer lattice hashing lives in Noise.h, shared with
+// the particle shaders. snoise() is the scalar reference; snoise4() evaluates
+// four independent points per call and is used for the turbulence octaves.
 
 //==============================================================================
 // COORDINATE TRANSFORMATIONS
@@ -272,6 +225,70 @@ float4 getBlackBodyColor(float temp) {
     return float4(color, 1.0);
 }
 
+//==============================================================================
+// SPECTRAL EMISSION
+//==============================================================================
+
+// Mirrors SpectralBasis in ShaderTypes.h (built by Spectral.cpp)
+#define SPECTRAL_COEFFS 8
+#define SPECTRAL_NODES 16
+#define SPECTRAL_TEMPERATURES 64
+
+struct SpectralBasis {
+    float4 coefficients[SPECTRAL_TEMPERATURES][2];
+    float4 nodes[SPECTRAL_NODES / 4];
+    float4 weights[3][SPECTRAL_NODES / 4];
+    float log_temp_min;
+    float inv_log_temp_step;
+    float inv_half_width;
+    float max_log_shift;
+};
+
+/**
+ * Shifted Blackbody Colour (spectral mode)
+ * 
+ * Emission is the log-radiance polynomial of the tabulated temperature in
+ * normalized log-wavelength u. A frequency shift g acts as a translation
+ * u → u + ln(g)/halfWidth, so the observed spectrum is the same polynomial
+ * evaluated at shifted nodes, four wavelengths per float4. The node
+ * radiances are then projected to linear sRGB in one pass.
+ * 
+ * @param temperature Emitter rest-frame temperature in Kelvin
+ * @param g Frequency ratio ν_observed / ν_emitted (Doppler × gravitational)
+ * @return Linear sRGB at unit luminance (the caller applies intensity)
+ */
+float3 spectralEmission(float temperature, float g, constant SpectralBasis& basis) {
+    float t = clamp((log(temperature) - basis.log_temp_min) * basis.inv_log_temp_step,
+                    0.0, float(SPECTRAL_TEMPERATURES - 1));
+    int i0 = min(int(t), SPECTRAL_TEMPERATURES - 2);
+    float f = t - float(i0);
+    float4 lo = mix(basis.coefficients[i0][0], basis.coefficients[i0 + 1][0], f);
+    float4 hi = mix(basis.coefficients[i0][1], basis.coefficients[i0 + 1][1], f);
+
+    float logShift = clamp(log(g), -basis.max_log_shift, basis.max_log_shift);
+    float delta = logShift * basis.inv_half_width;
+
+    float3 rgb = float3(0.0);
+    for (int q = 0; q < SPECTRAL_NODES / 4; ++q) {
+        float4 u = basis.nodes[q] + delta;
+        float4 v = fma(float4(hi.w), u, float4(hi.z));
+        v = fma(v, u, float4(hi.y));
+        v = fma(v, u, float4(hi.x));
+        v = fma(v, u, float4(lo.w));
+        v = fma(v, u, float4(lo.z));
+        v = fma(v, u, float4(lo.y));
+        v = fma(v, u, float4(lo.x));
+        float4 radiance = exp(v);
+        rgb += float3(dot(radiance, basis.weights[0][q]),
+                      dot(radiance, basis.weights[1][q]),
+                      dot(radiance, basis.weights[2][q]));
+    }
+
+    // The g⁵ factor of I_obs(λ) = g⁵ I_emit(gλ) cancels here
+    float luminance = dot(rgb, float3(0.2126, 0.7152, 0.0722));
+    return max(rgb / max(luminance, 1e-30), 0.0);
+}
+
 //==============================================================================
 // RELATIVISTIC EFFECTS
 //==============================================================================
@@ -359,10 +376,15 @@ float calculateRealisticTemperature(float3 pos, float baseTemp) {
 // ACCRETION DISK RENDERING
 //==============================================================================
 
+// Path length the disk's emission and falloff parameters are defined per
+// (the High preset's step); also the sample spacing inside the disk slab
+constant float diskSampleLength = 0.1;
+
 /**
- * Disk Render Function
+ * Disk Sample
  * 
- * Computes color and opacity of accretion disk at given position.
+ * Computes color and opacity of accretion disk over a short path around
+ * the given position.
  * Implements:
  * - Procedural density via simplex noise
  * - Blackbody radiation based on temperature
@@ -370,14 +392,22 @@ float calculateRealisticTemperature(float3 pos, float baseTemp) {
  * - Doppler shifting from orbital motion
  * - Relativistic beaming
  * 
+ * The emission and falloff terms give the deposit and opacity of one
+ * diskSampleLength of path. They are converted to an absorption
+ * coefficient κ = -ln(1 - attenuation) / diskSampleLength and a source
+ * term, and integrated exactly over the path: T = exp(-κ·ds) and the
+ * sample adds S·(1 - T) behind what is already in front of it.
+ * 
  * @param pos Position to evaluate
+ * @param ds Path length the sample stands for
  * @param[out] color Accumulated RGB color
  * @param[out] alpha Accumulated opacity
  * @param viewDir View direction for Doppler calculation
+ * @param footprint World-space width of the pixel's ray cone at pos
  * @param time Animation time for turbulence
  * @param uniforms User-adjustable parameters
  */
-void diskRender(float3 pos, thread float4& color, thread float& alpha, float3 viewDir, float time, constant Uniforms& uniforms, texture2d<float, access::sample> diskColorMap) {
+void diskSample(float3 pos, float ds, thread float4& color, thread float& alpha, float3 viewDir, float footprint, float time, constant Uniforms& uniforms, texture2d<float, access::sample> diskColorMap, constant SpectralBasis& spectral) {
     // Create a sampler for the color map texture
     constexpr sampler colorSampler(mag_filter::linear, min_filter::linear, address::clamp_to_edge);
     
@@ -445,20 +475,73 @@ void diskRender(float3 pos, thread float4& color, thread float& alpha, float3 vi
     density *= mix(0.35, 1.25, laneMask * bandNoise);
 
     float noise = 1.0;
-    int noiseOctaves = max(uniforms.disk_noise_octaves, 1);
+    int noiseOctaves = clamp(uniforms.disk_noise_octaves, 1, 8);
     float noiseScale = max(uniforms.disk_noise_scale, 0.001);
     float noiseSpeed = uniforms.disk_noise_speed;
+
+    // Pixel footprint expressed in noise lattice units per unit frequency.
+    // The angular axes are scaled by 2 and 4 above, so near the hole they
+    // stretch faster than the radial axis (d(phi)/dy ~ 1/r).
+    float lodBias = uniforms.disk_noise_lod_bias;
+    float latticeFootprint = (lodBias > 0.0)
+        ? footprint * lodBias * max(1.0, 4.0 / max(rDisk, 0.001)) * noiseScale
+        : 0.0;
+
+    // Gather every octave's sample point first (the advection offsets do not
+    // depend on noise values), then evaluate the surviving points in
+    // batches of four. Octave frequency grows monotonically, so the
+    // unculled octaves always form a prefix of the list.
+    float3 samplePoints[9];
+    float sampleWeights[9];
+    int sampleCount = 0;
     for (int i = 0; i < noiseOctaves; ++i) {
         float octave = pow(float(i) + 1.0, 2.0);
         float octaveSpeed = noiseSpeed * (1.0 + 0.18 * float(i));
-        noise *= 0.55 * snoise(sphericalCoord * octave * noiseScale) + 0.45;
+        // Fade octaves toward their mean (0.45) once one pixel spans about a
+        // lattice cell; fully faded octaves skip the noise evaluation.
+        float octaveWeight = 1.0 - smoothstep(0.5, 1.0, latticeFootprint * octave);
+        if (octaveWeight > 0.0) {
+            samplePoints[sampleCount] = sphericalCoord * octave * noiseScale;
+            sampleWeights[sampleCount] = octaveWeight;
+            sampleCount++;
+        }
         float direction = (i % 2 == 0) ? -1.0 : 1.0;
         sphericalCoord.y += direction * time * octaveSpeed * keplerFactor;
     }
+    int octaveSamples = sampleCount;
     
-    // Fine-grained particle detail
-    float microDetail = 0.5 + 0.5 * snoise(sphericalCoord * 18.0 * noiseScale + time * 0.3);
-    noise *= mix(0.85, 1.15, microDetail);
+    // Fine-grained particle detail (mean factor 1.0, so it simply drops out
+    // when the footprint is too coarse to resolve it). It rides in the same
+    // batch as the octaves.
+    float microWeight = 1.0 - smoothstep(0.5, 1.0, latticeFootprint * 18.0);
+    if (microWeight > 0.0) {
+        samplePoints[sampleCount] = sphericalCoord * 18.0 * noiseScale + time * 0.3;
+        sampleWeights[sampleCount] = microWeight;
+        sampleCount++;
+    }
+
+    float sampleValues[9];
+    int batched = sampleCount & ~3;
+    for (int b = 0; b < batched; b += 4) {
+        float4 v = snoise4(samplePoints[b], samplePoints[b + 1], samplePoints[b + 2], samplePoints[b + 3]);
+        sampleValues[b] = v.x;
+        sampleValues[b + 1] = v.y;
+        sampleValues[b + 2] = v.z;
+        sampleValues[b + 3] = v.w;
+    }
+    for (int b = batched; b < sampleCount; ++b) {
+        sampleValues[b] = snoise(samplePoints[b]);
+    }
+
+    for (int k = 0; k < octaveSamples; ++k) {
+        noise *= mix(0.45, 0.55 * sampleValues[k] + 0.45, sampleWeights[k]);
+    }
+    // Culled octaves contribute their mean factor
+    noise *= pow(0.45, float(noiseOctaves - octaveSamples));
+    if (sampleCount > octaveSamples) {
+        float microDetail = 0.5 + 0.5 * sampleValues[octaveSamples];
+        noise *= mix(1.0, mix(0.85, 1.15, microDetail), sampleWeights[octaveSamples]);
+    }
 
     float3 tangentDir = normalize(float3(-advectedPos.z, 0.0, advectedPos.x));
     float viewDot = clamp(dot(tangentDir, -normalize(viewDir)), -1.0, 1.0);
@@ -487,6 +570,17 @@ void diskRender(float3 pos, thread float4& color, thread float& alpha, float3 vi
     // Apply beaming effect (relativistic intensity boost)
     float beaming = pow(doppler, 3.0);
 
+    // Spectral mode: shift the rest-frame blackbody by g = ν_obs/ν_emit.
+    // doppler and redshift are both wavelength stretch factors here.
+    float3 spectralColor = float3(0.0);
+    if (uniforms.spectral_mode) {
+        float g = 1.0 / (doppler * redshift);
+        spectralColor = spectralEmission(calculateRealisticTemperature(pos, 7500.0), g, spectral);
+        // Bolometric intensity scales as g⁴
+        float g2 = g * g;
+        beaming = g2 * g2;
+    }
+
     // Lensing flare near photon ring
     float photonProximity = smoothstep(innerRadius * 1.5, innerRadius * 1.05, rDisk);
     float lensingFlare = 1.0 + 1.8 * photonProximity * pow(clamp(viewDot * 0.5 + 0.5, 0.0, 1.0), 2.0);
@@ -507,88 +601,577 @@ void diskRender(float3 pos, thread float4& color, thread float& alpha, float3 vi
     
     // Final disk color combines base color (from texture or blackbody) with tinting
     float3 diskColor = mix(tintedColor, baseColor, 0.75);
-    float deposit = rawDeposit * alpha;
-    color.rgb += diskColor * deposit;
-    color.a = min(color.a + deposit, 1.0);
-
+    if (uniforms.spectral_mode) {
+        diskColor = spectralColor;
+    }
+    // Opacity of one diskSampleLength, then the exact transmittance for ds.
+    // S is chosen so one diskSampleLength deposits rawDeposit; without
+    // falloff the medium is purely emissive and the deposit is linear in ds.
     float alphaFalloff = clamp(uniforms.disk_alpha_falloff, 0.0, 1.0);
     float attenuation = clamp(rawDeposit * alphaFalloff * (0.75 + 0.45 * (1.0 - radialNorm)), 0.0, 0.95);
-    alpha *= (1.0 - attenuation);
-    alpha = max(alpha, 0.0);
+    float transmittance = exp(log(1.0 - attenuation) * (ds / diskSampleLength));
+    float emitted = attenuation > 1e-4
+        ? rawDeposit * (1.0 - transmittance) / attenuation
+        : rawDeposit * (ds / diskSampleLength);
+
+    float deposit = emitted * alpha;
+    color.rgb += diskColor * deposit;
+    color.a = min(color.a + alpha * (1.0 - transmittance), 1.0);
+    alpha *= transmittance;
+}
+
+/**
+ * Disk Segment
+ * 
+ * Integrates the disk along one march segment a → b. Only the part inside
+ * the slab |y| <= disk_thickness can emit; it is split into samples no
+ * longer than diskSampleLength, each at its midpoint, so a thin disk is
+ * neither stepped over nor brightened by small steps. The image converges
+ * as the march step grows up to the slab's size.
+ * 
+ * @param a Segment start
+ * @param b Segment end (current ray position)
+ * @param viewDir View direction for Doppler calculation
+ * @param footprint World-space width of the pixel's ray cone at b
+ */
+void diskRender(float3 a, float3 b, thread float4& color, thread float& alpha, float3 viewDir, float footprint, float time, constant Uniforms& uniforms, texture2d<float, access::sample> diskColorMap, constant SpectralBasis& spectral) {
+    float halfHeight = max(uniforms.disk_thickness, 0.01);
+    float3 d = b - a;
+    float t0 = 0.0;
+    float t1 = 1.0;
+    if (abs(d.y) > 1e-6) {
+        float ta = (-halfHeight - a.y) / d.y;
+        float tb = (halfHeight - a.y) / d.y;
+        t0 = max(t0, min(ta, tb));
+        t1 = min(t1, max(ta, tb));
+    } else if (abs(a.y) > halfHeight) {
+        return;
+    }
+    if (t0 >= t1) {
+        return;
+    }
+
+    float inside = length(d) * (t1 - t0);
+    int samples = clamp(int(ceil(inside / diskSampleLength)), 1, 8);
+    float ds = inside / float(samples);
+    for (int i = 0; i < samples; ++i) {
+        float t = t0 + (t1 - t0) * (float(i) + 0.5) / float(samples);
+        diskSample(a + d * t, ds, color, alpha, viewDir, footprint, time, uniforms, diskColorMap, spectral);
+        if (alpha < 0.01) {
+            return;
+        }
+    }
+}
+
+// Integrator chosen per pipeline (Geodesic.h); RK4 when the constant is unset
+constant int integratorConstant [[function_constant(0)]];
+constant int geodesicIntegrator = is_function_constant_defined(integratorConstant) ? integratorConstant : GEODESIC_RK4;
+
+// Advance one photon step with the pipeline's integrator
+void integrateGeodesic(thread float3& pos, thread float3& dir, float h2, float dt, float gravity) {
+    geodesicStep(geodesicIntegrator, pos, dir, h2, dt, gravity);
 }
 
-// Exact acceleration from repository
-float3 acceleration(float h2, float3 pos, float gravityStrength) {
+//==============================================================================
+// RAY DIFFERENTIALS
+//==============================================================================
+
+/**
+ * Ray Differential
+ * 
+ * Tracks how a ray's position and direction change per pixel step along
+ * screen x and y (Igehy 1999). Propagated alongside the geodesic with the
+ * linearized equation of motion, it gives the width of the pixel's ray cone
+ * anywhere on the curved path, including the magnification or
+ * demagnification caused by lensing.
+ */
+struct RayDifferential {
+    float3 dPdx;    // Position change per pixel in x
+    float3 dPdy;    // Position change per pixel in y
+    float3 dDdx;    // Direction change per pixel in x
+    float3 dDdy;    // Direction change per pixel in y
+};
+
+// Jacobian of geodesicAcceleration() applied to a displacement v:
+// J·v = -1.5 h² g (v / r⁵ - 5 x (x·v) / r⁷)
+float3 accelerationJacobian(float h2, float3 pos, float3 v, float gravityStrength) {
     float r2 = dot(pos, pos);
-    float r5 = pow(r2, 2.5);
-    float3 acc = -1.5 * h2 * pos / r5 * gravityStrength;
-    return acc;
+    float k = -1.5 * h2 * gravityStrength / pow(r2, 2.5);
+    return k * (v - 5.0 * pos * (dot(pos, v) / r2));
 }
 
-// Exact Verlet integration from repository
-void verlet(thread float3& pos, float h2, thread float3& dir, float dt, float gravityStrength) {
-    float3 a = acceleration(h2, pos, gravityStrength);
-    float3 pos_new = pos + dir * dt + 0.5 * a * dt * dt;
-    float3 a_new = acceleration(h2, pos_new, gravityStrength);
+// Advance the differential over one integration step (semi-implicit Euler,
+// evaluated at the step midpoint). Angular momentum variation is ignored;
+// the footprint only needs to be accurate to within a factor of ~2.
+void propagateDifferential(thread RayDifferential& rd, float3 midPos, float h2, float dt, float gravityStrength) {
+    rd.dDdx += accelerationJacobian(h2, midPos, rd.dPdx, gravityStrength) * dt;
+    rd.dDdy += accelerationJacobian(h2, midPos, rd.dPdy, gravityStrength) * dt;
+    rd.dPdx += rd.dDdx * dt;
+    rd.dPdy += rd.dDdy * dt;
+}
 
-    dir += 0.5 * (a + a_new) * dt;
-    pos = pos_new;
+// World-space width of the pixel footprint at the current ray position
+float rayFootprint(RayDifferential rd) {
+    return max(length(rd.dPdx), length(rd.dPdy));
 }
 
-// Exact RK4 integration from repository
-void rk4(thread float3& pos, float h2, thread float3& dir, float dt, float gravityStrength) {
-    float3 k1_pos = dir;
-    float3 k1_vel = acceleration(h2, pos, gravityStrength);
+//==============================================================================
+// ORBITING EMITTERS
+//==============================================================================
 
-    float3 k2_pos = dir + 0.5 * k1_vel * dt;
-    float3 k2_vel = acceleration(h2, pos + 0.5 * k1_pos * dt, gravityStrength);
+// Mirrors Emitter / EmitterGrid in ShaderTypes.h (built by Emitters.cpp)
+#define EMITTER_GRID_DIM 16
 
-    float3 k3_pos = dir + 0.5 * k2_vel * dt;
-    float3 k3_vel = acceleration(h2, pos + 0.5 * k2_pos * dt, gravityStrength);
+struct Emitter {
+    float4 position_radius;
+    float4 velocity;
+    float4 emission;
+};
 
-    float3 k4_pos = dir + k3_vel * dt;
-    float3 k4_vel = acceleration(h2, pos + k3_pos * dt, gravityStrength);
+struct EmitterGrid {
+    float4 origin;
+    float4 inv_cell_size;
+    uint emitter_count;
+    uint ref_count;
+    float max_blur;
+    float pad;
+};
+
+// The four sections of this frame's emitter buffer
+struct EmitterScene {
+    constant EmitterGrid* grid;
+    const device uint2* cells;      // (first ref, count) per grid cell
+    const device uint* refs;        // Emitter indices, grouped by cell
+    const device Emitter* emitters;
+};
 
-    float3 pos_new = pos + (1.0 / 6.0) * (k1_pos + 2.0 * k2_pos + 2.0 * k3_pos + k4_pos) * dt;
-    float3 dir_new = dir + (1.0 / 6.0) * (k1_vel + 2.0 * k2_vel + 2.0 * k3_vel + k4_vel) * dt;
+/**
+ * Emitter Segment Test
+ * 
+ * Tests the orbiting emitters against one integration segment a → b of the
+ * curved ray, so they are lensed like everything else. Rays that wind
+ * around the photon sphere reach an emitter again on a later segment,
+ * which produces the secondary and tertiary images without extra work.
+ * 
+ * Only the grid cell containing the segment midpoint is visited; the CPU
+ * inserted each sphere with enough margin for that to be conservative. A
+ * sphere counts on the segment where the ray enters it, so each image is
+ * added once however many steps it spans. The impact parameter is taken
+ * from the segment's line, the local chord of the geodesic.
+ * 
+ * Spheres smaller than the pixel footprint are widened (up to max_blur
+ * radii) with their flux kept constant, so distant or demagnified images
+ * do not flicker between frames.
+ * 
+ * @param a Segment start (previous position)
+ * @param b Segment end (current position)
+ * @param footprint World-space width of the pixel's ray cone at b
+ */
+void emitterRender(float3 a, float3 b, float footprint, thread float4& color, thread float& alpha, constant Uniforms& uniforms, EmitterScene scene, constant SpectralBasis& spectral) {
+    constant EmitterGrid& grid = *scene.grid;
+    float3 cellPos = (0.5 * (a + b) - grid.origin.xyz) * grid.inv_cell_size.xyz;
+    if (any(cellPos < 0.0) || any(cellPos >= float(EMITTER_GRID_DIM))) {
+        return;
+    }
+    int3 cell = int3(cellPos);
+    uint2 range = scene.cells[(cell.z * EMITTER_GRID_DIM + cell.y) * EMITTER_GRID_DIM + cell.x];
+
+    float3 d = b - a;
+    float segLen2 = max(dot(d, d), 1e-12);
+    float3 rayDir = d * rsqrt(segLen2);
+
+    for (uint k = 0; k < range.y; ++k) {
+        Emitter e = scene.emitters[scene.refs[range.x + k]];
+        float3 center = e.position_radius.xyz;
+        float radius = e.position_radius.w;
+        float blurred = clamp(0.5 * footprint, radius, radius * grid.max_blur);
+        float r2 = blurred * blurred;
+
+        // Rays that start inside (or are already inside) were counted on entry
+        float3 ac = center - a;
+        if (dot(ac, ac) <= r2) {
+            continue;
+        }
+        float t = dot(ac, d) / segLen2;
+        float3 bc = center - b;
+        float impact2 = length_squared(ac - d * t);
+        bool enters = (t >= 0.0) && ((t <= 1.0) ? (impact2 < r2) : (dot(bc, bc) <= r2));
+        if (!enters) {
+            continue;
+        }
 
-    pos = pos_new;
-    dir = dir_new;
+        float q = sqrt(impact2 / r2);
+        float coverage = (1.0 - smoothstep(0.7, 1.0, q)) * (radius * radius / r2);
+        float limb = 0.6 + 0.4 * sqrt(max(1.0 - q * q, 0.0));
+
+        // Frequency shift g = ν_obs/ν_emit; the photon travels back along -rayDir
+        float g = 1.0;
+        if (uniforms.redshift_enabled) {
+            g *= sqrt(max(1.0 - 1.0 / length(center), 0.0));
+        }
+        if (uniforms.doppler_enabled) {
+            float3 beta = e.velocity.xyz;
+            float gamma = rsqrt(max(1.0 - dot(beta, beta), 1e-4));
+            g /= gamma * (1.0 + dot(beta, rayDir));
+        }
+
+        float3 emitted = e.emission.rgb;
+        if (uniforms.spectral_mode && e.emission.w > 0.0) {
+            float luminance = dot(emitted, float3(0.2126, 0.7152, 0.0722));
+            emitted = spectralEmission(e.emission.w, g, spectral) * luminance;
+        }
+        // Bolometric intensity scales as g⁴
+        float g2 = g * g;
+        float intensity = uniforms.beaming_enabled ? min(g2 * g2, 16.0) : 1.0;
+
+        float deposit = coverage * alpha;
+        color.rgb += emitted * (limb * intensity * deposit);
+        color.a = min(color.a + deposit, 1.0);
+        alpha *= 1.0 - coverage;
+    }
 }
 
-// Render an orbiting star with proper physics
-float4 renderOrbitingStar(float3 rayPos, float3 rayDir, float time, float orbitRadius, float orbitSpeed, float brightness) {
-    // Calculate star position in circular orbit (XZ plane)
-    float angle = time * orbitSpeed;
-    float3 starPos = float3(orbitRadius * cos(angle), 0.0, orbitRadius * sin(angle));
-    
-    // Check if ray intersects star (sphere intersection)
-    float3 toStar = starPos - rayPos;
-    float starRadius = 0.1;  // Small visible star
-    
-    float b = dot(toStar, rayDir);
-    if (b < 0.0) return float4(0.0);  // Behind ray origin
-    
-    float c = dot(toStar, toStar) - b * b;
-    float disc = starRadius * starRadius - c;
-    
-    if (disc < 0.0) return float4(0.0);  // No intersection
-    
-    // Calculate star color with distance falloff
-    float dist = b - sqrt(disc);
-    float intensity = brightness * (1.0 / (1.0 + dist * dist * 0.1));
-    
-    // Star color (white/blue-white)
-    float3 starColor = float3(0.9, 0.95, 1.0) * intensity;
-    
-    // Apply gravitational redshift to star
-    float starDist = length(starPos);
-    if (starDist > 1.0) {
-        float redshift = sqrt(max(0.0, 1.0 - 1.0/starDist));
-        starColor *= (1.0 + redshift);  // Redshift effect
+//==============================================================================
+// STAR CATALOG
+//==============================================================================
+
+// Mirrors CatalogStar / StarCatalogInfo in ShaderTypes.h (file: StarCatalog.hpp)
+struct CatalogStar {
+    float4 direction_flux;
+    float4 color;
+};
+
+struct StarCatalogInfo {
+    uint order;
+    uint star_count;
+    uint max_per_cell;
+    float splat_sigma;
+    float brightness;
+    float max_magnification;
+    float pad[2];
+};
+
+struct SkyCatalog {
+    constant StarCatalogInfo* info;
+    const device uint* cells;       // Prefix offsets, 12·4^order + 1 entries
+    const device CatalogStar* stars;
+    float pixel_solid_angle;        // Unlensed solid angle of this pixel
+    float weight;                   // 0 leaves the sky out (source flux only)
+};
+
+// Interleave zeros between the low 16 bits of v
+inline uint spreadBits(uint v) {
+    v &= 0xFFFFu;
+    v = (v | (v << 8)) & 0x00FF00FFu;
+    v = (v | (v << 4)) & 0x0F0F0F0Fu;
+    v = (v | (v << 2)) & 0x33333333u;
+    v = (v | (v << 1)) & 0x55555555u;
+    return v;
+}
+
+/**
+ * HEALPix NESTED Pixel Index
+ * 
+ * Standard ang2pix_nest (Górski et al. 2005) for a unit vector, with the
+ * renderer's y axis as the HEALPix pole. Mirrors ang2pix_nest() in
+ * tools/build_star_catalog.py, which bins the catalog.
+ */
+uint healpixNest(float3 v, uint order) {
+    int nside = 1 << order;
+    float za = abs(v.y);
+    float tt = atan2(v.z, v.x) * (2.0 / M_PI_F);
+    tt = (tt < 0.0) ? tt + 4.0 : tt;
+
+    int face, ix, iy;
+    if (za <= 2.0 / 3.0) {
+        float temp1 = float(nside) * (0.5 + tt);
+        float temp2 = float(nside) * v.y * 0.75;
+        int jp = int(temp1 - temp2);
+        int jm = int(temp1 + temp2);
+        int ifp = jp >> order;
+        int ifm = jm >> order;
+        face = (ifp == ifm) ? (ifp | 4) : ((ifp < ifm) ? ifp : ifm + 8);
+        ix = jm & (nside - 1);
+        iy = nside - (jp & (nside - 1)) - 1;
+    } else {
+        int ntt = min(3, int(tt));
+        float tp = tt - float(ntt);
+        // sqrt(3(1 - |z|)) via sin θ, accurate at the poles
+        float tmp = float(nside) * sqrt(3.0 * (v.x * v.x + v.z * v.z) / (1.0 + za));
+        int jp = min(int(tp * tmp), nside - 1);
+        int jm = min(int((1.0 - tp) * tmp), nside - 1);
+        if (v.y >= 0.0) {
+            face = ntt;
+            ix = nside - jm - 1;
+            iy = nside - jp - 1;
+        } else {
+            face = ntt + 8;
+            ix = jp;
+            iy = jm;
+        }
     }
-    
-    return float4(starColor, min(intensity, 1.0));
+    return uint(face) * uint(nside * nside) + spreadBits(uint(ix)) + (spreadBits(uint(iy)) << 1);
+}
+
+/**
+ * Catalog Starfield
+ * 
+ * Splats catalog stars for an escaped ray. The ray differential gives the
+ * Jacobian J from screen pixels to sky directions at the end of the
+ * geodesic; a star at sky offset δ lands at pixel offset J⁻¹δ and is drawn
+ * as a unit-integral Gaussian there, so arcs near the Einstein ring come
+ * out stretched. Its flux is multiplied by the point-source magnification
+ * μ = Ω_pixel / |det J| (capped near caustics).
+ * 
+ * Only the pixels containing the ray direction and the four corners of the
+ * splat's bounding square are visited, each capped at max_per_cell of its
+ * brightest stars, so the cost per screen pixel is bounded.
+ * 
+ * @param dir Final ray direction (any length)
+ * @param dDdx Direction change per screen pixel in x
+ * @param dDdy Direction change per screen pixel in y
+ */
+float3 catalogStars(float3 dir, float3 dDdx, float3 dDdy, SkyCatalog sky) {
+    constant StarCatalogInfo& info = *sky.info;
+    float invLen = rsqrt(dot(dir, dir));
+    float3 n = dir * invLen;
+
+    // Derivatives of the unit direction, in an orthonormal tangent basis
+    float3 a = (dDdx - n * dot(n, dDdx)) * invLen;
+    float3 b = (dDdy - n * dot(n, dDdy)) * invLen;
+    float la = length(a);
+    if (la < 1e-12) {
+        return float3(0.0);
+    }
+    float3 e1 = a / la;
+    float3 e2 = cross(n, e1);
+    float b1 = dot(e1, b);
+    float b2 = dot(e2, b);
+    float det = la * b2;
+    if (abs(det) < 1e-20) {
+        return float3(0.0);
+    }
+    float magnification = min(sky.pixel_solid_angle / abs(det), info.max_magnification);
+
+    float sigma = info.splat_sigma;
+    float reach = 3.0 * sigma * sqrt(la * la + dot(b, b));
+    float invTwoSigma2 = 0.5 / (sigma * sigma);
+    float norm = invTwoSigma2 / M_PI_F;
+
+    uint visited[5];
+    float3 probes[5] = {
+        n,
+        normalize(n + reach * ( e1 + e2)),
+        normalize(n + reach * ( e1 - e2)),
+        normalize(n + reach * (-e1 + e2)),
+        normalize(n + reach * (-e1 - e2)),
+    };
+
+    float3 color = float3(0.0);
+    for (int p = 0; p < 5; ++p) {
+        uint pix = healpixNest(probes[p], info.order);
+        bool seen = false;
+        for (int q = 0; q < p; ++q) {
+            seen = seen || (visited[q] == pix);
+        }
+        visited[p] = pix;
+        if (seen) {
+            continue;
+        }
+
+        uint first = sky.cells[pix];
+        uint last = min(sky.cells[pix + 1], first + info.max_per_cell);
+        for (uint k = first; k < last; ++k) {
+            CatalogStar star = sky.stars[k];
+            float3 offset = star.direction_flux.xyz - n;
+            if (dot(star.direction_flux.xyz, n) <= 0.0) {
+                continue;
+            }
+            // Solve J·pixel = δ (J is upper triangular in this basis)
+            float py = dot(offset, e2) / b2;
+            float px = (dot(offset, e1) - b1 * py) / la;
+            float r2 = px * px + py * py;
+            if (r2 > 9.0 * sigma * sigma) {
+                continue;
+            }
+            color += star.color.rgb * (star.direction_flux.w * exp(-r2 * invTwoSigma2));
+        }
+    }
+    return color * (norm * magnification * info.brightness);
+}
+
+//==============================================================================
+// VOLUMETRIC DATA
+//==============================================================================
+
+// Mirrors VolumeInfo in ShaderTypes.h (streamed by VolumeCache.cpp)
+#define VOLUME_NOT_RESIDENT 0xFFFFFFFFu
+#define VOLUME_EMPTY_BRICK 0xFFFFFFFEu
+
+struct VolumeInfo {
+    float4 box_min;
+    float4 inv_box_size;
+    uint4 dims;
+    uint4 brick_grid;
+    uint4 atlas_slots;
+    uint brick_size;
+    float density_scale;
+    float emission_scale;
+    float temperature_scale;
+};
+
+struct VolumeScene {
+    constant VolumeInfo* info;
+    texture3d<float, access::sample> atlas;    // RG16F bricks with apron
+    texture3d<float, access::sample> coarse;   // RG16F, one voxel per brick
+    const device uint* pages;                  // Slot per brick
+    device atomic_uint* feedback;              // 1 = hit, 2 = miss per brick
+};
+
+/**
+ * Volume Sample
+ * 
+ * Trilinear (density, temperature) at a world position. The brick is
+ * located from the voxel coordinate, so the filter footprint always stays
+ * inside that brick plus its apron. Absent bricks are reported as misses
+ * and answered from the coarse level, so streaming never leaves holes.
+ * 
+ * @return Stored density and temperature (unscaled), zero outside the grid
+ */
+float2 sampleVolume(float3 pos, VolumeScene vol) {
+    constexpr sampler volumeSampler(coord::normalized, filter::linear, address::clamp_to_edge);
+    constant VolumeInfo& info = *vol.info;
+
+    float3 uvw = (pos - info.box_min.xyz) * info.inv_box_size.xyz;
+    if (any(uvw < 0.0) || any(uvw >= 1.0)) {
+        return float2(0.0);
+    }
+    float3 dims = float3(info.dims.xyz);
+    float3 voxel = clamp(uvw * dims - 0.5, 0.0, dims - 1.0);
+    uint3 brick = min(uint3(voxel) / info.brick_size, info.brick_grid.xyz - 1);
+    uint index = (brick.z * info.brick_grid.y + brick.y) * info.brick_grid.x + brick.x;
+
+    uint page = vol.pages[index];
+    if (page == VOLUME_EMPTY_BRICK) {
+        return float2(0.0);
+    }
+    bool resident = page != VOLUME_NOT_RESIDENT;
+    // Load first: most threads find the flag already set and skip the atomic write
+    device atomic_uint* flag = &vol.feedback[index];
+    if (atomic_load_explicit(flag, memory_order_relaxed) == 0) {
+        atomic_store_explicit(flag, resident ? 1u : 2u, memory_order_relaxed);
+    }
+    if (!resident) {
+        return vol.coarse.sample(volumeSampler, uvw).rg;
+    }
+
+    uint3 slots = info.atlas_slots.xyz;
+    uint3 slot = uint3(page % slots.x, (page / slots.x) % slots.y, page / (slots.x * slots.y));
+    float padded = float(info.brick_size + 2);
+    float3 local = voxel - float3(brick * info.brick_size) + 1.0;
+    float3 texel = float3(slot) * padded + local + 0.5;
+    return vol.atlas.sample(volumeSampler, texel / (float3(slots) * padded)).rg;
+}
+
+/**
+ * Shifted Thermal Emission
+ * 
+ * Observed colour × intensity of co-rotating gas at temperature T: the
+ * frequency ratio g = ν_obs/ν_emit comes from the same stretch factors
+ * diskRender uses, and bolometric intensity scales as g⁴ with beaming.
+ */
+float3 shiftedThermalEmission(float3 pos, float3 viewDir, float temperature, constant Uniforms& uniforms, constant SpectralBasis& spectral) {
+    float redshift = uniforms.redshift_enabled ? calculateRedShift(pos) : 1.0;
+    float doppler = uniforms.doppler_enabled ? max(calculateDopplerEffect(pos, viewDir), 0.2) : 1.0;
+    float g = 1.0 / max(doppler * redshift, 1e-3);
+
+    float3 emitted = uniforms.spectral_mode
+        ? spectralEmission(temperature, g, spectral)
+        : getBlackBodyColor(temperature * g).rgb;
+    float g2 = g * g;
+    float intensity = uniforms.beaming_enabled ? min(g2 * g2, 16.0) : 1.0;
+    return emitted * intensity;
+}
+
+/**
+ * Volume Segment
+ * 
+ * Emission-absorption over one integration segment a → b, sampled at its
+ * midpoint: transmittance T = exp(-σ·length), and the segment adds the
+ * source term S·(1 - T) behind what is already in front of it. The gas is
+ * assumed to co-rotate like the disk, so the Doppler and gravitational
+ * shifts reuse the disk's model. Replaces diskRender while a volume is
+ * bound.
+ * 
+ * @param viewDir Current ray direction (for Doppler)
+ */
+void volumeRender(float3 a, float3 b, float3 viewDir, thread float4& color, thread float& alpha, constant Uniforms& uniforms, VolumeScene vol, constant SpectralBasis& spectral) {
+    constant VolumeInfo& info = *vol.info;
+    float3 mid = 0.5 * (a + b);
+    float2 value = sampleVolume(mid, vol);
+    float sigma = value.x * info.density_scale;
+    if (sigma <= 0.0) {
+        return;
+    }
+    float transmittance = exp(-sigma * length(b - a));
+    float temperature = max(value.y * info.temperature_scale, 1.0);
+    float3 emitted = shiftedThermalEmission(mid, viewDir, temperature, uniforms, spectral);
+
+    float deposit = alpha * (1.0 - transmittance);
+    color.rgb += emitted * (info.emission_scale * deposit);
+    color.a = min(color.a + deposit, 1.0);
+    alpha *= transmittance;
+}
+
+//==============================================================================
+// LENSED PARTICLES
+//==============================================================================
+
+// Mirrors ParticleGridInfo in ShaderTypes.h (grid written by ParticleSystem.metal)
+struct ParticleGridInfo {
+    float inner_radius;
+    float inv_log_span;
+    float half_height;
+    float emission_scale;
+    float absorption;
+    uint enabled;
+    float pad[2];
+};
+
+/**
+ * Particle Grid Segment
+ * 
+ * Samples the deposited particle emission (azimuth × log radius × height,
+ * azimuth wrapping) at the segment midpoint and integrates it like a thin
+ * emitting medium with mild extinction. Replaces diskRender while particle
+ * lensing is on; cost is independent of how many particles were deposited.
+ */
+void particleRender(float3 a, float3 b, float3 viewDir, thread float4& color, thread float& alpha, constant Uniforms& uniforms, texture3d<float, access::sample> grid, constant ParticleGridInfo& info, constant SpectralBasis& spectral) {
+    constexpr sampler gridSampler(coord::normalized, filter::linear,
+                                  s_address::repeat, t_address::clamp_to_edge, r_address::clamp_to_edge);
+    float3 mid = 0.5 * (a + b);
+    float r = length(mid.xz);
+    if (r <= info.inner_radius || abs(mid.y) >= info.half_height) {
+        return;
+    }
+    float u = log(r / info.inner_radius) * info.inv_log_span;
+    if (u >= 1.0) {
+        return;
+    }
+    float3 uvw = float3(atan2(mid.z, mid.x) / (2.0 * M_PI_F) + 0.5, u, mid.y / info.half_height * 0.5 + 0.5);
+    float2 value = grid.sample(gridSampler, uvw).rg;
+    if (value.x <= 0.0) {
+        return;
+    }
+
+    float segLen = length(b - a);
+    float temperature = max(value.y * 1000.0, 1.0);
+    float3 emitted = shiftedThermalEmission(mid, viewDir, temperature, uniforms, spectral);
+    float transmittance = exp(-value.x * info.absorption * segLen);
+
+    color.rgb += emitted * (value.x * info.emission_scale * segLen * alpha);
+    color.a = min(color.a + alpha * (1.0 - transmittance), 1.0);
+    alpha *= transmittance;
 }
 
 // Apply gravitational redshift to background star color
@@ -604,8 +1187,119 @@ float3 applyBackgroundRedshift(float3 color, float3 pos) {
     return color * float3(1.0, factor, factor * factor);
 }
 
+//==============================================================================
+// RENDER TIERS
+//==============================================================================
+
+/**
+ * Preview Leg
+ * 
+ * Shades one straight leg a → b of a preview ray. Only the part inside the
+ * slab |y| <= halfHeight can hold disk or emitter emission, so only that
+ * part is sampled, at the normal step spacing.
+ * 
+ * @param distance Path length from the camera to a (for the pixel footprint)
+ */
+void previewLeg(float3 a, float3 b, float distance, float halfHeight, RayDifferential rd, float time, constant Uniforms& uniforms, texture2d<float, access::sample> diskColorMap, constant SpectralBasis& spectral, EmitterScene emitters, thread float4& color, thread float& alpha) {
+    float3 d = b - a;
+    float t0 = 0.0;
+    float t1 = 1.0;
+    if (abs(d.y) > 1e-6) {
+        float ta = (halfHeight - a.y) / d.y;
+        float tb = (-halfHeight - a.y) / d.y;
+        t0 = max(t0, min(ta, tb));
+        t1 = min(t1, max(ta, tb));
+    } else if (abs(a.y) > halfHeight) {
+        return;
+    }
+    if (t0 >= t1) {
+        return;
+    }
+    
+    float legLength = length(d);
+    float3 dir = d / legLength;
+    float span = legLength * (t1 - t0);
+    int samples = clamp(int(ceil(span / uniforms.step_size)), 1, uniforms.max_iterations);
+    float spread = max(length(rd.dDdx), length(rd.dDdy));
+    bool testEmitters = emitters.grid->emitter_count > 0;
+    float3 prev = a + d * t0;
+    for (int i = 1; i <= samples; ++i) {
+        float t = t0 + (t1 - t0) * float(i) / float(samples);
+        float3 p = a + d * t;
+        float footprint = spread * (distance + legLength * t);
+        if (testEmitters) {
+            emitterRender(prev, p, footprint, color, alpha, uniforms, emitters, spectral);
+        }
+        diskRender(prev, p, color, alpha, dir, footprint, time, uniforms, diskColorMap, spectral);
+        if (alpha < 0.01) {
+            return;
+        }
+        prev = p;
+    }
+}
+
+/**
+ * Weak-Field Preview
+ * 
+ * Preview tier, no geodesic integration: the ray runs straight to its
+ * closest approach, turns once by the weak-field deflection
+ * α = 2·Rs/b + (15π/16)·(Rs/b)² and runs straight on. Rays with impact
+ * parameter b below b_c = 3√3/2·Rs are captured. Close to b_c the bend is
+ * underestimated and higher-order images are missing; the tier error map
+ * shows where.
+ * 
+ * On return pos and dir describe the escaping ray for the sky lookup.
+ * 
+ * @return false if the ray is captured
+ */
+bool previewMarch(thread float3& pos, thread float3& dir, RayDifferential rd, float time, constant Uniforms& uniforms, texture2d<float, access::sample> diskColorMap, constant SpectralBasis& spectral, EmitterScene emitters, thread float4& color, thread float& alpha) {
+    // geodesicAcceleration() scales the Schwarzschild term by gravity; horizon at r = 1
+    float rs = uniforms.gravity;
+    float criticalImpact = max(2.598076 * rs, 1.0);
+    float escapeRadius = 100.0;
+    
+    // Emitters orbit close to the disk plane; the slab must hold them too
+    float halfHeight = max(uniforms.disk_thickness, 0.01);
+    if (emitters.grid->emitter_count > 0) {
+        halfHeight = max(halfHeight, 0.25);
+    }
+    
+    float tClosest = -dot(pos, dir);
+    float impact = length(cross(pos, dir));
+    
+    // Moving away from the hole: a single straight leg
+    if (tClosest <= 0.0) {
+        float3 end = pos + dir * escapeRadius;
+        previewLeg(pos, end, 0.0, halfHeight, rd, time, uniforms, diskColorMap, spectral, emitters, color, alpha);
+        pos = end;
+        return true;
+    }
+    
+    // Captured: shade up to the capture sphere only
+    if (impact < criticalImpact) {
+        float tEnter = tClosest - sqrt(criticalImpact * criticalImpact - impact * impact);
+        previewLeg(pos, pos + dir * max(tEnter, 0.0), 0.0, halfHeight, rd, time, uniforms, diskColorMap, spectral, emitters, color, alpha);
+        return false;
+    }
+    
+    float3 closest = pos + dir * tClosest;
+    previewLeg(pos, closest, 0.0, halfHeight, rd, time, uniforms, diskColorMap, spectral, emitters, color, alpha);
+    
+    float u = rs / impact;
+    float deflection = 2.0 * u + (15.0 * M_PI_F / 16.0) * u * u;
+    float3 inward = -closest / max(length(closest), 1e-6);
+    float3 bent = normalize(dir * cos(deflection) + inward * sin(deflection));
+    float3 end = closest + bent * escapeRadius;
+    if (alpha >= 0.01) {
+        previewLeg(closest, end, tClosest, halfHeight, rd, time, uniforms, diskColorMap, spectral, emitters, color, alpha);
+    }
+    pos = end;
+    dir = bent;
+    return true;
+}
+
 // Complete ray marching with adaptive performance optimization
-float4 rayMarch(float3 pos, float3 dir, float time, constant Uniforms& uniforms, texture2d<float, access::sample> diskColorMap) {
+float4 rayMarch(float3 pos, float3 dir, RayDifferential rd, float time, constant Uniforms& uniforms, texture2d<float, access::sample> diskColorMap, constant SpectralBasis& spectral, EmitterScene emitters, SkyCatalog sky, VolumeScene volume, texture3d<float, access::sample> particleGrid, constant ParticleGridInfo& particleInfo, int tier) {
     float4 color = float4(0.0);
     float alpha = 1.0;
 
@@ -616,6 +1310,16 @@ float4 rayMarch(float3 pos, float3 dir, float time, constant Uniforms& uniforms,
     // Use performance parameters for adaptive quality
     int maxSteps = uniforms.max_iterations;
     float stepSize = uniforms.step_size;
+    bool testEmitters = emitters.grid->emitter_count > 0;
+    bool volumeBound = volume.info->dims.w != 0;
+    
+    // Preview covers the disk and emitters; volumes and particles need the march
+    if (tier == RENDER_TIER_PREVIEW && !volumeBound && !particleInfo.enabled) {
+        if (!previewMarch(pos, dir, rd, time, uniforms, diskColorMap, spectral, emitters, color, alpha)) {
+            return color;
+        }
+        maxSteps = 0;
+    }
 
     for (int i = 0; i < maxSteps; ++i) {
         // Adaptive step size based on curvature (optional performance feature)
@@ -628,16 +1332,44 @@ float4 rayMarch(float3 pos, float3 dir, float time, constant Uniforms& uniforms,
             }
         }
         
-        // Use RK4 integration for maximum accuracy
-        rk4(pos, h2, dir, currentStepSize, uniforms.gravity);
+        // Integrator fixed per pipeline (integration_method)
+        float3 prevPos = pos;
+        if (tier == RENDER_TIER_REFERENCE) {
+            // Reference: substeps no longer than 2% of the radius, shaded
+            // at the same points as Standard so only the geodesic differs
+            int substeps = clamp(int(ceil(currentStepSize / (0.02 * length(pos)))), 1, 32);
+            float dt = currentStepSize / float(substeps);
+            for (int sub = 0; sub < substeps; ++sub) {
+                float3 subPos = pos;
+                integrateGeodesic(pos, dir, h2, dt, uniforms.gravity);
+                propagateDifferential(rd, 0.5 * (subPos + pos), h2, dt, uniforms.gravity);
+            }
+        } else {
+            integrateGeodesic(pos, dir, h2, currentStepSize, uniforms.gravity);
+            propagateDifferential(rd, 0.5 * (prevPos + pos), h2, currentStepSize, uniforms.gravity);
+        }
 
         // Check if ray hit event horizon (early termination)
         if (dot(pos, pos) < 1.0) {
             return color;  // Return accumulated color at event horizon
         }
 
-        // Render accretion disk with full physics
-        diskRender(pos, color, alpha, dir, time, uniforms, diskColorMap);
+        float footprint = rayFootprint(rd);
+
+        // Orbiting emitters along this segment of the curved path
+        if (testEmitters) {
+            emitterRender(prevPos, pos, footprint, color, alpha, uniforms, emitters, spectral);
+        }
+
+        // Render the streamed volume if one is bound, else the particle grid
+        // or the procedural disk
+        if (volumeBound) {
+            volumeRender(prevPos, pos, dir, color, alpha, uniforms, volume, spectral);
+        } else if (particleInfo.enabled) {
+            particleRender(prevPos, pos, dir, color, alpha, uniforms, particleGrid, particleInfo, spectral);
+        } else {
+            diskRender(prevPos, pos, color, alpha, dir, footprint, time, uniforms, diskColorMap, spectral);
+        }
         
         // Early exit if pixel is opaque enough (performance optimization)
         if (alpha < 0.01) {
@@ -649,6 +1381,11 @@ float4 rayMarch(float3 pos, float3 dir, float time, constant Uniforms& uniforms,
             break;
         }
     }
+    
+    // Light curves measure the source alone
+    if (sky.weight <= 0.0) {
+        return color;
+    }
 
     // Add animated background starfield
     float3 skyColor = float3(0.005, 0.01, 0.02);
@@ -666,17 +1403,28 @@ float4 rayMarch(float3 pos, float3 dir, float time, constant Uniforms& uniforms,
     // Drift starfield with subtle parallax
     float3 driftedDir = animatedDir + float3(time * 0.005, time * 0.003, 0.0);
     
-    // Add procedural stars with motion
-    float starNoise = snoise(driftedDir * 50.0);
-    if (starNoise > 0.8) {
-        float3 starColor = float3(0.8, 0.9, 1.0) * (starNoise - 0.8) * 5.0;
-        
-        // Apply redshift to background stars based on ray path
+    if (sky.info->star_count > 0) {
+        // Catalog stars, rotated with the sky, lensed through the ray differential
+        float3 dDdx = float3(rd.dDdx.x * cosR - rd.dDdx.z * sinR, rd.dDdx.y, rd.dDdx.x * sinR + rd.dDdx.z * cosR);
+        float3 dDdy = float3(rd.dDdy.x * cosR - rd.dDdy.z * sinR, rd.dDdy.y, rd.dDdy.x * sinR + rd.dDdy.z * cosR);
+        float3 starColor = catalogStars(animatedDir, dDdx, dDdy, sky);
         if (length(pos) < 20.0) {
             starColor = applyBackgroundRedshift(starColor, pos);
         }
-        
         skyColor += starColor;
+    } else {
+        // Add procedural stars with motion
+        float starNoise = snoise(driftedDir * 50.0);
+        if (starNoise > 0.8) {
+            float3 starColor = float3(0.8, 0.9, 1.0) * (starNoise - 0.8) * 5.0;
+            
+            // Apply redshift to background stars based on ray path
+            if (length(pos) < 20.0) {
+                starColor = applyBackgroundRedshift(starColor, pos);
+            }
+            
+            skyColor += starColor;
+        }
     }
     
     // Add subtle animated color variation to space
@@ -688,24 +1436,23 @@ float4 rayMarch(float3 pos, float3 dir, float time, constant Uniforms& uniforms,
     return color;
 }
 
-// Main compute kernel - exact coordinate system from repository
-kernel void computeShader(texture2d<float, access::write> output [[texture(0)]],
-                         texture2d<float, access::sample> diskColorMap [[texture(1)]],
-                         constant Uniforms& uniforms [[buffer(0)]],
-                         uint2 gid [[thread_position_in_grid]]) {
-    
-    if (gid.x >= uint(uniforms.resolution.x) || gid.y >= uint(uniforms.resolution.y)) {
-        return;
-    }
-    
+/**
+ * Primary Ray
+ * 
+ * Camera ray through a pixel position and its initial ray differential.
+ * pixelSize is the sample footprint in pixels (below 1 for supersampling),
+ * so noise filtering and catalog magnification follow the sample density.
+ */
+void primaryRay(float2 pixel, float pixelSize, constant Uniforms& uniforms,
+                thread float3& cameraPos, thread float3& dir, thread RayDifferential& rd) {
     // EXACT coordinate transformation from repository - this is critical!
-    float2 uv = (2.0 * float2(gid) - uniforms.resolution.xy) / uniforms.resolution.y;
+    float2 uv = (2.0 * pixel - uniforms.resolution.xy) / uniforms.resolution.y;
     
     // Camera setup: use observer position if set, otherwise use camera_distance
     bool useObserverPos = (length(uniforms.observer_position) > 0.1);
-    float3 cameraPos = useObserverPos ? 
-                       uniforms.observer_position : 
-                       float3(0.0, 0.0, uniforms.camera_distance);
+    cameraPos = useObserverPos ? 
+                uniforms.observer_position : 
+                float3(0.0, 0.0, uniforms.camera_distance);
     float3 target = float3(0.0, 0.0, 0.0);
     float3 up = float3(0.0, 1.0, 0.0);
     
@@ -715,23 +1462,238 @@ kernel void computeShader(texture2d<float, access::write> output [[texture(0)]],
     float3 trueUp = cross(forward, right);
     
     // Ray direction through pixel
-    float3 dir = normalize(uv.x * right + uv.y * trueUp + forward);
+    float3 rawDir = uv.x * right + uv.y * trueUp + forward;
+    float invLen = 1.0 / length(rawDir);
+    dir = rawDir * invLen;
+    
+    // Initial ray differential: all rays start at the camera, and one pixel
+    // moves uv by 2/height. Differentiate the normalized direction.
+    float pixelScale = 2.0 * pixelSize / uniforms.resolution.y;
+    rd.dPdx = float3(0.0);
+    rd.dPdy = float3(0.0);
+    rd.dDdx = (right - dir * dot(dir, right)) * (pixelScale * invLen);
+    rd.dDdy = (trueUp - dir * dot(dir, trueUp)) * (pixelScale * invLen);
+}
+
+/**
+ * Critical Curve Band
+ * 
+ * The n ≥ 1 photon subrings lie in a thin annulus just outside the critical
+ * impact parameter b_c = 3√3/2·Rs. The impact parameter b = |pos × dir| of
+ * a camera ray is conserved along the geodesic, so the critical curve on
+ * screen is where the primary ray has b = b_c. The band is at least a few
+ * pixels wide, so the curve is covered at any zoom.
+ */
+bool inCriticalBand(float3 cameraPos, float3 dir, RayDifferential rd, constant Uniforms& uniforms) {
+    if (uniforms.critical_samples <= 1 || uniforms.render_tier == RENDER_TIER_PREVIEW) {
+        return false;
+    }
+    float criticalImpact = 2.598076 * uniforms.gravity;
+    float impact = length(cross(cameraPos, dir));
+    float pixelImpact = max(length(cross(cameraPos, rd.dDdx)), length(cross(cameraPos, rd.dDdy)));
+    float halfWidth = max(uniforms.critical_band * criticalImpact, 2.0 * pixelImpact);
+    return abs(impact - criticalImpact) < halfWidth;
+}
+
+// Main compute kernel - exact coordinate system from repository
+kernel void computeShader(texture2d<float, access::write> output [[texture(0)]],
+                         texture2d<float, access::sample> diskColorMap [[texture(1)]],
+                         constant Uniforms& uniforms [[buffer(0)]],
+                         constant SpectralBasis& spectral [[buffer(1)]],
+                         constant EmitterGrid& emitterGrid [[buffer(2)]],
+                         const device uint2* emitterCells [[buffer(3)]],
+                         const device uint* emitterRefs [[buffer(4)]],
+                         const device Emitter* emitterList [[buffer(5)]],
+                         constant StarCatalogInfo& starInfo [[buffer(6)]],
+                         const device uint* starCells [[buffer(7)]],
+                         const device CatalogStar* catalogStarList [[buffer(8)]],
+                         texture3d<float, access::sample> volumeAtlas [[texture(2)]],
+                         texture3d<float, access::sample> volumeCoarse [[texture(3)]],
+                         constant VolumeInfo& volumeInfo [[buffer(9)]],
+                         const device uint* volumePages [[buffer(10)]],
+                         device atomic_uint* volumeFeedback [[buffer(11)]],
+                         texture3d<float, access::sample> particleGrid [[texture(4)]],
+                         constant ParticleGridInfo& particleInfo [[buffer(12)]],
+                         uint2 gid [[thread_position_in_grid]]) {
+    
+    if (gid.x >= uint(uniforms.resolution.x) || gid.y >= uint(uniforms.resolution.y)) {
+        return;
+    }
+    
+    float3 cameraPos;
+    float3 dir;
+    RayDifferential rd;
+    primaryRay(float2(gid), 1.0, uniforms, cameraPos, dir, rd);
     
     // Apply observer velocity for motion-based doppler (future enhancement)
     // This would shift colors based on observer_velocity
     
-    float4 fragColor = rayMarch(cameraPos, dir, uniforms.time, uniforms, diskColorMap);
+    // Orbiting star and hot spots are traced along the geodesic (see emitterRender)
+    EmitterScene emitters = { &emitterGrid, emitterCells, emitterRefs, emitterList };
     
-    // Render orbiting star on top if enabled
-    if (uniforms.show_orbiting_star) {
-        float4 starColor = renderOrbitingStar(cameraPos, dir, uniforms.time, 
-                                              uniforms.star_orbit_radius, 
-                                              uniforms.star_orbit_speed, 
-                                              uniforms.star_brightness);
-        // Blend star over scene
-        fragColor.rgb = fragColor.rgb * (1.0 - starColor.a) + starColor.rgb * starColor.a;
-        fragColor.a = max(fragColor.a, starColor.a);
+    // Catalog magnification is relative to this pixel's unlensed solid angle
+    SkyCatalog sky = { &starInfo, starCells, catalogStarList, length(cross(rd.dDdx, rd.dDdy)), 1.0 };
+    
+    // Streamed volume (replaces the procedural disk when bound)
+    VolumeScene volume = { &volumeInfo, volumeAtlas, volumeCoarse, volumePages, volumeFeedback };
+    
+    float4 fragColor;
+    if (inCriticalBand(cameraPos, dir, rd, uniforms)) {
+        // Photon rings: n × n stratified rays with Reference integration
+        int n = min(uniforms.critical_samples, 4);
+        float subPixel = 1.0 / float(n);
+        fragColor = float4(0.0);
+        for (int y = 0; y < n; ++y) {
+            for (int x = 0; x < n; ++x) {
+                float2 offset = (float2(x, y) + 0.5) * subPixel - 0.5;
+                float3 sampleDir;
+                RayDifferential sampleRd;
+                primaryRay(float2(gid) + offset, subPixel, uniforms, cameraPos, sampleDir, sampleRd);
+                sky.pixel_solid_angle = length(cross(sampleRd.dDdx, sampleRd.dDdy));
+                fragColor += rayMarch(cameraPos, sampleDir, sampleRd, uniforms.time, uniforms, diskColorMap, spectral, emitters, sky, volume, particleGrid, particleInfo, RENDER_TIER_REFERENCE);
+            }
+        }
+        fragColor *= subPixel * subPixel;
+    } else {
+        fragColor = rayMarch(cameraPos, dir, rd, uniforms.time, uniforms, diskColorMap, spectral, emitters, sky, volume, particleGrid, particleInfo, uniforms.render_tier);
     }
     
     output.write(fragColor, gid);
-}
\ No newline at end of file
+}
+/**
+ * Tier Error Map
+ * 
+ * Traces each pixel at the current tier and at Reference and writes the
+ * relative difference |current - reference| / (luminance(reference) + 0.05)
+ * as a heat map: black none, red 33%, yellow 67%, white 100% and above.
+ * errorSum[0] accumulates the clamped error in 1/256 steps, errorSum[1]
+ * counts pixels above 10%.
+ */
+kernel void tierErrorShader(texture2d<float, access::write> output [[texture(0)]],
+                            texture2d<float, access::sample> diskColorMap [[texture(1)]],
+                            constant Uniforms& uniforms [[buffer(0)]],
+                            constant SpectralBasis& spectral [[buffer(1)]],
+                            constant EmitterGrid& emitterGrid [[buffer(2)]],
+                            const device uint2* emitterCells [[buffer(3)]],
+                            const device uint* emitterRefs [[buffer(4)]],
+                            const device Emitter* emitterList [[buffer(5)]],
+                            constant StarCatalogInfo& starInfo [[buffer(6)]],
+                            const device uint* starCells [[buffer(7)]],
+                            const device CatalogStar* catalogStarList [[buffer(8)]],
+                            texture3d<float, access::sample> volumeAtlas [[texture(2)]],
+                            texture3d<float, access::sample> volumeCoarse [[texture(3)]],
+                            constant VolumeInfo& volumeInfo [[buffer(9)]],
+                            const device uint* volumePages [[buffer(10)]],
+                            device atomic_uint* volumeFeedback [[buffer(11)]],
+                            texture3d<float, access::sample> particleGrid [[texture(4)]],
+                            constant ParticleGridInfo& particleInfo [[buffer(12)]],
+                            device atomic_uint* errorSum [[buffer(13)]],
+                            uint2 gid [[thread_position_in_grid]]) {
+    
+    if (gid.x >= uint(uniforms.resolution.x) || gid.y >= uint(uniforms.resolution.y)) {
+        return;
+    }
+    
+    float3 cameraPos;
+    float3 dir;
+    RayDifferential rd;
+    primaryRay(float2(gid), 1.0, uniforms, cameraPos, dir, rd);
+    
+    EmitterScene emitters = { &emitterGrid, emitterCells, emitterRefs, emitterList };
+    SkyCatalog sky = { &starInfo, starCells, catalogStarList, length(cross(rd.dDdx, rd.dDdy)), 1.0 };
+    VolumeScene volume = { &volumeInfo, volumeAtlas, volumeCoarse, volumePages, volumeFeedback };
+    
+    float3 current = rayMarch(cameraPos, dir, rd, uniforms.time, uniforms, diskColorMap, spectral, emitters, sky, volume, particleGrid, particleInfo, uniforms.render_tier).rgb;
+    float3 reference = rayMarch(cameraPos, dir, rd, uniforms.time, uniforms, diskColorMap, spectral, emitters, sky, volume, particleGrid, particleInfo, RENDER_TIER_REFERENCE).rgb;
+    
+    float referenceLuminance = dot(reference, float3(0.2126, 0.7152, 0.0722));
+    float error = length(current - reference) / (referenceLuminance + 0.05);
+    float t = clamp(error, 0.0, 1.0);
+    float3 heat = clamp(float3(3.0 * t, 3.0 * t - 1.0, 3.0 * t - 2.0), 0.0, 1.0);
+    output.write(float4(heat, 1.0), gid);
+    
+    atomic_fetch_add_explicit(&errorSum[0], uint(t * 256.0), memory_order_relaxed);
+    if (error > 0.1) {
+        atomic_fetch_add_explicit(&errorSum[1], 1u, memory_order_relaxed);
+    }
+}
+
+//==============================================================================
+// LIGHT CURVES
+//==============================================================================
+
+// Mirrors LightCurveTile in ShaderTypes.h (planned by LightCurve.cpp)
+#define LIGHT_CURVE_TILE 8
+
+struct LightCurveTile {
+    float2 origin;
+    float step;
+    uint tile;
+};
+
+/**
+ * Light Curve Kernel
+ * 
+ * Flux-only scene pass: one threadgroup per tile, one sample per thread,
+ * reduced in threadgroup memory to Σ (R, G, B, luminance)·dΩ. Nothing is
+ * written per pixel. The solid angle comes from the ray differential, so
+ * refined tiles (smaller step) sum to the same flux at a finer sampling.
+ * Samples past the base image edge contribute nothing.
+ */
+kernel void lightCurveShader(texture2d<float, access::sample> diskColorMap [[texture(1)]],
+                             constant Uniforms& uniforms [[buffer(0)]],
+                             constant SpectralBasis& spectral [[buffer(1)]],
+                             constant EmitterGrid& emitterGrid [[buffer(2)]],
+                             const device uint2* emitterCells [[buffer(3)]],
+                             const device uint* emitterRefs [[buffer(4)]],
+                             const device Emitter* emitterList [[buffer(5)]],
+                             constant StarCatalogInfo& starInfo [[buffer(6)]],
+                             const device uint* starCells [[buffer(7)]],
+                             const device CatalogStar* catalogStarList [[buffer(8)]],
+                             texture3d<float, access::sample> volumeAtlas [[texture(2)]],
+                             texture3d<float, access::sample> volumeCoarse [[texture(3)]],
+                             constant VolumeInfo& volumeInfo [[buffer(9)]],
+                             const device uint* volumePages [[buffer(10)]],
+                             device atomic_uint* volumeFeedback [[buffer(11)]],
+                             texture3d<float, access::sample> particleGrid [[texture(4)]],
+                             constant ParticleGridInfo& particleInfo [[buffer(12)]],
+                             constant LightCurveTile* tiles [[buffer(13)]],
+                             device float4* tileFlux [[buffer(14)]],
+                             constant float& skyWeight [[buffer(15)]],
+                             uint group [[threadgroup_position_in_grid]],
+                             uint2 lid [[thread_position_in_threadgroup]],
+                             uint index [[thread_index_in_threadgroup]]) {
+    threadgroup float4 partial[LIGHT_CURVE_TILE * LIGHT_CURVE_TILE];
+    
+    LightCurveTile tile = tiles[group];
+    float2 pixel = tile.origin + (float2(lid) + 0.5) * tile.step;
+    
+    float4 value = float4(0.0);
+    if (pixel.x < uniforms.resolution.x && pixel.y < uniforms.resolution.y) {
+        float3 cameraPos;
+        float3 dir;
+        RayDifferential rd;
+        primaryRay(pixel, tile.step, uniforms, cameraPos, dir, rd);
+        float solidAngle = length(cross(rd.dDdx, rd.dDdy));
+        
+        EmitterScene emitters = { &emitterGrid, emitterCells, emitterRefs, emitterList };
+        SkyCatalog sky = { &starInfo, starCells, catalogStarList, solidAngle, skyWeight };
+        VolumeScene volume = { &volumeInfo, volumeAtlas, volumeCoarse, volumePages, volumeFeedback };
+        
+        float3 rgb = rayMarch(cameraPos, dir, rd, uniforms.time, uniforms, diskColorMap, spectral, emitters, sky, volume, particleGrid, particleInfo, uniforms.render_tier).rgb;
+        float luminance = dot(rgb, float3(0.2126, 0.7152, 0.0722));
+        value = float4(rgb, luminance) * solidAngle;
+    }
+    
+    // Tree reduction over the tile
+    partial[index] = value;
+    for (uint stride = LIGHT_CURVE_TILE * LIGHT_CURVE_TILE / 2; stride > 0; stride >>= 1) {
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+        if (index < stride) {
+            partial[index] += partial[index + stride];
+        }
+    }
+    if (index == 0) {
+        tileFlux[group] = partial[0];
+    }
+}
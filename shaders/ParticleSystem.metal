@@ -45,6 +45,8 @@ using namespace metal;
 
 // Import shared data structures
 #include "../src/ShaderTypes.h"
+#include "../src/Philox.h"
+#include "Noise.h"
 
 // Constants for particle physics
 constant float SCHWARZSCHILD_RADIUS = 1.0;     // Black hole radius in units
@@ -62,17 +64,13 @@ constant float PARTICLE_MASS_DEBRIS = 5.0;     // Relative mass for debris parti
 
 /**
  * Random number generation for particle initialization and turbulence
+ * 
+ * Philox draws keyed by (particle_seed, stream) with counter (slot, step,
+ * draw): the same seed replays the same simulation regardless of frame
+ * rate, dispatch order or GPU, and the CPU can reproduce any value.
  */
-float rand(uint2 coord, float seed) {
-    return fract(sin(dot(float2(coord), float2(12.9898, 78.233)) + seed) * 43758.5453);
-}
-
-float3 rand3(uint3 coord, float seed) {
-    return float3(
-        rand(coord.xy, seed),
-        rand(coord.yz, seed + 1.0),
-        rand(coord.xz, seed + 2.0)
-    );
+float4 particleRandom(constant Uniforms& uniforms, uint stream, uint index, uint draw) {
+    return philoxUniform4(philoxDraw(uniforms.particle_seed, stream, index, uniforms.particle_step, draw));
 }
 
 /**
@@ -123,7 +121,7 @@ float3 temperatureToColor(float temperature) {
 /**
  * Calculate Keplerian orbital velocity at given radius
  */
-float3 calculateKeplerianVelocity(float3 position, float blackHoleMass) {
+float3 calculateKeplerianVelocity(float3 position, float blackHoleMass, float jitter) {
     float r = length(position);
     if (r < SCHWARZSCHILD_RADIUS * 1.1) {
         return float3(0.0); // Too close to event horizon
@@ -137,7 +135,7 @@ float3 calculateKeplerianVelocity(float3 position, float blackHoleMass) {
     float3 tangentialDir = normalize(cross(radialDir, float3(0.0, 1.0, 0.0)));
     
     // Add small random perturbation for realistic orbits
-    float perturbation = 0.05 * (rand(uint2(position.x * 1000, position.z * 1000), 0.0) - 0.5);
+    float perturbation = 0.05 * (jitter - 0.5);
     speed *= (1.0 + perturbation);
     
     return tangentialDir * speed;
@@ -195,7 +193,7 @@ kernel void updateParticles(
     device Particle& particle = particles[index];
     if (!particle.is_active) return;
     
-    float deltaTime = 1.0 / 60.0; // Assume 60 FPS for now
+    float deltaTime = 1.0 / 60.0; // Fixed step; simulation time is particle_step * deltaTime
     float3 position = particle.position;
     float3 velocity = particle.velocity;
     float mass = particle.mass;
@@ -211,10 +209,23 @@ kernel void updateParticles(
     float3 gravitationalForce = calculateGravitationalForce(position, mass, uniforms.gravity);
     float3 magneticForce = calculateMagneticForce(position, velocity, 1.0, uniforms);
     
-    // Add turbulence for realistic motion
+    // Add turbulence for realistic motion: curl of two simplex noise fields
+    // (cross(grad n1, grad n2) is divergence-free), so neighbouring particles
+    // swirl coherently instead of receiving uncorrelated kicks. The field
+    // evolves with the step count, not wall time, so runs are reproducible
     float r = length(position);
     float turbulenceStrength = uniforms.particle_turbulence * exp(-r / uniforms.disk_radius);
-    float3 turbulence = turbulenceStrength * (rand3(uint3(position * 1000.0), uniforms.time) - 0.5);
+    float simTime = float(uniforms.particle_step) * deltaTime;
+    float3 noisePos = position * 0.75 + float3(0.0, simTime * 0.2, 0.0);
+    float3 gradA;
+    float3 gradB;
+    snoiseGrad(noisePos, gradA);
+    snoiseGrad(noisePos + float3(31.416, 47.853, 12.793), gradB);
+    float3 turbulence = turbulenceStrength * 0.5 * cross(gradA, gradB);
+    
+    // Small-scale eddies below the noise resolution: a zero-mean random kick
+    float3 kick = particleRandom(uniforms, PHILOX_STREAM_TURBULENCE, index, 0).xyz - 0.5;
+    turbulence += turbulenceStrength * 0.2 * kick;
     
     // Combine forces
     particle.acceleration = (gravitationalForce + magneticForce + turbulence) / mass;
@@ -237,6 +248,8 @@ kernel void updateParticles(
     // Update particle properties
     particle.position = newPosition;
     particle.velocity = newVelocity;
+    particle.angular_momentum = cross(newVelocity, newPosition).y;
+    particle.radial_velocity = dot(newVelocity.xz, newPosition.xz) / max(length(newPosition.xz), 1e-4);
     
     // Update temperature based on orbital dynamics
     float kineticEnergy = 0.5 * mass * dot(newVelocity, newVelocity);
@@ -280,14 +293,15 @@ kernel void spawnParticles(
     if (particle.is_active) return;
     
     // Random spawn probability based on emission rate
+    float4 draw0 = particleRandom(uniforms, PHILOX_STREAM_SPAWN, index, 0);
     float spawnProbability = uniforms.particle_emission_rate / 60.0; // Convert to per-frame probability
-    if (rand(uint2(index, uniforms.time * 1000), 0.0) > spawnProbability) return;
+    if (draw0.x > spawnProbability) return;
+    float4 draw1 = particleRandom(uniforms, PHILOX_STREAM_SPAWN, index, 1);
     
     // Generate spawn position in annular region
-    float spawnRadius = mix(uniforms.spawning_radius_min, uniforms.spawning_radius_max, 
-                           rand(uint2(index * 2, uniforms.time * 1000), 1.0));
-    float spawnAngle = rand(uint2(index * 3, uniforms.time * 1000), 2.0) * 2.0 * M_PI_F;
-    float spawnHeight = (rand(uint2(index * 4, uniforms.time * 1000), 3.0) - 0.5) * uniforms.disk_thickness;
+    float spawnRadius = mix(uniforms.spawning_radius_min, uniforms.spawning_radius_max, draw0.y);
+    float spawnAngle = draw0.z * 2.0 * M_PI_F;
+    float spawnHeight = (draw0.w - 0.5) * uniforms.disk_thickness;
     
     particle.position = float3(
         spawnRadius * cos(spawnAngle),
@@ -296,19 +310,20 @@ kernel void spawnParticles(
     );
     
     // Set initial Keplerian velocity
-    particle.velocity = calculateKeplerianVelocity(particle.position, uniforms.gravity);
+    particle.velocity = calculateKeplerianVelocity(particle.position, uniforms.gravity, draw1.w);
     
     // Add small random velocity component
-    float3 randomVel = 0.1 * (rand3(uint3(index, uniforms.time * 1000, 0), 4.0) - 0.5);
+    float3 randomVel = 0.1 * (draw1.xyz - 0.5);
     particle.velocity += randomVel;
     
     // Initialize other properties
     particle.acceleration = float3(0.0);
     particle.age = 0.0;
-    particle.lifetime = uniforms.particle_lifetime * (0.5 + rand(uint2(index * 5, uniforms.time * 1000), 5.0));
+    float4 draw2 = particleRandom(uniforms, PHILOX_STREAM_SPAWN, index, 2);
+    particle.lifetime = uniforms.particle_lifetime * (0.5 + draw2.x);
     
     // Random material type
-    float materialRand = rand(uint2(index * 6, uniforms.time * 1000), 6.0);
+    float materialRand = draw2.y;
     if (materialRand < 0.6) {
         particle.material_type = 0; // gas (most common)
         particle.mass = PARTICLE_MASS_GAS;
@@ -329,8 +344,8 @@ kernel void spawnParticles(
     particle.luminosity = particle.temperature / 20000.0;
     particle.size = uniforms.particle_size;
     
-    particle.angular_momentum = length(cross(particle.position, particle.velocity));
-    particle.radial_velocity = dot(particle.velocity, normalize(particle.position));
+    particle.angular_momentum = cross(particle.velocity, particle.position).y;
+    particle.radial_velocity = dot(particle.velocity.xz, particle.position.xz) / max(length(particle.position.xz), 1e-4);
     particle.magnetic_field = float3(0.0);
     
     particle.is_active = true;
@@ -364,9 +379,19 @@ kernel void processParticleCollisions(
         float distance = length(separation);
         float minDistance = (particle1.size + particle2.size) * 1.5;
         
-        if (distance < minDistance && distance > 0.0) {
-            // Collision detected - exchange momentum and energy
-            float3 normal = separation / distance;
+        if (distance < minDistance) {
+            // Collision detected - exchange momentum and energy. Coincident
+            // particles get a random normal (keyed by the pair) instead of
+            // being skipped, so they separate on the next step
+            float3 normal;
+            if (distance > 1e-6) {
+                normal = separation / distance;
+            } else {
+                float4 u = particleRandom(uniforms, PHILOX_STREAM_COLLISION, index, i);
+                float z = 2.0 * u.x - 1.0;
+                float phi = 2.0 * M_PI_F * u.y;
+                normal = float3(sqrt(max(0.0, 1.0 - z * z)) * float2(cos(phi), sin(phi)), z);
+            }
             
             // Conservation of momentum (simplified elastic collision)
             float totalMass = particle1.mass + particle2.mass;
@@ -394,6 +419,162 @@ kernel void processParticleCollisions(
     }
 }
 
+/**
+ * Particle Grid Deposition
+ * 
+ * Scatters each live particle's luminosity into the cylindrical emission
+ * grid with cloud-in-cell weights (8 cells, azimuth wrapping). Threadgroups
+ * add into private copies of the grid (see ShaderTypes.h), using 24.8
+ * fixed point so the result does not depend on scheduling.
+ * 
+ * Grid layout: [copy][cell][emission, emission × temperature in kK] with
+ * cell = (z * R + r) * PHI + phi.
+ */
+kernel void depositParticles(
+    const device Particle* particles [[buffer(0)]],
+    device atomic_uint* grid [[buffer(1)]],
+    constant Uniforms& uniforms [[buffer(2)]],
+    constant ParticleGridInfo& info [[buffer(3)]],
+    uint index [[thread_position_in_grid]],
+    uint group [[threadgroup_position_in_grid]]
+) {
+    if (index >= uniforms.max_particles) return;
+    
+    const device Particle& particle = particles[index];
+    if (!particle.is_active || particle.luminosity <= 0.0) return;
+    
+    float3 position = particle.position;
+    float r = length(position.xz);
+    if (r <= info.inner_radius) return;
+    
+    // Continuous grid coordinates, shifted so integer values are cell centres
+    const int3 bins = int3(PARTICLE_GRID_PHI, PARTICLE_GRID_R, PARTICLE_GRID_Z);
+    float3 coord = float3(atan2(position.z, position.x) / (2.0 * M_PI_F) + 0.5,
+                          log(r / info.inner_radius) * info.inv_log_span,
+                          position.y / info.half_height * 0.5 + 0.5) * float3(bins) - 0.5;
+    int3 base = int3(floor(coord));
+    float3 frac = coord - float3(base);
+    
+    float weight = particle.luminosity * PARTICLE_GRID_FIXED_SCALE;
+    float temperatureKK = particle.temperature / 1000.0;
+    uint cellCount = uint(bins.x * bins.y * bins.z);
+    device atomic_uint* copy = grid + (group % PARTICLE_GRID_COPIES) * cellCount * 2;
+    
+    for (int corner = 0; corner < 8; ++corner) {
+        int3 offset = int3(corner & 1, (corner >> 1) & 1, corner >> 2);
+        int3 cell = base + offset;
+        if (cell.y < 0 || cell.y >= bins.y || cell.z < 0 || cell.z >= bins.z) {
+            continue;
+        }
+        cell.x = (cell.x + bins.x) % bins.x;
+        float3 w3 = select(1.0 - frac, frac, offset != 0);
+        float w = w3.x * w3.y * w3.z * weight;
+        uint amount = uint(w + 0.5);
+        if (amount == 0) {
+            continue;
+        }
+        uint slot = 2 * uint((cell.z * bins.y + cell.y) * bins.x + cell.x);
+        atomic_fetch_add_explicit(&copy[slot], amount, memory_order_relaxed);
+        atomic_fetch_add_explicit(&copy[slot + 1], uint(w * temperatureKK + 0.5), memory_order_relaxed);
+    }
+}
+
+/**
+ * Particle Grid Resolve
+ * 
+ * Sums the private copies of one cell, clears them for the next frame and
+ * writes (emissivity, temperature in kK). Emissivity is luminosity per unit
+ * volume; log-spaced radial bins grow as r², so without the division the
+ * outer disk would look denser than it is.
+ */
+kernel void resolveParticleGrid(
+    device uint* grid [[buffer(0)]],
+    constant ParticleGridInfo& info [[buffer(1)]],
+    texture3d<half, access::write> output [[texture(0)]],
+    uint3 gid [[thread_position_in_grid]]
+) {
+    const uint3 bins = uint3(PARTICLE_GRID_PHI, PARTICLE_GRID_R, PARTICLE_GRID_Z);
+    if (any(gid >= bins)) return;
+    
+    uint cellCount = bins.x * bins.y * bins.z;
+    uint slot = 2 * ((gid.z * bins.y + gid.y) * bins.x + gid.x);
+    float weight = 0.0;
+    float weightedTemperature = 0.0;
+    for (uint k = 0; k < PARTICLE_GRID_COPIES; ++k) {
+        uint i = k * cellCount * 2 + slot;
+        weight += float(grid[i]);
+        weightedTemperature += float(grid[i + 1]);
+        grid[i] = 0;
+        grid[i + 1] = 0;
+    }
+    
+    // Cell volume r·dr·dφ·dz, with dr = r·du·ln(outer / inner)
+    float du = 1.0 / (info.inv_log_span * float(bins.y));
+    float radius = info.inner_radius * exp((float(gid.y) + 0.5) * du);
+    float volume = radius * radius * du * (2.0 * M_PI_F / float(bins.x)) * (2.0 * info.half_height / float(bins.z));
+    float emissivity = weight / (PARTICLE_GRID_FIXED_SCALE * volume);
+    float temperature = weight > 0.0 ? weightedTemperature / weight : 0.0;
+    output.write(half4(half(min(emissivity, 60000.0)), half(temperature), 0.0h, 0.0h), gid);
+}
+
+/**
+ * Particle Statistics Reduction
+ * 
+ * Histograms live particles into radius × azimuth bins (see ShaderTypes.h):
+ * a threadgroup-private histogram first, then one device add per non-empty
+ * bin. Runs every few frames on demand; the output must start zeroed.
+ */
+kernel void reduceParticleStats(
+    const device Particle* particles [[buffer(0)]],
+    device atomic_int* stats [[buffer(1)]],
+    constant Uniforms& uniforms [[buffer(2)]],
+    constant ParticleGridInfo& info [[buffer(3)]],
+    uint index [[thread_position_in_grid]],
+    uint local [[thread_index_in_threadgroup]],
+    uint groupSize [[threads_per_threadgroup]]
+) {
+    const uint total = PARTICLE_STATS_CHANNELS * PARTICLE_STATS_BINS;
+    threadgroup atomic_int bins[PARTICLE_STATS_CHANNELS * PARTICLE_STATS_BINS];
+    for (uint i = local; i < total; i += groupSize) {
+        atomic_store_explicit(&bins[i], 0, memory_order_relaxed);
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+    
+    // No early returns: every thread must reach the barriers
+    if (index < uniforms.max_particles) {
+        const device Particle& particle = particles[index];
+        float r = length(particle.position.xz);
+        float u = log(max(r, 1e-6) / info.inner_radius) * info.inv_log_span;
+        if (particle.is_active && u >= 0.0 && u < 1.0) {
+            uint radial = min(uint(u * PARTICLE_STATS_R), uint(PARTICLE_STATS_R - 1));
+            float phi = atan2(particle.position.z, particle.position.x) / (2.0 * M_PI_F) + 0.5;
+            uint azimuth = min(uint(phi * PARTICLE_STATS_PHI), uint(PARTICLE_STATS_PHI - 1));
+            uint bin = radial * PARTICLE_STATS_PHI + azimuth;
+            
+            float values[PARTICLE_STATS_CHANNELS] = {
+                0.0,
+                particle.mass,
+                particle.temperature / 1000.0,
+                particle.angular_momentum,
+                particle.radial_velocity
+            };
+            atomic_fetch_add_explicit(&bins[PARTICLE_STATS_COUNT * PARTICLE_STATS_BINS + bin], 1, memory_order_relaxed);
+            for (uint c = 1; c < PARTICLE_STATS_CHANNELS; ++c) {
+                float v = clamp(values[c], -PARTICLE_STATS_LIMIT, PARTICLE_STATS_LIMIT);
+                atomic_fetch_add_explicit(&bins[c * PARTICLE_STATS_BINS + bin], int(rint(v * PARTICLE_STATS_SCALE)), memory_order_relaxed);
+            }
+        }
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+    
+    for (uint i = local; i < total; i += groupSize) {
+        int v = atomic_load_explicit(&bins[i], memory_order_relaxed);
+        if (v != 0) {
+            atomic_fetch_add_explicit(&stats[i], v, memory_order_relaxed);
+        }
+    }
+}
+
 /**
  * Particle Rendering Compute Shader
  * Renders particles to texture with trails, bloom, and realistic colors
@@ -0,0 +1,131 @@
+#include <metal_stdlib>
+using namespace metal;
+
+// Auto-exposure
+//
+// 1) luminance_histogram: log2-luminance histogram of the HDR image, sampled
+//    on a reduced grid. Each threadgroup accumulates into its own bins in
+//    threadgroup memory and merges them into the global histogram once, so
+//    device atomics scale with bins × threadgroups rather than pixels.
+// 2) exposure_adapt: a single threadgroup turns the histogram into a trimmed
+//    average luminance, adapts it over time and writes the exposure that
+//    tonemapping_kernel reads. It also clears the histogram for next frame.
+//
+// Exposure state (float4): x = adapted luminance, y = exposure multiplier,
+// z = this frame's average luminance, w = 1 once initialized.
+
+#define HISTOGRAM_BINS 256
+
+// Bin 0 collects black and anything below minLogLum; bins 1..255 cover
+// [minLogLum, minLogLum + logLumRange].
+static inline uint luminanceBin(float luminance, float minLogLum, float invLogLumRange) {
+    if (luminance < 1e-5) {
+        return 0;
+    }
+    float t = saturate((log2(luminance) - minLogLum) * invLogLumRange);
+    return uint(t * 254.0 + 1.0);
+}
+
+kernel void luminance_histogram(
+    texture2d<float, access::read> inputTexture [[texture(0)]],
+    device atomic_uint* histogram [[buffer(0)]],
+    constant float &minLogLum [[buffer(1)]],
+    constant float &invLogLumRange [[buffer(2)]],
+    constant uint &sampleStride [[buffer(3)]],
+    uint2 gid [[thread_position_in_grid]],
+    uint tid [[thread_index_in_threadgroup]],
+    uint2 tgSize [[threads_per_threadgroup]])
+{
+    threadgroup atomic_uint localBins[HISTOGRAM_BINS];
+    uint threads = tgSize.x * tgSize.y;
+    for (uint i = tid; i < HISTOGRAM_BINS; i += threads) {
+        atomic_store_explicit(&localBins[i], 0u, memory_order_relaxed);
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    // One sample per sampleStride×sampleStride block
+    uint2 pixel = gid * sampleStride + sampleStride / 2;
+    if (pixel.x < inputTexture.get_width() && pixel.y < inputTexture.get_height()) {
+        float3 color = inputTexture.read(pixel).rgb;
+        float luminance = dot(color, float3(0.2125, 0.7154, 0.0721));
+        uint bin = luminanceBin(luminance, minLogLum, invLogLumRange);
+        atomic_fetch_add_explicit(&localBins[bin], 1u, memory_order_relaxed);
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    for (uint i = tid; i < HISTOGRAM_BINS; i += threads) {
+        uint count = atomic_load_explicit(&localBins[i], memory_order_relaxed);
+        if (count > 0) {
+            atomic_fetch_add_explicit(&histogram[i], count, memory_order_relaxed);
+        }
+    }
+}
+
+// Dispatch exactly one threadgroup of HISTOGRAM_BINS threads
+kernel void exposure_adapt(
+    device atomic_uint* histogram [[buffer(0)]],
+    device float4* exposureState [[buffer(1)]],
+    constant float &minLogLum [[buffer(2)]],
+    constant float &logLumRange [[buffer(3)]],
+    constant float &adaptation [[buffer(4)]],      // 1 - exp(-dt * speed)
+    constant float &keyValue [[buffer(5)]],        // Target middle grey, includes compensation
+    constant float2 &exposureLimits [[buffer(6)]], // Min/max exposure multiplier
+    constant float2 &percentiles [[buffer(7)]],    // Fraction of lit samples ignored below/above
+    uint tid [[thread_index_in_threadgroup]])
+{
+    threadgroup float prefix[HISTOGRAM_BINS];
+    threadgroup float weighted[HISTOGRAM_BINS];
+    threadgroup float kept[HISTOGRAM_BINS];
+
+    uint count = atomic_load_explicit(&histogram[tid], memory_order_relaxed);
+    atomic_store_explicit(&histogram[tid], 0u, memory_order_relaxed);
+
+    // Black pixels (bin 0) would drag the average towards the empty sky
+    float c = (tid == 0) ? 0.0 : float(count);
+
+    // Inclusive prefix sum (Hillis-Steele) for percentile trimming
+    prefix[tid] = c;
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+    for (uint offset = 1; offset < HISTOGRAM_BINS; offset <<= 1) {
+        float add = (tid >= offset) ? prefix[tid - offset] : 0.0;
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+        prefix[tid] += add;
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+    }
+    float total = prefix[HISTOGRAM_BINS - 1];
+
+    // Portion of this bin that falls inside [low, high] of the sorted samples
+    float low = total * percentiles.x;
+    float high = total * percentiles.y;
+    float begin = prefix[tid] - c;
+    float end = prefix[tid];
+    float inside = max(min(end, high) - max(begin, low), 0.0);
+
+    float binLogLum = minLogLum + (float(tid) - 0.5) / 254.0 * logLumRange;
+    weighted[tid] = inside * binLogLum;
+    kept[tid] = inside;
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    // Tree reduction of the trimmed log-luminance sum
+    for (uint stride = HISTOGRAM_BINS / 2; stride > 0; stride >>= 1) {
+        if (tid < stride) {
+            weighted[tid] += weighted[tid + stride];
+            kept[tid] += kept[tid + stride];
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+    }
+
+    if (tid == 0) {
+        float4 state = exposureState[0];
+        // An all-black frame keeps the previous adaptation
+        float average = (kept[0] > 0.0) ? exp2(weighted[0] / kept[0]) : state.x;
+        average = max(average, 1e-4);
+
+        // Adapt in log space so brightening and darkening take equal time
+        float adapted = (state.w > 0.0)
+            ? exp2(mix(log2(max(state.x, 1e-4)), log2(average), adaptation))
+            : average;
+        float exposure = clamp(keyValue / adapted, exposureLimits.x, exposureLimits.y);
+        exposureState[0] = float4(adapted, exposure, average, 1.0);
+    }
+}
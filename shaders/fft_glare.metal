@@ -0,0 +1,175 @@
+#include <metal_stdlib>
+using namespace metal;
+
+// FFT convolution glare
+//
+// Convolves the bright part of the scene with an arbitrary point-spread
+// function (diffraction spikes, Airy-like halos) in the frequency domain, so
+// the cost is O(N² log N) regardless of the PSF extent.
+//
+// The working image is an N×N buffer of float4, each holding two complex
+// numbers: (R + iG, B + i0). Because the PSF is real, multiplying by its
+// spectrum keeps the real and imaginary parts of each pair independent, so
+// three colour channels take two complex transforms instead of three.
+
+#define FFT_MAX_SIZE 1024
+
+// Complex multiply
+static inline float2 cmul(float2 a, float2 b) {
+    return float2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+// Radix-2 decimation-in-time FFT of one line per threadgroup.
+// Lines are addressed as data[line * lineStride + k * elemStride], so the same
+// kernel transforms rows (lineStride = N, elemStride = 1) and columns
+// (lineStride = 1, elemStride = N). Dispatch N/2 threads per threadgroup.
+// direction: -1 forward, +1 inverse (unnormalized; 1/N² is folded into the
+// cached PSF spectrum).
+kernel void fft_radix2(
+    device float4* data [[buffer(0)]],
+    constant uint &n [[buffer(1)]],
+    constant uint &logN [[buffer(2)]],
+    constant uint &lineStride [[buffer(3)]],
+    constant uint &elemStride [[buffer(4)]],
+    constant float &direction [[buffer(5)]],
+    uint line [[threadgroup_position_in_grid]],
+    uint tid [[thread_index_in_threadgroup]])
+{
+    threadgroup float4 lineData[FFT_MAX_SIZE];
+    device float4* base = data + line * lineStride;
+    uint halfN = n >> 1;
+
+    // Load in bit-reversed order
+    for (uint i = tid; i < n; i += halfN) {
+        uint r = reverse_bits(i) >> (32 - logN);
+        lineData[r] = base[i * elemStride];
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    // One butterfly per thread per stage
+    for (uint s = 1; s <= logN; ++s) {
+        uint span = 1u << (s - 1);
+        uint j = tid & (span - 1);
+        uint i0 = ((tid >> (s - 1)) << s) + j;
+        uint i1 = i0 + span;
+
+        float angle = direction * M_PI_F * float(j) / float(span);
+        float c;
+        float sn = sincos(angle, c);
+        float2 w = float2(c, sn);
+
+        float4 a = lineData[i0];
+        float4 b = lineData[i1];
+        float4 bw = float4(cmul(b.xy, w), cmul(b.zw, w));
+        lineData[i0] = a + bw;
+        lineData[i1] = a - bw;
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+    }
+
+    for (uint i = tid; i < n; i += halfN) {
+        base[i * elemStride] = lineData[i];
+    }
+}
+
+// Bright pass into the packed complex buffer at working resolution.
+// Pixels outside workSize are the zero guard band that keeps the circular
+// convolution from wrapping glare across the image edges.
+kernel void glare_prepare(
+    texture2d<float, access::sample> sceneTexture [[texture(0)]],
+    device float4* data [[buffer(0)]],
+    constant uint &n [[buffer(1)]],
+    constant uint2 &workSize [[buffer(2)]],
+    constant float &brightPassThreshold [[buffer(3)]],
+    uint2 gid [[thread_position_in_grid]])
+{
+    if (gid.x >= n || gid.y >= n) {
+        return;
+    }
+
+    float4 packed = float4(0.0);
+    if (gid.x < workSize.x && gid.y < workSize.y) {
+        constexpr sampler textureSampler(mag_filter::linear, min_filter::linear, address::clamp_to_edge);
+        float2 uv = (float2(gid) + 0.5) / float2(workSize);
+        float3 color = sceneTexture.sample(textureSampler, uv).rgb;
+
+        // Keep only the energy above threshold so glare fades in smoothly
+        const float3 luminanceVector = float3(0.2125, 0.7154, 0.0721);
+        float luminance = dot(color, luminanceVector);
+        color *= max(luminance - brightPassThreshold, 0.0) / max(luminance, 1e-4);
+
+        packed = float4(color.r, color.g, color.b, 0.0);
+    }
+    data[gid.y * n + gid.x] = packed;
+}
+
+// Load the real PSF (wrapped so its centre is at texel 0) for transformation
+kernel void glare_load_psf(
+    device const float* psf [[buffer(0)]],
+    device float4* data [[buffer(1)]],
+    constant uint &count [[buffer(2)]],
+    uint gid [[thread_position_in_grid]])
+{
+    if (gid >= count) {
+        return;
+    }
+    data[gid] = float4(psf[gid], 0.0, 0.0, 0.0);
+}
+
+// Keep the transformed PSF as a compact spectrum, pre-scaled by 1/N²
+kernel void glare_store_spectrum(
+    device const float4* data [[buffer(0)]],
+    device float2* spectrum [[buffer(1)]],
+    constant uint &count [[buffer(2)]],
+    constant float &scale [[buffer(3)]],
+    uint gid [[thread_position_in_grid]])
+{
+    if (gid >= count) {
+        return;
+    }
+    spectrum[gid] = data[gid].xy * scale;
+}
+
+// Pointwise product with the cached PSF spectrum
+kernel void glare_multiply(
+    device float4* data [[buffer(0)]],
+    device const float2* spectrum [[buffer(1)]],
+    constant uint &count [[buffer(2)]],
+    uint gid [[thread_position_in_grid]])
+{
+    if (gid >= count) {
+        return;
+    }
+    float2 h = spectrum[gid];
+    float4 v = data[gid];
+    data[gid] = float4(cmul(v.xy, h), cmul(v.zw, h));
+}
+
+// Unpack the convolved channels and upsample to the output resolution
+kernel void glare_resolve(
+    device const float4* data [[buffer(0)]],
+    texture2d<float, access::write> outputTexture [[texture(0)]],
+    constant uint &n [[buffer(1)]],
+    constant uint2 &workSize [[buffer(2)]],
+    uint2 gid [[thread_position_in_grid]])
+{
+    if (gid.x >= outputTexture.get_width() || gid.y >= outputTexture.get_height()) {
+        return;
+    }
+
+    float2 outSize = float2(outputTexture.get_width(), outputTexture.get_height());
+    float2 p = (float2(gid) + 0.5) * float2(workSize) / outSize - 0.5;
+    p = clamp(p, float2(0.0), float2(workSize) - 1.0);
+
+    uint2 p0 = uint2(p);
+    uint2 p1 = min(p0 + 1, workSize - 1);
+    float2 f = p - float2(p0);
+
+    // Real parts carry R, G (imaginary of the first pair) and B
+    float3 c00 = data[p0.y * n + p0.x].xyz;
+    float3 c10 = data[p0.y * n + p1.x].xyz;
+    float3 c01 = data[p1.y * n + p0.x].xyz;
+    float3 c11 = data[p1.y * n + p1.x].xyz;
+    float3 color = mix(mix(c00, c10, f.x), mix(c01, c11, f.x), f.y);
+
+    outputTexture.write(float4(max(color, 0.0), 1.0), gid);
+}
@@ -12,11 +12,21 @@ float3 aces_tonemap(float3 x) {
     return clamp((x * (a * x + b)) / (x * (c * x + d) + e), 0.0, 1.0);
 }
 
+// Exact inverse of the piecewise sRGB encoding (IEC 61966-2-1). A pow(2.2)
+// approximation is off by several codes in the linear toe, where the sky sits
+float3 srgb_to_linear(float3 c) {
+    c = saturate(c);
+    return select(pow((c + 0.055) / 1.055, float3(2.4)), c / 12.92, c <= 0.04045);
+}
+
 kernel void tonemapping_kernel(
     texture2d<float, access::read> inputTexture [[texture(0)]],
     texture2d<float, access::write> outputTexture [[texture(1)]],
     constant float &gamma [[buffer(0)]],
     constant bool &tonemappingEnabled [[buffer(1)]],
+    constant bool &srgbOutput [[buffer(2)]],
+    device const float4* exposureState [[buffer(3)]],
+    constant bool &autoExposure [[buffer(4)]],
     uint2 gid [[thread_position_in_grid]])
 {
     if (gid.x >= outputTexture.get_width() || gid.y >= outputTexture.get_height()) {
@@ -25,6 +35,11 @@ kernel void tonemapping_kernel(
     
     float4 color = inputTexture.read(gid);
     
+    // Exposure from auto_exposure.metal (y component)
+    if (autoExposure) {
+        color.rgb *= exposureState[0].y;
+    }
+    
     if (tonemappingEnabled) {
         // Apply ACES filmic tone mapping
         color.rgb = aces_tonemap(color.rgb);
@@ -33,6 +48,12 @@ kernel void tonemapping_kernel(
         color.rgb = pow(color.rgb, float3(1.0 / gamma));
     }
     
+    // An sRGB target encodes on store; decoding first makes the stored bytes
+    // those of a plain Unorm write
+    if (srgbOutput) {
+        color.rgb = srgb_to_linear(color.rgb);
+    }
+    
     color.a = 1.0;
     outputTexture.write(color, gid);
 }
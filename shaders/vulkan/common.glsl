@@ -0,0 +1,55 @@
+/**
+ * common.glsl
+ *
+ * Scene uniforms for the Vulkan kernels
+ *
+ * Mirrors VulkanSceneUniforms in src/VulkanTypes.h (std140, 128 bytes).
+ */
+
+#ifndef COMMON_GLSL
+#define COMMON_GLSL
+
+layout(std140, set = 0, binding = 2) uniform SceneUniforms {
+    vec2 resolution;
+    float time;
+    float gravity;
+
+    float disk_radius;
+    float disk_thickness;
+    float black_hole_size;
+    float camera_distance;
+
+    float disk_density_vertical;
+    float disk_density_horizontal;
+    float disk_density_gain;
+    float disk_density_clamp;
+
+    float disk_noise_scale;
+    float disk_noise_speed;
+    int disk_noise_octaves;
+    float disk_emission_strength;
+
+    float disk_alpha_falloff;
+    float disk_inner_multiplier;
+    float disk_inner_softness;
+    float disk_color_mix;
+
+    float disk_noise_lod_bias;
+    int max_iterations;
+    float step_size;
+    int adaptive_stepping;
+
+    vec4 observer_position;
+
+    float sky_weight;
+    float pad0;
+    float pad1;
+    float pad2;
+} uniforms;
+
+// Physical constants (natural units: G = M = c = 1), as in BlackHole.metal
+const float G = 1.0;
+const float M = 1.0;
+const float c = 1.0;
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * geodesic.glsl
+ *
+ * Photon integrators for the Vulkan scene kernel
+ *
+ * GLSL port of src/Geodesic.h (GLSL has no templates). The scheme is a
+ * specialization constant, the counterpart of BlackHole.metal's function
+ * constant: every pipeline is built for one integrator.
+ */
+
+#ifndef GEODESIC_GLSL
+#define GEODESIC_GLSL
+
+#define GEODESIC_VERLET 0
+#define GEODESIC_RK4 1
+#define GEODESIC_YOSHIDA4 2
+#define GEODESIC_YOSHIDA6 3
+
+layout(constant_id = 0) const int geodesicIntegrator = GEODESIC_RK4;
+
+// x'' = -1.5 g h² x / |x|⁵
+vec3 geodesicAcceleration(vec3 pos, float h2, float gravity) {
+    float r2 = dot(pos, pos);
+    float r5 = r2 * r2 * sqrt(r2);
+    return pos * (-1.5 * h2 * gravity / r5);
+}
+
+// Kick-drift-kick stage; acc carries the force between chained stages
+void geodesicVerletStage(inout vec3 pos, inout vec3 dir, inout vec3 acc, float h2, float dt, float gravity) {
+    dir += acc * (0.5 * dt);
+    pos += dir * dt;
+    acc = geodesicAcceleration(pos, h2, gravity);
+    dir += acc * (0.5 * dt);
+}
+
+void geodesicRK4(inout vec3 pos, inout vec3 dir, float h2, float dt, float gravity) {
+    vec3 k1Pos = dir;
+    vec3 k1Vel = geodesicAcceleration(pos, h2, gravity);
+    vec3 k2Pos = dir + k1Vel * (0.5 * dt);
+    vec3 k2Vel = geodesicAcceleration(pos + k1Pos * (0.5 * dt), h2, gravity);
+    vec3 k3Pos = dir + k2Vel * (0.5 * dt);
+    vec3 k3Vel = geodesicAcceleration(pos + k2Pos * (0.5 * dt), h2, gravity);
+    vec3 k4Pos = dir + k3Vel * dt;
+    vec3 k4Vel = geodesicAcceleration(pos + k3Pos * dt, h2, gravity);
+
+    float sixth = dt / 6.0;
+    pos += (k1Pos + k2Pos * 2.0 + k3Pos * 2.0 + k4Pos) * sixth;
+    dir += (k1Vel + k2Vel * 2.0 + k3Vel * 2.0 + k4Vel) * sixth;
+}
+
+// Advance one photon step with the pipeline's integrator
+void integrateGeodesic(inout vec3 pos, inout vec3 dir, float h2, float dt, float gravity) {
+    if (geodesicIntegrator == GEODESIC_VERLET) {
+        vec3 acc = geodesicAcceleration(pos, h2, gravity);
+        geodesicVerletStage(pos, dir, acc, h2, dt, gravity);
+    } else if (geodesicIntegrator == GEODESIC_YOSHIDA4) {
+        const float w1 = 1.3512071919596578;
+        const float w0 = -1.7024143839193155;
+        vec3 acc = geodesicAcceleration(pos, h2, gravity);
+        geodesicVerletStage(pos, dir, acc, h2, w1 * dt, gravity);
+        geodesicVerletStage(pos, dir, acc, h2, w0 * dt, gravity);
+        geodesicVerletStage(pos, dir, acc, h2, w1 * dt, gravity);
+    } else if (geodesicIntegrator == GEODESIC_YOSHIDA6) {
+        const float w1 = -1.17767998417887;
+        const float w2 = 0.235573213359357;
+        const float w3 = 0.784513610477560;
+        const float w0 = 1.31518632068391;
+        vec3 acc = geodesicAcceleration(pos, h2, gravity);
+        geodesicVerletStage(pos, dir, acc, h2, w3 * dt, gravity);
+        geodesicVerletStage(pos, dir, acc, h2, w2 * dt, gravity);
+        geodesicVerletStage(pos, dir, acc, h2, w1 * dt, gravity);
+        geodesicVerletStage(pos, dir, acc, h2, w0 * dt, gravity);
+        geodesicVerletStage(pos, dir, acc, h2, w1 * dt, gravity);
+        geodesicVerletStage(pos, dir, acc, h2, w2 * dt, gravity);
+        geodesicVerletStage(pos, dir, acc, h2, w3 * dt, gravity);
+    } else {
+        geodesicRK4(pos, dir, h2, dt, gravity);
+    }
+}
+
+#endif
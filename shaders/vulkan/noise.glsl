@@ -0,0 +1,133 @@
+/**
+ * noise.glsl
+ *
+ * 3D simplex noise with integer lattice hashing
+ *
+ * GLSL port of shaders/Noise.h (snoise and snoise4). Same hash, gradient
+ * set and arithmetic, so the Vulkan and Metal disks share their turbulence.
+ */
+
+#ifndef NOISE_GLSL
+#define NOISE_GLSL
+
+const float NOISE_F3 = 1.0 / 3.0;   // Skew factor for 3D simplex grid
+const float NOISE_G3 = 1.0 / 6.0;   // Unskew factor
+const float NOISE_SCALE = 32.0;     // Normalizes output to about [-1, 1]
+
+// Multiply-xorshift lattice hash (noiseHash in Noise.h)
+uint noiseHash(uint x, uint y, uint z) {
+    uint h = x * 0x8da6b343u ^ y * 0xd8163841u ^ z * 0xcb1ab31fu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+uvec4 noiseHash(uvec4 x, uvec4 y, uvec4 z) {
+    uvec4 h = x * 0x8da6b343u ^ y * 0xd8163841u ^ z * 0xcb1ab31fu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+// dot(gradient(h), (x, y, z)) for the 12 cube-edge gradients
+float noiseGradDot(uint h, float x, float y, float z) {
+    uint g = h & 15u;
+    float u = g < 8u ? x : y;
+    float v = g < 4u ? y : (((g | 2u) == 14u) ? x : z);
+    return ((g & 1u) != 0u ? -u : u) + ((g & 2u) != 0u ? -v : v);
+}
+
+vec4 noiseGradDot(uvec4 h, vec4 x, vec4 y, vec4 z) {
+    uvec4 g = h & 15u;
+    vec4 u = mix(y, x, lessThan(g, uvec4(8u)));
+    vec4 v = mix(mix(z, x, equal(g | 2u, uvec4(14u))), y, lessThan(g, uvec4(4u)));
+    return mix(u, -u, notEqual(g & 1u, uvec4(0u))) + mix(v, -v, notEqual(g & 2u, uvec4(0u)));
+}
+
+// Scalar reference (snoise in Noise.h)
+float snoise(vec3 v) {
+    vec3 i = floor(v + dot(v, vec3(NOISE_F3)));
+    vec3 x0 = v - i + dot(i, vec3(NOISE_G3));
+
+    vec3 g = step(x0.yzx, x0.xyz);
+    vec3 l = 1.0 - g;
+    vec3 i1 = min(g.xyz, l.zxy);
+    vec3 i2 = max(g.xyz, l.zxy);
+
+    vec3 x1 = x0 - i1 + NOISE_G3;
+    vec3 x2 = x0 - i2 + 2.0 * NOISE_G3;
+    vec3 x3 = x0 - 1.0 + 3.0 * NOISE_G3;
+
+    uvec3 ci = uvec3(ivec3(i));
+    uvec3 c1 = ci + uvec3(i1);
+    uvec3 c2 = ci + uvec3(i2);
+    uvec3 c3 = ci + 1u;
+
+    vec4 t = max(0.6 - vec4(dot(x0, x0), dot(x1, x1), dot(x2, x2), dot(x3, x3)), 0.0);
+    t *= t;
+    t *= t;
+
+    vec4 n = vec4(
+        noiseGradDot(noiseHash(ci.x, ci.y, ci.z), x0.x, x0.y, x0.z),
+        noiseGradDot(noiseHash(c1.x, c1.y, c1.z), x1.x, x1.y, x1.z),
+        noiseGradDot(noiseHash(c2.x, c2.y, c2.z), x2.x, x2.y, x2.z),
+        noiseGradDot(noiseHash(c3.x, c3.y, c3.z), x3.x, x3.y, x3.z));
+
+    return NOISE_SCALE * dot(t, n);
+}
+
+// One simplex corner for four lanes
+vec4 snoiseCorner4(uvec4 cx, uvec4 cy, uvec4 cz, vec4 dx, vec4 dy, vec4 dz) {
+    vec4 t = max(0.6 - (dx * dx + dy * dy + dz * dz), 0.0);
+    t *= t;
+    return t * t * noiseGradDot(noiseHash(cx, cy, cz), dx, dy, dz);
+}
+
+// Four points in structure-of-arrays form (snoise4 in Noise.h)
+vec4 snoise4(vec4 x, vec4 y, vec4 z) {
+    vec4 s = (x + y + z) * NOISE_F3;
+    vec4 ix = floor(x + s);
+    vec4 iy = floor(y + s);
+    vec4 iz = floor(z + s);
+    vec4 t = (ix + iy + iz) * NOISE_G3;
+    vec4 x0 = x - ix + t;
+    vec4 y0 = y - iy + t;
+    vec4 z0 = z - iz + t;
+
+    vec4 gx = step(y0, x0);
+    vec4 gy = step(z0, y0);
+    vec4 gz = step(x0, z0);
+    vec4 i1x = min(gx, 1.0 - gz);
+    vec4 i1y = min(gy, 1.0 - gx);
+    vec4 i1z = min(gz, 1.0 - gy);
+    vec4 i2x = max(gx, 1.0 - gz);
+    vec4 i2y = max(gy, 1.0 - gx);
+    vec4 i2z = max(gz, 1.0 - gy);
+
+    uvec4 cx = uvec4(ivec4(ix));
+    uvec4 cy = uvec4(ivec4(iy));
+    uvec4 cz = uvec4(ivec4(iz));
+
+    vec4 n = snoiseCorner4(cx, cy, cz, x0, y0, z0);
+    n += snoiseCorner4(cx + uvec4(i1x), cy + uvec4(i1y), cz + uvec4(i1z),
+                       x0 - i1x + NOISE_G3, y0 - i1y + NOISE_G3, z0 - i1z + NOISE_G3);
+    n += snoiseCorner4(cx + uvec4(i2x), cy + uvec4(i2y), cz + uvec4(i2z),
+                       x0 - i2x + 2.0 * NOISE_G3, y0 - i2y + 2.0 * NOISE_G3, z0 - i2z + 2.0 * NOISE_G3);
+    n += snoiseCorner4(cx + 1u, cy + 1u, cz + 1u,
+                       x0 - 1.0 + 3.0 * NOISE_G3, y0 - 1.0 + 3.0 * NOISE_G3, z0 - 1.0 + 3.0 * NOISE_G3);
+    return NOISE_SCALE * n;
+}
+
+vec4 snoise4(vec3 p0, vec3 p1, vec3 p2, vec3 p3) {
+    return snoise4(vec4(p0.x, p1.x, p2.x, p3.x),
+                   vec4(p0.y, p1.y, p2.y, p3.y),
+                   vec4(p0.z, p1.z, p2.z, p3.z));
+}
+
+#endif
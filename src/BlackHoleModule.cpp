@@ -0,0 +1,730 @@
+/**
+ * BlackHoleModule.cpp
+ *
+ * Python bindings (module "blackhole")
+ *
+ *   Tracer(width, height, threads=0)
+ *       Uniforms fields of LensingParams as attributes, trace(), resize(),
+ *       and the AOV tables steps, termination, escape_direction and
+ *       disk_hit as memoryviews over the tracer's own storage.
+ *   Renderer(width, height, quality=2, integrator=RK4, device="any",
+ *            shader_dir=None)   [built with Vulkan only]
+ *       Scene uniforms as attributes, render(time) and the tone-mapped
+ *       image as a memoryview.
+ *   trace_start(path=None), trace_stop(), trace_dump(path)
+ *       Timeline of tracer rows and frames (see Trace.hpp).
+ *
+ * numpy.asarray() on a table shares memory with the engine: later traces
+ * or renders update arrays already held by Python. trace() and render()
+ * release the GIL. Resizing while a table is exported raises BufferError,
+ * as bytearray does, because the storage would move.
+ *
+ * The C API and buffer protocol are used directly so the module needs
+ * neither pybind11 nor NumPy to build.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "LensingTracer.hpp"
+#include "Trace.hpp"
+#include <cstddef>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+
+#ifdef BLACKHOLE_WITH_VULKAN
+#include "VulkanRenderer.hpp"
+#endif
+
+namespace {
+
+// --- Struct fields as attributes ---
+
+enum FieldType { FloatField, IntField, BoolField };
+
+struct Field
+{
+    const char* name;
+    size_t offset;
+    FieldType type;
+};
+
+PyObject* getField(char* base, const Field& field)
+{
+    char* address = base + field.offset;
+    switch (field.type) {
+        case FloatField: return PyFloat_FromDouble(*reinterpret_cast<float*>(address));
+        case IntField: return PyLong_FromLong(*reinterpret_cast<int32_t*>(address));
+        default: return PyBool_FromLong(*reinterpret_cast<bool*>(address));
+    }
+}
+
+int setField(char* base, const Field& field, PyObject* value)
+{
+    if (!value) {
+        PyErr_Format(PyExc_AttributeError, "cannot delete %s", field.name);
+        return -1;
+    }
+    char* address = base + field.offset;
+    switch (field.type) {
+        case FloatField: {
+            double v = PyFloat_AsDouble(value);
+            if (v == -1.0 && PyErr_Occurred()) {
+                return -1;
+            }
+            *reinterpret_cast<float*>(address) = (float)v;
+            return 0;
+        }
+        case IntField: {
+            long v = PyLong_AsLong(value);
+            if (v == -1 && PyErr_Occurred()) {
+                return -1;
+            }
+            *reinterpret_cast<int32_t*>(address) = (int32_t)v;
+            return 0;
+        }
+        default: {
+            int v = PyObject_IsTrue(value);
+            if (v < 0) {
+                return -1;
+            }
+            *reinterpret_cast<bool*>(address) = v != 0;
+            return 0;
+        }
+    }
+}
+
+PyObject* getVector3(const float* v)
+{
+    return Py_BuildValue("(fff)", v[0], v[1], v[2]);
+}
+
+// Any sequence of three numbers: tuple, list or numpy array
+int setVector3(float* v, PyObject* value)
+{
+    if (!value) {
+        PyErr_SetString(PyExc_TypeError, "cannot delete a vector attribute");
+        return -1;
+    }
+    PyObject* items = PySequence_Fast(value, "expected a sequence of 3 numbers");
+    if (!items) {
+        return -1;
+    }
+    if (PySequence_Fast_GET_SIZE(items) != 3) {
+        Py_DECREF(items);
+        PyErr_SetString(PyExc_TypeError, "expected a sequence of 3 numbers");
+        return -1;
+    }
+    float xyz[3];
+    for (int i = 0; i < 3; ++i) {
+        double c = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(items, i));
+        if (c == -1.0 && PyErr_Occurred()) {
+            Py_DECREF(items);
+            return -1;
+        }
+        xyz[i] = (float)c;
+    }
+    Py_DECREF(items);
+    v[0] = xyz[0];
+    v[1] = xyz[1];
+    v[2] = xyz[2];
+    return 0;
+}
+
+// --- Table: one buffer over an engine-owned array ---
+
+struct TableObject
+{
+    PyObject_HEAD
+    PyObject* owner;            // Keeps the storage alive
+    void* data;
+    const char* format;         // struct module format of one element
+    Py_ssize_t itemsize;
+    int ndim;
+    Py_ssize_t shape[3];
+    Py_ssize_t strides[3];
+    Py_ssize_t* exports;        // Owner's export count
+    bool readonly;
+};
+
+int tableGetBuffer(PyObject* self, Py_buffer* view, int flags)
+{
+    TableObject* table = reinterpret_cast<TableObject*>(self);
+    if ((flags & PyBUF_WRITABLE) && table->readonly) {
+        PyErr_SetString(PyExc_BufferError, "table is read-only");
+        return -1;
+    }
+    Py_ssize_t length = table->itemsize;
+    for (int i = 0; i < table->ndim; ++i) {
+        length *= table->shape[i];
+    }
+    view->obj = self;
+    Py_INCREF(self);
+    view->buf = table->data;
+    view->len = length;
+    view->readonly = table->readonly ? 1 : 0;
+    view->itemsize = table->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>(table->format) : nullptr;
+    view->ndim = table->ndim;
+    view->shape = (flags & PyBUF_ND) ? table->shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? table->strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    ++*table->exports;
+    return 0;
+}
+
+void tableReleaseBuffer(PyObject* self, Py_buffer*)
+{
+    --*reinterpret_cast<TableObject*>(self)->exports;
+}
+
+void tableDealloc(PyObject* self)
+{
+    Py_XDECREF(reinterpret_cast<TableObject*>(self)->owner);
+    Py_TYPE(self)->tp_free(self);
+}
+
+PyBufferProcs tableBufferProcs = { tableGetBuffer, tableReleaseBuffer };
+
+PyTypeObject TableType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+    "blackhole._Table",
+};
+
+/**
+ * memoryview over data with a C-contiguous shape
+ *
+ * The memoryview holds the table, which holds owner.
+ */
+PyObject* newTable(PyObject* owner, Py_ssize_t* exports, void* data, const char* format, Py_ssize_t itemsize,
+                   std::initializer_list<Py_ssize_t> shape, bool readonly)
+{
+    TableObject* table = PyObject_New(TableObject, &TableType);
+    if (!table) {
+        return nullptr;
+    }
+    Py_INCREF(owner);
+    table->owner = owner;
+    table->data = data;
+    table->format = format;
+    table->itemsize = itemsize;
+    table->ndim = (int)shape.size();
+    table->exports = exports;
+    table->readonly = readonly;
+    int i = 0;
+    for (Py_ssize_t extent : shape) {
+        table->shape[i++] = extent;
+    }
+    Py_ssize_t stride = itemsize;
+    for (i = table->ndim - 1; i >= 0; --i) {
+        table->strides[i] = stride;
+        stride *= table->shape[i];
+    }
+    PyObject* view = PyMemoryView_FromObject(reinterpret_cast<PyObject*>(table));
+    Py_DECREF(table);
+    return view;
+}
+
+// --- Tracer ---
+
+struct TracerObject
+{
+    PyObject_HEAD
+    LensingTracer* tracer;
+    LensingParams params;
+    Py_ssize_t exports;         // Live buffers over the tables
+    bool busy;                  // trace() running without the GIL
+};
+
+const Field kTracerFields[] = {
+    { "gravity", offsetof(LensingParams, gravity), FloatField },
+    { "camera_distance", offsetof(LensingParams, camera_distance), FloatField },
+    { "step_size", offsetof(LensingParams, step_size), FloatField },
+    { "max_iterations", offsetof(LensingParams, max_iterations), IntField },
+    { "adaptive_stepping", offsetof(LensingParams, adaptive_stepping), BoolField },
+    { "integration_method", offsetof(LensingParams, integration_method), IntField },
+    { "disk_radius", offsetof(LensingParams, disk_radius), FloatField },
+    { "black_hole_size", offsetof(LensingParams, black_hole_size), FloatField },
+    { "disk_inner_multiplier", offsetof(LensingParams, disk_inner_multiplier), FloatField },
+};
+
+bool tracerIdle(TracerObject* self)
+{
+    if (!self->tracer) {
+        PyErr_SetString(PyExc_RuntimeError, "Tracer is not initialized");
+        return false;
+    }
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "Tracer is busy in another thread");
+        return false;
+    }
+    return true;
+}
+
+PyObject* tracerGetField(PyObject* self, void* closure)
+{
+    TracerObject* tracer = reinterpret_cast<TracerObject*>(self);
+    return getField(reinterpret_cast<char*>(&tracer->params), *static_cast<const Field*>(closure));
+}
+
+int tracerSetField(PyObject* self, PyObject* value, void* closure)
+{
+    TracerObject* tracer = reinterpret_cast<TracerObject*>(self);
+    return setField(reinterpret_cast<char*>(&tracer->params), *static_cast<const Field*>(closure), value);
+}
+
+PyObject* tracerGetObserver(PyObject* self, void*)
+{
+    return getVector3(reinterpret_cast<TracerObject*>(self)->params.observer_position);
+}
+
+int tracerSetObserver(PyObject* self, PyObject* value, void*)
+{
+    return setVector3(reinterpret_cast<TracerObject*>(self)->params.observer_position, value);
+}
+
+PyObject* tracerGetSize(PyObject* self, void*)
+{
+    TracerObject* tracer = reinterpret_cast<TracerObject*>(self);
+    if (!tracer->tracer) {
+        PyErr_SetString(PyExc_RuntimeError, "Tracer is not initialized");
+        return nullptr;
+    }
+    return Py_BuildValue("(ii)", tracer->tracer->width(), tracer->tracer->height());
+}
+
+// Tables are writable so analysts can post-process in place
+PyObject* tracerTable(PyObject* self, void* closure)
+{
+    TracerObject* tracer = reinterpret_cast<TracerObject*>(self);
+    if (!tracer->tracer) {
+        PyErr_SetString(PyExc_RuntimeError, "Tracer is not initialized");
+        return nullptr;
+    }
+    LensingTracer& t = *tracer->tracer;
+    Py_ssize_t w = t.width();
+    Py_ssize_t h = t.height();
+    switch ((int)(intptr_t)closure) {
+        case 0: return newTable(self, &tracer->exports, t.steps(), "i", 4, { h, w }, false);
+        case 1: return newTable(self, &tracer->exports, t.termination(), "B", 1, { h, w }, false);
+        case 2: return newTable(self, &tracer->exports, t.escapeDirection(), "f", 4, { h, w, 3 }, false);
+        default: return newTable(self, &tracer->exports, t.diskHit(), "f", 4, { h, w, 2 }, false);
+    }
+}
+
+PyObject* tracerTrace(PyObject* self, PyObject*)
+{
+    TracerObject* tracer = reinterpret_cast<TracerObject*>(self);
+    if (!tracerIdle(tracer)) {
+        return nullptr;
+    }
+    // Params are copied under the GIL; attribute writes during the trace
+    // apply to the next one
+    LensingParams params = tracer->params;
+    tracer->busy = true;
+    Py_BEGIN_ALLOW_THREADS
+    tracer->tracer->trace(params);
+    Py_END_ALLOW_THREADS
+    tracer->busy = false;
+    Py_RETURN_NONE;
+}
+
+PyObject* tracerResize(PyObject* self, PyObject* args)
+{
+    TracerObject* tracer = reinterpret_cast<TracerObject*>(self);
+    int width, height;
+    if (!PyArg_ParseTuple(args, "ii", &width, &height) || !tracerIdle(tracer)) {
+        return nullptr;
+    }
+    if (width < 1 || height < 1) {
+        PyErr_SetString(PyExc_ValueError, "width and height must be positive");
+        return nullptr;
+    }
+    if (width == tracer->tracer->width() && height == tracer->tracer->height()) {
+        Py_RETURN_NONE;
+    }
+    if (tracer->exports > 0) {
+        PyErr_SetString(PyExc_BufferError, "cannot resize while tables are exported");
+        return nullptr;
+    }
+    tracer->tracer->resize(width, height);
+    Py_RETURN_NONE;
+}
+
+int tracerInit(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+    TracerObject* tracer = reinterpret_cast<TracerObject*>(self);
+    static const char* keywords[] = { "width", "height", "threads", nullptr };
+    int width, height, threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ii|i", const_cast<char**>(keywords), &width, &height, &threads)) {
+        return -1;
+    }
+    if (width < 1 || height < 1) {
+        PyErr_SetString(PyExc_ValueError, "width and height must be positive");
+        return -1;
+    }
+    if (tracer->tracer) {
+        PyErr_SetString(PyExc_RuntimeError, "Tracer is already initialized");
+        return -1;
+    }
+    new (&tracer->params) LensingParams();
+    try {
+        tracer->tracer = new LensingTracer(width, height, threads);
+    } catch (const std::exception& e) {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return -1;
+    }
+    return 0;
+}
+
+void tracerDealloc(PyObject* self)
+{
+    delete reinterpret_cast<TracerObject*>(self)->tracer;
+    Py_TYPE(self)->tp_free(self);
+}
+
+PyMethodDef kTracerMethods[] = {
+    { "trace", tracerTrace, METH_NOARGS, "Trace every pixel with the current parameters (releases the GIL)" },
+    { "resize", tracerResize, METH_VARARGS, "resize(width, height): reallocate the tables" },
+    { nullptr, nullptr, 0, nullptr },
+};
+
+// Field getsets are filled in at module init from kTracerFields
+PyGetSetDef kTracerGetSets[sizeof(kTracerFields) / sizeof(Field) + 8];
+
+PyTypeObject TracerType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+    "blackhole.Tracer",
+};
+
+#ifdef BLACKHOLE_WITH_VULKAN
+
+// --- Renderer (Vulkan) ---
+
+struct RendererObject
+{
+    PyObject_HEAD
+    VulkanRenderer* renderer;
+    std::vector<uint8_t>* pixels;   // Latest frame, reused by every render()
+    Py_ssize_t exports;
+    bool busy;
+};
+
+const Field kRendererFields[] = {
+    { "gravity", offsetof(VulkanSceneUniforms, gravity), FloatField },
+    { "disk_radius", offsetof(VulkanSceneUniforms, disk_radius), FloatField },
+    { "disk_thickness", offsetof(VulkanSceneUniforms, disk_thickness), FloatField },
+    { "black_hole_size", offsetof(VulkanSceneUniforms, black_hole_size), FloatField },
+    { "camera_distance", offsetof(VulkanSceneUniforms, camera_distance), FloatField },
+    { "disk_density_vertical", offsetof(VulkanSceneUniforms, disk_density_vertical), FloatField },
+    { "disk_density_horizontal", offsetof(VulkanSceneUniforms, disk_density_horizontal), FloatField },
+    { "disk_density_gain", offsetof(VulkanSceneUniforms, disk_density_gain), FloatField },
+    { "disk_density_clamp", offsetof(VulkanSceneUniforms, disk_density_clamp), FloatField },
+    { "disk_noise_scale", offsetof(VulkanSceneUniforms, disk_noise_scale), FloatField },
+    { "disk_noise_speed", offsetof(VulkanSceneUniforms, disk_noise_speed), FloatField },
+    { "disk_noise_octaves", offsetof(VulkanSceneUniforms, disk_noise_octaves), IntField },
+    { "disk_emission_strength", offsetof(VulkanSceneUniforms, disk_emission_strength), FloatField },
+    { "disk_alpha_falloff", offsetof(VulkanSceneUniforms, disk_alpha_falloff), FloatField },
+    { "disk_inner_multiplier", offsetof(VulkanSceneUniforms, disk_inner_multiplier), FloatField },
+    { "disk_inner_softness", offsetof(VulkanSceneUniforms, disk_inner_softness), FloatField },
+    { "disk_color_mix", offsetof(VulkanSceneUniforms, disk_color_mix), FloatField },
+    { "disk_noise_lod_bias", offsetof(VulkanSceneUniforms, disk_noise_lod_bias), FloatField },
+    { "max_iterations", offsetof(VulkanSceneUniforms, max_iterations), IntField },
+    { "step_size", offsetof(VulkanSceneUniforms, step_size), FloatField },
+    { "adaptive_stepping", offsetof(VulkanSceneUniforms, adaptive_stepping), IntField },
+    { "sky_weight", offsetof(VulkanSceneUniforms, sky_weight), FloatField },
+};
+
+bool rendererIdle(RendererObject* self)
+{
+    if (!self->renderer) {
+        PyErr_SetString(PyExc_RuntimeError, "Renderer is not initialized");
+        return false;
+    }
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "Renderer is busy in another thread");
+        return false;
+    }
+    return true;
+}
+
+PyObject* rendererGetField(PyObject* self, void* closure)
+{
+    RendererObject* renderer = reinterpret_cast<RendererObject*>(self);
+    if (!rendererIdle(renderer)) {
+        return nullptr;
+    }
+    return getField(reinterpret_cast<char*>(&renderer->renderer->uniforms()), *static_cast<const Field*>(closure));
+}
+
+int rendererSetField(PyObject* self, PyObject* value, void* closure)
+{
+    RendererObject* renderer = reinterpret_cast<RendererObject*>(self);
+    if (!rendererIdle(renderer)) {
+        return -1;
+    }
+    return setField(reinterpret_cast<char*>(&renderer->renderer->uniforms()), *static_cast<const Field*>(closure), value);
+}
+
+PyObject* rendererGetObserver(PyObject* self, void*)
+{
+    RendererObject* renderer = reinterpret_cast<RendererObject*>(self);
+    if (!rendererIdle(renderer)) {
+        return nullptr;
+    }
+    return getVector3(renderer->renderer->uniforms().observer_position);
+}
+
+int rendererSetObserver(PyObject* self, PyObject* value, void*)
+{
+    RendererObject* renderer = reinterpret_cast<RendererObject*>(self);
+    if (!rendererIdle(renderer)) {
+        return -1;
+    }
+    return setVector3(renderer->renderer->uniforms().observer_position, value);
+}
+
+PyObject* rendererImage(PyObject* self, void*)
+{
+    RendererObject* renderer = reinterpret_cast<RendererObject*>(self);
+    if (!renderer->renderer) {
+        PyErr_SetString(PyExc_RuntimeError, "Renderer is not initialized");
+        return nullptr;
+    }
+    Py_ssize_t w = renderer->renderer->width();
+    Py_ssize_t h = renderer->renderer->height();
+    return newTable(self, &renderer->exports, renderer->pixels->data(), "B", 1, { h, w, 4 }, true);
+}
+
+PyObject* rendererRender(PyObject* self, PyObject* args)
+{
+    RendererObject* renderer = reinterpret_cast<RendererObject*>(self);
+    float time = 0.0f;
+    if (!PyArg_ParseTuple(args, "|f", &time) || !rendererIdle(renderer)) {
+        return nullptr;
+    }
+    std::string error;
+    renderer->busy = true;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        // pixels already has the frame size, so readFrame never reallocates
+        int slot = renderer->renderer->submitFrame(time);
+        renderer->renderer->readFrame(slot, *renderer->pixels);
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    Py_END_ALLOW_THREADS
+    renderer->busy = false;
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject* rendererApplyQualityPreset(PyObject* self, PyObject* args)
+{
+    RendererObject* renderer = reinterpret_cast<RendererObject*>(self);
+    int preset;
+    if (!PyArg_ParseTuple(args, "i", &preset) || !rendererIdle(renderer)) {
+        return nullptr;
+    }
+    renderer->renderer->applyQualityPreset(preset);
+    Py_RETURN_NONE;
+}
+
+int rendererInit(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+    RendererObject* renderer = reinterpret_cast<RendererObject*>(self);
+    static const char* keywords[] = { "width", "height", "quality", "integrator", "device", "shader_dir", nullptr };
+    VulkanOptions options;
+    const char* device = "any";
+    const char* shaderDir = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ii|iisz", const_cast<char**>(keywords), &options.width,
+                                     &options.height, &options.quality, &options.integrator, &device, &shaderDir)) {
+        return -1;
+    }
+    std::string deviceName = device;
+    if (deviceName == "gpu") {
+        options.device = VulkanOptions::GpuDevice;
+    } else if (deviceName == "cpu") {
+        options.device = VulkanOptions::CpuDevice;
+    } else if (deviceName != "any") {
+        PyErr_SetString(PyExc_ValueError, "device must be 'any', 'gpu' or 'cpu'");
+        return -1;
+    }
+    options.shaderDir = shaderDir ? shaderDir : BLACKHOLE_SPIRV_DIR;
+    if (renderer->renderer) {
+        PyErr_SetString(PyExc_RuntimeError, "Renderer is already initialized");
+        return -1;
+    }
+    try {
+        renderer->renderer = new VulkanRenderer(options);
+        renderer->pixels = new std::vector<uint8_t>((size_t)options.width * options.height * 4, 0);
+    } catch (const std::exception& e) {
+        delete renderer->renderer;
+        renderer->renderer = nullptr;
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return -1;
+    }
+    return 0;
+}
+
+void rendererDealloc(PyObject* self)
+{
+    RendererObject* renderer = reinterpret_cast<RendererObject*>(self);
+    delete renderer->renderer;
+    delete renderer->pixels;
+    Py_TYPE(self)->tp_free(self);
+}
+
+PyMethodDef kRendererMethods[] = {
+    { "render", rendererRender, METH_VARARGS, "render(time=0): render one frame into image (releases the GIL)" },
+    { "apply_quality_preset", rendererApplyQualityPreset, METH_VARARGS, "apply_quality_preset(0-3)" },
+    { nullptr, nullptr, 0, nullptr },
+};
+
+PyGetSetDef kRendererGetSets[sizeof(kRendererFields) / sizeof(Field) + 4];
+
+PyTypeObject RendererType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+    "blackhole.Renderer",
+};
+
+#endif
+
+template <size_t N>
+size_t addFieldGetSets(PyGetSetDef* getsets, const Field (&fields)[N], getter get, setter set)
+{
+    for (size_t i = 0; i < N; ++i) {
+        getsets[i] = { fields[i].name, get, set, nullptr, const_cast<Field*>(&fields[i]) };
+    }
+    return N;
+}
+
+PyObject* moduleTraceStart(PyObject*, PyObject* args)
+{
+    const char* path = nullptr;
+    if (!PyArg_ParseTuple(args, "|z", &path)) {
+        return nullptr;
+    }
+    traceStart(path);
+    Py_RETURN_NONE;
+}
+
+PyObject* moduleTraceStop(PyObject*, PyObject*)
+{
+    traceStop();
+    Py_RETURN_NONE;
+}
+
+PyObject* moduleTraceDump(PyObject*, PyObject* args)
+{
+    const char* path = nullptr;
+    if (!PyArg_ParseTuple(args, "s", &path)) {
+        return nullptr;
+    }
+    if (!traceDump(path)) {
+        PyErr_Format(PyExc_OSError, "cannot write trace to %s (or tracing compiled out)", path);
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+PyMethodDef kModuleMethods[] = {
+    { "trace_start", moduleTraceStart, METH_VARARGS,
+      "trace_start(path=None): record a timeline; path is written at exit" },
+    { "trace_stop", moduleTraceStop, METH_NOARGS, "Stop recording (events so far are kept)" },
+    { "trace_dump", moduleTraceDump, METH_VARARGS, "trace_dump(path): write Chrome trace JSON" },
+    { nullptr, nullptr, 0, nullptr },
+};
+
+PyModuleDef kModule = {
+    PyModuleDef_HEAD_INIT,
+    "blackhole",
+    "Black hole tracer: lensing tables, per-ray AOVs and (with Vulkan) rendering",
+    -1,
+    kModuleMethods,
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_blackhole()
+{
+    TableType.tp_basicsize = sizeof(TableObject);
+    TableType.tp_flags = Py_TPFLAGS_DEFAULT;
+    TableType.tp_dealloc = tableDealloc;
+    TableType.tp_as_buffer = &tableBufferProcs;
+    TableType.tp_doc = "Engine-owned array (exported through the buffer protocol)";
+    if (PyType_Ready(&TableType) < 0) {
+        return nullptr;
+    }
+
+    size_t n = addFieldGetSets(kTracerGetSets, kTracerFields, tracerGetField, tracerSetField);
+    kTracerGetSets[n++] = { "observer_position", tracerGetObserver, tracerSetObserver,
+                            "Camera position (x, y, z); camera_distance on +z when shorter than 0.1", nullptr };
+    kTracerGetSets[n++] = { "size", tracerGetSize, nullptr, "(width, height)", nullptr };
+    kTracerGetSets[n++] = { "steps", tracerTable, nullptr, "int32 (height, width): march iterations", (void*)0 };
+    kTracerGetSets[n++] = { "termination", tracerTable, nullptr,
+                            "uint8 (height, width): ESCAPED, CAPTURED or ITERATION_LIMIT", (void*)1 };
+    kTracerGetSets[n++] = { "escape_direction", tracerTable, nullptr,
+                            "float32 (height, width, 3): final direction (sky lookup), NaN for captured rays", (void*)2 };
+    kTracerGetSets[n++] = { "disk_hit", tracerTable, nullptr,
+                            "float32 (height, width, 2): radius and azimuth of the first disk crossing, or NaN",
+                            (void*)3 };
+    kTracerGetSets[n] = { nullptr, nullptr, nullptr, nullptr, nullptr };
+
+    TracerType.tp_basicsize = sizeof(TracerObject);
+    TracerType.tp_flags = Py_TPFLAGS_DEFAULT;
+    TracerType.tp_new = PyType_GenericNew;
+    TracerType.tp_init = tracerInit;
+    TracerType.tp_dealloc = tracerDealloc;
+    TracerType.tp_methods = kTracerMethods;
+    TracerType.tp_getset = kTracerGetSets;
+    TracerType.tp_doc = "Tracer(width, height, threads=0): CPU lensing tables and per-ray AOVs";
+    if (PyType_Ready(&TracerType) < 0) {
+        return nullptr;
+    }
+
+#ifdef BLACKHOLE_WITH_VULKAN
+    n = addFieldGetSets(kRendererGetSets, kRendererFields, rendererGetField, rendererSetField);
+    kRendererGetSets[n++] = { "observer_position", rendererGetObserver, rendererSetObserver,
+                              "Camera position (x, y, z)", nullptr };
+    kRendererGetSets[n++] = { "image", rendererImage, nullptr, "uint8 (height, width, 4): last rendered frame",
+                              nullptr };
+    kRendererGetSets[n] = { nullptr, nullptr, nullptr, nullptr, nullptr };
+
+    RendererType.tp_basicsize = sizeof(RendererObject);
+    RendererType.tp_flags = Py_TPFLAGS_DEFAULT;
+    RendererType.tp_new = PyType_GenericNew;
+    RendererType.tp_init = rendererInit;
+    RendererType.tp_dealloc = rendererDealloc;
+    RendererType.tp_methods = kRendererMethods;
+    RendererType.tp_getset = kRendererGetSets;
+    RendererType.tp_doc = "Renderer(width, height, quality=2, integrator=1, device='any', shader_dir=None)";
+    if (PyType_Ready(&RendererType) < 0) {
+        return nullptr;
+    }
+#endif
+
+    PyObject* module = PyModule_Create(&kModule);
+    if (!module) {
+        return nullptr;
+    }
+    Py_INCREF(&TracerType);
+    PyModule_AddObject(module, "Tracer", reinterpret_cast<PyObject*>(&TracerType));
+#ifdef BLACKHOLE_WITH_VULKAN
+    Py_INCREF(&RendererType);
+    PyModule_AddObject(module, "Renderer", reinterpret_cast<PyObject*>(&RendererType));
+#endif
+    PyModule_AddIntConstant(module, "ESCAPED", RayEscaped);
+    PyModule_AddIntConstant(module, "CAPTURED", RayCaptured);
+    PyModule_AddIntConstant(module, "ITERATION_LIMIT", RayIterationLimit);
+    PyModule_AddIntConstant(module, "VERLET", GEODESIC_VERLET);
+    PyModule_AddIntConstant(module, "RK4", GEODESIC_RK4);
+    PyModule_AddIntConstant(module, "YOSHIDA4", GEODESIC_YOSHIDA4);
+    PyModule_AddIntConstant(module, "YOSHIDA6", GEODESIC_YOSHIDA6);
+    return module;
+}
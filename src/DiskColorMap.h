@@ -0,0 +1,44 @@
+/**
+ * DiskColorMap.h
+ *
+ * Disk colour map gradient (hot inner edge to cool rim)
+ *
+ * The same 256 x 1 RGBA8 ramp the Metal renderer builds in init(); shared
+ * by the Vulkan backend and the CPU shading ports in tools/.
+ */
+
+#ifndef DiskColorMap_h
+#define DiskColorMap_h
+
+#include <cmath>
+#include <cstdint>
+
+inline void fillDiskColorMap(uint8_t* rgba, int width)
+{
+    for (int x = 0; x < width; x++) {
+        float t = (float)x / (float)(width - 1);
+        float r, g, b;
+        if (t < 0.3f) {
+            float localT = t / 0.3f;
+            r = 0.8f + 0.2f * localT;
+            g = 0.85f + 0.15f * localT;
+            b = 1.0f;
+        } else if (t < 0.6f) {
+            float localT = (t - 0.3f) / 0.3f;
+            r = 1.0f;
+            g = 1.0f - 0.2f * localT;
+            b = 1.0f - 0.5f * localT;
+        } else {
+            float localT = (t - 0.6f) / 0.4f;
+            r = 1.0f - 0.2f * localT;
+            g = 0.8f - 0.5f * localT;
+            b = 0.5f - 0.3f * localT;
+        }
+        rgba[x * 4 + 0] = (uint8_t)(powf(r, 0.9f) * 255.0f);
+        rgba[x * 4 + 1] = (uint8_t)(g * 255.0f);
+        rgba[x * 4 + 2] = (uint8_t)(powf(b, 1.1f) * 255.0f);
+        rgba[x * 4 + 3] = 255;
+    }
+}
+
+#endif
@@ -0,0 +1,181 @@
+/**
+ * Emitters.cpp
+ *
+ * Orbit evaluation and uniform-grid binning for the orbiting emitters.
+ */
+
+#include "Emitters.hpp"
+#include "Philox.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr int kCells = EMITTER_GRID_DIM * EMITTER_GRID_DIM * EMITTER_GRID_DIM;
+
+// Orbital speed in units of c, same profile as the disk Doppler term
+float orbitalBeta(float r)
+{
+    if (r <= 3.0f) {
+        return 0.5f;
+    }
+    return std::sqrt((1.0f / r) * (1.0f - 3.0f / r));
+}
+
+// Rotate an in-plane vector (x, 0, z) into the tilted orbital plane
+vector_float3 orient(float x, float z, float inclination, float node)
+{
+    float ci = std::cos(inclination), si = std::sin(inclination);
+    float cn = std::cos(node), sn = std::sin(node);
+    // Tilt about X, then rotate about Y
+    float y = z * si;
+    float zt = z * ci;
+    return vector_float3{ x * cn + zt * sn, y, -x * sn + zt * cn };
+}
+
+int cellCoord(float v, float origin, float invCell)
+{
+    int i = (int)std::floor((v - origin) * invCell);
+    return std::clamp(i, 0, EMITTER_GRID_DIM - 1);
+}
+
+} // namespace
+
+void EmitterSystem::setStar(bool enabled, const EmitterOrbit& orbit)
+{
+    _hasStar = enabled;
+    _star = orbit;
+}
+
+void EmitterSystem::scatterHotSpots(int count, float innerRadius, float outerRadius, float thickness,
+                                    float size, float brightness, float speed, uint32_t seed)
+{
+    count = std::clamp(count, 0, MAX_EMITTERS - 1);
+    _hotSpots.resize(count);
+    auto range = [](float u, float lo, float hi) { return lo + (hi - lo) * u; };
+    for (int i = 0; i < count; ++i) {
+        EmitterOrbit& o = _hotSpots[i];
+        // Eight Philox draws per hot spot: adding spots keeps existing ones in place
+        float u[8];
+        philoxFillUniform(seed, PHILOX_STREAM_HOTSPOTS, (uint32_t)i, 0, 0, u, 8);
+        // Uniform in area across the annulus
+        o.radius = std::sqrt(innerRadius * innerRadius + u[0] * (outerRadius * outerRadius - innerRadius * innerRadius));
+        o.inclination = range(u[1], -thickness, thickness);
+        o.node = range(u[2], 0.0f, 6.2831853f);
+        o.phase = range(u[3], 0.0f, 6.2831853f);
+        o.angularSpeed = speed * std::pow(6.0f / o.radius, 1.5f);
+        o.size = size * range(u[4], 0.6f, 1.4f);
+        o.brightness = brightness * range(u[5], 0.5f, 1.5f);
+        // Hotter near the hole, like the disk (T ∝ r^-3/4)
+        o.temperature = 20000.0f * std::pow(o.radius / innerRadius, -0.75f) * range(u[6], 0.8f, 1.2f);
+        float warm = std::clamp((o.radius - innerRadius) / std::max(outerRadius - innerRadius, 1e-3f), 0.0f, 1.0f);
+        o.color = vector_float3{ 1.0f, 0.85f - 0.25f * warm, 0.7f - 0.45f * warm };
+    }
+}
+
+size_t EmitterSystem::count() const
+{
+    return _hotSpots.size() + (_hasStar ? 1 : 0);
+}
+
+void EmitterSystem::build(float time, float segmentLength, void* frame)
+{
+    auto* bytes = static_cast<uint8_t*>(frame);
+    auto* grid = reinterpret_cast<EmitterGrid*>(bytes + kGridOffset);
+    auto* cells = reinterpret_cast<vector_uint2*>(bytes + kCellsOffset);
+    auto* refs = reinterpret_cast<uint32_t*>(bytes + kRefsOffset);
+    auto* out = reinterpret_cast<Emitter*>(bytes + kEmittersOffset);
+
+    // Advance orbits
+    _emitters.clear();
+    auto emit = [&](const EmitterOrbit& o) {
+        float angle = o.phase + time * o.angularSpeed;
+        float c = std::cos(angle), s = std::sin(angle);
+        vector_float3 p = orient(o.radius * c, o.radius * s, o.inclination, o.node);
+        float beta = orbitalBeta(o.radius) * (o.angularSpeed < 0.0f ? -1.0f : 1.0f);
+        vector_float3 v = orient(-s * beta, c * beta, o.inclination, o.node);
+
+        Emitter e;
+        e.position_radius = vector_float4{ p[0], p[1], p[2], o.size };
+        e.velocity = vector_float4{ v[0], v[1], v[2], 0.0f };
+        e.emission = vector_float4{ o.color[0] * o.brightness, o.color[1] * o.brightness,
+                                    o.color[2] * o.brightness, o.temperature };
+        _emitters.push_back(e);
+    };
+    if (_hasStar) {
+        emit(_star);
+    }
+    for (const EmitterOrbit& o : _hotSpots) {
+        emit(o);
+    }
+
+    std::memset(grid, 0, sizeof(EmitterGrid));
+    grid->max_blur = kMaxBlur;
+    if (_emitters.empty()) {
+        return;
+    }
+
+    // A segment can only touch spheres whose centres lie within
+    // radius·maxBlur + segmentLength/2 of its midpoint
+    const float margin = 0.5f * segmentLength;
+    auto reach = [&](const Emitter& e) { return e.position_radius[3] * kMaxBlur + margin; };
+
+    float lo[3] = { 1e30f, 1e30f, 1e30f };
+    float hi[3] = { -1e30f, -1e30f, -1e30f };
+    for (const Emitter& e : _emitters) {
+        float r = reach(e);
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = std::min(lo[a], e.position_radius[a] - r);
+            hi[a] = std::max(hi[a], e.position_radius[a] + r);
+        }
+    }
+    float inv[3];
+    for (int a = 0; a < 3; ++a) {
+        inv[a] = (float)EMITTER_GRID_DIM / std::max(hi[a] - lo[a], 1e-4f);
+    }
+
+    // Counting sort of sphere-cell overlaps: count, prefix sum, scatter
+    _cellCounts.assign(kCells, 0);
+    auto forEachCell = [&](const Emitter& e, auto&& fn) {
+        float r = reach(e);
+        int c0[3], c1[3];
+        for (int a = 0; a < 3; ++a) {
+            c0[a] = cellCoord(e.position_radius[a] - r, lo[a], inv[a]);
+            c1[a] = cellCoord(e.position_radius[a] + r, lo[a], inv[a]);
+        }
+        for (int z = c0[2]; z <= c1[2]; ++z) {
+            for (int y = c0[1]; y <= c1[1]; ++y) {
+                for (int x = c0[0]; x <= c1[0]; ++x) {
+                    fn((z * EMITTER_GRID_DIM + y) * EMITTER_GRID_DIM + x);
+                }
+            }
+        }
+    };
+    for (const Emitter& e : _emitters) {
+        forEachCell(e, [&](int cell) { ++_cellCounts[cell]; });
+    }
+
+    uint32_t total = 0;
+    for (int i = 0; i < kCells; ++i) {
+        uint32_t n = std::min<uint32_t>(_cellCounts[i], MAX_EMITTER_REFS - total);
+        cells[i] = vector_uint2{ total, 0 };
+        _cellCounts[i] = n;
+        total += n;
+    }
+    for (uint32_t index = 0; index < (uint32_t)_emitters.size(); ++index) {
+        forEachCell(_emitters[index], [&](int cell) {
+            vector_uint2& range = cells[cell];
+            if (range[1] < _cellCounts[cell]) {
+                refs[range[0] + range[1]] = index;
+                ++range[1];
+            }
+        });
+    }
+
+    std::memcpy(out, _emitters.data(), sizeof(Emitter) * _emitters.size());
+    grid->origin = vector_float4{ lo[0], lo[1], lo[2], 0.0f };
+    grid->inv_cell_size = vector_float4{ inv[0], inv[1], inv[2], 0.0f };
+    grid->emitter_count = (uint32_t)_emitters.size();
+    grid->ref_count = total;
+}
@@ -0,0 +1,98 @@
+/**
+ * Emitters.hpp
+ *
+ * Host-side orbiting emitters and their per-frame acceleration grid
+ *
+ * Keeps the orbital elements of every compact light source (the legacy
+ * orbiting star plus any number of disk hot spots), advances them to the
+ * current time and bins them into the uniform grid described in
+ * ShaderTypes.h (EmitterGrid). Pure C++; the renderer writes the result
+ * straight into one of its in-flight GPU buffers.
+ */
+
+#pragma once
+#include "ShaderTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Circular orbit of one emitter
+ *
+ * The orbit lies in the XZ plane, tilted by inclination about the X axis
+ * and then rotated by node about the Y axis. With both at zero the angle
+ * phase + angularSpeed·t matches the legacy orbiting star.
+ */
+struct EmitterOrbit
+{
+    float radius;                   // Orbital radius (Schwarzschild radius = 1)
+    float inclination;              // Tilt of the orbital plane (radians)
+    float node;                     // Longitude of ascending node (radians)
+    float phase;                    // Orbital angle at t = 0 (radians)
+    float angularSpeed;             // Animation speed (rad per unit time, sign sets direction)
+    float size;                     // Sphere radius
+    float brightness;               // Emission multiplier
+    float temperature;              // Blackbody temperature for spectral mode (K)
+    vector_float3 color;            // Linear RGB colour outside spectral mode
+};
+
+class EmitterSystem
+{
+public:
+    // Byte offsets of each section within a frame buffer (256-aligned for binding)
+    static constexpr size_t kGridOffset = 0;
+    static constexpr size_t kCellsOffset = 256;
+    static constexpr size_t kRefsOffset = kCellsOffset + sizeof(vector_uint2) * EMITTER_GRID_DIM * EMITTER_GRID_DIM * EMITTER_GRID_DIM;
+    static constexpr size_t kEmittersOffset = kRefsOffset + sizeof(uint32_t) * MAX_EMITTER_REFS;
+    static constexpr size_t kFrameBytes = kEmittersOffset + sizeof(Emitter) * MAX_EMITTERS;
+
+    // Footprint blur the shader may apply, in multiples of the emitter radius
+    static constexpr float kMaxBlur = 2.0f;
+
+    /**
+     * Set or clear the legacy orbiting star (always emitter 0 when present)
+     */
+    void setStar(bool enabled, const EmitterOrbit& orbit);
+
+    /**
+     * Replace the hot spots with count random orbits
+     *
+     * Hot spots ride Keplerian orbits in a slightly puffed disk plane, so
+     * inner ones move faster. Deterministic for a given seed.
+     *
+     * @param count Number of hot spots (clamped so the total fits MAX_EMITTERS)
+     * @param innerRadius Smallest orbital radius
+     * @param outerRadius Largest orbital radius
+     * @param thickness Maximum inclination (radians)
+     * @param size Typical sphere radius
+     * @param brightness Emission multiplier
+     * @param speed Angular speed at radius 6 (scaled as r^-1.5 elsewhere)
+     * @param seed Random seed
+     */
+    void scatterHotSpots(int count, float innerRadius, float outerRadius, float thickness,
+                         float size, float brightness, float speed, uint32_t seed);
+
+    size_t count() const;
+
+    /**
+     * Advance all emitters to time and build the acceleration grid
+     *
+     * Writes EmitterGrid, cells, references and emitters into frame at the
+     * k*Offset positions above. References beyond MAX_EMITTER_REFS are
+     * dropped (those emitters disappear from the affected cells only).
+     *
+     * @param time Animation time (Uniforms::time)
+     * @param segmentLength Longest integration segment the shader will test
+     * @param frame Destination of at least kFrameBytes
+     */
+    void build(float time, float segmentLength, void* frame);
+
+private:
+    bool _hasStar = false;
+    EmitterOrbit _star = {};
+    std::vector<EmitterOrbit> _hotSpots;
+
+    // Scratch reused across frames
+    std::vector<Emitter> _emitters;
+    std::vector<uint32_t> _cellCounts;
+};
@@ -0,0 +1,182 @@
+/**
+ * LensingTracer.cpp
+ *
+ * CPU lensing tables and per-ray AOVs
+ */
+
+#include "LensingTracer.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+struct Vec3
+{
+    float x, y, z;
+};
+
+inline Vec3 operator+(Vec3 a, Vec3 b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+inline Vec3 operator-(Vec3 a, Vec3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline Vec3 operator*(Vec3 a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+inline float dot(Vec3 a, Vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 cross(Vec3 a, Vec3 b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+inline Vec3 normalize(Vec3 a) { return a * (1.0f / std::sqrt(dot(a, a))); }
+
+const float kNaN = std::numeric_limits<float>::quiet_NaN();
+const float kEscapeRadius = 100.0f;
+
+} // namespace
+
+LensingTracer::LensingTracer(int width, int height, int threads)
+{
+    resize(width, height);
+    if (threads <= 0) {
+        threads = (int)std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    // The calling thread works too
+    for (int i = 1; i < threads; ++i) {
+        _workers.emplace_back(&LensingTracer::workerLoop, this);
+    }
+}
+
+LensingTracer::~LensingTracer()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for (std::thread& worker : _workers) {
+        worker.join();
+    }
+}
+
+void LensingTracer::resize(int width, int height)
+{
+    _width = std::max(width, 1);
+    _height = std::max(height, 1);
+    size_t pixels = (size_t)_width * _height;
+    _steps.assign(pixels, 0);
+    _termination.assign(pixels, RayIterationLimit);
+    _escape.assign(pixels * 3, kNaN);
+    _disk.assign(pixels * 2, kNaN);
+}
+
+void LensingTracer::trace(const LensingParams& params)
+{
+    TRACE_SCOPE("tracer", "trace");
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _params = params;
+        _params.integration_method = std::clamp(params.integration_method, 0, GEODESIC_INTEGRATOR_COUNT - 1);
+        _nextRow = 0;
+        _activeWorkers = (int)_workers.size();
+        ++_generation;
+    }
+    _wake.notify_all();
+    traceRows();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _activeWorkers == 0; });
+}
+
+void LensingTracer::workerLoop()
+{
+    traceThreadName("Tracer worker");
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return _stopping || _generation != seen; });
+            if (_stopping) {
+                return;
+            }
+            seen = _generation;
+        }
+        traceRows();
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (--_activeWorkers == 0) {
+            _done.notify_one();
+        }
+    }
+}
+
+void LensingTracer::traceRows()
+{
+    for (int y = _nextRow++; y < _height; y = _nextRow++) {
+        TRACE_SCOPE_ARG("tracer", "row", y);
+        for (int x = 0; x < _width; ++x) {
+            traceRay(x, y);
+        }
+    }
+}
+
+// primaryRay and the march of rayMarch, recording instead of shading
+void LensingTracer::traceRay(int x, int y)
+{
+    const LensingParams& p = _params;
+    size_t index = (size_t)y * _width + x;
+
+    float u = (2.0f * (float)x - (float)_width) / (float)_height;
+    float v = (2.0f * (float)y - (float)_height) / (float)_height;
+    Vec3 observer = { p.observer_position[0], p.observer_position[1], p.observer_position[2] };
+    Vec3 pos = dot(observer, observer) > 0.01f ? observer : Vec3{ 0.0f, 0.0f, p.camera_distance };
+    Vec3 forward = normalize(pos * -1.0f);
+    Vec3 right = normalize(cross(Vec3{ 0.0f, 1.0f, 0.0f }, forward));
+    Vec3 up = cross(forward, right);
+    Vec3 dir = normalize(right * u + up * v + forward);
+
+    Vec3 h = cross(pos, dir);
+    float h2 = dot(h, h);
+    float innerRadius = p.black_hole_size * std::max(p.disk_inner_multiplier, 1.0f);
+    float* disk = &_disk[index * 2];
+    float* escape = &_escape[index * 3];
+    disk[0] = disk[1] = kNaN;
+    escape[0] = escape[1] = escape[2] = kNaN;
+    _termination[index] = RayIterationLimit;
+
+    int steps = 0;
+    while (steps < p.max_iterations) {
+        float stepSize = p.step_size;
+        if (p.adaptive_stepping) {
+            float r = std::sqrt(dot(pos, pos));
+            if (r < 3.0f) {
+                stepSize = p.step_size * (r / 3.0f);
+            }
+        }
+
+        Vec3 prevPos = pos;
+        geodesicStep(p.integration_method, pos, dir, h2, stepSize, p.gravity);
+        ++steps;
+
+        if (dot(pos, pos) < 1.0f) {
+            _steps[index] = steps;
+            _termination[index] = RayCaptured;
+            return;
+        }
+
+        // First crossing of the y = 0 plane inside the annulus
+        if (std::isnan(disk[0]) && (prevPos.y > 0.0f) != (pos.y > 0.0f)) {
+            Vec3 hit = prevPos + (pos - prevPos) * (prevPos.y / (prevPos.y - pos.y));
+            float radius = std::sqrt(hit.x * hit.x + hit.z * hit.z);
+            if (radius >= innerRadius && radius <= p.disk_radius) {
+                disk[0] = radius;
+                disk[1] = std::atan2(hit.z, hit.x);
+            }
+        }
+
+        if (dot(pos, pos) > kEscapeRadius * kEscapeRadius) {
+            _termination[index] = RayEscaped;
+            break;
+        }
+    }
+
+    _steps[index] = steps;
+    // rayMarch shades the sky along dir whether the ray escaped or ran out of steps
+    Vec3 out = normalize(dir);
+    escape[0] = out.x;
+    escape[1] = out.y;
+    escape[2] = out.z;
+}
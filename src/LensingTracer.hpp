@@ -0,0 +1,106 @@
+/**
+ * LensingTracer.hpp
+ *
+ * CPU lensing tables and per-ray AOVs
+ *
+ * Marches one camera ray per pixel exactly as rayMarch does (same camera,
+ * adaptive step rule, integrators from Geodesic.h, horizon at r = 1 and
+ * escape at r = 100) but shades nothing. Instead every pixel records:
+ *
+ *   steps        march iterations taken
+ *   termination  RayEscaped, RayCaptured or RayIterationLimit
+ *   escape       final direction, the one rayMarch looks the sky up
+ *                with (the lensing map from screen to sky); NaN for
+ *                captured rays
+ *   disk         radius and azimuth where the ray first crossed the disk
+ *                plane inside the disk annulus; NaN if it never did
+ *
+ * The disk is treated as transparent, so rays behind it are traced on to
+ * the sky or the horizon (rayMarch stops once the disk is opaque).
+ *
+ * The tables live in the tracer and are reused by every trace(), so a
+ * parameter sweep allocates nothing per point. Rows are split between
+ * persistent worker threads.
+ */
+
+#pragma once
+#include "Geodesic.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Uniforms fields the march depends on (same names and defaults as Renderer)
+struct LensingParams
+{
+    float gravity = 2.5f;
+    float camera_distance = 8.0f;
+    float observer_position[3] = { 0.0f, 0.0f, 0.0f };  // Used when longer than 0.1
+    float step_size = 0.1f;
+    int max_iterations = 256;
+    bool adaptive_stepping = true;
+    int integration_method = GEODESIC_RK4;
+    float disk_radius = 5.0f;
+    float black_hole_size = 0.12f;
+    float disk_inner_multiplier = 25.0f;    // Inner disk edge at black_hole_size × this
+};
+
+enum RayTermination : uint8_t
+{
+    RayEscaped = 0,
+    RayCaptured = 1,        // Crossed the horizon
+    RayIterationLimit = 2   // max_iterations reached inside r = 100
+};
+
+class LensingTracer
+{
+public:
+    // threads <= 0 uses every hardware thread
+    explicit LensingTracer(int width, int height, int threads = 0);
+    ~LensingTracer();
+
+    LensingTracer(const LensingTracer&) = delete;
+    LensingTracer& operator=(const LensingTracer&) = delete;
+
+    // Reallocate the tables; pointers from the accessors become invalid
+    void resize(int width, int height);
+
+    // Trace every pixel with params, overwriting the tables
+    void trace(const LensingParams& params);
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+    int threads() const { return (int)_workers.size() + 1; }
+
+    // Row-major, top row first
+    int32_t* steps() { return _steps.data(); }
+    uint8_t* termination() { return _termination.data(); }
+    float* escapeDirection() { return _escape.data(); }    // 3 floats per pixel
+    float* diskHit() { return _disk.data(); }              // radius, azimuth per pixel
+
+private:
+    void workerLoop();
+    void traceRows();
+    void traceRay(int x, int y);
+
+    int _width = 0;
+    int _height = 0;
+    std::vector<int32_t> _steps;
+    std::vector<uint8_t> _termination;
+    std::vector<float> _escape;
+    std::vector<float> _disk;
+
+    // Current job (valid while a trace() runs)
+    LensingParams _params;
+    std::atomic<int> _nextRow{ 0 };
+    int _activeWorkers = 0;
+    uint64_t _generation = 0;
+    bool _stopping = false;
+
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+};
@@ -0,0 +1,251 @@
+/**
+ * LightCurve.cpp
+ *
+ * Option parsing, adaptive tile plans and CSV output for light curves.
+ */
+
+#include "LightCurve.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+bool parseFloat(const char* text, float& value)
+{
+    char* end = nullptr;
+    value = std::strtof(text, &end);
+    return end != text && *end == '\0';
+}
+
+bool parseInt(const char* text, int& value)
+{
+    char* end = nullptr;
+    long parsed = std::strtol(text, &end, 10);
+    value = (int)parsed;
+    return end != text && *end == '\0';
+}
+
+} // namespace
+
+const char* lightCurveUsage()
+{
+    return "Usage: BlackHole --lightcurve [options]\n"
+           "  --sweep time|inclination   Quantity varied across epochs (default time)\n"
+           "  --from X --to Y            Sweep range (seconds or degrees from the disk axis)\n"
+           "  --epochs N                 Number of epochs (default 600)\n"
+           "  --inclination DEG          Fixed inclination for time sweeps (default 80)\n"
+           "  --time T                   Fixed time for inclination sweeps (default 0)\n"
+           "  --size WxH                 Base resolution, one coarse sample per pixel (default 256x256)\n"
+           "  --refine SHARE             Flux share of the tiles that are refined (default 0.95)\n"
+           "  --levels N                 Refined tiles use up to 4^N samples per pixel (default 2)\n"
+           "  --sky                      Include the background sky in the flux\n"
+           "  --out PATH                 CSV output (default lightcurve.csv)\n";
+}
+
+bool parseLightCurveArgs(int argc, char** argv, LightCurveOptions& options, std::string& error)
+{
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto need = [&]() {
+            if (!value) {
+                error = arg + " needs a value";
+                return false;
+            }
+            ++i;
+            return true;
+        };
+        bool ok = true;
+        if (arg == "--sweep") {
+            if (!need()) return false;
+            if (std::strcmp(value, "time") == 0) {
+                options.sweep = LightCurveOptions::Time;
+            } else if (std::strcmp(value, "inclination") == 0) {
+                options.sweep = LightCurveOptions::Inclination;
+            } else {
+                ok = false;
+            }
+        } else if (arg == "--from") {
+            ok = need() && parseFloat(value, options.from);
+        } else if (arg == "--to") {
+            ok = need() && parseFloat(value, options.to);
+        } else if (arg == "--epochs") {
+            ok = need() && parseInt(value, options.epochs) && options.epochs > 0;
+        } else if (arg == "--inclination") {
+            ok = need() && parseFloat(value, options.inclination);
+        } else if (arg == "--time") {
+            ok = need() && parseFloat(value, options.time);
+        } else if (arg == "--size") {
+            ok = need() && std::sscanf(value, "%dx%d", &options.width, &options.height) == 2 &&
+                 options.width >= LIGHT_CURVE_TILE && options.height >= LIGHT_CURVE_TILE;
+        } else if (arg == "--refine") {
+            ok = need() && parseFloat(value, options.refineShare) &&
+                 options.refineShare >= 0.0f && options.refineShare <= 1.0f;
+        } else if (arg == "--levels") {
+            ok = need() && parseInt(value, options.maxLevel) && options.maxLevel >= 0 && options.maxLevel <= 4;
+        } else if (arg == "--sky") {
+            options.sky = true;
+        } else if (arg == "--out") {
+            ok = need();
+            if (ok) {
+                options.output = value;
+            }
+        } else {
+            error = "unknown option " + arg;
+            return false;
+        }
+        if (!ok) {
+            error = "bad value for " + arg;
+            return false;
+        }
+    }
+    return true;
+}
+
+LightCurvePlan::LightCurvePlan(const LightCurveOptions& options)
+    : _options(options),
+      _tilesX((options.width + LIGHT_CURVE_TILE - 1) / LIGHT_CURVE_TILE),
+      _tilesY((options.height + LIGHT_CURVE_TILE - 1) / LIGHT_CURVE_TILE)
+{
+    _coarse.reserve(tileCount());
+    for (int y = 0; y < _tilesY; ++y) {
+        for (int x = 0; x < _tilesX; ++x) {
+            LightCurveTile tile = {};
+            tile.origin = vector_float2{ (float)(x * LIGHT_CURVE_TILE), (float)(y * LIGHT_CURVE_TILE) };
+            tile.step = 1.0f;
+            tile.tile = (uint32_t)(y * _tilesX + x);
+            _coarse.push_back(tile);
+        }
+    }
+    _level.assign(tileCount(), 0);
+    _order.resize(tileCount());
+}
+
+size_t LightCurvePlan::maxRefined() const
+{
+    return (size_t)tileCount() << (2 * _options.maxLevel);
+}
+
+const std::vector<LightCurveTile>& LightCurvePlan::refine(const float* coarseFlux)
+{
+    _refined.clear();
+    std::fill(_level.begin(), _level.end(), 0);
+    _refinedTiles = 0;
+    if (_options.maxLevel == 0) {
+        return _refined;
+    }
+
+    double total = 0.0;
+    for (int i = 0; i < tileCount(); ++i) {
+        _order[i] = (uint32_t)i;
+        total += std::max(coarseFlux[4 * i + 3], 0.0f);
+    }
+    if (total <= 0.0) {
+        return _refined;
+    }
+    std::sort(_order.begin(), _order.end(), [&](uint32_t a, uint32_t b) {
+        return coarseFlux[4 * a + 3] > coarseFlux[4 * b + 3];
+    });
+
+    // Brightest first until the requested share of the flux is covered
+    double covered = 0.0;
+    for (uint32_t i : _order) {
+        float luminance = coarseFlux[4 * i + 3];
+        if (covered >= _options.refineShare * total || luminance <= 0.0f) {
+            break;
+        }
+        int level = covered < 0.5 * total ? _options.maxLevel : std::max(_options.maxLevel - 1, 1);
+        covered += luminance;
+        _level[i] = (uint8_t)level;
+        ++_refinedTiles;
+    }
+
+    // Sub-tiles in coarse-tile order, so combine() can walk both lists together
+    for (int i = 0; i < tileCount(); ++i) {
+        int level = _level[i];
+        if (level == 0) {
+            continue;
+        }
+        int split = 1 << level;
+        float step = 1.0f / (float)split;
+        float span = LIGHT_CURVE_TILE * step;
+        for (int sy = 0; sy < split; ++sy) {
+            for (int sx = 0; sx < split; ++sx) {
+                LightCurveTile tile = {};
+                tile.origin = vector_float2{ _coarse[i].origin[0] + sx * span, _coarse[i].origin[1] + sy * span };
+                tile.step = step;
+                tile.tile = (uint32_t)i;
+                _refined.push_back(tile);
+            }
+        }
+    }
+    return _refined;
+}
+
+void LightCurvePlan::combine(const float* coarseFlux, const float* refinedFlux, double flux[4]) const
+{
+    std::vector<double> tileFlux((size_t)tileCount() * 4, 0.0);
+    for (int i = 0; i < tileCount(); ++i) {
+        if (_level[i] == 0) {
+            for (int c = 0; c < 4; ++c) {
+                tileFlux[4 * i + c] = coarseFlux[4 * i + c];
+            }
+        }
+    }
+    for (size_t j = 0; j < _refined.size(); ++j) {
+        uint32_t i = _refined[j].tile;
+        for (int c = 0; c < 4; ++c) {
+            tileFlux[4 * i + c] += refinedFlux[4 * j + c];
+        }
+    }
+    for (int c = 0; c < 4; ++c) {
+        flux[c] = 0.0;
+    }
+    for (int i = 0; i < tileCount(); ++i) {
+        for (int c = 0; c < 4; ++c) {
+            flux[c] += tileFlux[4 * i + c];
+        }
+    }
+}
+
+uint64_t LightCurvePlan::samples() const
+{
+    const uint64_t perTile = LIGHT_CURVE_TILE * LIGHT_CURVE_TILE;
+    return ((uint64_t)_coarse.size() + _refined.size()) * perTile;
+}
+
+LightCurveWriter::~LightCurveWriter()
+{
+    close();
+}
+
+bool LightCurveWriter::open(const LightCurveOptions& options, std::string& error)
+{
+    close();
+    _file = std::fopen(options.output.c_str(), "w");
+    if (!_file) {
+        error = "cannot create " + options.output + ": " + std::strerror(errno);
+        return false;
+    }
+    std::fprintf(_file, "epoch,time,inclination,flux_r,flux_g,flux_b,flux_y,samples,refined_tiles\n");
+    return true;
+}
+
+void LightCurveWriter::write(int epoch, float time, float inclination, const double flux[4], uint64_t samples, int refinedTiles)
+{
+    if (!_file) {
+        return;
+    }
+    std::fprintf(_file, "%d,%.6g,%.6g,%.9g,%.9g,%.9g,%.9g,%llu,%d\n", epoch, time, inclination,
+                 flux[0], flux[1], flux[2], flux[3], (unsigned long long)samples, refinedTiles);
+}
+
+void LightCurveWriter::close()
+{
+    if (_file) {
+        std::fclose(_file);
+        _file = nullptr;
+    }
+}
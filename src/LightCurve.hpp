@@ -0,0 +1,118 @@
+/**
+ * LightCurve.hpp
+ *
+ * Headless light curves: integrated flux versus time or inclination
+ *
+ * Each epoch is traced without storing an image. lightCurveShader reduces
+ * every LIGHT_CURVE_TILE² block of samples to one flux sum (RGB bands and
+ * luminance, weighted by solid angle). A coarse pass at one sample per
+ * pixel finds where the flux is; the tiles holding most of it are traced
+ * again at up to 4^max_level samples per pixel and replace their coarse
+ * sums. Dark tiles, usually most of the frame, are never refined.
+ *
+ * Flux is Σ I·dΩ over the image in the renderer's HDR units; the sky is
+ * left out unless requested.
+ */
+
+#pragma once
+#include "ShaderTypes.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct LightCurveOptions
+{
+    enum Sweep { Time, Inclination };
+
+    Sweep sweep = Time;
+    float from = 0.0f;              // First epoch (seconds, or degrees from the disk axis)
+    float to = 60.0f;               // Last epoch
+    int epochs = 600;
+    float inclination = 80.0f;      // Fixed inclination for time sweeps (degrees)
+    float time = 0.0f;              // Fixed time for inclination sweeps
+    int width = 256;                // Base image size (one coarse sample per pixel)
+    int height = 256;
+    float refineShare = 0.95f;      // Refine the brightest tiles holding this share of the flux
+    int maxLevel = 2;               // Refined tiles use up to 4^maxLevel samples per pixel
+    bool sky = false;               // Include the background sky
+    std::string output = "lightcurve.csv";
+};
+
+/**
+ * Parse the arguments following --lightcurve
+ *
+ * @return false with a message on unknown options or bad values
+ */
+bool parseLightCurveArgs(int argc, char** argv, LightCurveOptions& options, std::string& error);
+
+// Command-line help for --lightcurve
+const char* lightCurveUsage();
+
+/**
+ * Tile plans and sums for one epoch
+ */
+class LightCurvePlan
+{
+public:
+    explicit LightCurvePlan(const LightCurveOptions& options);
+
+    int tilesX() const { return _tilesX; }
+    int tilesY() const { return _tilesY; }
+    int tileCount() const { return _tilesX * _tilesY; }
+
+    // Coarse pass: every tile at one sample per pixel
+    const std::vector<LightCurveTile>& coarse() const { return _coarse; }
+
+    // Largest refined list refine() can produce
+    size_t maxRefined() const;
+
+    /**
+     * Choose refinement levels from the coarse sums
+     *
+     * Tiles are ranked by luminance. Those holding the first half of the
+     * flux get maxLevel, the rest up to refineShare get maxLevel - 1 (at
+     * least 1); all others keep their coarse value.
+     *
+     * @param coarseFlux One float4 (R, G, B, luminance) per coarse tile
+     * @return Sub-tiles to trace, grouped by coarse tile
+     */
+    const std::vector<LightCurveTile>& refine(const float* coarseFlux);
+
+    /**
+     * Combine coarse and refined sums
+     *
+     * @param refinedFlux One float4 per entry of the last refine() list
+     * @param[out] flux R, G, B, luminance
+     */
+    void combine(const float* coarseFlux, const float* refinedFlux, double flux[4]) const;
+
+    // Samples traced in the last epoch (coarse + refined)
+    uint64_t samples() const;
+    int refinedTiles() const { return _refinedTiles; }
+
+private:
+    LightCurveOptions _options;
+    int _tilesX;
+    int _tilesY;
+    std::vector<LightCurveTile> _coarse;
+    std::vector<LightCurveTile> _refined;
+    std::vector<uint8_t> _level;
+    std::vector<uint32_t> _order;
+    int _refinedTiles = 0;
+};
+
+/**
+ * CSV output, one row per epoch
+ */
+class LightCurveWriter
+{
+public:
+    ~LightCurveWriter();
+    bool open(const LightCurveOptions& options, std::string& error);
+    void write(int epoch, float time, float inclination, const double flux[4], uint64_t samples, int refinedTiles);
+    void close();
+
+private:
+    FILE* _file = nullptr;
+};
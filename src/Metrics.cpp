@@ -0,0 +1,291 @@
+/**
+ * Metrics.cpp
+ *
+ * Worker health and throughput metrics (Prometheus text format)
+ */
+
+#include "Metrics.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+namespace {
+
+// Threads take shards round-robin on first use
+int threadShard()
+{
+    static std::atomic<int> next{ 0 };
+    thread_local int shard = next.fetch_add(1, std::memory_order_relaxed) % MetricCounter::kShards;
+    return shard;
+}
+
+void appendNumber(std::string& text, double value)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    text += buffer;
+}
+
+// A scraper hanging up early must not kill the renderer with SIGPIPE
+#ifdef MSG_NOSIGNAL
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+bool sendAll(int socket, const std::string& data)
+{
+#ifdef SO_NOSIGPIPE
+    int noSigpipe = 1;
+    setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+#endif
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(socket, data.data() + sent, data.size() - sent, kSendFlags);
+        if (n <= 0) {
+            return false;
+        }
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+} // namespace
+
+void MetricCounter::add(uint64_t n)
+{
+    _shards[threadShard()].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t MetricCounter::value() const
+{
+    uint64_t total = 0;
+    for (const Shard& shard : _shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+MetricCounter& MetricsRegistry::counter(const std::string& name, const std::string& help)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _counters.emplace_back();
+    Entry entry;
+    entry.name = name;
+    entry.help = help;
+    entry.counter = &_counters.back();
+    _entries.push_back(entry);
+    return _counters.back();
+}
+
+MetricGauge& MetricsRegistry::gauge(const std::string& name, const std::string& help)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _gauges.emplace_back();
+    Entry entry;
+    entry.name = name;
+    entry.help = help;
+    entry.gauge = &_gauges.back();
+    _entries.push_back(entry);
+    return _gauges.back();
+}
+
+std::string MetricsRegistry::prometheusText() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::string text;
+    for (const Entry& entry : _entries) {
+        text += "# HELP " + entry.name + " " + entry.help + "\n";
+        text += "# TYPE " + entry.name + (entry.counter ? " counter\n" : " gauge\n");
+        text += entry.name + " ";
+        if (entry.counter) {
+            text += std::to_string(entry.counter->value());
+        } else {
+            appendNumber(text, entry.gauge->value());
+        }
+        text += "\n";
+    }
+    return text;
+}
+
+MetricsExporter::MetricsExporter(const MetricsRegistry& registry, const MetricsExporterOptions& options)
+    : _registry(registry), _options(options)
+{
+    if (_options.port > 0) {
+        _listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (_listener < 0) {
+            throw std::runtime_error("metrics: socket() failed");
+        }
+        int reuse = 1;
+        setsockopt(_listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        // Local only: the farm agent on the same host scrapes or forwards
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons((uint16_t)_options.port);
+        if (bind(_listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(_listener, 8) < 0) {
+            int error = errno;              // close() may overwrite it
+            close(_listener);
+            throw std::runtime_error("metrics: cannot listen on 127.0.0.1:" + std::to_string(_options.port) + " (" +
+                                     std::strerror(error) + ")");
+        }
+    }
+    if (_listener >= 0 || !_options.path.empty()) {
+        _thread = std::thread(&MetricsExporter::run, this);
+    }
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    if (_listener >= 0) {
+        close(_listener);
+    }
+    if (!_options.path.empty()) {
+        writeSnapshot();
+    }
+}
+
+void MetricsExporter::run()
+{
+    using Clock = std::chrono::steady_clock;
+    auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(std::max(_options.intervalSeconds, 0.1)));
+    Clock::time_point nextSnapshot = Clock::now();
+
+    for (;;) {
+        if (!_options.path.empty() && Clock::now() >= nextSnapshot) {
+            if (!writeSnapshot()) {
+                std::fprintf(stderr, "metrics: cannot write %s\n", _options.path.c_str());
+            }
+            nextSnapshot += interval;
+        }
+
+        if (_listener >= 0) {
+            // Short poll so a stop request is noticed promptly
+            pollfd fd = { _listener, POLLIN, 0 };
+            if (poll(&fd, 1, 200) > 0 && (fd.revents & POLLIN)) {
+                int client = accept(_listener, nullptr, nullptr);
+                if (client >= 0) {
+                    serveClient(client);
+                    close(client);
+                }
+            }
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_stopping) {
+                return;
+            }
+        } else {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_wake.wait_until(lock, nextSnapshot, [this] { return _stopping; })) {
+                return;
+            }
+        }
+    }
+}
+
+// One request per connection (HTTP/1.0 style), which is all a scraper needs
+void MetricsExporter::serveClient(int client)
+{
+    timeval timeout = { 1, 0 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char request[2048];
+    size_t length = 0;
+    while (length < sizeof(request) - 1) {
+        ssize_t n = recv(client, request + length, sizeof(request) - 1 - length, 0);
+        if (n <= 0) {
+            break;
+        }
+        length += (size_t)n;
+        request[length] = '\0';
+        if (std::strstr(request, "\r\n\r\n") || std::strstr(request, "\n\n")) {
+            break;
+        }
+    }
+    request[length] = '\0';
+
+    std::string status = "200 OK";
+    std::string body;
+    if (std::strncmp(request, "GET /metrics", 12) == 0 || std::strncmp(request, "GET / ", 6) == 0) {
+        body = _registry.prometheusText();
+    } else {
+        status = "404 Not Found";
+        body = "Try /metrics\n";
+    }
+    std::string response = "HTTP/1.0 " + status +
+                           "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    sendAll(client, response);
+}
+
+bool MetricsExporter::writeSnapshot()
+{
+    std::string text = _registry.prometheusText();
+    std::string temporary = _options.path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok = std::fclose(file) == 0 && ok;
+    return ok && std::rename(temporary.c_str(), _options.path.c_str()) == 0;
+}
+
+uint64_t processResidentBytes()
+{
+#if defined(__linux__)
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    unsigned long long pages = 0, resident = 0;
+    int fields = std::fscanf(file, "%llu %llu", &pages, &resident);
+    std::fclose(file);
+    return fields == 2 ? resident * (uint64_t)sysconf(_SC_PAGESIZE) : 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.resident_size;
+#else
+    return 0;
+#endif
+}
+
+uint64_t processPeakResidentBytes()
+{
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return (uint64_t)usage.ru_maxrss;           // Bytes on macOS
+#else
+    return (uint64_t)usage.ru_maxrss * 1024;    // Kilobytes on Linux
+#endif
+}
@@ -0,0 +1,124 @@
+/**
+ * Metrics.hpp
+ *
+ * Worker health and throughput metrics (Prometheus text format)
+ *
+ * Counters are sharded per thread: each thread adds to its own cache line
+ * with a relaxed atomic, and only an export sums the shards, so render
+ * threads never share a line with each other or wait on the exporter.
+ * Gauges are single atomics written by whoever owns the value.
+ *
+ * MetricsExporter publishes a registry either over HTTP on a local port
+ * (GET /metrics, for a Prometheus scrape) or as a snapshot file rewritten
+ * every interval (written to a temporary file and renamed, so readers
+ * never see a partial snapshot). Register every metric before starting an
+ * exporter; the references returned stay valid for the registry's life.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class MetricCounter
+{
+public:
+    static constexpr int kShards = 16;
+
+    // Add to the calling thread's shard
+    void add(uint64_t n = 1);
+
+    // Sum of all shards (a consistent total once writers are idle)
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> value{ 0 };
+    };
+
+    Shard _shards[kShards];
+};
+
+class MetricGauge
+{
+public:
+    void set(double value) { _value.store(value, std::memory_order_relaxed); }
+    double value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> _value{ 0.0 };
+};
+
+class MetricsRegistry
+{
+public:
+    // name must follow Prometheus rules ([a-zA-Z_:][a-zA-Z0-9_:]*)
+    MetricCounter& counter(const std::string& name, const std::string& help);
+    MetricGauge& gauge(const std::string& name, const std::string& help);
+
+    // Every metric in registration order, in the text exposition format
+    std::string prometheusText() const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        std::string help;
+        MetricCounter* counter = nullptr;
+        MetricGauge* gauge = nullptr;
+    };
+
+    mutable std::mutex _mutex;
+    std::deque<MetricCounter> _counters;    // deque: references survive growth
+    std::deque<MetricGauge> _gauges;
+    std::deque<Entry> _entries;
+};
+
+struct MetricsExporterOptions
+{
+    int port = 0;                   // HTTP on 127.0.0.1:port when > 0
+    std::string path;               // Snapshot file when not empty
+    double intervalSeconds = 5.0;   // Snapshot period
+};
+
+class MetricsExporter
+{
+public:
+    /**
+     * Start serving and/or writing snapshots on a background thread
+     *
+     * @throws std::runtime_error when the port cannot be bound
+     */
+    MetricsExporter(const MetricsRegistry& registry, const MetricsExporterOptions& options);
+
+    // Stops the thread; a snapshot file gets one final write
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+private:
+    void run();
+    void serveClient(int client);
+    bool writeSnapshot();
+
+    const MetricsRegistry& _registry;
+    MetricsExporterOptions _options;
+    int _listener = -1;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stopping = false;
+    std::thread _thread;
+};
+
+// Resident set size of this process in bytes (0 where unsupported)
+uint64_t processResidentBytes();
+
+// High-water mark of the resident set in bytes (0 where unsupported)
+uint64_t processPeakResidentBytes();
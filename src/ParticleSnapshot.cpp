@@ -0,0 +1,238 @@
+/**
+ * ParticleSnapshot.cpp
+ *
+ * Snapshot mapping, validation and background writing.
+ */
+
+#include "ParticleSnapshot.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool writeAll(int fd, const void* data, size_t bytes, uint64_t offset)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    while (bytes > 0) {
+        ssize_t n = pwrite(fd, p, bytes, (off_t)offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        bytes -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+} // namespace
+
+ParticleSnapshot::~ParticleSnapshot()
+{
+    close();
+}
+
+void ParticleSnapshot::close()
+{
+    if (_particles) {
+        munmap(_particles, _particleBytes);
+        _particles = nullptr;
+        _particleBytes = 0;
+    }
+    if (_trails) {
+        munmap(_trails, _trailMapped);
+        _trails = nullptr;
+        _trailMapped = 0;
+        _trailSkew = 0;
+    }
+    _header = {};
+}
+
+bool ParticleSnapshot::open(const char* path, size_t capacityBytes, uint32_t particleStride, std::string& error)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        error = std::string("cannot open ") + path + ": " + std::strerror(errno);
+        return false;
+    }
+    auto fail = [&](const char* reason) {
+        ::close(fd);
+        close();
+        error = reason;
+        return false;
+    };
+
+    struct stat st;
+    ParticleSnapshotHeader h;
+    if (fstat(fd, &st) != 0 || pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) {
+        return fail("file too small for a snapshot header");
+    }
+    uint64_t fileBytes = (uint64_t)st.st_size;
+    if (std::memcmp(h.magic, "BHPSNAP", 8) != 0) {
+        return fail("not a particle snapshot (bad magic)");
+    }
+    if (h.version != kParticleSnapshotVersion) {
+        return fail("unsupported snapshot version");
+    }
+    if (h.particle_stride != particleStride) {
+        return fail("snapshot was written with a different particle layout");
+    }
+    if (h.particle_offset % kParticleSnapshotAlignment != 0 || h.trail_offset % kParticleSnapshotAlignment != 0) {
+        return fail("snapshot sections are not aligned");
+    }
+    uint64_t particleBytes = (uint64_t)h.slots * h.particle_stride;
+    if (particleBytes > capacityBytes) {
+        return fail("snapshot holds more particles than the simulation capacity");
+    }
+    if (h.particle_offset + particleBytes > fileBytes ||
+        (h.trail_offset && h.trail_offset + h.trail_bytes > fileBytes)) {
+        return fail("snapshot is truncated");
+    }
+
+    // Reserve the full capacity as zero pages, then map the saved slots
+    // over its start. Private and writable: the simulation updates the
+    // slots in place, and touched pages are copied, never written back
+    size_t page = (size_t)getpagesize();
+    size_t reserved = (size_t)alignUp(capacityBytes, page);
+    void* region = mmap(nullptr, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (region == MAP_FAILED) {
+        return fail("cannot reserve the particle region");
+    }
+    _particles = region;
+    _particleBytes = reserved;
+    if (particleBytes > 0) {
+        // Sections are aligned to any page size, so the last page holds
+        // only padding after the slots: zero in the file, or past its end
+        size_t mapped = (size_t)alignUp(particleBytes, page);
+        if (mmap(region, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, (off_t)h.particle_offset) == MAP_FAILED) {
+            return fail("mmap of the particle section failed");
+        }
+        madvise(region, mapped, MADV_WILLNEED);
+    }
+
+    if (h.trail_offset && h.trail_bytes > 0) {
+        uint64_t start = h.trail_offset / page * page;
+        _trailSkew = (size_t)(h.trail_offset - start);
+        _trailMapped = (size_t)alignUp(_trailSkew + h.trail_bytes, page);
+        void* trails = mmap(nullptr, _trailMapped, PROT_READ, MAP_PRIVATE, fd, (off_t)start);
+        if (trails == MAP_FAILED) {
+            _trailMapped = 0;
+            return fail("mmap of the trail section failed");
+        }
+        _trails = trails;
+    }
+
+    ::close(fd);
+    _header = h;
+    return true;
+}
+
+bool ParticleSnapshot::write(const char* path, ParticleSnapshotHeader header,
+                             const void* particles, const void* trails, std::string& error)
+{
+    uint64_t particleBytes = (uint64_t)header.slots * header.particle_stride;
+    std::memcpy(header.magic, "BHPSNAP", 8);
+    header.version = kParticleSnapshotVersion;
+    header.particle_offset = kParticleSnapshotAlignment;
+    header.trail_offset = 0;
+    if (trails && header.trail_bytes > 0) {
+        header.trail_offset = alignUp(header.particle_offset + particleBytes, kParticleSnapshotAlignment);
+    } else {
+        header.trail_bytes = 0;
+    }
+    uint64_t fileBytes = header.trail_offset ? header.trail_offset + header.trail_bytes
+                                             : header.particle_offset + particleBytes;
+
+    // Write beside the target and rename, so readers see the old file or the new one
+    std::string temp = std::string(path) + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        error = std::string("cannot create ") + temp + ": " + std::strerror(errno);
+        return false;
+    }
+    bool ok = ftruncate(fd, (off_t)fileBytes) == 0 &&
+              writeAll(fd, &header, sizeof(header), 0) &&
+              writeAll(fd, particles, (size_t)particleBytes, header.particle_offset) &&
+              (!header.trail_offset || writeAll(fd, trails, (size_t)header.trail_bytes, header.trail_offset));
+    if (!ok) {
+        error = std::string("write failed: ") + std::strerror(errno);
+    }
+    if (::close(fd) != 0 && ok) {
+        error = std::string("close failed: ") + std::strerror(errno);
+        ok = false;
+    }
+    if (ok && std::rename(temp.c_str(), path) != 0) {
+        error = std::string("rename failed: ") + std::strerror(errno);
+        ok = false;
+    }
+    if (!ok) {
+        std::remove(temp.c_str());
+    }
+    return ok;
+}
+
+ParticleSnapshotWriter::~ParticleSnapshotWriter()
+{
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+bool ParticleSnapshotWriter::start(std::string path, const ParticleSnapshotHeader& header,
+                                   const void* particles, const void* trails, std::function<void()> release)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_busy) {
+            return false;
+        }
+        _busy = true;
+    }
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    _thread = std::thread([this, path = std::move(path), header, particles, trails, release = std::move(release)]() {
+        std::string error;
+        bool ok = ParticleSnapshot::write(path.c_str(), header, particles, trails, error);
+        if (release) {
+            release();
+        }
+        char status[256];
+        if (ok) {
+            std::snprintf(status, sizeof(status), "Saved %u slots at step %u", header.slots, header.step);
+        } else {
+            std::snprintf(status, sizeof(status), "%s", error.c_str());
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        _status = status;
+        _busy = false;
+    });
+    return true;
+}
+
+bool ParticleSnapshotWriter::busy() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _busy;
+}
+
+std::string ParticleSnapshotWriter::status() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _status;
+}
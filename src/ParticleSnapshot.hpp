@@ -0,0 +1,130 @@
+/**
+ * ParticleSnapshot.hpp
+ *
+ * Particle simulation snapshots
+ *
+ * Saves the particle slots (and trails, when a trail buffer exists) with
+ * the Philox seed and step, so a settled disk can be restored instead of
+ * spawned from empty. Files are written on a background thread to a
+ * temporary name and renamed into place, so readers never see a partial
+ * snapshot.
+ *
+ * Loading maps the particle section copy-on-write over an anonymous region
+ * sized for the full slot capacity: slots past the saved count read as
+ * zero (inactive), and the renderer wraps the whole range as its particle
+ * buffer without copying. Untouched pages stay shared with the page cache,
+ * so several processes can start from one file.
+ *
+ * File layout (little-endian, sections kParticleSnapshotAlignment aligned):
+ *   ParticleSnapshotHeader
+ *   Particle particles[slots]        GPU layout, record size particle_stride
+ *   uint8_t trails[trail_bytes]      Optional, record size trail_stride
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct ParticleSnapshotHeader
+{
+    char magic[8];                  // "BHPSNAP\0"
+    uint32_t version;               // kParticleSnapshotVersion
+    uint32_t particle_stride;       // sizeof(Particle) of the writer
+    uint32_t slots;                 // Particle records stored
+    uint32_t spawned;               // Spawn counter at save time
+    uint32_t seed;                  // Philox seed (Uniforms::particle_seed)
+    uint32_t step;                  // Next simulation step (Uniforms::particle_step)
+    uint64_t particle_offset;       // Byte offset of the particle section
+    uint64_t trail_offset;          // Byte offset of the trail section (0 = none)
+    uint64_t trail_bytes;           // Size of the trail section
+    uint32_t trail_stride;          // Trail record size
+    float disk_radius;              // Simulation context at save time
+    float disk_thickness;
+    float gravity;
+    uint32_t reserved[6];
+};
+
+constexpr uint32_t kParticleSnapshotVersion = 1;
+
+// Largest page size of the supported platforms, so sections can be mapped anywhere
+constexpr uint64_t kParticleSnapshotAlignment = 16384;
+
+class ParticleSnapshot
+{
+public:
+    ParticleSnapshot() = default;
+    ~ParticleSnapshot();
+    ParticleSnapshot(const ParticleSnapshot&) = delete;
+    ParticleSnapshot& operator=(const ParticleSnapshot&) = delete;
+
+    /**
+     * Map a snapshot, replacing any open one
+     *
+     * @param capacityBytes Size of the particle region to reserve (full slot capacity)
+     * @param particleStride Record size the caller expects
+     * @param[out] error Reason on failure
+     * @return false if the file is missing, truncated or from another layout
+     */
+    bool open(const char* path, size_t capacityBytes, uint32_t particleStride, std::string& error);
+    void close();
+
+    bool isOpen() const { return _particles != nullptr; }
+    const ParticleSnapshotHeader& header() const { return _header; }
+
+    // Particle region, page-aligned and page-sized (suitable for a no-copy GPU buffer)
+    void* particleData() const { return _particles; }
+    size_t particleBytes() const { return _particleBytes; }
+
+    // Trail section, or nullptr when the snapshot has none
+    const void* trailData() const { return _trails ? static_cast<const uint8_t*>(_trails) + _trailSkew : nullptr; }
+
+    /**
+     * Write a snapshot synchronously
+     *
+     * Header offsets are filled in here; the other fields are the caller's.
+     */
+    static bool write(const char* path, ParticleSnapshotHeader header,
+                      const void* particles, const void* trails, std::string& error);
+
+private:
+    ParticleSnapshotHeader _header = {};
+    void* _particles = nullptr;
+    size_t _particleBytes = 0;
+    void* _trails = nullptr;
+    size_t _trailMapped = 0;
+    size_t _trailSkew = 0;
+};
+
+/**
+ * Background snapshot writer
+ *
+ * One save at a time; the caller keeps the source memory alive until
+ * release runs on the writer thread.
+ */
+class ParticleSnapshotWriter
+{
+public:
+    ParticleSnapshotWriter() = default;
+    ~ParticleSnapshotWriter();
+    ParticleSnapshotWriter(const ParticleSnapshotWriter&) = delete;
+    ParticleSnapshotWriter& operator=(const ParticleSnapshotWriter&) = delete;
+
+    // @return false if a save is still running
+    bool start(std::string path, const ParticleSnapshotHeader& header,
+               const void* particles, const void* trails, std::function<void()> release);
+
+    bool busy() const;
+
+    // Result of the last save ("" before the first)
+    std::string status() const;
+
+private:
+    std::thread _thread;
+    mutable std::mutex _mutex;
+    bool _busy = false;
+    std::string _status;
+};
@@ -0,0 +1,224 @@
+/**
+ * ParticleStats.cpp
+ *
+ * Histogram readback, radial profiles and time-series recording.
+ */
+
+#include "ParticleStats.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+// A bin holding every particle at the clamp must still fit the int32 sums
+static_assert((double)PARTICLE_CAPACITY * PARTICLE_STATS_LIMIT * PARTICLE_STATS_SCALE <= 2147483647.0,
+              "particle statistics sums can overflow int32");
+
+ParticleStats::~ParticleStats()
+{
+    stopRecording();
+}
+
+int ParticleStats::acquire()
+{
+    for (int slot = 0; slot < kSlots; ++slot) {
+        bool idle = false;
+        if (_busy[slot].compare_exchange_strong(idle, true)) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+void ParticleStats::release(int slot)
+{
+    if (slot >= 0 && slot < kSlots) {
+        _busy[slot].store(false);
+    }
+}
+
+void ParticleStats::computeProfile(const int32_t* histogram, float innerRadius, float outerRadius, ParticleProfile& out)
+{
+    const float kPi = 3.14159265f;
+    const float invScale = 1.0f / PARTICLE_STATS_SCALE;
+    float logSpan = std::log(outerRadius / innerRadius);
+    auto sum = [&](int channel, int bin) { return (double)histogram[channel * PARTICLE_STATS_BINS + bin]; };
+
+    out.particles = 0;
+    for (int r = 0; r < PARTICLE_STATS_R; ++r) {
+        float r0 = innerRadius * std::exp(logSpan * (float)r / PARTICLE_STATS_R);
+        float r1 = innerRadius * std::exp(logSpan * (float)(r + 1) / PARTICLE_STATS_R);
+        out.radius[r] = std::sqrt(r0 * r1);
+
+        double count = 0.0, mass = 0.0, temperature = 0.0, angular = 0.0, radial = 0.0;
+        double cosSum = 0.0, sinSum = 0.0;
+        for (int phi = 0; phi < PARTICLE_STATS_PHI; ++phi) {
+            int bin = r * PARTICLE_STATS_PHI + phi;
+            double n = sum(PARTICLE_STATS_COUNT, bin);
+            count += n;
+            mass += sum(PARTICLE_STATS_MASS, bin);
+            temperature += sum(PARTICLE_STATS_TEMPERATURE, bin);
+            angular += sum(PARTICLE_STATS_ANGULAR_MOMENTUM, bin);
+            radial += sum(PARTICLE_STATS_RADIAL_VELOCITY, bin);
+            // Bin centre angle, matching atan2(z, x) / 2π + 0.5 in the kernel
+            double angle = 2.0 * kPi * ((phi + 0.5) / PARTICLE_STATS_PHI - 0.5);
+            cosSum += n * std::cos(angle);
+            sinSum += n * std::sin(angle);
+        }
+        out.particles += (uint32_t)count;
+
+        float area = kPi * (r1 * r1 - r0 * r0);
+        out.value[ParticleProfile::SurfaceDensity][r] = (float)(mass * invScale / area);
+        if (count > 0.0) {
+            out.value[ParticleProfile::Temperature][r] = (float)(temperature * invScale / count * 1000.0);
+            out.value[ParticleProfile::AngularMomentum][r] = (float)(angular * invScale / count);
+            out.value[ParticleProfile::RadialVelocity][r] = (float)(radial * invScale / count);
+            out.value[ParticleProfile::Asymmetry][r] = (float)(std::sqrt(cosSum * cosSum + sinSum * sinSum) / count);
+        } else {
+            for (int q = ParticleProfile::Temperature; q < ParticleProfile::Count; ++q) {
+                out.value[q][r] = 0.0f;
+            }
+        }
+    }
+}
+
+void ParticleStats::submit(int slot, const int32_t* histogram, uint32_t step, float time,
+                           float innerRadius, float outerRadius)
+{
+    ParticleProfile profile;
+    profile.step = step;
+    profile.time = time;
+    computeProfile(histogram, innerRadius, outerRadius, profile);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _history.push_back(profile);
+        if (_history.size() > kHistoryLength) {
+            _history.pop_front();
+        }
+        ++_samples;
+        record(profile, histogram, innerRadius, outerRadius);
+    }
+    release(slot);
+}
+
+void ParticleStats::record(const ParticleProfile& profile, const int32_t* histogram, float innerRadius, float outerRadius)
+{
+    if (!_file) {
+        return;
+    }
+    if (_csv) {
+        for (int r = 0; r < PARTICLE_STATS_R; ++r) {
+            float r0 = innerRadius * std::exp(std::log(outerRadius / innerRadius) * (float)r / PARTICLE_STATS_R);
+            float r1 = innerRadius * std::exp(std::log(outerRadius / innerRadius) * (float)(r + 1) / PARTICLE_STATS_R);
+            int count = 0;
+            for (int phi = 0; phi < PARTICLE_STATS_PHI; ++phi) {
+                count += histogram[PARTICLE_STATS_COUNT * PARTICLE_STATS_BINS + r * PARTICLE_STATS_PHI + phi];
+            }
+            std::fprintf(_file, "%u,%.4f,%.5g,%.5g,%d,%.6g,%.6g,%.6g,%.6g,%.6g\n",
+                         profile.step, profile.time, r0, r1, count,
+                         profile.value[ParticleProfile::SurfaceDensity][r],
+                         profile.value[ParticleProfile::Temperature][r],
+                         profile.value[ParticleProfile::AngularMomentum][r],
+                         profile.value[ParticleProfile::RadialVelocity][r],
+                         profile.value[ParticleProfile::Asymmetry][r]);
+        }
+    } else {
+        float sums[PARTICLE_STATS_CHANNELS * PARTICLE_STATS_BINS];
+        for (int i = 0; i < PARTICLE_STATS_CHANNELS * PARTICLE_STATS_BINS; ++i) {
+            bool count = i < PARTICLE_STATS_BINS;
+            sums[i] = count ? (float)histogram[i] : (float)histogram[i] / PARTICLE_STATS_SCALE;
+        }
+        float radii[2] = { innerRadius, outerRadius };
+        std::fwrite(&profile.step, sizeof(uint32_t), 1, _file);
+        std::fwrite(&profile.time, sizeof(float), 1, _file);
+        std::fwrite(radii, sizeof(radii), 1, _file);
+        std::fwrite(sums, sizeof(sums), 1, _file);
+    }
+}
+
+bool ParticleStats::startRecording(const char* path, std::string& error)
+{
+    stopRecording();
+    size_t length = std::strlen(path);
+    bool csv = length >= 4 && std::strcmp(path + length - 4, ".csv") == 0;
+    FILE* file = std::fopen(path, csv ? "w" : "wb");
+    if (!file) {
+        error = std::string("cannot create ") + path + ": " + std::strerror(errno);
+        return false;
+    }
+    if (csv) {
+        std::fprintf(file, "step,time,r_inner,r_outer,particles,surface_density,temperature,angular_momentum,radial_velocity,asymmetry\n");
+    } else {
+        ParticleStatsFileHeader header = {};
+        std::memcpy(header.magic, "BHPSTAT", 8);
+        header.version = kParticleStatsVersion;
+        header.radial_bins = PARTICLE_STATS_R;
+        header.azimuthal_bins = PARTICLE_STATS_PHI;
+        header.channels = PARTICLE_STATS_CHANNELS;
+        std::fwrite(&header, sizeof(header), 1, file);
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _file = file;
+    _csv = csv;
+    return true;
+}
+
+void ParticleStats::stopRecording()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_file) {
+        std::fclose(_file);
+        _file = nullptr;
+    }
+}
+
+bool ParticleStats::recording() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _file != nullptr;
+}
+
+void ParticleStats::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _history.clear();
+    _samples = 0;
+}
+
+bool ParticleStats::latest(ParticleProfile& out) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_history.empty()) {
+        return false;
+    }
+    out = _history.back();
+    return true;
+}
+
+std::vector<float> ParticleStats::series(ParticleProfile::Quantity quantity, int radialBin) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<float> values;
+    values.reserve(_history.size());
+    for (const ParticleProfile& profile : _history) {
+        values.push_back(profile.value[quantity][radialBin]);
+    }
+    return values;
+}
+
+uint64_t ParticleStats::samples() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _samples;
+}
+
+const char* ParticleStats::quantityName(ParticleProfile::Quantity quantity)
+{
+    switch (quantity) {
+        case ParticleProfile::SurfaceDensity: return "Surface Density";
+        case ParticleProfile::Temperature: return "Temperature (K)";
+        case ParticleProfile::AngularMomentum: return "Angular Momentum";
+        case ParticleProfile::RadialVelocity: return "Radial Velocity";
+        case ParticleProfile::Asymmetry: return "m=1 Asymmetry";
+        default: return "";
+    }
+}
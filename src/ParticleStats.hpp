@@ -0,0 +1,114 @@
+/**
+ * ParticleStats.hpp
+ *
+ * Radial and azimuthal statistics of the particle disk over time
+ *
+ * Consumes the r × φ histograms written by reduceParticleStats and turns
+ * them into radial profiles: surface density, mean temperature, mean
+ * specific angular momentum, mean radial velocity and the m = 1 azimuthal
+ * asymmetry. Samples are kept in a short history for live plots and can
+ * be recorded to disk:
+ *
+ * - .csv: one row per sample and radial bin (azimuth summed)
+ * - anything else: binary, ParticleStatsFileHeader followed by records of
+ *   { uint32 step, float time, float inner_radius, float outer_radius,
+ *     float sums[PARTICLE_STATS_CHANNELS][PARTICLE_STATS_BINS] }
+ *   holding the full r × φ sums (fixed point already converted)
+ *
+ * Histograms are read back through a small ring of buffers, each marked
+ * busy from dispatch until its command buffer completes. A reduction is
+ * skipped when every buffer is still in flight, so statistics never make
+ * the simulation wait.
+ */
+
+#pragma once
+#include "ShaderTypes.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ParticleStatsFileHeader
+{
+    char magic[8];                  // "BHPSTAT\0"
+    uint32_t version;               // kParticleStatsVersion
+    uint32_t radial_bins;           // PARTICLE_STATS_R
+    uint32_t azimuthal_bins;        // PARTICLE_STATS_PHI
+    uint32_t channels;              // PARTICLE_STATS_CHANNELS
+    uint32_t reserved;
+};
+
+constexpr uint32_t kParticleStatsVersion = 1;
+
+// One sample, azimuth summed
+struct ParticleProfile
+{
+    enum Quantity { SurfaceDensity, Temperature, AngularMomentum, RadialVelocity, Asymmetry, Count };
+
+    uint32_t step = 0;              // Simulation step of the sample
+    float time = 0.0f;              // Simulated seconds
+    uint32_t particles = 0;         // Particles inside the binned span
+    float radius[PARTICLE_STATS_R] = {};    // Bin centres (geometric mean of the edges)
+    float value[Count][PARTICLE_STATS_R] = {};
+};
+
+class ParticleStats
+{
+public:
+    static constexpr int kSlots = 3;
+    static constexpr size_t kHistoryLength = 512;
+    static constexpr size_t kHistogramBytes = sizeof(int32_t) * PARTICLE_STATS_CHANNELS * PARTICLE_STATS_BINS;
+
+    ParticleStats() = default;
+    ~ParticleStats();
+    ParticleStats(const ParticleStats&) = delete;
+    ParticleStats& operator=(const ParticleStats&) = delete;
+
+    // Free readback slot, marked busy; -1 when all are in flight
+    int acquire();
+
+    // Return a slot without a result (failed command buffer)
+    void release(int slot);
+
+    /**
+     * Convert one readback, append it to the history and the recording, free the slot
+     *
+     * Thread-safe; called from command buffer completion handlers.
+     */
+    void submit(int slot, const int32_t* histogram, uint32_t step, float time,
+                float innerRadius, float outerRadius);
+
+    /**
+     * Start recording, replacing any current recording
+     *
+     * @param path .csv for radial profiles, any other extension for binary r × φ sums
+     */
+    bool startRecording(const char* path, std::string& error);
+    void stopRecording();
+    bool recording() const;
+
+    void clear();
+
+    // Copies for the UI thread
+    bool latest(ParticleProfile& out) const;
+    std::vector<float> series(ParticleProfile::Quantity quantity, int radialBin) const;
+    uint64_t samples() const;
+
+    static const char* quantityName(ParticleProfile::Quantity quantity);
+
+    // Histogram sums to profiles; public so offline tools can share it
+    static void computeProfile(const int32_t* histogram, float innerRadius, float outerRadius, ParticleProfile& out);
+
+private:
+    void record(const ParticleProfile& profile, const int32_t* histogram, float innerRadius, float outerRadius);
+
+    std::atomic<bool> _busy[kSlots] = {};
+    mutable std::mutex _mutex;
+    std::deque<ParticleProfile> _history;
+    uint64_t _samples = 0;
+    FILE* _file = nullptr;
+    bool _csv = false;
+};
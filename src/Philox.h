@@ -0,0 +1,123 @@
+/**
+ * Philox.h
+ *
+ * Counter-Based Random Numbers Shared by CPU and GPU
+ *
+ * Philox4x32-10 (Salmon et al. 2011, "Parallel random numbers: as easy as
+ * 1, 2, 3"): ten rounds of multiply-high/xor turn a 128-bit counter and a
+ * 64-bit key into 128 random bits. There is no state to carry between
+ * calls, so any thread can draw any number in any order and get the same
+ * result, which keeps parallel simulation deterministic.
+ *
+ * Conventions used in this project:
+ *   key     = (seed, stream)       stream separates independent uses
+ *   counter = (id, step, draw, 0)  id = particle/emitter, step = simulation step
+ *
+ * Each call yields four 32-bit words (four uniforms via philoxUniform).
+ * The same header compiles as C++ and as Metal and produces bit-identical
+ * words on both.
+ */
+
+#ifndef Philox_h
+#define Philox_h
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+// Streams (key.y); one per independent consumer
+#define PHILOX_STREAM_SPAWN 1u
+#define PHILOX_STREAM_TURBULENCE 2u
+#define PHILOX_STREAM_COLLISION 3u
+#define PHILOX_STREAM_HOTSPOTS 4u
+
+#ifdef __METAL_VERSION__
+
+typedef uint PhiloxWord;
+typedef uint4 PhiloxBlock;
+#define PHILOX_INLINE inline
+#define PHILOX_MULHI(a, b) mulhi(a, b)
+#define PHILOX_BLOCK(a, b, c, d) uint4(a, b, c, d)
+
+#else
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t PhiloxWord;
+struct PhiloxBlock { uint32_t x, y, z, w; };
+#define PHILOX_INLINE inline
+#define PHILOX_MULHI(a, b) ((uint32_t)(((uint64_t)(a) * (uint64_t)(b)) >> 32))
+#define PHILOX_BLOCK(a, b, c, d) PhiloxBlock{ a, b, c, d }
+
+#endif
+
+/**
+ * Philox4x32-10 block
+ *
+ * @param c0..c3 Counter words
+ * @param k0, k1 Key words
+ * @return Four independent uniformly distributed 32-bit words
+ */
+PHILOX_INLINE PhiloxBlock philox4x32(PhiloxWord c0, PhiloxWord c1, PhiloxWord c2, PhiloxWord c3,
+                                     PhiloxWord k0, PhiloxWord k1)
+{
+    for (int round = 0; round < 10; ++round) {
+        PhiloxWord hi0 = PHILOX_MULHI(PHILOX_M0, c0);
+        PhiloxWord lo0 = PHILOX_M0 * c0;
+        PhiloxWord hi1 = PHILOX_MULHI(PHILOX_M1, c2);
+        PhiloxWord lo1 = PHILOX_M1 * c2;
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    return PHILOX_BLOCK(c0, c1, c2, c3);
+}
+
+// One draw under the project's key/counter convention
+PHILOX_INLINE PhiloxBlock philoxDraw(PhiloxWord seed, PhiloxWord stream, PhiloxWord id, PhiloxWord step, PhiloxWord draw)
+{
+    return philox4x32(id, step, draw, 0u, seed, stream);
+}
+
+// Top 24 bits as a float in [0, 1); exact in single precision
+PHILOX_INLINE float philoxUniform(PhiloxWord bits)
+{
+    return (float)(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+#ifdef __METAL_VERSION__
+
+inline float4 philoxUniform4(PhiloxBlock b)
+{
+    return float4(uint4(b) >> 8) * (1.0 / 16777216.0);
+}
+
+#else
+
+/**
+ * Fill out[0..count) with uniforms in [0, 1)
+ *
+ * Word j comes from draw (firstDraw + j / 4) of the given id and step, so
+ * out[4 * d + k] equals philoxUniform of word k of philoxDraw(..., firstDraw + d).
+ */
+inline void philoxFillUniform(uint32_t seed, uint32_t stream, uint32_t id, uint32_t step, uint32_t firstDraw,
+                              float* out, size_t count)
+{
+    size_t blocks = (count + 3) / 4;
+    for (size_t block = 0; block < blocks; ++block) {
+        PhiloxBlock b = philoxDraw(seed, stream, id, step, firstDraw + (uint32_t)block);
+        uint32_t words[4] = { b.x, b.y, b.z, b.w };
+        for (size_t k = 0; k < 4 && block * 4 + k < count; ++k) {
+            out[block * 4 + k] = philoxUniform(words[k]);
+        }
+    }
+}
+
+#endif
+
+#endif /* Philox_h */
@@ -26,6 +26,14 @@
 
 #pragma once
 #include "ShaderTypes.h"
+#include "Geodesic.h"
+#include "Emitters.hpp"
+#include "StarCatalog.hpp"
+#include "VolumeCache.hpp"
+#include "ParticleSnapshot.hpp"
+#include "ParticleStats.hpp"
+#include "LightCurve.hpp"
+#include "Soak.hpp"
 
 // Forward declarations for Objective-C types
 // Using opaque pointers to keep the header pure C++ compatible
@@ -77,12 +85,37 @@ public:
      * Performance: Adaptive based on quality preset (15-60+ FPS possible)
      */
     void draw();
+    
+    /**
+     * Headless light curve (--lightcurve)
+     * 
+     * Traces every epoch of the sweep without storing images: a coarse pass
+     * reduced per tile, then the brightest tiles again at a finer sampling.
+     * Writes one CSV row per epoch and reports progress on stdout.
+     * 
+     * @return false if the pipeline or the output file is unavailable
+     */
+    bool runLightCurve(const LightCurveOptions& options);
+    
+    /**
+     * Resource-churn soak (--soak)
+     * 
+     * Runs the SoakScript through the normal draw path: resizes the window,
+     * switches visual presets and bloom levels, and logs hitches, rebuild
+     * cost and memory per event. Restores the starting configuration.
+     * 
+     * @return false if the log cannot be written, memory leaks or a hitch
+     *         breaks the budget
+     */
+    bool runSoak(const SoakOptions& options);
 
 private:
     GLFWwindow* _pWindow;           // GLFW window for rendering context
     void* _pDevice;                 // MTLDevice* - GPU device handle
     void* _pCommandQueue;           // MTLCommandQueue* - command submission queue
-    void* _pPSO;                    // MTLComputePipelineState* - compiled shader pipeline
+    void* _pPSO;                    // MTLComputePipelineState* - compiled shader pipeline (RK4 entry below)
+    void* _integratorPSOs[GEODESIC_INTEGRATOR_COUNT]; // MTLComputePipelineState* - computeShader per integration_method
+    void* _lightCurvePSOs[GEODESIC_INTEGRATOR_COUNT]; // MTLComputePipelineState* - per-tile flux reduction (--lightcurve) per integrator
     void* _pMetalLayer;             // CAMetalLayer* - drawable presentation layer
 
     // Post-processing pipeline states
@@ -91,6 +124,14 @@ private:
     void* _bloomUpsamplePSO;        // MTLComputePipelineState* - bloom upsample
     void* _bloomCompositePSO;       // MTLComputePipelineState* - bloom composite
     void* _tonemappingPSO;          // MTLComputePipelineState* - ACES tone mapping
+    void* _fftPSO;                  // MTLComputePipelineState* - radix-2 line FFT
+    void* _glarePreparePSO;         // MTLComputePipelineState* - glare bright pass
+    void* _glareLoadPSFPSO;         // MTLComputePipelineState* - PSF upload
+    void* _glareSpectrumPSO;        // MTLComputePipelineState* - PSF spectrum store
+    void* _glareMultiplyPSO;        // MTLComputePipelineState* - spectrum product
+    void* _glareResolvePSO;         // MTLComputePipelineState* - glare unpack/upsample
+    void* _histogramPSO;            // MTLComputePipelineState* - log-luminance histogram
+    void* _exposureAdaptPSO;        // MTLComputePipelineState* - temporal exposure adaptation
     
     // Post-processing textures
     void* _sceneTexture;            // MTLTexture* - main scene render target
@@ -99,12 +140,102 @@ private:
     void* _bloomUpsample[8];        // MTLTexture* - bloom upsample pyramid
     void* _bloomFinalTexture;       // MTLTexture* - final combined bloom
     void* _finalTexture;            // MTLTexture* - after tone mapping
+    void* _finalSRGBView;           // MTLTexture* - sRGB-encoding view of _finalTexture
     void* _diskColorMap;            // MTLTexture* - accretion disk color gradient
+    void* _spectralBasis;           // MTLBuffer* - SpectralBasis for spectral disk emission
+    void* _glareTexture;            // MTLTexture* - FFT glare at output resolution
+    void* _glareBuffer;             // MTLBuffer* - N×N packed complex image (R+iG, B+0i)
+    void* _psfSpectrum;             // MTLBuffer* - cached PSF spectrum (float2 per bin)
+    void* _histogramBuffer;         // MTLBuffer* - 256 luminance bins (cleared by the GPU)
+    void* _exposureBuffer;          // MTLBuffer* - adapted luminance and exposure (float4)
     
     int   _ppWidth;                 // Width of post-processing textures
     int   _ppHeight;                // Height of post-processing textures
     int   _allocatedBloomIterations;// Number of bloom mip levels allocated
     bool  _postProcessDirty;        // Post-processing resources need rebuild
+    double _ppRebuildMs;            // Total CPU time in createPostProcessingTextures
+    uint64_t _ppAllocations;        // Textures and buffers it has created
+    uint64_t _ppAllocatedBytes;     // Their total GPU size
+    
+    // Storage formats of intermediate buffers (index into HDR storage table in Renderer.mm)
+    int   _sceneStorage;            // Scene and bloom composite targets
+    int   _bloomStorage;            // Brightness pass and bloom pyramid
+    bool  _srgbOutput;              // Encode final LDR output with hardware sRGB stores (opt-in)
+    void* _passTimer;               // PassTimer* - per-pass GPU timestamps and bandwidth
+    
+    // Orbiting emitters (legacy star + hot spots), traced along the geodesic
+    static constexpr int kMaxFramesInFlight = 3;
+    EmitterSystem _emitters;        // Orbits and per-frame acceleration grid
+    void* _emitterFrames[kMaxFramesInFlight]; // MTLBuffer* - grid, refs and emitters per frame in flight
+    void* _frameSemaphore;          // dispatch_semaphore_t - bounds frames in flight to the ring size
+    int   _emitterFrame;            // Ring slot written this frame
+    int   _hotSpotCount;            // Number of disk hot spots
+    float _hotSpotSize;             // Typical hot spot radius
+    float _hotSpotBrightness;       // Hot spot emission multiplier
+    int   _hotSpotSeed;             // Seed of the hot spot layout
+    
+    // Render tiers (RENDER_TIER_* in ShaderTypes.h)
+    int   _renderTier;              // Tier traced while idle
+    bool  _previewWhileEditing;     // Trace the Preview tier while a control is held
+    bool  _uiActive;                // A control was held in the last UI frame
+    double _lastEditTime;           // glfwGetTime() when a control was last held
+    bool  _tierErrorMap;            // Show the error of the traced tier against Reference
+    void* _tierErrorPSOs[GEODESIC_INTEGRATOR_COUNT]; // MTLComputePipelineState* - both tiers per pixel, heat map out, per integrator
+    void* _tierErrorBuffers[kMaxFramesInFlight]; // MTLBuffer* - error sums per frame in flight
+    std::atomic<float> _tierError;  // Mean relative error of the last error-map frame
+    std::atomic<float> _tierErrorShare; // Share of pixels above 10% error
+    
+    // Background star catalog (memory-mapped, wrapped by the GPU without copying)
+    StarCatalog _starCatalog;       // Open catalog mapping
+    void* _starCatalogBuffer;       // MTLBuffer* - no-copy view of the mapping (nullptr = procedural sky)
+    void* _emptyBuffer;             // MTLBuffer* - bound in place of absent optional data
+    StarCatalogInfo _starInfo;      // Lookup and splat parameters for the scene pass
+    bool  _starCatalogDirty;        // Load _starCatalogPath at the start of the next frame
+    char  _starCatalogPath[512];    // Catalog file (tools/build_star_catalog.py)
+    char  _starCatalogStatus[128];  // Result of the last load
+    
+    // Streamed volumetric data (replaces the procedural disk while loaded)
+    VolumeCache _volume;            // Mapped sources, decoder threads and brick residency
+    void* _volumeAtlas;             // MTLTexture* - RG16F brick atlas (nullptr = no volume)
+    void* _volumeCoarse;            // MTLTexture* - RG16F coarse level, one voxel per brick
+    void* _volumePlaceholder;       // MTLTexture* - 1³ texture bound without a volume
+    void* _volumeFrames[kMaxFramesInFlight]; // MTLBuffer* - page table and feedback per frame in flight
+    size_t _volumeFeedbackOffset;   // Byte offset of the feedback section in a volume frame
+    VolumeInfo _volumeInfo;         // Grid placement and scales for the scene pass
+    bool  _volumeDirty;             // Open _volumePath at the start of the next frame
+    char  _volumePath[512];         // .bhvol file, or raw float32 density
+    char  _volumeTemperaturePath[512]; // Raw float32 temperature (optional)
+    int   _volumeRawDims[3];        // Raw grid dimensions
+    int   _volumeBrickSize;         // Brick edge used for raw grids
+    int   _volumeSlots;             // Atlas capacity in bricks
+    float _volumeExtent;            // Half-size of the grid box in world units
+    char  _volumeStatus[128];       // Result of the last load
+    
+    // Lensed particles: simulated on the GPU, deposited into a grid the tracer samples
+    void* _particleSpawnPSO;        // MTLComputePipelineState* - refill inactive slots
+    void* _particleUpdatePSO;       // MTLComputePipelineState* - orbital integration
+    void* _particleDepositPSO;      // MTLComputePipelineState* - scatter-add into private grid copies
+    void* _particleResolvePSO;      // MTLComputePipelineState* - sum copies into the grid texture
+    void* _particleBuffer;          // MTLBuffer* - Particle[PARTICLE_CAPACITY], allocated on first use
+    void* _particleCounter;         // MTLBuffer* - particles spawned so far
+    void* _particleAccum;           // MTLBuffer* - fixed-point grid copies (cleared by the resolve)
+    void* _particleGrid;            // MTLTexture* - RG16F emissivity / temperature grid
+    ParticleGridInfo _particleInfo; // Grid placement and shading for deposit and trace
+    bool _particleRestart;          // Clear all slots and rewind particle_step next frame
+    ParticleSnapshot _particleSnapshot;     // Mapping adopted as _particleBuffer after a load
+    ParticleSnapshotWriter _snapshotWriter; // Background snapshot saves
+    bool  _particleSnapshotSave;    // Save to _particleSnapshotPath in the next frame
+    bool  _particleSnapshotLoad;    // Load _particleSnapshotPath at the start of the next frame
+    char  _particleSnapshotPath[512]; // Snapshot file (.bhsnap)
+    char  _particleSnapshotStatus[128]; // Result of the last load or save request
+    void* _particleStatsPSO;        // MTLComputePipelineState* - r × φ histogram reduction
+    void* _particleStatsBuffers[ParticleStats::kSlots]; // MTLBuffer* - shared histogram readback ring
+    ParticleStats _particleStats;   // Radial profiles, plot history and recording
+    int   _particleStatsInterval;   // Simulation steps between reductions (0 = off)
+    int   _particleStatsQuantity;   // ParticleProfile::Quantity shown in the plots
+    int   _particleStatsRadius;     // Radial bin of the time-series plot
+    char  _particleStatsPath[512];  // Recording target (.csv profiles, otherwise binary r × φ sums)
+    char  _particleStatsStatus[128]; // Result of the last recording request
     
     // Post-processing parameters
     float _bloomStrength;           // Bloom intensity
@@ -113,6 +244,22 @@ private:
     float _tonemapGamma;            // Gamma correction value
     bool _tonemappingEnabled;       // Enable/disable tone mapping
     bool _bloomEnabled;             // Enable/disable bloom effect
+    bool  _autoExposure;            // Drive exposure from the luminance histogram
+    float _exposureCompensation;    // Exposure bias in EV
+    float _exposureAdaptSpeed;      // Adaptation rate (1/s)
+    
+    // FFT glare parameters
+    int   _bloomMode;               // 0 = mip chain bloom, 1 = FFT convolution glare
+    int   _glareSize;               // FFT size N of the allocated glare buffers (0 = none)
+    int   _glareWorkWidth;          // Glare working resolution (excludes guard band)
+    int   _glareWorkHeight;
+    bool  _psfDirty;                // PSF spectrum must be recomputed
+    int   _psfSource;               // 0 = procedural, 1 = image file
+    int   _psfSpikes;               // Number of diffraction spikes (procedural)
+    float _psfSpikeStrength;        // Energy in spikes relative to the halo
+    float _psfHaloRadius;           // Halo core radius in working-resolution pixels
+    char  _psfPath[512];            // PSF image path (grayscale or RGB, centred)
+    char  _psfStatus[128];          // Result of the last PSF load
 
     Uniforms _uniforms;             // Shared GPU/CPU uniform buffer (see ShaderTypes.h)
     
@@ -146,4 +293,17 @@ private:
     void createPostProcessingTextures(int width, int height);
     void applyBloomEffect(void* commandBuffer, void* inputTexture, void* outputTexture);
     void applyToneMapping(void* commandBuffer, void* inputTexture, void* outputTexture);
+    void updateAutoExposure(void* commandBuffer, void* inputTexture);
+    void applyFFTGlare(void* commandBuffer, void* inputTexture, void* outputTexture);
+    void updatePSFSpectrum(void* commandBuffer);
+    void* updateEmitters(void* commandBuffer);
+    bool loadStarCatalog(const char* path);
+    bool loadVolume(const char* path);
+    void releaseVolume();
+    void updateVolume(void* encoder);
+    bool ensureParticleResources();
+    void updateParticles(void* commandBuffer);
+    bool loadParticleSnapshot(const char* path);
+    void saveParticleSnapshot(const char* path, void* commandBuffer);
+    void waitForFramesInFlight();
 };
@@ -18,10 +18,22 @@
  */
 
 #include "Renderer.hpp"
+#include "Metrics.hpp"
+#include "Spectral.hpp"
+#include "Trace.hpp"
 #include <iostream>
 #include <stdexcept>
 #include <chrono>
 #include <algorithm>
+#include <atomic>
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
 
 // Platform-specific headers for Metal and GLFW integration
 #define GLFW_INCLUDE_NONE
@@ -38,6 +50,406 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_metal.h"
 
+//==============================================================================
+// INTERMEDIATE BUFFER STORAGE
+//==============================================================================
+
+// HDR formats selectable for the scene (_sceneStorage) and bloom
+// (_bloomStorage) buffers. The GPU converts on every texture read/write, so
+// the conversion is fused into the kernels that produce and consume them.
+struct HDRStorageInfo {
+    MTLPixelFormat format;
+    int bytesPerPixel;
+    const char* name;
+};
+
+static const HDRStorageInfo kHDRStorage[] = {
+    { MTLPixelFormatRGBA32Float, 16, "RGBA32F" },
+    { MTLPixelFormatRGBA16Float,  8, "RGBA16F" },
+    { MTLPixelFormatRG11B10Float, 4, "R11G11B10F" },
+    { MTLPixelFormatRGB9E5Float,  4, "RGB9E5" },
+};
+static const int kHDRStorageCount = (int)(sizeof(kHDRStorage) / sizeof(kHDRStorage[0]));
+
+// RGB9E5 and sRGB shader writes are only available on Apple-family GPUs
+static bool hdrStorageWritable(id<MTLDevice> device, int storage)
+{
+    if (storage < 0 || storage >= kHDRStorageCount) {
+        return false;
+    }
+    if (kHDRStorage[storage].format == MTLPixelFormatRGB9E5Float) {
+        return [device supportsFamily:MTLGPUFamilyApple3];
+    }
+    return true;
+}
+
+//==============================================================================
+// PER-PASS GPU TIMING
+//==============================================================================
+
+enum PostPass {
+    PassScene = 0,
+    PassBrightness,
+    PassDownsample,
+    PassUpsample,
+    PassGlare,
+    PassComposite,
+    PassExposure,
+    PassTonemap,
+    PassParticles,
+    PassCount
+};
+
+static const char* kPassNames[PassCount] = {
+    "Scene", "Bright pass", "Downsample", "Upsample", "FFT glare", "Composite", "Exposure", "Tone map", "Particles"
+};
+
+/**
+ * PassTimer
+ * 
+ * Samples GPU timestamps at the start and end of every compute encoder
+ * (stage-boundary counters) and keeps a smoothed per-pass duration. Also
+ * holds the per-pass memory traffic computed from the buffer formats, so
+ * format choices can be compared against an all-RGBA32F baseline.
+ * 
+ * Sample slots are split into one region per frame in flight; the drawable
+ * pool bounds the number of frames the CPU can run ahead.
+ */
+struct PassTimer {
+    static const int kPairsPerFrame = 32;
+    static const int kFramesInFlight = 3;
+
+    id<MTLCounterSampleBuffer> samples = nil;
+    int slot = 0;
+    int pairCount = 0;
+    int passOfPair[kFramesInFlight][kPairsPerFrame] = {};
+
+    std::atomic<float> passMs[PassCount];
+    double passBytes[PassCount] = {};
+    double baselineBytes[PassCount] = {};
+
+    bool calibrated = false;
+    MTLTimestamp cpuBase = 0;
+    MTLTimestamp gpuBase = 0;
+    std::atomic<double> nsPerTick{1.0};
+    std::atomic<int64_t> traceOffset{0};    // Trace clock minus CPU timestamp
+
+    PassTimer() {
+        for (int i = 0; i < PassCount; ++i) {
+            passMs[i].store(0.0f);
+        }
+    }
+
+    // Track the GPU/CPU timestamp ratio; CPU timestamps are in nanoseconds
+    void calibrate(id<MTLDevice> device) {
+        MTLTimestamp cpu = 0, gpu = 0;
+        [device sampleTimestamps:&cpu gpuTimestamp:&gpu];
+        traceOffset.store(traceNow() - (int64_t)cpu);
+        if (!calibrated) {
+            cpuBase = cpu;
+            gpuBase = gpu;
+            calibrated = true;
+        } else if (cpu - cpuBase > 200000000ull && gpu > gpuBase) {
+            nsPerTick.store((double)(cpu - cpuBase) / (double)(gpu - gpuBase));
+        }
+    }
+
+    void beginFrame() {
+        slot = (slot + 1) % kFramesInFlight;
+        pairCount = 0;
+    }
+
+    // Called from the command buffer completion handler
+    void resolve(int frameSlot, int pairs, const int* passes) {
+        if (!samples || pairs == 0) {
+            return;
+        }
+        NSData* data = [samples resolveCounterRange:NSMakeRange((NSUInteger)frameSlot * kPairsPerFrame * 2, (NSUInteger)pairs * 2)];
+        if (!data) {
+            return;
+        }
+        const MTLCounterResultTimestamp* ts = (const MTLCounterResultTimestamp*)data.bytes;
+        double sums[PassCount] = {};
+        bool seen[PassCount] = {};
+        double ns = nsPerTick.load();
+        double scale = ns * 1e-6;
+        bool tracing = traceEnabled();
+        static int gpuTrack = traceTrack("GPU");
+        int64_t traceBase = (int64_t)cpuBase + traceOffset.load();
+        for (int k = 0; k < pairs; ++k) {
+            MTLTimestamp start = ts[2 * k].timestamp;
+            MTLTimestamp end = ts[2 * k + 1].timestamp;
+            if (start == MTLCounterErrorValue || end == MTLCounterErrorValue || end < start) {
+                continue;
+            }
+            sums[passes[k]] += (double)(end - start) * scale;
+            seen[passes[k]] = true;
+            // Each encoder (so each bloom level) is its own span on the GPU row
+            if (tracing) {
+                int64_t begin = traceBase + (int64_t)((double)(int64_t)(start - gpuBase) * ns);
+                traceSpan("gpu", kPassNames[passes[k]], begin, begin + (int64_t)((double)(end - start) * ns), k, gpuTrack);
+            }
+        }
+        for (int p = 0; p < PassCount; ++p) {
+            if (seen[p]) {
+                float old = passMs[p].load();
+                passMs[p].store(old * 0.9f + (float)sums[p] * 0.1f);
+            }
+        }
+    }
+};
+
+// Open a compute encoder, attaching timestamp samples when supported
+static id<MTLComputeCommandEncoder> beginComputePass(PassTimer* timer, id<MTLCommandBuffer> cmd, PostPass pass)
+{
+    if (timer && timer->samples && timer->pairCount < PassTimer::kPairsPerFrame) {
+        MTLComputePassDescriptor* desc = [MTLComputePassDescriptor computePassDescriptor];
+        NSUInteger base = ((NSUInteger)timer->slot * PassTimer::kPairsPerFrame + timer->pairCount) * 2;
+        desc.sampleBufferAttachments[0].sampleBuffer = timer->samples;
+        desc.sampleBufferAttachments[0].startOfEncoderSampleIndex = base;
+        desc.sampleBufferAttachments[0].endOfEncoderSampleIndex = base + 1;
+        timer->passOfPair[timer->slot][timer->pairCount++] = pass;
+        return [cmd computeCommandEncoderWithDescriptor:desc];
+    }
+    return [cmd computeCommandEncoder];
+}
+
+//==============================================================================
+// GLARE POINT-SPREAD FUNCTION
+//==============================================================================
+
+// Largest FFT the line kernel handles (matches FFT_MAX_SIZE in fft_glare.metal)
+static const int kMaxFFTSize = 1024;
+
+// Offset of texel i from the PSF centre, with the centre wrapped to texel 0
+static inline int psfWrappedOffset(int i, int n)
+{
+    return i < n / 2 ? i : i - n;
+}
+
+// Confines the PSF to the guard band so the circular convolution never wraps
+static inline float psfWindow(float r, float radius)
+{
+    float t = std::clamp((r - 0.7f * radius) / (0.3f * radius), 0.0f, 1.0f);
+    return 1.0f - t * t * (3.0f - 2.0f * t);
+}
+
+static bool normalizePSF(std::vector<float>& psf)
+{
+    double sum = 0.0;
+    for (float v : psf) {
+        sum += v;
+    }
+    if (sum <= 0.0) {
+        return false;
+    }
+    float inv = (float)(1.0 / sum);
+    for (float& v : psf) {
+        v *= inv;
+    }
+    return true;
+}
+
+/**
+ * Procedural glare PSF
+ * 
+ * Moffat halo (an Airy-like core with power-law wings) plus thin diffraction
+ * spikes that fall off as 1/r. Halo and spikes are normalized separately so
+ * spikeStrength is their share of the glare energy. Rows are built in
+ * parallel on the CPU.
+ * 
+ * @param n FFT size; the result is n×n with its centre wrapped to texel 0
+ * @param radius Guard band radius the PSF must fit in
+ */
+static void buildProceduralPSF(std::vector<float>& psf, int n, float radius,
+                               int spikes, float spikeStrength, float haloRadius)
+{
+    std::vector<float> halo((size_t)n * n, 0.0f);
+    std::vector<float> spike((size_t)n * n, 0.0f);
+    float* haloData = halo.data();
+    float* spikeData = spike.data();
+    const float spikeWidth = 0.7f;
+    const float sector = spikes > 0 ? 2.0f * (float)M_PI / (float)spikes : 0.0f;
+    
+    dispatch_apply((size_t)n, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t row) {
+        float dy = (float)psfWrappedOffset((int)row, n);
+        for (int x = 0; x < n; ++x) {
+            float dx = (float)psfWrappedOffset(x, n);
+            float r = std::sqrt(dx * dx + dy * dy);
+            if (r >= radius) {
+                continue;
+            }
+            float window = psfWindow(r, radius);
+            float q = r / haloRadius;
+            size_t idx = row * (size_t)n + x;
+            haloData[idx] = window / std::pow(1.0f + q * q, 2.5f);
+            if (spikes > 0) {
+                // Perpendicular distance to the nearest spike direction
+                float delta = std::remainder(std::atan2(dy, dx), sector);
+                float d = r * std::fabs(std::sin(delta));
+                spikeData[idx] = window * std::exp(-0.5f * d * d / (spikeWidth * spikeWidth)) / (1.0f + q);
+            }
+        }
+    });
+    
+    normalizePSF(halo);
+    bool hasSpikes = spikes > 0 && normalizePSF(spike);
+    float share = hasSpikes ? std::clamp(spikeStrength, 0.0f, 1.0f) : 0.0f;
+    psf.resize((size_t)n * n);
+    for (size_t i = 0; i < psf.size(); ++i) {
+        psf[i] = (1.0f - share) * halo[i] + share * spike[i];
+    }
+}
+
+/**
+ * Load a PSF from an image file
+ * 
+ * The image is converted to luminance, centred on the PSF origin and shrunk
+ * if needed to fit the guard band.
+ * 
+ * @return false if the image cannot be read or has no energy
+ */
+static bool loadPSFImage(const char* path, std::vector<float>& psf, int n, float radius)
+{
+    @autoreleasepool {
+        NSImage* image = [[NSImage alloc] initWithContentsOfFile:[NSString stringWithUTF8String:path]];
+        if (!image) {
+            return false;
+        }
+        CGImageRef cgImage = [image CGImageForProposedRect:nullptr context:nil hints:nil];
+        if (!cgImage) {
+            return false;
+        }
+        
+        std::vector<float> canvas((size_t)n * n, 0.0f);
+        CGColorSpaceRef gray = CGColorSpaceCreateDeviceGray();
+        CGContextRef ctx = CGBitmapContextCreate(canvas.data(), n, n, 32, n * sizeof(float), gray,
+                                                 kCGImageAlphaNone | kCGBitmapFloatComponents | kCGBitmapByteOrder32Little);
+        CGColorSpaceRelease(gray);
+        if (!ctx) {
+            return false;
+        }
+        float w = (float)CGImageGetWidth(cgImage);
+        float h = (float)CGImageGetHeight(cgImage);
+        float fit = std::min(1.0f, 2.0f * radius / std::max(w, h));
+        CGContextDrawImage(ctx, CGRectMake((n - w * fit) * 0.5, (n - h * fit) * 0.5, w * fit, h * fit), cgImage);
+        CGContextRelease(ctx);
+        
+        // Move the image centre to texel 0
+        psf.assign((size_t)n * n, 0.0f);
+        for (int y = 0; y < n; ++y) {
+            float dy = (float)psfWrappedOffset(y, n);
+            for (int x = 0; x < n; ++x) {
+                float dx = (float)psfWrappedOffset(x, n);
+                float r = std::sqrt(dx * dx + dy * dy);
+                if (r < radius) {
+                    size_t src = (size_t)((y + n / 2) % n) * n + (x + n / 2) % n;
+                    psf[(size_t)y * n + x] = std::max(canvas[src], 0.0f) * psfWindow(r, radius);
+                }
+            }
+        }
+        return normalizePSF(psf);
+    }
+}
+
+// Encode one batch of line FFTs (rows or columns of the glare buffer)
+static void encodeFFTLines(id<MTLComputeCommandEncoder> enc, id<MTLComputePipelineState> pso,
+                           id<MTLBuffer> buffer, uint32_t n, uint32_t lines,
+                           uint32_t lineStride, uint32_t elemStride, float direction)
+{
+    uint32_t logN = 0;
+    while ((1u << logN) < n) {
+        logN++;
+    }
+    [enc setComputePipelineState:pso];
+    [enc setBuffer:buffer offset:0 atIndex:0];
+    [enc setBytes:&n length:sizeof(uint32_t) atIndex:1];
+    [enc setBytes:&logN length:sizeof(uint32_t) atIndex:2];
+    [enc setBytes:&lineStride length:sizeof(uint32_t) atIndex:3];
+    [enc setBytes:&elemStride length:sizeof(uint32_t) atIndex:4];
+    [enc setBytes:&direction length:sizeof(float) atIndex:5];
+    [enc dispatchThreadgroups:MTLSizeMake(lines, 1, 1) threadsPerThreadgroup:MTLSizeMake(n / 2, 1, 1)];
+}
+
+// Dispatch a 1D kernel over count elements
+static void dispatchLinear(id<MTLComputePipelineState> pso, id<MTLComputeCommandEncoder> enc, NSUInteger count)
+{
+    NSUInteger tw = std::min<NSUInteger>(pso.maxTotalThreadsPerThreadgroup, 256);
+    [enc dispatchThreads:MTLSizeMake(count, 1, 1) threadsPerThreadgroup:MTLSizeMake(tw, 1, 1)];
+}
+
+//==============================================================================
+// AUTO-EXPOSURE
+//==============================================================================
+
+// Histogram range (log2 luminance) and adaptation limits; the bin count must
+// match HISTOGRAM_BINS in auto_exposure.metal
+static const int   kHistogramBins = 256;
+static const float kMinLogLuminance = -10.0f;
+static const float kLogLuminanceRange = 16.0f;
+static const float kExposureKey = 0.18f;           // Middle grey
+static const float kMinExposure = 1.0f / 256.0f;
+static const float kMaxExposure = 256.0f;
+static const int   kExposureSampleRows = 540;      // Histogram grid height cap
+
+//==============================================================================
+// RENDER TIERS
+//==============================================================================
+
+// The Preview tier is kept this long after the last held control
+static const double kPreviewIdleSeconds = 0.3;
+
+//==============================================================================
+// SCENE KERNELS
+//==============================================================================
+
+// Screen radius of the critical curve (b = b_c, see inCriticalBand) and the
+// share of pixels inside its supersampled band, for a camera aimed at the hole
+static bool criticalCurveFootprint(const Uniforms& uniforms, int width, int height, float& radius, float& share)
+{
+    float distance = simd_length(uniforms.observer_position) > 0.1f
+        ? simd_length(uniforms.observer_position) : uniforms.camera_distance;
+    float criticalImpact = 2.598076f * uniforms.gravity;
+    if (width <= 0 || height <= 0 || criticalImpact >= distance) {
+        return false;
+    }
+    // b = D·sin θ for a straight camera ray; one uv unit is height / 2 pixels
+    float theta = std::asin(criticalImpact / distance);
+    float pixelsPerUV = 0.5f * (float)height;
+    radius = std::tan(theta) * pixelsPerUV;
+    float dRadiusDImpact = pixelsPerUV / (std::cos(theta) * std::cos(theta)) / (distance * std::cos(theta));
+    float halfWidth = std::max(uniforms.critical_band * criticalImpact * dRadiusDImpact, 2.0f);
+    float ring = 2.0f * (float)M_PI * radius * 2.0f * halfWidth;
+    share = std::min(ring / ((float)width * (float)height), 1.0f);
+    return true;
+}
+
+// Scene kernels specialized for one geodesic integrator (function constant 0)
+static id<MTLFunction> newIntegratorFunction(id<MTLLibrary> library, NSString* name, int method, NSError** error)
+{
+    MTLFunctionConstantValues* constants = [MTLFunctionConstantValues new];
+    [constants setConstantValue:&method type:MTLDataTypeInt atIndex:0];
+    return [library newFunctionWithName:name constantValues:constants error:error];
+}
+
+// Pipeline for one integrator specialization of a kernel; nil (and logged) on failure
+static id<MTLComputePipelineState> newIntegratorPSO(id<MTLDevice> device, id<MTLLibrary> library, NSString* name, int method)
+{
+    NSError* error = nil;
+    id<MTLFunction> function = newIntegratorFunction(library, name, method, &error);
+    if (!function) {
+        std::cerr << "Failed to specialize " << name.UTF8String << " for integrator " << method << ": "
+                  << (error ? error.localizedDescription.UTF8String : "function not found") << std::endl;
+        return nil;
+    }
+    id<MTLComputePipelineState> pso = [device newComputePipelineStateWithFunction:function error:&error];
+    if (!pso) {
+        std::cerr << "Failed to create " << name.UTF8String << " pipeline for integrator " << method << ": "
+                  << (error ? error.localizedDescription.UTF8String : "unknown error") << std::endl;
+    }
+    return pso;
+}
+
 Renderer::Renderer(GLFWwindow* pWindow) : _pWindow(pWindow),
     _lastFrameTime(0.0), _currentFPS(0.0f), _frameTimeMs(0.0f),
     _isRecording(false), _videoWriter(nullptr), _videoInput(nullptr),
@@ -45,8 +457,62 @@ Renderer::Renderer(GLFWwindow* pWindow) : _pWindow(pWindow),
     _currentTab(0), _currentPreset(0), _currentVisualPreset(0),
     _bloomStrength(0.08f), _bloomThreshold(1.2f), _bloomIterations(3),
     _tonemapGamma(2.2f), _tonemappingEnabled(true), _bloomEnabled(true),
-    _ppWidth(0), _ppHeight(0), _allocatedBloomIterations(0), _postProcessDirty(true)
+    _bloomMode(0), _glareSize(0), _glareWorkWidth(0), _glareWorkHeight(0), _psfDirty(true),
+    _psfSource(0), _psfSpikes(6), _psfSpikeStrength(0.35f), _psfHaloRadius(4.0f),
+    _autoExposure(false), _exposureCompensation(0.0f), _exposureAdaptSpeed(1.5f),
+    _ppWidth(0), _ppHeight(0), _allocatedBloomIterations(0), _postProcessDirty(true),
+    _ppRebuildMs(0.0), _ppAllocations(0), _ppAllocatedBytes(0),
+    _sceneStorage(1), _bloomStorage(2), _srgbOutput(false), _passTimer(nullptr),
+    _frameSemaphore(nullptr), _emitterFrame(0),
+    _hotSpotCount(24), _hotSpotSize(0.08f), _hotSpotBrightness(2.0f), _hotSpotSeed(1),
+    _renderTier(RENDER_TIER_STANDARD), _previewWhileEditing(true), _uiActive(false), _lastEditTime(0.0),
+    _tierErrorMap(false), _tierError(0.0f), _tierErrorShare(0.0f),
+    _starCatalogBuffer(nullptr), _emptyBuffer(nullptr), _starCatalogDirty(false),
+    _volumeAtlas(nullptr), _volumeCoarse(nullptr), _volumePlaceholder(nullptr), _volumeFeedbackOffset(0),
+    _volumeDirty(false), _volumeBrickSize(32), _volumeSlots(512), _volumeExtent(12.0f),
+    _particleSpawnPSO(nullptr), _particleUpdatePSO(nullptr), _particleDepositPSO(nullptr), _particleResolvePSO(nullptr),
+    _particleBuffer(nullptr), _particleCounter(nullptr), _particleAccum(nullptr), _particleGrid(nullptr),
+    _particleRestart(false), _particleSnapshotSave(false), _particleSnapshotLoad(false),
+    _particleStatsPSO(nullptr), _particleStatsInterval(30), _particleStatsQuantity(ParticleProfile::SurfaceDensity),
+    _particleStatsRadius(8)
 {
+    _psfPath[0] = '\0';
+    _psfStatus[0] = '\0';
+    _starCatalogStatus[0] = '\0';
+    _volumePath[0] = '\0';
+    _volumeTemperaturePath[0] = '\0';
+    _volumeStatus[0] = '\0';
+    std::snprintf(_particleSnapshotPath, sizeof(_particleSnapshotPath), "particles.bhsnap");
+    _particleSnapshotStatus[0] = '\0';
+    std::snprintf(_particleStatsPath, sizeof(_particleStatsPath), "disk_profiles.csv");
+    _particleStatsStatus[0] = '\0';
+    for (int i = 0; i < ParticleStats::kSlots; ++i) {
+        _particleStatsBuffers[i] = nullptr;
+    }
+    for (int i = 0; i < GEODESIC_INTEGRATOR_COUNT; ++i) {
+        _integratorPSOs[i] = nullptr;
+        _lightCurvePSOs[i] = nullptr;
+        _tierErrorPSOs[i] = nullptr;
+    }
+    _volumeRawDims[0] = _volumeRawDims[1] = 256;
+    _volumeRawDims[2] = 64;
+    for (int i = 0; i < kMaxFramesInFlight; ++i) {
+        _volumeFrames[i] = nullptr;
+        _tierErrorBuffers[i] = nullptr;
+    }
+    _volumeInfo = {};
+    _volumeInfo.density_scale = 1.0f;
+    _volumeInfo.emission_scale = 1.0f;
+    _volumeInfo.temperature_scale = kVolumeTemperatureUnit;
+    _particleInfo = {};
+    _particleInfo.emission_scale = 0.05f;
+    _particleInfo.absorption = 0.02f;
+    _starInfo = {};
+    _starInfo.max_per_cell = 16;
+    _starInfo.splat_sigma = 0.7f;
+    _starInfo.brightness = 50.0f;
+    _starInfo.max_magnification = 100.0f;
+    
     // Initialize default parameters inspired by Gargantua from Interstellar
     _uniforms.time = 0.0f;
     _uniforms.gravity = 2.5f;
@@ -74,6 +540,10 @@ Renderer::Renderer(GLFWwindow* pWindow) : _pWindow(pWindow),
     _uniforms.max_iterations = 256;
     _uniforms.step_size = 0.1f;
     _uniforms.adaptive_stepping = true;
+    _uniforms.integration_method = GEODESIC_RK4;
+    _uniforms.render_tier = RENDER_TIER_STANDARD;
+    _uniforms.critical_samples = 3;
+    _uniforms.critical_band = 0.06f;
 
     // Rossning-inspired accretion disk defaults
     _uniforms.disk_density_vertical = 2.0f;
@@ -88,6 +558,25 @@ Renderer::Renderer(GLFWwindow* pWindow) : _pWindow(pWindow),
     _uniforms.disk_inner_multiplier = 25.0f;
     _uniforms.disk_inner_softness = 1.1f;
     _uniforms.disk_color_mix = 0.65f;
+    _uniforms.disk_noise_lod_bias = 1.0f;
+    _uniforms.spectral_mode = false;
+    
+    // Particle disk (off: the procedural disk is traced by default)
+    _uniforms.particle_lensing = false;
+    _uniforms.particle_spawning = true;
+    _uniforms.particle_trails = false;
+    _uniforms.max_particles = 65536;
+    _uniforms.particle_emission_rate = 2.0f;
+    _uniforms.particle_lifetime = 8.0f;
+    _uniforms.particle_size = 0.05f;
+    _uniforms.particle_turbulence = 0.5f;
+    _uniforms.particle_magnetism = 0.0f;
+    _uniforms.particle_collision_damping = 0.02f;
+    _uniforms.spawning_radius_min = 2.0f;
+    _uniforms.spawning_radius_max = 5.0f;
+    _uniforms.trail_length = 0.5f;
+    _uniforms.particle_seed = 1;
+    _uniforms.particle_step = 0;
 
 
     applyVisualPreset(_currentVisualPreset);
@@ -129,27 +618,32 @@ Renderer::Renderer(GLFWwindow* pWindow) : _pWindow(pWindow),
     ImGui_ImplMetal_Init(device);
 
     // --- Shader Compilation ---
-    NSError* pError = nil;
     id<MTLLibrary> pLibrary = [device newDefaultLibrary];
     if (!pLibrary) {
         std::cerr << "Failed to load default Metal library" << std::endl;
         throw std::runtime_error("Metal library creation failed");
     }
 
-    id<MTLFunction> pKernelFunction = [pLibrary newFunctionWithName:@"computeShader"];
-    if (!pKernelFunction) {
-        std::cerr << "Failed to find computeShader function in Metal library" << std::endl;
-        throw std::runtime_error("Metal kernel function not found");
-    }
-    
-    id<MTLComputePipelineState> pso = [device newComputePipelineStateWithFunction:pKernelFunction error:&pError];
-    if (!pso) {
-        if (pError) {
-            std::cerr << "Failed to create compute pipeline state: " << pError.localizedDescription.UTF8String << std::endl;
+    // One pipeline per integrator for every geodesic kernel, so the march loop
+    // never branches on it and each pass traces with the selected scheme
+    for (int method = 0; method < GEODESIC_INTEGRATOR_COUNT; ++method) {
+        _integratorPSOs[method] = (__bridge_retained void*)newIntegratorPSO(device, pLibrary, @"computeShader", method);
+        // Flux-only variant of the scene pass for light curves
+        _lightCurvePSOs[method] = (__bridge_retained void*)newIntegratorPSO(device, pLibrary, @"lightCurveShader", method);
+        // Tier error map: current tier and Reference per pixel
+        _tierErrorPSOs[method] = (__bridge_retained void*)newIntegratorPSO(device, pLibrary, @"tierErrorShader", method);
+        if (_tierErrorPSOs[method] && !_tierErrorBuffers[0]) {
+            // Error sums per frame slot, shared by all integrators
+            for (int i = 0; i < kMaxFramesInFlight; ++i) {
+                id<MTLBuffer> sums = [device newBufferWithLength:2 * sizeof(uint32_t) options:MTLResourceStorageModeShared];
+                _tierErrorBuffers[i] = (__bridge_retained void*)sums;
+            }
         }
+    }
+    if (!_integratorPSOs[GEODESIC_RK4]) {
         throw std::runtime_error("Metal pipeline state creation failed");
     }
-    _pPSO = (__bridge void*)pso;
+    _pPSO = _integratorPSOs[GEODESIC_RK4];
     
     // Initialize post-processing pipelines
     initializePostProcessing();
@@ -220,6 +714,109 @@ Renderer::Renderer(GLFWwindow* pWindow) : _pWindow(pWindow),
         _diskColorMap = (__bridge_retained void*)colorMapTexture;
         std::cout << "Disk color map texture created successfully (" << colorMapWidth << "x" << colorMapHeight << ")" << std::endl;
     }
+    
+    // Spectral emission basis: blackbody fits and colour projection weights
+    @autoreleasepool {
+        SpectralBasis basis;
+        Spectral::buildSpectralBasis(basis);
+        id<MTLBuffer> spectralBuffer = [device newBufferWithBytes:&basis
+                                                           length:sizeof(SpectralBasis)
+                                                          options:MTLResourceStorageModeShared];
+        _spectralBasis = (__bridge_retained void*)spectralBuffer;
+        std::cout << "Spectral basis created (" << SPECTRAL_TEMPERATURES << " temperatures, "
+                  << SPECTRAL_COEFFS << " coefficients)" << std::endl;
+    }
+    
+    // Orbiting emitter buffers: one per frame in flight, rewritten by the CPU
+    // each frame, so the semaphore keeps the GPU and CPU on different slots
+    @autoreleasepool {
+        for (int i = 0; i < kMaxFramesInFlight; ++i) {
+            id<MTLBuffer> frame = [device newBufferWithLength:EmitterSystem::kFrameBytes
+                                                      options:MTLResourceStorageModeShared];
+            std::memset(frame.contents, 0, EmitterSystem::kFrameBytes);
+            _emitterFrames[i] = (__bridge_retained void*)frame;
+        }
+        dispatch_semaphore_t semaphore = dispatch_semaphore_create(kMaxFramesInFlight);
+        _frameSemaphore = (__bridge_retained void*)semaphore;
+        std::cout << "Emitter buffers created (" << kMaxFramesInFlight << " x "
+                  << EmitterSystem::kFrameBytes / 1024 << " KB, up to " << MAX_EMITTERS << " emitters)" << std::endl;
+    }
+    
+    // Optional star catalog: $BLACKHOLE_STAR_CATALOG or stars.bhcat in the
+    // working directory; the procedural starfield is used otherwise
+    @autoreleasepool {
+        id<MTLBuffer> empty = [device newBufferWithLength:256 options:MTLResourceStorageModeShared];
+        std::memset(empty.contents, 0, 256);
+        _emptyBuffer = (__bridge_retained void*)empty;
+        
+        const char* catalogPath = std::getenv("BLACKHOLE_STAR_CATALOG");
+        std::snprintf(_starCatalogPath, sizeof(_starCatalogPath), "%s", catalogPath ? catalogPath : "stars.bhcat");
+        if (catalogPath || access(_starCatalogPath, R_OK) == 0) {
+            loadStarCatalog(_starCatalogPath);
+        }
+    }
+    
+    // Optional streamed volume from $BLACKHOLE_VOLUME (.bhvol); the
+    // placeholder keeps the volume textures bound while none is loaded
+    @autoreleasepool {
+        MTLTextureDescriptor* desc = [[MTLTextureDescriptor alloc] init];
+        desc.textureType = MTLTextureType3D;
+        desc.pixelFormat = MTLPixelFormatRG16Float;
+        desc.width = desc.height = desc.depth = 1;
+        desc.usage = MTLTextureUsageShaderRead;
+        id<MTLTexture> placeholder = [device newTextureWithDescriptor:desc];
+        _volumePlaceholder = (__bridge_retained void*)placeholder;
+        
+        const char* volumePath = std::getenv("BLACKHOLE_VOLUME");
+        if (volumePath) {
+            std::snprintf(_volumePath, sizeof(_volumePath), "%s", volumePath);
+            loadVolume(_volumePath);
+        }
+    }
+    
+    // Particle pipelines; buffers and the grid are allocated on first use
+    @autoreleasepool {
+        NSError* error = nil;
+        id<MTLLibrary> library = [device newDefaultLibrary];
+        struct { const char* name; void** slot; } particleKernels[] = {
+            { "spawnParticles", &_particleSpawnPSO },
+            { "updateParticles", &_particleUpdatePSO },
+            { "depositParticles", &_particleDepositPSO },
+            { "resolveParticleGrid", &_particleResolvePSO },
+            { "reduceParticleStats", &_particleStatsPSO },
+        };
+        for (auto& kernel : particleKernels) {
+            id<MTLFunction> function = [library newFunctionWithName:[NSString stringWithUTF8String:kernel.name]];
+            if (!function) {
+                continue;
+            }
+            id<MTLComputePipelineState> pso = [device newComputePipelineStateWithFunction:function error:&error];
+            if (pso) {
+                *kernel.slot = (__bridge_retained void*)pso;
+            } else {
+                std::cerr << "Failed to create " << kernel.name << " pipeline: " << (error ? error.localizedDescription.UTF8String : "unknown error") << std::endl;
+            }
+        }
+        if (_particleSpawnPSO && _particleUpdatePSO && _particleDepositPSO && _particleResolvePSO) {
+            std::cout << "Particle grid pipelines created successfully" << std::endl;
+        }
+        
+        // Histogram readback ring for the disk statistics
+        if (_particleStatsPSO) {
+            for (int i = 0; i < ParticleStats::kSlots; ++i) {
+                id<MTLBuffer> stats = [device newBufferWithLength:ParticleStats::kHistogramBytes
+                                                          options:MTLResourceStorageModeShared];
+                _particleStatsBuffers[i] = (__bridge_retained void*)stats;
+            }
+        }
+        
+        // Warm start from a settled disk (loaded with the first frame)
+        const char* snapshotPath = std::getenv("BLACKHOLE_PARTICLE_SNAPSHOT");
+        if (snapshotPath) {
+            std::snprintf(_particleSnapshotPath, sizeof(_particleSnapshotPath), "%s", snapshotPath);
+            _particleSnapshotLoad = true;
+        }
+    }
 }
 
 void Renderer::initializePostProcessing()
@@ -289,11 +886,70 @@ void Renderer::initializePostProcessing()
             }
         }
         
+        // FFT glare pipelines
+        _fftPSO = nullptr;
+        _glarePreparePSO = nullptr;
+        _glareLoadPSFPSO = nullptr;
+        _glareSpectrumPSO = nullptr;
+        _glareMultiplyPSO = nullptr;
+        _glareResolvePSO = nullptr;
+        struct { const char* name; void** slot; } glareKernels[] = {
+            { "fft_radix2", &_fftPSO },
+            { "glare_prepare", &_glarePreparePSO },
+            { "glare_load_psf", &_glareLoadPSFPSO },
+            { "glare_store_spectrum", &_glareSpectrumPSO },
+            { "glare_multiply", &_glareMultiplyPSO },
+            { "glare_resolve", &_glareResolvePSO },
+        };
+        for (auto& kernel : glareKernels) {
+            id<MTLFunction> function = [library newFunctionWithName:[NSString stringWithUTF8String:kernel.name]];
+            if (!function) {
+                continue;
+            }
+            id<MTLComputePipelineState> pso = [device newComputePipelineStateWithFunction:function error:&error];
+            if (pso) {
+                *kernel.slot = (__bridge_retained void*)pso;
+            } else {
+                std::cerr << "Failed to create " << kernel.name << " pipeline: " << (error ? error.localizedDescription.UTF8String : "unknown error") << std::endl;
+            }
+        }
+        if (_fftPSO && _glarePreparePSO && _glareLoadPSFPSO && _glareSpectrumPSO && _glareMultiplyPSO && _glareResolvePSO) {
+            std::cout << "FFT glare pipelines created successfully" << std::endl;
+        }
+        
+        // Auto-exposure pipelines and their persistent state
+        _histogramPSO = nullptr;
+        _exposureAdaptPSO = nullptr;
+        id<MTLFunction> histogram = [library newFunctionWithName:@"luminance_histogram"];
+        id<MTLFunction> adapt = [library newFunctionWithName:@"exposure_adapt"];
+        if (histogram && adapt) {
+            id<MTLComputePipelineState> histogramPSO = [device newComputePipelineStateWithFunction:histogram error:&error];
+            id<MTLComputePipelineState> adaptPSO = histogramPSO ? [device newComputePipelineStateWithFunction:adapt error:&error] : nil;
+            if (histogramPSO && adaptPSO) {
+                _histogramPSO = (__bridge_retained void*)histogramPSO;
+                _exposureAdaptPSO = (__bridge_retained void*)adaptPSO;
+                std::cout << "Auto-exposure pipelines created successfully" << std::endl;
+            } else {
+                std::cerr << "Failed to create auto-exposure pipelines: " << (error ? error.localizedDescription.UTF8String : "unknown error") << std::endl;
+            }
+        }
+        id<MTLBuffer> histogramBuffer = [device newBufferWithLength:kHistogramBins * sizeof(uint32_t) options:MTLResourceStorageModeShared];
+        id<MTLBuffer> exposureBuffer = [device newBufferWithLength:4 * sizeof(float) options:MTLResourceStorageModeShared];
+        std::memset(histogramBuffer.contents, 0, histogramBuffer.length);
+        float initialState[4] = { kExposureKey, 1.0f, kExposureKey, 0.0f };
+        std::memcpy(exposureBuffer.contents, initialState, sizeof(initialState));
+        _histogramBuffer = (__bridge_retained void*)histogramBuffer;
+        _exposureBuffer = (__bridge_retained void*)exposureBuffer;
+        
         // Initialize texture pointers to null
         _sceneTexture = nullptr;
         _brightnessTexture = nullptr;
         _bloomFinalTexture = nullptr;
         _finalTexture = nullptr;
+        _finalSRGBView = nullptr;
+        _glareTexture = nullptr;
+        _glareBuffer = nullptr;
+        _psfSpectrum = nullptr;
         for (int i = 0; i < 8; i++) {
             _bloomDownsample[i] = nullptr;
             _bloomUpsample[i] = nullptr;
@@ -302,11 +958,38 @@ void Renderer::initializePostProcessing()
         _ppHeight = 0;
         _allocatedBloomIterations = 0;
         _postProcessDirty = true;
+        
+        // Per-pass GPU timing via stage-boundary timestamp counters
+        PassTimer* timer = new PassTimer();
+        if ([device supportsCounterSampling:MTLCounterSamplingPointAtStageBoundary]) {
+            for (id<MTLCounterSet> set in device.counterSets) {
+                if (![set.name isEqualToString:MTLCommonCounterSetTimestamp]) {
+                    continue;
+                }
+                MTLCounterSampleBufferDescriptor* sampleDesc = [[MTLCounterSampleBufferDescriptor alloc] init];
+                sampleDesc.counterSet = set;
+                sampleDesc.storageMode = MTLStorageModeShared;
+                sampleDesc.sampleCount = PassTimer::kFramesInFlight * PassTimer::kPairsPerFrame * 2;
+                timer->samples = [device newCounterSampleBufferWithDescriptor:sampleDesc error:&error];
+                if (!timer->samples) {
+                    std::cerr << "Failed to create GPU timestamp buffer: " << (error ? error.localizedDescription.UTF8String : "unknown error") << std::endl;
+                }
+                break;
+            }
+        }
+        if (timer->samples) {
+            timer->calibrate(device);
+            std::cout << "Per-pass GPU timing enabled" << std::endl;
+        } else {
+            std::cout << "Per-pass GPU timing unavailable on this device" << std::endl;
+        }
+        _passTimer = timer;
     }
 }
 
 void Renderer::createPostProcessingTextures(int width, int height)
 {
+    auto rebuildStart = std::chrono::steady_clock::now();
     @autoreleasepool {
         id<MTLDevice> device = (__bridge id<MTLDevice>)_pDevice;
 
@@ -322,14 +1005,35 @@ void Renderer::createPostProcessingTextures(int width, int height)
         releaseTexture(_sceneTexture);
         releaseTexture(_brightnessTexture);
         releaseTexture(_bloomFinalTexture);
+        releaseTexture(_finalSRGBView);
         releaseTexture(_finalTexture);
+        releaseTexture(_glareTexture);
         for (int i = 0; i < 8; ++i) {
             releaseTexture(_bloomDownsample[i]);
             releaseTexture(_bloomUpsample[i]);
         }
+        auto releaseBuffer = [](void*& slot) {
+            if (slot) {
+                id<MTLBuffer> oldBuf = (__bridge_transfer id<MTLBuffer>)slot;
+                oldBuf = nil;
+                slot = nullptr;
+            }
+        };
+        releaseBuffer(_glareBuffer);
+        releaseBuffer(_psfSpectrum);
+        
+        // Fall back to half floats when a compact format cannot be written
+        if (!hdrStorageWritable(device, _sceneStorage)) {
+            _sceneStorage = 1;
+        }
+        if (!hdrStorageWritable(device, _bloomStorage)) {
+            _bloomStorage = 1;
+        }
+        MTLPixelFormat sceneFormat = kHDRStorage[_sceneStorage].format;
+        MTLPixelFormat bloomFormat = kHDRStorage[_bloomStorage].format;
         
         // Create scene texture (HDR format for bloom)
-        MTLTextureDescriptor* sceneDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatRGBA16Float
+        MTLTextureDescriptor* sceneDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:sceneFormat
                                                                                              width:width
                                                                                             height:height
                                                                                          mipmapped:NO];
@@ -337,8 +1041,13 @@ void Renderer::createPostProcessingTextures(int width, int height)
         id<MTLTexture> sceneTexture = [device newTextureWithDescriptor:sceneDesc];
         _sceneTexture = (__bridge_retained void*)sceneTexture;
         
-        // Create brightness texture
-        id<MTLTexture> brightnessTexture = [device newTextureWithDescriptor:sceneDesc];
+        // Create brightness texture (bloom storage: only feeds the blurred pyramid)
+        MTLTextureDescriptor* brightnessDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:bloomFormat
+                                                                                                  width:width
+                                                                                                 height:height
+                                                                                              mipmapped:NO];
+        brightnessDesc.usage = MTLTextureUsageShaderRead | MTLTextureUsageShaderWrite;
+        id<MTLTexture> brightnessTexture = [device newTextureWithDescriptor:brightnessDesc];
         _brightnessTexture = (__bridge_retained void*)brightnessTexture;
         
         // Create bloom final texture
@@ -355,7 +1064,7 @@ void Renderer::createPostProcessingTextures(int width, int height)
                 break;
             }
 
-            MTLTextureDescriptor* mipDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatRGBA16Float
+            MTLTextureDescriptor* mipDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:bloomFormat
                                                                                                width:mipWidth
                                                                                               height:mipHeight
                                                                                            mipmapped:NO];
@@ -364,7 +1073,7 @@ void Renderer::createPostProcessingTextures(int width, int height)
             id<MTLTexture> downsampleTexture = [device newTextureWithDescriptor:mipDesc];
             _bloomDownsample[i] = (__bridge_retained void*)downsampleTexture;
 
-                MTLTextureDescriptor* upDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatRGBA16Float
+                MTLTextureDescriptor* upDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:bloomFormat
                                                                                                                              width:width >> i
                                                                                                                             height:height >> i
                                                                                                                         mipmapped:NO];
@@ -380,19 +1089,129 @@ void Renderer::createPostProcessingTextures(int width, int height)
             _bloomUpsample[i] = nullptr;
         }
         
+        // FFT glare works at half resolution inside an N×N transform. At least
+        // a fifth of N is left as zero guard band, which bounds the PSF radius
+        // for a linear (non-wrapping) convolution.
+        _glareSize = 0;
+        if (_bloomMode == 1 && _fftPSO) {
+            id<MTLComputePipelineState> fftPSO = (__bridge id<MTLComputePipelineState>)_fftPSO;
+            int maxN = std::min(kMaxFFTSize, 2 * (int)fftPSO.maxTotalThreadsPerThreadgroup);
+            float longest = 0.5f * (float)std::max(width, height);
+            int n = 64;
+            while (n < maxN && (float)n < longest * 1.25f) {
+                n <<= 1;
+            }
+            float fit = std::min(1.0f, 0.8f * (float)n / longest);
+            _glareWorkWidth = std::max(1, (int)(0.5f * width * fit));
+            _glareWorkHeight = std::max(1, (int)(0.5f * height * fit));
+            
+            id<MTLBuffer> glareBuffer = [device newBufferWithLength:(NSUInteger)n * n * 16 options:MTLResourceStorageModePrivate];
+            id<MTLBuffer> spectrum = [device newBufferWithLength:(NSUInteger)n * n * 8 options:MTLResourceStorageModePrivate];
+            MTLTextureDescriptor* glareDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:bloomFormat
+                                                                                                 width:width
+                                                                                                height:height
+                                                                                             mipmapped:NO];
+            glareDesc.usage = MTLTextureUsageShaderRead | MTLTextureUsageShaderWrite;
+            id<MTLTexture> glareTexture = [device newTextureWithDescriptor:glareDesc];
+            if (glareBuffer && spectrum && glareTexture) {
+                _glareBuffer = (__bridge_retained void*)glareBuffer;
+                _psfSpectrum = (__bridge_retained void*)spectrum;
+                _glareTexture = (__bridge_retained void*)glareTexture;
+                _glareSize = n;
+            }
+            _psfDirty = true;
+        }
+        
         // Create final tone-mapped texture (LDR format for display)
         MTLTextureDescriptor* finalDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatBGRA8Unorm
                                                                                              width:width
                                                                                             height:height
                                                                                          mipmapped:NO];
         finalDesc.usage = MTLTextureUsageShaderRead | MTLTextureUsageShaderWrite;
+        if (_srgbOutput) {
+            finalDesc.usage |= MTLTextureUsagePixelFormatView;
+        }
         id<MTLTexture> finalTexture = [device newTextureWithDescriptor:finalDesc];
         _finalTexture = (__bridge_retained void*)finalTexture;
+        
+        // The tone mapper writes through an sRGB view so encoding happens in the
+        // store unit; the drawable blit copies the raw bytes of the same memory
+        if (_srgbOutput) {
+            id<MTLTexture> srgbView = [finalTexture newTextureViewWithPixelFormat:MTLPixelFormatBGRA8Unorm_sRGB];
+            _finalSRGBView = (__bridge_retained void*)srgbView;
+        }
 
         _allocatedBloomIterations = actualLevels;
         _ppWidth = width;
         _ppHeight = height;
+        
+        // Allocation totals for --soak; the sRGB view shares _finalTexture's memory
+        std::vector<void*> created = { _sceneTexture, _brightnessTexture, _bloomFinalTexture, _finalTexture,
+                                       _glareTexture, _glareBuffer, _psfSpectrum };
+        created.insert(created.end(), _bloomDownsample, _bloomDownsample + 8);
+        created.insert(created.end(), _bloomUpsample, _bloomUpsample + 8);
+        for (void* slot : created) {
+            if (slot) {
+                _ppAllocations++;
+                _ppAllocatedBytes += ((__bridge id<MTLResource>)slot).allocatedSize;
+            }
+        }
+        if (_finalSRGBView) {
+            _ppAllocations++;
+        }
+        
+        // Per-pass memory traffic (reads + writes) for the timing table,
+        // alongside the same passes with all HDR buffers in RGBA32F
+        if (_passTimer) {
+            PassTimer* timer = (PassTimer*)_passTimer;
+            double pixels = (double)width * height;
+            double sceneBpp = kHDRStorage[_sceneStorage].bytesPerPixel;
+            double bloomBpp = kHDRStorage[_bloomStorage].bytesPerPixel;
+            double fullBpp = kHDRStorage[0].bytesPerPixel;
+            
+            // Pyramid levels: downsample i reads level i-1 (or brightness) and
+            // writes a quarter-size target; upsample mirrors it in reverse
+            double pyramidPixels = 0.0;
+            for (int i = 0; i < actualLevels; ++i) {
+                pyramidPixels += pixels / (double)(1 << (2 * (i + 1)));
+            }
+            
+            timer->passBytes[PassScene] = pixels * sceneBpp;
+            timer->passBytes[PassBrightness] = pixels * (sceneBpp + bloomBpp);
+            timer->passBytes[PassDownsample] = (pixels * 4.0 + pyramidPixels) * bloomBpp;
+            timer->passBytes[PassUpsample] = (pyramidPixels * 5.0 + pixels * 4.0) * bloomBpp;
+            timer->passBytes[PassComposite] = pixels * (2.0 * sceneBpp + bloomBpp);
+            timer->passBytes[PassTonemap] = pixels * (sceneBpp + 4.0);
+            int exposureStride = std::max(1, (height + kExposureSampleRows - 1) / kExposureSampleRows);
+            timer->passBytes[PassExposure] = pixels / (double)(exposureStride * exposureStride) * sceneBpp;
+            timer->baselineBytes[PassExposure] = pixels / (double)(exposureStride * exposureStride) * fullBpp;
+            
+            timer->baselineBytes[PassScene] = pixels * fullBpp;
+            timer->baselineBytes[PassBrightness] = pixels * 2.0 * fullBpp;
+            timer->baselineBytes[PassDownsample] = (pixels * 4.0 + pyramidPixels) * fullBpp;
+            timer->baselineBytes[PassUpsample] = (pyramidPixels * 5.0 + pixels * 4.0) * fullBpp;
+            timer->baselineBytes[PassComposite] = pixels * 3.0 * fullBpp;
+            timer->baselineBytes[PassTonemap] = pixels * (fullBpp + 4.0);
+            
+            // FFT glare replaces the mip chain; its complex buffer is always float
+            timer->passBytes[PassGlare] = 0.0;
+            timer->baselineBytes[PassGlare] = 0.0;
+            if (_glareSize > 0) {
+                double n2 = (double)_glareSize * _glareSize;
+                double work = (double)_glareWorkWidth * _glareWorkHeight;
+                double rowShare = (double)_glareWorkHeight / _glareSize;
+                // prepare write, 2 row + 2 column passes (read + write), multiply, spectrum
+                double complexBytes = n2 * 16.0 * (1.0 + 4.0 * rowShare + 4.0 + 2.0) + n2 * 8.0;
+                timer->passBytes[PassGlare] = complexBytes + work * (sceneBpp + 16.0) + pixels * bloomBpp;
+                timer->baselineBytes[PassGlare] = complexBytes + work * (fullBpp + 16.0) + pixels * fullBpp;
+                for (int p : { PassBrightness, PassDownsample, PassUpsample }) {
+                    timer->passBytes[p] = 0.0;
+                    timer->baselineBytes[p] = 0.0;
+                }
+            }
+        }
     }
+    _ppRebuildMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - rebuildStart).count();
 }
 
 
@@ -414,8 +1233,15 @@ Renderer::~Renderer()
     releaseObj(_sceneTexture);
     releaseObj(_brightnessTexture);
     releaseObj(_bloomFinalTexture);
+    releaseObj(_finalSRGBView);
     releaseObj(_finalTexture);
     releaseObj(_diskColorMap);
+    releaseObj(_spectralBasis);
+    releaseObj(_glareTexture);
+    releaseObj(_glareBuffer);
+    releaseObj(_psfSpectrum);
+    releaseObj(_histogramBuffer);
+    releaseObj(_exposureBuffer);
     for (int i = 0; i < 8; ++i) {
         releaseObj(_bloomDownsample[i]);
         releaseObj(_bloomUpsample[i]);
@@ -425,6 +1251,53 @@ Renderer::~Renderer()
     releaseObj(_bloomUpsamplePSO);
     releaseObj(_bloomCompositePSO);
     releaseObj(_tonemappingPSO);
+    releaseObj(_fftPSO);
+    releaseObj(_glarePreparePSO);
+    releaseObj(_glareLoadPSFPSO);
+    releaseObj(_glareSpectrumPSO);
+    releaseObj(_glareMultiplyPSO);
+    releaseObj(_glareResolvePSO);
+    releaseObj(_histogramPSO);
+    releaseObj(_exposureAdaptPSO);
+    releaseObj(_particleSpawnPSO);
+    releaseObj(_particleUpdatePSO);
+    releaseObj(_particleDepositPSO);
+    releaseObj(_particleResolvePSO);
+    releaseObj(_particleBuffer);
+    releaseObj(_particleCounter);
+    releaseObj(_particleAccum);
+    releaseObj(_particleGrid);
+    releaseObj(_particleStatsPSO);
+    for (int i = 0; i < GEODESIC_INTEGRATOR_COUNT; ++i) {
+        releaseObj(_integratorPSOs[i]);
+        releaseObj(_lightCurvePSOs[i]);
+        releaseObj(_tierErrorPSOs[i]);
+    }
+    for (int i = 0; i < ParticleStats::kSlots; ++i) {
+        releaseObj(_particleStatsBuffers[i]);
+    }
+    
+    // Completion handlers write into the pass timer; drain the queue first
+    if (_pCommandQueue) {
+        id<MTLCommandBuffer> drain = [(__bridge id<MTLCommandQueue>)_pCommandQueue commandBuffer];
+        [drain commit];
+        [drain waitUntilCompleted];
+    }
+    delete (PassTimer*)_passTimer;
+    _passTimer = nullptr;
+    
+    // A semaphore must be released at its initial count
+    waitForFramesInFlight();
+    releaseObj(_frameSemaphore);
+    for (int i = 0; i < kMaxFramesInFlight; ++i) {
+        releaseObj(_emitterFrames[i]);
+        releaseObj(_tierErrorBuffers[i]);
+    }
+    // The no-copy buffer must go before the mapping (closed by ~StarCatalog)
+    releaseObj(_starCatalogBuffer);
+    releaseObj(_emptyBuffer);
+    releaseVolume();
+    releaseObj(_volumePlaceholder);
 
     // Clean up ImGui resources first
     ImGui_ImplMetal_Shutdown();
@@ -456,26 +1329,33 @@ void Renderer::applyQualityPreset(int preset)
 {
     _uniforms.quality_preset = preset;
     
+    // Presets leave the integrator as chosen. Per tools/geodesic_bench, the
+    // default RK4 is the cheapest scheme within each preset's error budget
+    // at these step sizes (Low's is met by none)
     switch (preset) {
         case 0: // Low - Maximum performance
             _uniforms.max_iterations = 128;
             _uniforms.step_size = 0.15f;
             _uniforms.adaptive_stepping = false;
+            _uniforms.critical_samples = 1;
             break;
         case 1: // Medium - Balanced
             _uniforms.max_iterations = 192;
             _uniforms.step_size = 0.12f;
             _uniforms.adaptive_stepping = true;
+            _uniforms.critical_samples = 2;
             break;
         case 2: // High - Good quality
             _uniforms.max_iterations = 256;
             _uniforms.step_size = 0.1f;
             _uniforms.adaptive_stepping = true;
+            _uniforms.critical_samples = 3;
             break;
         case 3: // Ultra - Maximum quality
             _uniforms.max_iterations = 512;
             _uniforms.step_size = 0.08f;
             _uniforms.adaptive_stepping = true;
+            _uniforms.critical_samples = 4;
             break;
     }
 }
@@ -659,11 +1539,16 @@ void Renderer::captureFrame()
 
 void Renderer::draw()
 {
+    TRACE_SCOPE("frame", "draw");
     updatePerformanceMetrics();
     
     @autoreleasepool {
         CAMetalLayer* metalLayer = (__bridge CAMetalLayer*)_pMetalLayer;
-        id<CAMetalDrawable> pDrawable = [metalLayer nextDrawable];
+        id<CAMetalDrawable> pDrawable;
+        {
+            TRACE_SCOPE("frame", "next drawable");
+            pDrawable = [metalLayer nextDrawable];
+        }
         if (!pDrawable) {
             return;
         }
@@ -694,23 +1579,103 @@ void Renderer::draw()
             std::cerr << "Failed to create command buffer" << std::endl;
             return;
         }
+        PassTimer* passTimer = (PassTimer*)_passTimer;
+        if (passTimer) {
+            passTimer->beginFrame();
+        }
 
         // ...existing code...
 
+        // Catalog reloads wait for the GPU, so do them before this frame takes a slot
+        if (_starCatalogDirty) {
+            _starCatalogDirty = false;
+            loadStarCatalog(_starCatalogPath);
+        }
+        if (_volumeDirty) {
+            _volumeDirty = false;
+            loadVolume(_volumePath);
+        }
+        if (_particleSnapshotLoad) {
+            _particleSnapshotLoad = false;
+            loadParticleSnapshot(_particleSnapshotPath);
+        }
+        
+        // Snapshots copy the slots before this frame's step advances them
+        if (_particleSnapshotSave) {
+            _particleSnapshotSave = false;
+            saveParticleSnapshot(_particleSnapshotPath, (__bridge void*)pCmd);
+        }
+
+        // Particle simulation and grid deposition, traced by the scene pass
+        updateParticles((__bridge void*)pCmd);
+
         // 2. Black Hole Compute Pass -> render into HDR scene texture
         {
-            id<MTLComputePipelineState> pso = (__bridge id<MTLComputePipelineState>)_pPSO;
+            TRACE_SCOPE("encode", "scene");
+            // Preview while a control is held, the chosen tier once idle
+            double now = glfwGetTime();
+            if (_uiActive) {
+                _lastEditTime = now;
+            }
+            bool editing = _previewWhileEditing && now - _lastEditTime < kPreviewIdleSeconds;
+            _uniforms.render_tier = editing ? RENDER_TIER_PREVIEW : _renderTier;
+            
+            int method = std::clamp(_uniforms.integration_method, 0, GEODESIC_INTEGRATOR_COUNT - 1);
+            bool errorMap = _tierErrorMap && _tierErrorPSOs[method] && !editing;
+            void* scenePSO = _integratorPSOs[method] ? _integratorPSOs[method] : _pPSO;
+            id<MTLComputePipelineState> pso = (__bridge id<MTLComputePipelineState>)(errorMap ? _tierErrorPSOs[method] : scenePSO);
             id<MTLTexture> sceneTex = (__bridge id<MTLTexture>)_sceneTexture;
             id<MTLTexture> colorMap = (__bridge id<MTLTexture>)_diskColorMap;
-            id<MTLComputeCommandEncoder> pEnc = [pCmd computeCommandEncoder];
+            id<MTLComputeCommandEncoder> pEnc = beginComputePass(passTimer, pCmd, PassScene);
             [pEnc setComputePipelineState:pso];
             [pEnc setTexture:sceneTex atIndex:0];
             [pEnc setTexture:colorMap atIndex:1];  // Bind color map for accretion disk
+            [pEnc setBuffer:(__bridge id<MTLBuffer>)_spectralBasis offset:0 atIndex:1];
 
             _uniforms.time += 0.01f;
             _uniforms.resolution = {(float)sceneTex.width, (float)sceneTex.height};
             [pEnc setBytes:&_uniforms length:sizeof(Uniforms) atIndex:0];
             
+            // Emitters advanced to this frame's time, with their grid
+            id<MTLBuffer> emitterFrame = (__bridge id<MTLBuffer>)updateEmitters((__bridge void*)pCmd);
+            [pEnc setBuffer:emitterFrame offset:EmitterSystem::kGridOffset atIndex:2];
+            [pEnc setBuffer:emitterFrame offset:EmitterSystem::kCellsOffset atIndex:3];
+            [pEnc setBuffer:emitterFrame offset:EmitterSystem::kRefsOffset atIndex:4];
+            [pEnc setBuffer:emitterFrame offset:EmitterSystem::kEmittersOffset atIndex:5];
+            
+            // Star catalog sections (empty placeholders with the procedural sky)
+            id<MTLBuffer> starBuffer = (__bridge id<MTLBuffer>)(_starCatalogBuffer ? _starCatalogBuffer : _emptyBuffer);
+            NSUInteger cellsOffset = _starCatalogBuffer ? (NSUInteger)_starCatalog.header().cells_offset : 0;
+            NSUInteger starsOffset = _starCatalogBuffer ? (NSUInteger)_starCatalog.header().stars_offset : 0;
+            [pEnc setBytes:&_starInfo length:sizeof(StarCatalogInfo) atIndex:6];
+            [pEnc setBuffer:starBuffer offset:cellsOffset atIndex:7];
+            [pEnc setBuffer:starBuffer offset:starsOffset atIndex:8];
+            
+            // Streamed volume: last feedback in, new bricks and page table out
+            updateVolume((__bridge void*)pEnc);
+            
+            // Particle grid (placeholder while the procedural disk is traced)
+            id<MTLTexture> particleGrid = (__bridge id<MTLTexture>)(_particleInfo.enabled ? _particleGrid : _volumePlaceholder);
+            [pEnc setTexture:particleGrid atIndex:4];
+            [pEnc setBytes:&_particleInfo length:sizeof(ParticleGridInfo) atIndex:12];
+            
+            // Error sums in this frame's slot (free since updateEmitters)
+            if (errorMap) {
+                id<MTLBuffer> sums = (__bridge id<MTLBuffer>)_tierErrorBuffers[_emitterFrame];
+                std::memset(sums.contents, 0, sums.length);
+                [pEnc setBuffer:sums offset:0 atIndex:13];
+                double pixels = (double)sceneTex.width * (double)sceneTex.height;
+                std::atomic<float>* meanError = &_tierError;
+                std::atomic<float>* share = &_tierErrorShare;
+                [pCmd addCompletedHandler:^(id<MTLCommandBuffer> buffer) {
+                    if (buffer.status == MTLCommandBufferStatusCompleted) {
+                        const uint32_t* result = (const uint32_t*)sums.contents;
+                        meanError->store((float)(result[0] / 256.0 / pixels));
+                        share->store((float)(result[1] / pixels));
+                    }
+                }];
+            }
+            
             MTLSize gridSize = MTLSizeMake(sceneTex.width, sceneTex.height, 1);
             NSUInteger threadGroupWidth = pso.threadExecutionWidth;
             NSUInteger threadGroupHeight = pso.maxTotalThreadsPerThreadgroup / threadGroupWidth;
@@ -724,15 +1689,18 @@ void Renderer::draw()
 
         // 4. Bloom (optional) -> writes to _bloomFinalTexture
         {
+            TRACE_SCOPE("encode", "post-process");
             id<MTLTexture> sceneTex = (__bridge id<MTLTexture>)_sceneTexture;
             id<MTLTexture> bloomOut = (__bridge id<MTLTexture>)_bloomFinalTexture;
-            if (_bloomEnabled && _bloomBrightnessPSO && _bloomDownsamplePSO && _bloomUpsamplePSO) {
+            if (_bloomEnabled && _bloomMode == 1 && _glareSize > 0) {
+                applyFFTGlare((__bridge void*)pCmd, (__bridge void*)sceneTex, (__bridge void*)bloomOut);
+            } else if (_bloomEnabled && _bloomBrightnessPSO && _bloomDownsamplePSO && _bloomUpsamplePSO) {
                 applyBloomEffect((__bridge void*)pCmd, (__bridge void*)sceneTex, (__bridge void*)bloomOut);
             } else {
                 // If bloom disabled, just copy scene into bloomOut via simple compute copy using composite with strength 0
                 id<MTLComputePipelineState> pso = (__bridge id<MTLComputePipelineState>)_bloomCompositePSO;
                 if (pso) {
-                    id<MTLComputeCommandEncoder> enc = [pCmd computeCommandEncoder];
+                    id<MTLComputeCommandEncoder> enc = beginComputePass(passTimer, pCmd, PassComposite);
                     [enc setComputePipelineState:pso];
                     [enc setTexture:sceneTex atIndex:0];
                     [enc setTexture:sceneTex atIndex:1];
@@ -752,12 +1720,17 @@ void Renderer::draw()
         }
     
         // 3. Tone mapping (optional) -> write into final texture when available
+        if (_autoExposure) {
+            updateAutoExposure((__bridge void*)pCmd, _bloomFinalTexture);
+        }
         bool usedIntermediate = false;
         {
             id<MTLTexture> inputTex = (__bridge id<MTLTexture>)_bloomFinalTexture;
             id<MTLTexture> finalTex = (__bridge id<MTLTexture>)_finalTexture;
             if (finalTex) {
-                applyToneMapping((__bridge void*)pCmd, (__bridge void*)inputTex, (__bridge void*)finalTex);
+                // Prefer the sRGB view so the store unit performs the encoding
+                void* target = _finalSRGBView ? _finalSRGBView : (__bridge void*)finalTex;
+                applyToneMapping((__bridge void*)pCmd, (__bridge void*)inputTex, target);
                 usedIntermediate = true;
             } else {
                 applyToneMapping((__bridge void*)pCmd, (__bridge void*)inputTex, (__bridge void*)pDrawableTexture);
@@ -784,6 +1757,7 @@ void Renderer::draw()
 
         // 5. Modern ImGui Interface
         {
+            TRACE_SCOPE("ui", "imgui");
             MTLRenderPassDescriptor* pRpd = [MTLRenderPassDescriptor renderPassDescriptor];
             pRpd.colorAttachments[0].texture = pDrawableTexture;
             pRpd.colorAttachments[0].loadAction = MTLLoadActionLoad;
@@ -817,6 +1791,28 @@ void Renderer::draw()
                 ImGui::SetTooltip("Higher quality = Better visuals but lower FPS");
             }
             
+            // Render tier traced while idle
+            ImGui::Text("Render Tier:");
+            const char* tiers[] = { "Preview (weak-field)", "Standard (RK4)", "Reference (adaptive RK4)" };
+            ImGui::Combo("##tier", &_renderTier, tiers, 3);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Preview: one analytic bend per ray, no integration\nStandard: RK4 march\nReference: RK4 substeps near the hole (slow)");
+            }
+            ImGui::Checkbox("Preview While Editing", &_previewWhileEditing);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Trace the Preview tier while a control is held, then switch back when idle");
+            }
+            if (_tierErrorPSOs[std::clamp(_uniforms.integration_method, 0, GEODESIC_INTEGRATOR_COUNT - 1)]) {
+                ImGui::Checkbox("Tier Error Map", &_tierErrorMap);
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("Relative error against Reference per pixel\nBlack 0%, red 33%, yellow 67%, white 100%+");
+                }
+                if (_tierErrorMap) {
+                    ImGui::TextDisabled("Mean error %.2f%%, %.1f%% of pixels above 10%%",
+                                        _tierError.load() * 100.0f, _tierErrorShare.load() * 100.0f);
+                }
+            }
+            
             ImGui::Separator();
             
             // Tabbed interface
@@ -910,6 +1906,34 @@ void Renderer::draw()
                         ImGui::SetTooltip("Color shift from relative motion");
                     }
                     
+                    if (ImGui::TreeNode("Star Catalog")) {
+                        ImGui::InputText("##star_catalog_path", _starCatalogPath, sizeof(_starCatalogPath));
+                        ImGui::SameLine();
+                        if (ImGui::Button("Load##star_catalog")) {
+                            _starCatalogDirty = true;
+                        }
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::SetTooltip("HEALPix catalog from tools/build_star_catalog.py.\nReplaces the procedural starfield with lensed, magnified stars.");
+                        }
+                        if (_starCatalogStatus[0] != '\0') {
+                            ImGui::TextDisabled("%s", _starCatalogStatus);
+                        }
+                        if (_starInfo.star_count > 0) {
+                            ImGui::SliderFloat("Star Brightness", &_starInfo.brightness, 1.0f, 1000.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+                            ImGui::SliderFloat("Splat Width", &_starInfo.splat_sigma, 0.4f, 2.0f, "%.2f px");
+                            ImGui::SliderFloat("Max Magnification", &_starInfo.max_magnification, 1.0f, 1000.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+                            int perCell = (int)_starInfo.max_per_cell;
+                            if (ImGui::SliderInt("Stars per Cell", &perCell, 1, 64)) {
+                                _starInfo.max_per_cell = (uint32_t)perCell;
+                            }
+                            if (ImGui::Button("Use Procedural Stars")) {
+                                _starCatalogPath[0] = '\0';
+                                _starCatalogDirty = true;
+                            }
+                        }
+                        ImGui::TreePop();
+                    }
+                    
                     ImGui::Spacing();
                     ImGui::TextColored(ImVec4(1.0f, 0.9f, 0.2f, 1.0f), "Post-Processing");
                     ImGui::Separator();
@@ -921,6 +1945,15 @@ void Renderer::draw()
                     
                     if (_bloomEnabled) {
                         ImGui::Indent();
+                        const char* bloomModes[] = { "Mip Chain", "FFT Glare" };
+                        ImGui::Text("Bloom Mode");
+                        if (ImGui::Combo("##bloom_mode", &_bloomMode, bloomModes, IM_ARRAYSIZE(bloomModes))) {
+                            _postProcessDirty = true;
+                        }
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::SetTooltip("FFT Glare convolves with a point-spread function (spikes, halos)");
+                        }
+                        
                         ImGui::Text("Bloom Strength");
                         ImGui::SliderFloat("##bloom_str", &_bloomStrength, 0.0f, 1.0f, "%.2f");
                         
@@ -930,12 +1963,44 @@ void Renderer::draw()
                             ImGui::SetTooltip("Brightness level required for bloom effect");
                         }
                         
-                        ImGui::Text("Bloom Quality");
-                        if (ImGui::SliderInt("##bloom_iter", &_bloomIterations, 1, 8)) {
-                            _postProcessDirty = true;
-                        }
-                        if (ImGui::IsItemHovered()) {
-                            ImGui::SetTooltip("Higher = smoother glow but slower");
+                        if (_bloomMode == 0) {
+                            ImGui::Text("Bloom Quality");
+                            if (ImGui::SliderInt("##bloom_iter", &_bloomIterations, 1, 8)) {
+                                _postProcessDirty = true;
+                            }
+                            if (ImGui::IsItemHovered()) {
+                                ImGui::SetTooltip("Higher = smoother glow but slower");
+                            }
+                        } else {
+                            const char* psfSources[] = { "Procedural", "Image File" };
+                            ImGui::Text("Point-Spread Function");
+                            if (ImGui::Combo("##psf_source", &_psfSource, psfSources, IM_ARRAYSIZE(psfSources))) {
+                                _psfDirty = true;
+                            }
+                            if (_psfSource == 0) {
+                                if (ImGui::SliderInt("Spikes", &_psfSpikes, 0, 16)) {
+                                    _psfDirty = true;
+                                }
+                                if (ImGui::SliderFloat("Spike Energy", &_psfSpikeStrength, 0.0f, 1.0f, "%.2f")) {
+                                    _psfDirty = true;
+                                }
+                                if (ImGui::SliderFloat("Halo Radius", &_psfHaloRadius, 0.5f, 32.0f, "%.1f px")) {
+                                    _psfHaloRadius = std::max(_psfHaloRadius, 0.5f);
+                                    _psfDirty = true;
+                                }
+                            } else {
+                                ImGui::InputText("##psf_path", _psfPath, sizeof(_psfPath));
+                                ImGui::SameLine();
+                                if (ImGui::Button("Load")) {
+                                    _psfDirty = true;
+                                }
+                                if (_psfStatus[0] != '\0') {
+                                    ImGui::TextDisabled("%s", _psfStatus);
+                                }
+                            }
+                            if (_glareSize > 0) {
+                                ImGui::TextDisabled("FFT %dx%d, glare at %dx%d", _glareSize, _glareSize, _glareWorkWidth, _glareWorkHeight);
+                            }
                         }
                         ImGui::Unindent();
                     }
@@ -956,22 +2021,118 @@ void Renderer::draw()
                         ImGui::Unindent();
                     }
                     
-                    ImGui::Spacing();
-                    ImGui::TextColored(ImVec4(0.8f, 0.9f, 0.4f, 1.0f), "Accretion Disk");
-                    ImGui::Separator();
-                    if (ImGui::SliderFloat("Vertical Density", &_uniforms.disk_density_vertical, 0.5f, 4.5f, "%.2f")) {
-                        _uniforms.disk_density_vertical = std::max(_uniforms.disk_density_vertical, 0.1f);
+                    ImGui::Checkbox("Auto Exposure", &_autoExposure);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("Adapt exposure to scene brightness (luminance histogram)");
                     }
-                    if (ImGui::SliderFloat("Radial Density", &_uniforms.disk_density_horizontal, 0.5f, 6.0f, "%.2f")) {
-                        _uniforms.disk_density_horizontal = std::max(_uniforms.disk_density_horizontal, 0.1f);
+                    if (_autoExposure && _exposureBuffer) {
+                        ImGui::Indent();
+                        ImGui::Text("Exposure Compensation");
+                        ImGui::SliderFloat("##exposure_comp", &_exposureCompensation, -4.0f, 4.0f, "%.1f EV");
+                        ImGui::Text("Adaptation Speed");
+                        ImGui::SliderFloat("##exposure_speed", &_exposureAdaptSpeed, 0.1f, 10.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+                        const float* state = (const float*)[(__bridge id<MTLBuffer>)_exposureBuffer contents];
+                        ImGui::TextDisabled("Exposure %+.2f EV (avg luminance %.3f)", std::log2(std::max(state[1], 1e-6f)), state[2]);
+                        ImGui::Unindent();
                     }
-                    ImGui::SliderFloat("Density Gain", &_uniforms.disk_density_gain, 1000.0f, 20000.0f, "%.0f");
-                    ImGui::SliderFloat("Density Clamp", &_uniforms.disk_density_clamp, 0.0f, 20.0f, "%.1f");
-                    ImGui::SliderFloat("Emission Strength", &_uniforms.disk_emission_strength, 0.05f, 0.5f, "%.2f");
-                    ImGui::SliderFloat("Alpha Falloff", &_uniforms.disk_alpha_falloff, 0.2f, 0.9f, "%.2f");
-                    ImGui::SliderFloat("Color Mix", &_uniforms.disk_color_mix, 0.0f, 1.0f, "%.2f");
-                    ImGui::SliderFloat("Inner Radius Mult", &_uniforms.disk_inner_multiplier, 10.0f, 35.0f, "%.1f");
-                    ImGui::SliderFloat("Inner Softness", &_uniforms.disk_inner_softness, 1.01f, 1.5f, "%.2f");
+                    
+                    ImGui::Spacing();
+                    if (ImGui::TreeNode("Buffer Storage")) {
+                        id<MTLDevice> device = (__bridge id<MTLDevice>)_pDevice;
+                        const char* storageNames[kHDRStorageCount];
+                        for (int i = 0; i < kHDRStorageCount; ++i) {
+                            storageNames[i] = kHDRStorage[i].name;
+                        }
+                        
+                        ImGui::Text("Scene Buffer");
+                        if (ImGui::Combo("##scene_storage", &_sceneStorage, storageNames, kHDRStorageCount)) {
+                            _postProcessDirty = true;
+                        }
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::SetTooltip("Ray traced HDR image and bloom composite");
+                        }
+                        ImGui::Text("Bloom Buffers");
+                        if (ImGui::Combo("##bloom_storage", &_bloomStorage, storageNames, kHDRStorageCount)) {
+                            _postProcessDirty = true;
+                        }
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::SetTooltip("Bright pass and blur pyramid; compact formats are invisible after blurring");
+                        }
+                        if ([device supportsFamily:MTLGPUFamilyApple2]) {
+                            if (ImGui::Checkbox("Hardware sRGB Encode", &_srgbOutput)) {
+                                _postProcessDirty = true;
+                            }
+                            if (ImGui::IsItemHovered()) {
+                                ImGui::SetTooltip("Tone mapper writes through an sRGB view; same output as the Unorm path");
+                            }
+                        }
+                        
+                        PassTimer* timer = (PassTimer*)_passTimer;
+                        if (timer && ImGui::BeginTable("##pass_timing", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp)) {
+                            ImGui::TableSetupColumn("Pass");
+                            ImGui::TableSetupColumn("ms");
+                            ImGui::TableSetupColumn("MB");
+                            ImGui::TableSetupColumn("RGBA32F MB");
+                            ImGui::TableHeadersRow();
+                            float totalMs = 0.0f;
+                            double totalBytes = 0.0, totalBaseline = 0.0;
+                            for (int p = 0; p < PassCount; ++p) {
+                                float ms = timer->passMs[p].load();
+                                totalMs += ms;
+                                totalBytes += timer->passBytes[p];
+                                totalBaseline += timer->baselineBytes[p];
+                                ImGui::TableNextRow();
+                                ImGui::TableNextColumn(); ImGui::TextUnformatted(kPassNames[p]);
+                                ImGui::TableNextColumn();
+                                if (timer->samples) ImGui::Text("%.3f", ms); else ImGui::TextUnformatted("-");
+                                ImGui::TableNextColumn(); ImGui::Text("%.1f", timer->passBytes[p] / 1.0e6);
+                                ImGui::TableNextColumn(); ImGui::Text("%.1f", timer->baselineBytes[p] / 1.0e6);
+                            }
+                            ImGui::TableNextRow();
+                            ImGui::TableNextColumn(); ImGui::TextUnformatted("Total");
+                            ImGui::TableNextColumn();
+                            if (timer->samples) ImGui::Text("%.3f", totalMs); else ImGui::TextUnformatted("-");
+                            ImGui::TableNextColumn(); ImGui::Text("%.1f", totalBytes / 1.0e6);
+                            ImGui::TableNextColumn(); ImGui::Text("%.1f", totalBaseline / 1.0e6);
+                            ImGui::EndTable();
+                        }
+#ifdef BLACKHOLE_TRACE
+                        // CPU phases, decoder threads and per-encoder GPU spans on one timeline
+                        bool recording = traceEnabled();
+                        if (ImGui::Checkbox("Record Trace", &recording)) {
+                            if (recording) traceStart(); else traceStop();
+                        }
+                        ImGui::SameLine();
+                        if (ImGui::Button("Save Trace")) {
+                            traceDump("blackhole_trace.json");
+                        }
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::SetTooltip("Writes blackhole_trace.json; open it in ui.perfetto.dev");
+                        }
+#endif
+                        ImGui::TreePop();
+                    }
+                    
+                    ImGui::Spacing();
+                    ImGui::TextColored(ImVec4(0.8f, 0.9f, 0.4f, 1.0f), "Accretion Disk");
+                    ImGui::Separator();
+                    if (ImGui::SliderFloat("Vertical Density", &_uniforms.disk_density_vertical, 0.5f, 4.5f, "%.2f")) {
+                        _uniforms.disk_density_vertical = std::max(_uniforms.disk_density_vertical, 0.1f);
+                    }
+                    if (ImGui::SliderFloat("Radial Density", &_uniforms.disk_density_horizontal, 0.5f, 6.0f, "%.2f")) {
+                        _uniforms.disk_density_horizontal = std::max(_uniforms.disk_density_horizontal, 0.1f);
+                    }
+                    ImGui::SliderFloat("Density Gain", &_uniforms.disk_density_gain, 1000.0f, 20000.0f, "%.0f");
+                    ImGui::SliderFloat("Density Clamp", &_uniforms.disk_density_clamp, 0.0f, 20.0f, "%.1f");
+                    ImGui::SliderFloat("Emission Strength", &_uniforms.disk_emission_strength, 0.05f, 0.5f, "%.2f");
+                    ImGui::SliderFloat("Alpha Falloff", &_uniforms.disk_alpha_falloff, 0.2f, 0.9f, "%.2f");
+                    ImGui::SliderFloat("Color Mix", &_uniforms.disk_color_mix, 0.0f, 1.0f, "%.2f");
+                    ImGui::Checkbox("Spectral Emission", &_uniforms.spectral_mode);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("Shift the blackbody spectrum by Doppler x gravitational factor\nbefore projecting to RGB (ignores Color Mix)");
+                    }
+                    ImGui::SliderFloat("Inner Radius Mult", &_uniforms.disk_inner_multiplier, 10.0f, 35.0f, "%.1f");
+                    ImGui::SliderFloat("Inner Softness", &_uniforms.disk_inner_softness, 1.01f, 1.5f, "%.2f");
                     ImGui::SliderFloat("Noise Scale", &_uniforms.disk_noise_scale, 0.2f, 2.0f, "%.2f");
                     if (ImGui::SliderFloat("Noise Speed", &_uniforms.disk_noise_speed, 0.1f, 1.5f, "%.2f")) {
                         _uniforms.disk_noise_speed = std::max(_uniforms.disk_noise_speed, 0.1f);
@@ -982,6 +2143,10 @@ void Renderer::draw()
                     if (ImGui::SliderInt("Noise Octaves", &_uniforms.disk_noise_octaves, 1, 8)) {
                         _uniforms.disk_noise_octaves = std::clamp(_uniforms.disk_noise_octaves, 1, 8);
                     }
+                    ImGui::SliderFloat("Noise LOD Bias", &_uniforms.disk_noise_lod_bias, 0.0f, 4.0f, "%.2f");
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("Fades noise octaves finer than the lensed pixel footprint (0 = off, higher = blurrier)");
+                    }
                     ImGui::Spacing();
                     if (ImGui::Button("Reset Disk Overrides")) {
                         applyVisualPreset(_currentVisualPreset);
@@ -991,7 +2156,7 @@ void Renderer::draw()
                     }
                     
                     ImGui::Spacing();
-                    ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.2f, 1.0f), "Orbiting Star");
+                    ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.2f, 1.0f), "Orbiting Emitters");
                     ImGui::Separator();
                     
                     ImGui::Checkbox("Show Orbiting Star", &_uniforms.show_orbiting_star);
@@ -1009,6 +2174,176 @@ void Renderer::draw()
                         ImGui::Unindent();
                     }
                     
+                    ImGui::Text("Hot Spots");
+                    ImGui::SliderInt("##hotspot_count", &_hotSpotCount, 0, 512);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("Compact sources on Keplerian orbits in the disk.\nTraced along each ray with lensed secondary images.");
+                    }
+                    if (_hotSpotCount > 0) {
+                        ImGui::Indent();
+                        ImGui::Text("Size");
+                        ImGui::SliderFloat("##hotspot_size", &_hotSpotSize, 0.02f, 0.3f, "%.2f");
+                        ImGui::Text("Brightness");
+                        ImGui::SliderFloat("##hotspot_bright", &_hotSpotBrightness, 0.1f, 10.0f, "%.1f");
+                        if (ImGui::Button("Reseed Hot Spots")) {
+                            ++_hotSpotSeed;
+                        }
+                        ImGui::Unindent();
+                    }
+                    ImGui::Text("Traced emitters: %zu", _emitters.count());
+                    
+                    ImGui::Spacing();
+                    ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.3f, 1.0f), "Volumetric Data");
+                    ImGui::Separator();
+                    
+                    ImGui::InputText("##volume_path", _volumePath, sizeof(_volumePath));
+                    ImGui::SameLine();
+                    if (ImGui::Button("Load##volume")) {
+                        _volumeDirty = true;
+                    }
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("Bricked .bhvol (tools/brick_volume.py) or raw float32 density.\nReplaces the procedural disk with the simulated flow.");
+                    }
+                    if (ImGui::TreeNode("Raw Grid")) {
+                        ImGui::InputInt3("Dimensions", _volumeRawDims);
+                        ImGui::InputText("Temperature", _volumeTemperaturePath, sizeof(_volumeTemperaturePath));
+                        ImGui::SliderInt("Brick Size", &_volumeBrickSize, 8, 64);
+                        ImGui::TreePop();
+                    }
+                    ImGui::SliderInt("Atlas Bricks", &_volumeSlots, 64, 4096, "%d", ImGuiSliderFlags_Logarithmic);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("GPU cache capacity, applied on the next load");
+                    }
+                    if (_volumeStatus[0] != '\0') {
+                        ImGui::TextDisabled("%s", _volumeStatus);
+                    }
+                    if (_volume.isOpen()) {
+                        ImGui::SliderFloat("Volume Extent", &_volumeExtent, 1.0f, 50.0f, "%.1f");
+                        ImGui::SliderFloat("Absorption", &_volumeInfo.density_scale, 0.001f, 100.0f, "%.3f", ImGuiSliderFlags_Logarithmic);
+                        ImGui::SliderFloat("Emission", &_volumeInfo.emission_scale, 0.01f, 100.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+                        float temperatureScale = _volumeInfo.temperature_scale / kVolumeTemperatureUnit;
+                        if (ImGui::SliderFloat("Temperature Scale", &temperatureScale, 0.1f, 10.0f, "%.2f", ImGuiSliderFlags_Logarithmic)) {
+                            _volumeInfo.temperature_scale = temperatureScale * kVolumeTemperatureUnit;
+                        }
+                        VolumeCache::Stats stats = _volume.stats();
+                        ImGui::Text("Resident: %u / %u bricks, %u queued", stats.resident, _volume.slotCount(), stats.queued);
+                        ImGui::Text("Hit rate: %.1f%%", stats.hitRate() * 100.0);
+                        ImGui::Text("Loads: %llu (%llu prefetched), %.1f MB read",
+                                    (unsigned long long)stats.loads, (unsigned long long)stats.prefetches, stats.bytesRead / 1.0e6);
+                        ImGui::Text("Evictions: %llu, deferred: %llu",
+                                    (unsigned long long)stats.evictions, (unsigned long long)stats.deferred);
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::SetTooltip("Deferred loads mean the view needs more bricks than the atlas holds");
+                        }
+                        if (ImGui::Button("Use Procedural Disk")) {
+                            _volumePath[0] = '\0';
+                            _volumeDirty = true;
+                        }
+                    }
+                    
+                    ImGui::Spacing();
+                    ImGui::TextColored(ImVec4(1.0f, 0.7f, 0.4f, 1.0f), "Lensed Particles");
+                    ImGui::Separator();
+                    
+                    ImGui::Checkbox("Particle Disk", &_uniforms.particle_lensing);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("Simulate disk particles and trace them through a deposited emission grid.\nReplaces the procedural disk; tracing cost does not depend on the particle count.");
+                    }
+                    if (_uniforms.particle_lensing) {
+                        ImGui::Indent();
+                        int particles = (int)_uniforms.max_particles;
+                        if (ImGui::SliderInt("Particles", &particles, 1024, PARTICLE_CAPACITY, "%d", ImGuiSliderFlags_Logarithmic)) {
+                            _uniforms.max_particles = (uint32_t)std::clamp(particles, 1024, PARTICLE_CAPACITY);
+                        }
+                        ImGui::Checkbox("Spawn Particles", &_uniforms.particle_spawning);
+                        ImGui::SliderFloat("Spawn Rate", &_uniforms.particle_emission_rate, 0.1f, 10.0f, "%.1f /s");
+                        ImGui::SliderFloat("Lifetime", &_uniforms.particle_lifetime, 1.0f, 30.0f, "%.1f s");
+                        ImGui::SliderFloat("Turbulence", &_uniforms.particle_turbulence, 0.0f, 2.0f, "%.2f");
+                        ImGui::SliderFloat("Spawn Inner", &_uniforms.spawning_radius_min, 1.5f, 10.0f, "%.1f");
+                        ImGui::SliderFloat("Spawn Outer", &_uniforms.spawning_radius_max, 2.0f, 20.0f, "%.1f");
+                        ImGui::SliderFloat("Particle Emission", &_particleInfo.emission_scale, 0.001f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic);
+                        ImGui::SliderFloat("Particle Absorption", &_particleInfo.absorption, 0.0f, 0.5f, "%.3f");
+                        int seed = (int)_uniforms.particle_seed;
+                        if (ImGui::InputInt("Seed", &seed)) {
+                            _uniforms.particle_seed = (uint32_t)seed;
+                            _particleRestart = true;
+                        }
+                        ImGui::SameLine();
+                        if (ImGui::Button("Restart")) {
+                            _particleRestart = true;
+                        }
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::SetTooltip("Same seed, same simulation: all randomness is keyed by seed, particle and step (step %u)", _uniforms.particle_step);
+                        }
+                        ImGui::InputText("Snapshot", _particleSnapshotPath, sizeof(_particleSnapshotPath));
+                        if (ImGui::Button("Save Snapshot")) {
+                            _particleSnapshotSave = true;
+                        }
+                        ImGui::SameLine();
+                        if (ImGui::Button("Load Snapshot")) {
+                            _particleSnapshotLoad = true;
+                        }
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::SetTooltip("Warm-start from a settled disk: the file is mapped and simulated in place");
+                        }
+                        if (_particleSnapshotStatus[0]) {
+                            ImGui::TextWrapped("%s", _particleSnapshotStatus);
+                        }
+                        std::string lastSave = _snapshotWriter.status();
+                        if (!lastSave.empty()) {
+                            ImGui::TextWrapped("Last save: %s", lastSave.c_str());
+                        }
+                        
+                        if (_particleStatsPSO && ImGui::TreeNode("Disk Statistics")) {
+                            ImGui::SliderInt("Every N Steps", &_particleStatsInterval, 0, 240);
+                            if (ImGui::IsItemHovered()) {
+                                ImGui::SetTooltip("Radius × azimuth histogram of the live particles (0 = off).\nRead back asynchronously; never stalls the simulation.");
+                            }
+                            const char* quantities[ParticleProfile::Count];
+                            for (int q = 0; q < ParticleProfile::Count; ++q) {
+                                quantities[q] = ParticleStats::quantityName((ParticleProfile::Quantity)q);
+                            }
+                            ImGui::Combo("Quantity", &_particleStatsQuantity, quantities, ParticleProfile::Count);
+                            ParticleProfile profile;
+                            if (_particleStats.latest(profile)) {
+                                ImGui::Text("Step %u: %u particles binned", profile.step, profile.particles);
+                                ImGui::PlotLines("Profile", profile.value[_particleStatsQuantity], PARTICLE_STATS_R, 0,
+                                                 "inner → outer", FLT_MAX, FLT_MAX, ImVec2(0, 80));
+                                ImGui::SliderInt("Radius Bin", &_particleStatsRadius, 0, PARTICLE_STATS_R - 1);
+                                ImGui::SameLine();
+                                ImGui::TextDisabled("r = %.2f", profile.radius[_particleStatsRadius]);
+                                std::vector<float> series = _particleStats.series((ParticleProfile::Quantity)_particleStatsQuantity, _particleStatsRadius);
+                                ImGui::PlotLines("History", series.data(), (int)series.size(), 0,
+                                                 nullptr, FLT_MAX, FLT_MAX, ImVec2(0, 80));
+                            } else {
+                                ImGui::TextDisabled("No samples yet");
+                            }
+                            ImGui::InputText("##stats_path", _particleStatsPath, sizeof(_particleStatsPath));
+                            ImGui::SameLine();
+                            if (!_particleStats.recording()) {
+                                if (ImGui::Button("Record")) {
+                                    std::string error;
+                                    if (_particleStats.startRecording(_particleStatsPath, error)) {
+                                        std::snprintf(_particleStatsStatus, sizeof(_particleStatsStatus), "Recording to %s", _particleStatsPath);
+                                    } else {
+                                        std::snprintf(_particleStatsStatus, sizeof(_particleStatsStatus), "%s", error.c_str());
+                                    }
+                                }
+                                if (ImGui::IsItemHovered()) {
+                                    ImGui::SetTooltip(".csv: radial profiles per sample\nOther extensions: binary r × φ sums (see ParticleStats.hpp)");
+                                }
+                            } else if (ImGui::Button("Stop")) {
+                                _particleStats.stopRecording();
+                                std::snprintf(_particleStatsStatus, sizeof(_particleStatsStatus), "Saved %s", _particleStatsPath);
+                            }
+                            if (_particleStatsStatus[0] != '\0') {
+                                ImGui::TextDisabled("%s", _particleStatsStatus);
+                            }
+                            ImGui::TreePop();
+                        }
+                        ImGui::Unindent();
+                    }
+                    
                     ImGui::Spacing();
                     ImGui::TextColored(ImVec4(0.5f, 1.0f, 0.5f, 1.0f), "Advanced Settings");
                     ImGui::Separator();
@@ -1030,6 +2365,29 @@ void Renderer::draw()
                         ImGui::SetTooltip("Automatically adjust step size based on curvature");
                     }
                     
+                    const char* integrators[] = { "Verlet (2nd order)", "RK4 (4th order)", "Yoshida (4th order, symplectic)", "Yoshida (6th order, symplectic)" };
+                    ImGui::Text("Integrator:");
+                    ImGui::Combo("##integrator", &_uniforms.integration_method, integrators, GEODESIC_INTEGRATOR_COUNT);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("Geodesic integrator; each has its own pipeline. RK4 is the cheapest that meets\nevery preset's accuracy budget (tools/geodesic_bench)");
+                    }
+                    
+                    ImGui::Text("Photon Ring Rays: %d x %d", _uniforms.critical_samples, _uniforms.critical_samples);
+                    ImGui::SliderInt("##critical_samples", &_uniforms.critical_samples, 1, 4);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("Rays per pixel axis near the critical curve, traced with Reference integration (1 = off)");
+                    }
+                    ImGui::Text("Photon Ring Band");
+                    ImGui::SliderFloat("##critical_band", &_uniforms.critical_band, 0.01f, 0.3f, "%.2f b_c");
+                    if (_uniforms.critical_samples > 1) {
+                        float radius = 0.0f, share = 0.0f;
+                        if (criticalCurveFootprint(_uniforms, _ppWidth, _ppHeight, radius, share)) {
+                            ImGui::TextDisabled("Ring radius %.0f px, %.1f%% of pixels supersampled", radius, share * 100.0f);
+                        } else {
+                            ImGui::TextDisabled("Critical curve fills the view");
+                        }
+                    }
+                    
                     ImGui::EndTabItem();
                 }
                 
@@ -1116,6 +2474,9 @@ void Renderer::draw()
             ImGui::TextWrapped("GPU-accelerated black hole ray tracer with scientifically accurate physics");
             
             ImGui::End();
+            
+            // Drives the Preview tier in the next frame
+            _uiActive = ImGui::IsAnyItemActive();
 
             ImGui::Render();
             
@@ -1129,6 +2490,19 @@ void Renderer::draw()
             captureFrame();
         }
 
+        // Resolve this frame's timestamps once the GPU is done with it
+        if (passTimer && passTimer->samples && passTimer->pairCount > 0) {
+            passTimer->calibrate((__bridge id<MTLDevice>)_pDevice);
+            int frameSlot = passTimer->slot;
+            int pairs = passTimer->pairCount;
+            std::vector<int> passes(passTimer->passOfPair[frameSlot], passTimer->passOfPair[frameSlot] + pairs);
+            [pCmd addCompletedHandler:^(id<MTLCommandBuffer> buffer) {
+                if (buffer.status == MTLCommandBufferStatusCompleted) {
+                    passTimer->resolve(frameSlot, pairs, passes.data());
+                }
+            }];
+        }
+
         [pCmd presentDrawable:pDrawable];
         [pCmd commit];
     }
@@ -1161,9 +2535,11 @@ void Renderer::applyBloomEffect(void* commandBuffer, void* inputTexture, void* o
         return;
     }
 
+    PassTimer* timer = (PassTimer*)_passTimer;
+
     // 1) Brightness extraction
     {
-        id<MTLComputeCommandEncoder> enc = [cmd computeCommandEncoder];
+        id<MTLComputeCommandEncoder> enc = beginComputePass(timer, cmd, PassBrightness);
         [enc setComputePipelineState:brightPSO];
         [enc setTexture:src atIndex:0];
         [enc setTexture:(__bridge id<MTLTexture>)_brightnessTexture atIndex:1];
@@ -1180,7 +2556,7 @@ void Renderer::applyBloomEffect(void* commandBuffer, void* inputTexture, void* o
     for (int i = 0; i < levels; ++i) {
         if (_bloomDownsample[i] == nullptr) break;
         id<MTLTexture> outLvl = (__bridge id<MTLTexture>)_bloomDownsample[i];
-        id<MTLComputeCommandEncoder> enc = [cmd computeCommandEncoder];
+        id<MTLComputeCommandEncoder> enc = beginComputePass(timer, cmd, PassDownsample);
         [enc setComputePipelineState:downPSO];
         [enc setTexture:prev atIndex:0];
         [enc setTexture:outLvl atIndex:1];
@@ -1198,7 +2574,7 @@ void Renderer::applyBloomEffect(void* commandBuffer, void* inputTexture, void* o
         if (!bigger || !dsLvl) {
             continue;
         }
-        id<MTLComputeCommandEncoder> enc = [cmd computeCommandEncoder];
+        id<MTLComputeCommandEncoder> enc = beginComputePass(timer, cmd, PassUpsample);
         [enc setComputePipelineState:upPSO];
         [enc setTexture:upPrev atIndex:0];       // smaller
         [enc setTexture:dsLvl atIndex:1];        // previous bigger level to add into
@@ -1210,7 +2586,7 @@ void Renderer::applyBloomEffect(void* commandBuffer, void* inputTexture, void* o
 
     // 4) Composite bloom with scene into dst
     {
-        id<MTLComputeCommandEncoder> enc = [cmd computeCommandEncoder];
+        id<MTLComputeCommandEncoder> enc = beginComputePass(timer, cmd, PassComposite);
         [enc setComputePipelineState:compPSO];
         [enc setTexture:src atIndex:0];
         [enc setTexture:upPrev atIndex:1];
@@ -1235,19 +2611,1008 @@ void Renderer::applyToneMapping(void* commandBuffer, void* inputTexture, void* o
         return;
     }
 
-    id<MTLComputeCommandEncoder> enc = [cmd computeCommandEncoder];
+    id<MTLComputeCommandEncoder> enc = beginComputePass((PassTimer*)_passTimer, cmd, PassTonemap);
     [enc setComputePipelineState:pso];
     [enc setTexture:src atIndex:0];
     [enc setTexture:dst atIndex:1];
     float gamma = _tonemapGamma;
     bool enabled = _tonemappingEnabled;
+    bool srgb = (dst.pixelFormat == MTLPixelFormatBGRA8Unorm_sRGB);
+    bool autoExposure = _autoExposure && _histogramPSO && _exposureAdaptPSO;
     [enc setBytes:&gamma length:sizeof(float) atIndex:0];
     [enc setBytes:&enabled length:sizeof(bool) atIndex:1];
+    [enc setBytes:&srgb length:sizeof(bool) atIndex:2];
+    [enc setBuffer:(__bridge id<MTLBuffer>)_exposureBuffer offset:0 atIndex:3];
+    [enc setBytes:&autoExposure length:sizeof(bool) atIndex:4];
     dispatchForTexture(pso, enc, dst);
     [enc endEncoding];
 }
 
+void Renderer::updateAutoExposure(void* commandBuffer, void* inputTexture)
+{
+    id<MTLCommandBuffer> cmd = (__bridge id<MTLCommandBuffer>)commandBuffer;
+    id<MTLTexture> src = (__bridge id<MTLTexture>)inputTexture;
+    id<MTLComputePipelineState> histogramPSO = (__bridge id<MTLComputePipelineState>)_histogramPSO;
+    id<MTLComputePipelineState> adaptPSO = (__bridge id<MTLComputePipelineState>)_exposureAdaptPSO;
+    
+    if (!src || !histogramPSO || !adaptPSO) {
+        return;
+    }
+    
+    id<MTLBuffer> histogram = (__bridge id<MTLBuffer>)_histogramBuffer;
+    id<MTLBuffer> exposure = (__bridge id<MTLBuffer>)_exposureBuffer;
+    
+    // Sample grid capped at kExposureSampleRows rows keeps the cost flat at 4K
+    uint32_t stride = (uint32_t)std::max<NSUInteger>(1, (src.height + kExposureSampleRows - 1) / kExposureSampleRows);
+    float minLogLum = kMinLogLuminance;
+    float logLumRange = kLogLuminanceRange;
+    float invLogLumRange = 1.0f / kLogLuminanceRange;
+    
+    float dt = std::clamp(_frameTimeMs * 0.001f, 0.0f, 0.25f);
+    float adaptation = 1.0f - std::exp(-dt * _exposureAdaptSpeed);
+    float key = kExposureKey * std::exp2(_exposureCompensation);
+    simd_float2 limits = { kMinExposure, kMaxExposure };
+    simd_float2 percentiles = { 0.5f, 0.98f };
+    
+    id<MTLComputeCommandEncoder> enc = beginComputePass((PassTimer*)_passTimer, cmd, PassExposure);
+    
+    // 1) Histogram with threadgroup-private bins
+    [enc setComputePipelineState:histogramPSO];
+    [enc setTexture:src atIndex:0];
+    [enc setBuffer:histogram offset:0 atIndex:0];
+    [enc setBytes:&minLogLum length:sizeof(float) atIndex:1];
+    [enc setBytes:&invLogLumRange length:sizeof(float) atIndex:2];
+    [enc setBytes:&stride length:sizeof(uint32_t) atIndex:3];
+    MTLSize grid = MTLSizeMake((src.width + stride - 1) / stride, (src.height + stride - 1) / stride, 1);
+    [enc dispatchThreads:grid threadsPerThreadgroup:MTLSizeMake(16, 16, 1)];
+    
+    // 2) Average, adapt and clear (single threadgroup, one thread per bin)
+    [enc setComputePipelineState:adaptPSO];
+    [enc setBuffer:histogram offset:0 atIndex:0];
+    [enc setBuffer:exposure offset:0 atIndex:1];
+    [enc setBytes:&minLogLum length:sizeof(float) atIndex:2];
+    [enc setBytes:&logLumRange length:sizeof(float) atIndex:3];
+    [enc setBytes:&adaptation length:sizeof(float) atIndex:4];
+    [enc setBytes:&key length:sizeof(float) atIndex:5];
+    [enc setBytes:&limits length:sizeof(limits) atIndex:6];
+    [enc setBytes:&percentiles length:sizeof(percentiles) atIndex:7];
+    [enc dispatchThreadgroups:MTLSizeMake(1, 1, 1) threadsPerThreadgroup:MTLSizeMake(kHistogramBins, 1, 1)];
+    [enc endEncoding];
+}
+
+void Renderer::updatePSFSpectrum(void* commandBuffer)
+{
+    id<MTLCommandBuffer> cmd = (__bridge id<MTLCommandBuffer>)commandBuffer;
+    id<MTLDevice> device = (__bridge id<MTLDevice>)_pDevice;
+    int n = _glareSize;
+    float radius = (float)(n - std::max(_glareWorkWidth, _glareWorkHeight));
+    
+    std::vector<float> psf;
+    bool loaded = false;
+    if (_psfSource == 1 && _psfPath[0] != '\0') {
+        loaded = loadPSFImage(_psfPath, psf, n, radius);
+        std::snprintf(_psfStatus, sizeof(_psfStatus), loaded ? "Loaded PSF (radius %.0f px)" : "Could not load PSF image", radius);
+    }
+    if (!loaded) {
+        buildProceduralPSF(psf, n, radius, _psfSpikes, _psfSpikeStrength, _psfHaloRadius);
+    }
+    
+    id<MTLBuffer> staging = [device newBufferWithBytes:psf.data()
+                                                length:psf.size() * sizeof(float)
+                                               options:MTLResourceStorageModeShared];
+    id<MTLBuffer> glareBuffer = (__bridge id<MTLBuffer>)_glareBuffer;
+    id<MTLBuffer> spectrum = (__bridge id<MTLBuffer>)_psfSpectrum;
+    id<MTLComputePipelineState> loadPSO = (__bridge id<MTLComputePipelineState>)_glareLoadPSFPSO;
+    id<MTLComputePipelineState> fftPSO = (__bridge id<MTLComputePipelineState>)_fftPSO;
+    id<MTLComputePipelineState> storePSO = (__bridge id<MTLComputePipelineState>)_glareSpectrumPSO;
+    uint32_t count = (uint32_t)(n * n);
+    
+    // Forward transform of the PSF, reusing the glare buffer as scratch.
+    // Dispatches within one compute encoder execute in order.
+    id<MTLComputeCommandEncoder> enc = beginComputePass((PassTimer*)_passTimer, cmd, PassGlare);
+    [enc setComputePipelineState:loadPSO];
+    [enc setBuffer:staging offset:0 atIndex:0];
+    [enc setBuffer:glareBuffer offset:0 atIndex:1];
+    [enc setBytes:&count length:sizeof(uint32_t) atIndex:2];
+    dispatchLinear(loadPSO, enc, count);
+    
+    encodeFFTLines(enc, fftPSO, glareBuffer, n, n, n, 1, -1.0f);
+    encodeFFTLines(enc, fftPSO, glareBuffer, n, n, 1, n, -1.0f);
+    
+    // Fold the inverse transform's 1/N² into the cached spectrum
+    float scale = 1.0f / (float)count;
+    [enc setComputePipelineState:storePSO];
+    [enc setBuffer:glareBuffer offset:0 atIndex:0];
+    [enc setBuffer:spectrum offset:0 atIndex:1];
+    [enc setBytes:&count length:sizeof(uint32_t) atIndex:2];
+    [enc setBytes:&scale length:sizeof(float) atIndex:3];
+    dispatchLinear(storePSO, enc, count);
+    [enc endEncoding];
+}
+
+void Renderer::applyFFTGlare(void* commandBuffer, void* inputTexture, void* outputTexture)
+{
+    id<MTLCommandBuffer> cmd = (__bridge id<MTLCommandBuffer>)commandBuffer;
+    id<MTLTexture> src = (__bridge id<MTLTexture>)inputTexture;
+    id<MTLTexture> dst = (__bridge id<MTLTexture>)outputTexture;
+    id<MTLComputePipelineState> fftPSO = (__bridge id<MTLComputePipelineState>)_fftPSO;
+    id<MTLComputePipelineState> preparePSO = (__bridge id<MTLComputePipelineState>)_glarePreparePSO;
+    id<MTLComputePipelineState> multiplyPSO = (__bridge id<MTLComputePipelineState>)_glareMultiplyPSO;
+    id<MTLComputePipelineState> resolvePSO = (__bridge id<MTLComputePipelineState>)_glareResolvePSO;
+    id<MTLComputePipelineState> compPSO = (__bridge id<MTLComputePipelineState>)_bloomCompositePSO;
+    
+    if (!src || !dst || !fftPSO || !preparePSO || !multiplyPSO || !resolvePSO || !compPSO ||
+        !_glareLoadPSFPSO || !_glareSpectrumPSO || _glareSize == 0) {
+        return;
+    }
+    
+    // The PSF spectrum only changes with the PSF or the transform size
+    if (_psfDirty) {
+        updatePSFSpectrum(commandBuffer);
+        _psfDirty = false;
+    }
+    
+    id<MTLBuffer> glareBuffer = (__bridge id<MTLBuffer>)_glareBuffer;
+    id<MTLBuffer> spectrum = (__bridge id<MTLBuffer>)_psfSpectrum;
+    id<MTLTexture> glareTex = (__bridge id<MTLTexture>)_glareTexture;
+    uint32_t n = (uint32_t)_glareSize;
+    uint32_t count = n * n;
+    simd_uint2 workSize = { (uint32_t)_glareWorkWidth, (uint32_t)_glareWorkHeight };
+    
+    id<MTLComputeCommandEncoder> enc = beginComputePass((PassTimer*)_passTimer, cmd, PassGlare);
+    
+    // 1) Bright pass into the packed complex buffer (guard band zeroed)
+    [enc setComputePipelineState:preparePSO];
+    [enc setTexture:src atIndex:0];
+    [enc setBuffer:glareBuffer offset:0 atIndex:0];
+    [enc setBytes:&n length:sizeof(uint32_t) atIndex:1];
+    [enc setBytes:&workSize length:sizeof(workSize) atIndex:2];
+    float threshold = _bloomThreshold;
+    [enc setBytes:&threshold length:sizeof(float) atIndex:3];
+    {
+        NSUInteger tw = preparePSO.threadExecutionWidth;
+        NSUInteger th = std::max<NSUInteger>(1, preparePSO.maxTotalThreadsPerThreadgroup / tw);
+        [enc dispatchThreads:MTLSizeMake(n, n, 1) threadsPerThreadgroup:MTLSizeMake(tw, th, 1)];
+    }
+    
+    // 2) Forward 2D FFT. Rows below the working height are all zero, so
+    //    only the image rows need transforming.
+    encodeFFTLines(enc, fftPSO, glareBuffer, n, workSize.y, n, 1, -1.0f);
+    encodeFFTLines(enc, fftPSO, glareBuffer, n, n, 1, n, -1.0f);
+    
+    // 3) Multiply by the cached PSF spectrum
+    [enc setComputePipelineState:multiplyPSO];
+    [enc setBuffer:glareBuffer offset:0 atIndex:0];
+    [enc setBuffer:spectrum offset:0 atIndex:1];
+    [enc setBytes:&count length:sizeof(uint32_t) atIndex:2];
+    dispatchLinear(multiplyPSO, enc, count);
+    
+    // 4) Inverse 2D FFT; only the image rows are read back
+    encodeFFTLines(enc, fftPSO, glareBuffer, n, n, 1, n, 1.0f);
+    encodeFFTLines(enc, fftPSO, glareBuffer, n, workSize.y, n, 1, 1.0f);
+    
+    // 5) Unpack and upsample to output resolution
+    [enc setComputePipelineState:resolvePSO];
+    [enc setBuffer:glareBuffer offset:0 atIndex:0];
+    [enc setTexture:glareTex atIndex:0];
+    [enc setBytes:&n length:sizeof(uint32_t) atIndex:1];
+    [enc setBytes:&workSize length:sizeof(workSize) atIndex:2];
+    dispatchForTexture(resolvePSO, enc, glareTex);
+    [enc endEncoding];
+    
+    // 6) Composite glare with scene into dst
+    {
+        id<MTLComputeCommandEncoder> compEnc = beginComputePass((PassTimer*)_passTimer, cmd, PassComposite);
+        [compEnc setComputePipelineState:compPSO];
+        [compEnc setTexture:src atIndex:0];
+        [compEnc setTexture:glareTex atIndex:1];
+        [compEnc setTexture:dst atIndex:2];
+        float strength = _bloomStrength;
+        float tone = 1.0f;
+        [compEnc setBytes:&strength length:sizeof(float) atIndex:0];
+        [compEnc setBytes:&tone length:sizeof(float) atIndex:1];
+        dispatchForTexture(compPSO, compEnc, dst);
+        [compEnc endEncoding];
+    }
+}
+
+
+
+void* Renderer::updateEmitters(void* commandBuffer)
+{
+    id<MTLCommandBuffer> cmd = (__bridge id<MTLCommandBuffer>)commandBuffer;
+    dispatch_semaphore_t frameSemaphore = (__bridge dispatch_semaphore_t)_frameSemaphore;
+    
+    // Wait until the GPU has released the oldest slot, then hand it back
+    // when this frame's command buffer completes
+    dispatch_semaphore_wait(frameSemaphore, DISPATCH_TIME_FOREVER);
+    [cmd addCompletedHandler:^(id<MTLCommandBuffer> buffer) {
+        dispatch_semaphore_signal(frameSemaphore);
+    }];
+    _emitterFrame = (_emitterFrame + 1) % kMaxFramesInFlight;
+    
+    // Legacy orbiting star: same orbit, now traced along the geodesic
+    EmitterOrbit star = {};
+    star.radius = _uniforms.star_orbit_radius;
+    star.angularSpeed = _uniforms.star_orbit_speed;
+    star.size = 0.1f;
+    star.brightness = _uniforms.star_brightness;
+    star.temperature = 9500.0f;
+    star.color = {0.9f, 0.95f, 1.0f};
+    _emitters.setStar(_uniforms.show_orbiting_star, star);
+    
+    // Hot spots follow the disk sliders; regenerating is cheap and the
+    // layout is stable for a given seed
+    float innerRadius = _uniforms.black_hole_size * _uniforms.disk_inner_multiplier;
+    float outerRadius = std::max(_uniforms.disk_radius, innerRadius + 0.1f);
+    _emitters.scatterHotSpots(_hotSpotCount, innerRadius, outerRadius, 0.04f,
+                              _hotSpotSize, _hotSpotBrightness, _uniforms.star_orbit_speed,
+                              (uint32_t)_hotSpotSeed);
+    
+    // Adaptive stepping only shortens steps; allow for |dir| drift in RK4
+    id<MTLBuffer> frame = (__bridge id<MTLBuffer>)_emitterFrames[_emitterFrame];
+    _emitters.build(_uniforms.time, _uniforms.step_size * 1.5f, frame.contents);
+    return (__bridge void*)frame;
+}
+
+void Renderer::waitForFramesInFlight()
+{
+    if (!_frameSemaphore) {
+        return;
+    }
+    // Taking every slot means no submitted frame still reads shared buffers
+    dispatch_semaphore_t semaphore = (__bridge dispatch_semaphore_t)_frameSemaphore;
+    for (int i = 0; i < kMaxFramesInFlight; ++i) {
+        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    }
+    for (int i = 0; i < kMaxFramesInFlight; ++i) {
+        dispatch_semaphore_signal(semaphore);
+    }
+}
+
+bool Renderer::loadStarCatalog(const char* path)
+{
+    id<MTLDevice> device = (__bridge id<MTLDevice>)_pDevice;
+    
+    // Frames in flight may still read the old mapping
+    waitForFramesInFlight();
+    if (_starCatalogBuffer) {
+        id<MTLBuffer> old = (__bridge_transfer id<MTLBuffer>)_starCatalogBuffer;
+        old = nil;
+        _starCatalogBuffer = nullptr;
+    }
+    _starInfo.star_count = 0;
+    if (path[0] == '\0') {
+        _starCatalog.close();
+        std::snprintf(_starCatalogStatus, sizeof(_starCatalogStatus), "Procedural starfield");
+        return false;
+    }
+    
+    std::string error;
+    if (!_starCatalog.open(path, error)) {
+        std::snprintf(_starCatalogStatus, sizeof(_starCatalogStatus), "%s", error.c_str());
+        std::cerr << "Star catalog not loaded: " << error << std::endl;
+        return false;
+    }
+    
+    // The mapping is page-aligned and page-sized, so the GPU reads it in place
+    id<MTLBuffer> buffer = [device newBufferWithBytesNoCopy:_starCatalog.mappedData()
+                                                     length:_starCatalog.mappedBytes()
+                                                    options:MTLResourceStorageModeShared
+                                                deallocator:nil];
+    if (!buffer) {
+        _starCatalog.close();
+        std::snprintf(_starCatalogStatus, sizeof(_starCatalogStatus), "Could not wrap catalog in a GPU buffer");
+        std::cerr << _starCatalogStatus << std::endl;
+        return false;
+    }
+    _starCatalogBuffer = (__bridge_retained void*)buffer;
+    
+    const StarCatalogHeader& header = _starCatalog.header();
+    _starInfo.order = header.order;
+    _starInfo.star_count = header.star_count;
+    std::snprintf(_starCatalogStatus, sizeof(_starCatalogStatus), "%u stars, HEALPix order %u, mag %.1f to %.1f",
+                  header.star_count, header.order, header.mag_min, header.mag_max);
+    std::cout << "Star catalog loaded: " << _starCatalogStatus << std::endl;
+    return true;
+}
+
+bool Renderer::loadVolume(const char* path)
+{
+    id<MTLDevice> device = (__bridge id<MTLDevice>)_pDevice;
+    
+    // Frames in flight may still sample the old atlas
+    waitForFramesInFlight();
+    releaseVolume();
+    if (path[0] == '\0') {
+        std::snprintf(_volumeStatus, sizeof(_volumeStatus), "Procedural disk");
+        return false;
+    }
+    
+    std::string error;
+    size_t length = std::strlen(path);
+    bool bricked = length > 6 && std::strcmp(path + length - 6, ".bhvol") == 0;
+    uint32_t slots = (uint32_t)std::clamp(_volumeSlots, 1, 16384);
+    bool opened;
+    if (bricked) {
+        opened = _volume.openBricked(path, slots, kMaxFramesInFlight, error);
+    } else {
+        uint32_t dims[3] = { (uint32_t)std::max(_volumeRawDims[0], 1), (uint32_t)std::max(_volumeRawDims[1], 1),
+                             (uint32_t)std::max(_volumeRawDims[2], 1) };
+        opened = _volume.openRaw(path, _volumeTemperaturePath, dims, (uint32_t)std::clamp(_volumeBrickSize, 4, 126),
+                                 10000.0f, slots, kMaxFramesInFlight, error);
+    }
+    if (!opened) {
+        std::snprintf(_volumeStatus, sizeof(_volumeStatus), "%s", error.c_str());
+        std::cerr << "Volume not loaded: " << error << std::endl;
+        return false;
+    }
+    
+    // Slots tile a near-cubic atlas
+    const uint32_t* grid = _volume.brickGrid();
+    uint32_t padded = _volume.paddedBrickSize();
+    uint32_t side = (uint32_t)std::ceil(std::cbrt((double)slots));
+    uint32_t layers = (slots + side * side - 1) / (side * side);
+    if (side * padded > 2048 || grid[0] > 2048 || grid[1] > 2048 || grid[2] > 2048) {
+        _volume.close();
+        std::snprintf(_volumeStatus, sizeof(_volumeStatus), "Atlas or brick grid exceeds 2048 texels per axis");
+        std::cerr << _volumeStatus << std::endl;
+        return false;
+    }
+    
+    @autoreleasepool {
+        MTLStorageMode storage = device.hasUnifiedMemory ? MTLStorageModeShared : MTLStorageModeManaged;
+        MTLTextureDescriptor* desc = [[MTLTextureDescriptor alloc] init];
+        desc.textureType = MTLTextureType3D;
+        desc.pixelFormat = MTLPixelFormatRG16Float;
+        desc.usage = MTLTextureUsageShaderRead;
+        desc.storageMode = storage;
+        desc.width = side * padded;
+        desc.height = side * padded;
+        desc.depth = layers * padded;
+        id<MTLTexture> atlas = [device newTextureWithDescriptor:desc];
+        
+        desc.width = grid[0];
+        desc.height = grid[1];
+        desc.depth = grid[2];
+        id<MTLTexture> coarse = [device newTextureWithDescriptor:desc];
+        [coarse replaceRegion:MTLRegionMake3D(0, 0, 0, grid[0], grid[1], grid[2])
+                  mipmapLevel:0
+                        slice:0
+                    withBytes:_volume.coarse().data()
+                  bytesPerRow:grid[0] * 2 * sizeof(uint16_t)
+                bytesPerImage:grid[0] * grid[1] * 2 * sizeof(uint16_t)];
+        _volumeAtlas = (__bridge_retained void*)atlas;
+        _volumeCoarse = (__bridge_retained void*)coarse;
+        
+        // Page table, then feedback (starts cleared: no bricks requested yet)
+        size_t tableBytes = (size_t)_volume.brickCount() * sizeof(uint32_t);
+        _volumeFeedbackOffset = (tableBytes + 255) / 256 * 256;
+        for (int i = 0; i < kMaxFramesInFlight; ++i) {
+            id<MTLBuffer> frame = [device newBufferWithLength:_volumeFeedbackOffset + tableBytes
+                                                      options:MTLResourceStorageModeShared];
+            std::memset(frame.contents, 0, frame.length);
+            _volumeFrames[i] = (__bridge_retained void*)frame;
+        }
+    }
+    
+    const uint32_t* dims = _volume.dims();
+    _volumeInfo.dims = {dims[0], dims[1], dims[2], 1};
+    _volumeInfo.brick_grid = {grid[0], grid[1], grid[2], 0};
+    _volumeInfo.atlas_slots = {side, side, layers, 0};
+    _volumeInfo.brick_size = _volume.brickSize();
+    std::snprintf(_volumeStatus, sizeof(_volumeStatus), "%ux%ux%u voxels, %u bricks of %u, %u cached",
+                  dims[0], dims[1], dims[2], _volume.brickCount(), _volume.brickSize(), slots);
+    std::cout << "Volume loaded: " << _volumeStatus << std::endl;
+    return true;
+}
+
+void Renderer::releaseVolume()
+{
+    // Callers make sure no frame in flight still reads these
+    auto release = [](void*& slot) {
+        if (slot) {
+            id obj = (__bridge_transfer id)slot;
+            obj = nil;
+            slot = nullptr;
+        }
+    };
+    release(_volumeAtlas);
+    release(_volumeCoarse);
+    for (int i = 0; i < kMaxFramesInFlight; ++i) {
+        release(_volumeFrames[i]);
+    }
+    _volume.close();
+    _volumeInfo.dims = {0, 0, 0, 0};
+}
+
+void Renderer::updateVolume(void* encoder)
+{
+    id<MTLComputeCommandEncoder> enc = (__bridge id<MTLComputeCommandEncoder>)encoder;
+    if (!_volumeAtlas) {
+        id<MTLTexture> placeholder = (__bridge id<MTLTexture>)_volumePlaceholder;
+        id<MTLBuffer> empty = (__bridge id<MTLBuffer>)_emptyBuffer;
+        [enc setTexture:placeholder atIndex:2];
+        [enc setTexture:placeholder atIndex:3];
+        [enc setBytes:&_volumeInfo length:sizeof(VolumeInfo) atIndex:9];
+        [enc setBuffer:empty offset:0 atIndex:10];
+        [enc setBuffer:empty offset:0 atIndex:11];
+        return;
+    }
+    
+    // The grid box is centred on the hole, longest axis spanning 2 × extent
+    const uint32_t* dims = _volume.dims();
+    float longest = (float)std::max({dims[0], dims[1], dims[2]});
+    simd_float3 size = simd_make_float3(dims[0], dims[1], dims[2]) * (2.0f * _volumeExtent / longest);
+    _volumeInfo.box_min = simd_make_float4(-0.5f * size, 0.0f);
+    _volumeInfo.inv_box_size = simd_make_float4(1.0f / size, 0.0f);
+    
+    // This ring slot was last used kMaxFramesInFlight frames ago and has
+    // completed (updateEmitters waited for it), so its feedback is final
+    id<MTLBuffer> frame = (__bridge id<MTLBuffer>)_volumeFrames[_emitterFrame];
+    uint8_t* base = (uint8_t*)frame.contents;
+    uint32_t* feedback = (uint32_t*)(base + _volumeFeedbackOffset);
+    size_t tableBytes = (size_t)_volume.brickCount() * sizeof(uint32_t);
+    
+    simd_float3 camera = simd_length(_uniforms.observer_position) > 0.1f
+        ? _uniforms.observer_position
+        : simd_make_float3(0.0f, 0.0f, _uniforms.camera_distance);
+    const uint32_t* grid = _volume.brickGrid();
+    simd_float3 uvw = (camera - _volumeInfo.box_min.xyz) * _volumeInfo.inv_box_size.xyz;
+    float cameraBrick[3] = { uvw.x * grid[0], uvw.y * grid[1], uvw.z * grid[2] };
+    _volume.processFeedback(feedback, cameraBrick);
+    std::memset(feedback, 0, tableBytes);
+    
+    // Bounded uploads per frame keep a cold start from stalling the CPU
+    constexpr uint32_t kMaxUploadsPerFrame = 32;
+    id<MTLTexture> atlas = (__bridge id<MTLTexture>)_volumeAtlas;
+    uint32_t padded = _volume.paddedBrickSize();
+    simd_uint4 slots = _volumeInfo.atlas_slots;
+    _volume.commit(kMaxUploadsPerFrame, [&](uint32_t slot, const uint16_t* voxels) {
+        MTLRegion region = MTLRegionMake3D((slot % slots.x) * padded, ((slot / slots.x) % slots.y) * padded,
+                                           (slot / (slots.x * slots.y)) * padded, padded, padded, padded);
+        [atlas replaceRegion:region
+                 mipmapLevel:0
+                       slice:0
+                   withBytes:voxels
+                 bytesPerRow:padded * 2 * sizeof(uint16_t)
+               bytesPerImage:padded * padded * 2 * sizeof(uint16_t)];
+    });
+    std::memcpy(base, _volume.pageTable().data(), tableBytes);
+    
+    [enc setTexture:atlas atIndex:2];
+    [enc setTexture:(__bridge id<MTLTexture>)_volumeCoarse atIndex:3];
+    [enc setBytes:&_volumeInfo length:sizeof(VolumeInfo) atIndex:9];
+    [enc setBuffer:frame offset:0 atIndex:10];
+    [enc setBuffer:frame offset:_volumeFeedbackOffset atIndex:11];
+}
+
+bool Renderer::ensureParticleResources()
+{
+    id<MTLDevice> device = (__bridge id<MTLDevice>)_pDevice;
+    id<MTLCommandQueue> queue = (__bridge id<MTLCommandQueue>)_pCommandQueue;
+    
+    // First use: the grid copies start cleared
+    if (!_particleGrid) {
+        size_t gridBytes = (size_t)PARTICLE_GRID_COPIES * PARTICLE_GRID_PHI * PARTICLE_GRID_R * PARTICLE_GRID_Z * 2 * sizeof(uint32_t);
+        id<MTLBuffer> counter = [device newBufferWithLength:sizeof(uint32_t) options:MTLResourceStorageModeShared];
+        id<MTLBuffer> accum = [device newBufferWithLength:gridBytes options:MTLResourceStorageModePrivate];
+        MTLTextureDescriptor* desc = [[MTLTextureDescriptor alloc] init];
+        desc.textureType = MTLTextureType3D;
+        desc.pixelFormat = MTLPixelFormatRG16Float;
+        desc.width = PARTICLE_GRID_PHI;
+        desc.height = PARTICLE_GRID_R;
+        desc.depth = PARTICLE_GRID_Z;
+        desc.usage = MTLTextureUsageShaderRead | MTLTextureUsageShaderWrite;
+        desc.storageMode = MTLStorageModePrivate;
+        id<MTLTexture> grid = [device newTextureWithDescriptor:desc];
+        if (!counter || !accum || !grid) {
+            std::cerr << "Failed to allocate particle grid resources" << std::endl;
+            return false;
+        }
+        std::memset(counter.contents, 0, sizeof(uint32_t));
+        id<MTLCommandBuffer> cmd = [queue commandBuffer];
+        id<MTLBlitCommandEncoder> blit = [cmd blitCommandEncoder];
+        [blit fillBuffer:accum range:NSMakeRange(0, accum.length) value:0];
+        [blit endEncoding];
+        [cmd commit];
+        _particleCounter = (__bridge_retained void*)counter;
+        _particleAccum = (__bridge_retained void*)accum;
+        _particleGrid = (__bridge_retained void*)grid;
+        std::cout << "Particle grid allocated (" << PARTICLE_GRID_PHI << "x" << PARTICLE_GRID_R << "x"
+                  << PARTICLE_GRID_Z << " cells)" << std::endl;
+    }
+    
+    // Slots start inactive unless a snapshot supplied them
+    if (!_particleBuffer) {
+        id<MTLBuffer> particles = [device newBufferWithLength:(size_t)PARTICLE_CAPACITY * sizeof(Particle)
+                                                      options:MTLResourceStorageModePrivate];
+        if (!particles) {
+            std::cerr << "Failed to allocate particle buffer" << std::endl;
+            return false;
+        }
+        id<MTLCommandBuffer> cmd = [queue commandBuffer];
+        id<MTLBlitCommandEncoder> blit = [cmd blitCommandEncoder];
+        [blit fillBuffer:particles range:NSMakeRange(0, particles.length) value:0];
+        [blit endEncoding];
+        [cmd commit];
+        _particleBuffer = (__bridge_retained void*)particles;
+        std::cout << "Particle buffer allocated (" << PARTICLE_CAPACITY << " particles)" << std::endl;
+    }
+    return true;
+}
+
+void Renderer::updateParticles(void* commandBuffer)
+{
+    _particleInfo.enabled = 0;
+    if (!_uniforms.particle_lensing || !_particleSpawnPSO || !_particleUpdatePSO ||
+        !_particleDepositPSO || !_particleResolvePSO) {
+        return;
+    }
+    if (!ensureParticleResources()) {
+        _uniforms.particle_lensing = false;
+        return;
+    }
+    
+    // Particles die inside r = 1.05 and beyond twice the disk radius; the
+    // grid spans that range, log-spaced to resolve the inner disk
+    float outerRadius = std::max(2.0f * _uniforms.disk_radius, 2.0f);
+    _particleInfo.inner_radius = 1.0f;
+    _particleInfo.inv_log_span = 1.0f / std::log(outerRadius / _particleInfo.inner_radius);
+    _particleInfo.half_height = std::max(_uniforms.disk_thickness, 0.05f);
+    _particleInfo.enabled = 1;
+    _uniforms.max_particles = std::min<uint32_t>(_uniforms.max_particles, PARTICLE_CAPACITY);
+    
+    id<MTLCommandBuffer> cmd = (__bridge id<MTLCommandBuffer>)commandBuffer;
+    id<MTLBuffer> particles = (__bridge id<MTLBuffer>)_particleBuffer;
+    id<MTLBuffer> counter = (__bridge id<MTLBuffer>)_particleCounter;
+    id<MTLBuffer> accum = (__bridge id<MTLBuffer>)_particleAccum;
+    
+    // Restart: every random draw is keyed by (seed, slot, step), so clearing
+    // the slots and rewinding the step replays the simulation exactly
+    if (_particleRestart) {
+        id<MTLBlitCommandEncoder> blit = [cmd blitCommandEncoder];
+        [blit fillBuffer:particles range:NSMakeRange(0, particles.length) value:0];
+        [blit fillBuffer:counter range:NSMakeRange(0, counter.length) value:0];
+        [blit endEncoding];
+        _uniforms.particle_step = 0;
+        _particleRestart = false;
+    }
+    id<MTLComputePipelineState> spawnPSO = (__bridge id<MTLComputePipelineState>)_particleSpawnPSO;
+    id<MTLComputePipelineState> updatePSO = (__bridge id<MTLComputePipelineState>)_particleUpdatePSO;
+    id<MTLComputePipelineState> depositPSO = (__bridge id<MTLComputePipelineState>)_particleDepositPSO;
+    id<MTLComputePipelineState> resolvePSO = (__bridge id<MTLComputePipelineState>)_particleResolvePSO;
+    
+    // One serial encoder: each dispatch sees the previous one's writes
+    id<MTLComputeCommandEncoder> enc = beginComputePass((PassTimer*)_passTimer, cmd, PassParticles);
+    MTLSize particleGrid = MTLSizeMake(_uniforms.max_particles, 1, 1);
+    MTLSize particleGroup = MTLSizeMake(256, 1, 1);
+    
+    [enc setComputePipelineState:spawnPSO];
+    [enc setBuffer:particles offset:0 atIndex:0];
+    [enc setBuffer:counter offset:0 atIndex:1];
+    [enc setBytes:&_uniforms length:sizeof(Uniforms) atIndex:2];
+    [enc dispatchThreads:particleGrid threadsPerThreadgroup:particleGroup];
+    
+    [enc setComputePipelineState:updatePSO];
+    [enc setBuffer:particles offset:0 atIndex:0];
+    [enc setBuffer:(__bridge id<MTLBuffer>)_emptyBuffer offset:0 atIndex:1];
+    [enc setBuffer:counter offset:0 atIndex:2];
+    [enc setBytes:&_uniforms length:sizeof(Uniforms) atIndex:3];
+    [enc dispatchThreads:particleGrid threadsPerThreadgroup:particleGroup];
+    
+    [enc setComputePipelineState:depositPSO];
+    [enc setBuffer:particles offset:0 atIndex:0];
+    [enc setBuffer:accum offset:0 atIndex:1];
+    [enc setBytes:&_uniforms length:sizeof(Uniforms) atIndex:2];
+    [enc setBytes:&_particleInfo length:sizeof(ParticleGridInfo) atIndex:3];
+    [enc dispatchThreads:particleGrid threadsPerThreadgroup:particleGroup];
+    
+    [enc setComputePipelineState:resolvePSO];
+    [enc setBuffer:accum offset:0 atIndex:0];
+    [enc setBytes:&_particleInfo length:sizeof(ParticleGridInfo) atIndex:1];
+    [enc setTexture:(__bridge id<MTLTexture>)_particleGrid atIndex:0];
+    [enc dispatchThreads:MTLSizeMake(PARTICLE_GRID_PHI, PARTICLE_GRID_R, PARTICLE_GRID_Z)
+        threadsPerThreadgroup:MTLSizeMake(32, 4, 2)];
+    
+    // Disk statistics every N steps; skipped rather than waited for while
+    // every readback buffer is still in flight
+    int statsSlot = -1;
+    if (_particleStatsPSO && _particleStatsInterval > 0 &&
+        _uniforms.particle_step % (uint32_t)_particleStatsInterval == 0) {
+        statsSlot = _particleStats.acquire();
+    }
+    id<MTLBuffer> stats = nil;
+    if (statsSlot >= 0) {
+        stats = (__bridge id<MTLBuffer>)_particleStatsBuffers[statsSlot];
+        std::memset(stats.contents, 0, ParticleStats::kHistogramBytes);
+        id<MTLComputePipelineState> statsPSO = (__bridge id<MTLComputePipelineState>)_particleStatsPSO;
+        [enc setComputePipelineState:statsPSO];
+        [enc setBuffer:particles offset:0 atIndex:0];
+        [enc setBuffer:stats offset:0 atIndex:1];
+        [enc setBytes:&_uniforms length:sizeof(Uniforms) atIndex:2];
+        [enc setBytes:&_particleInfo length:sizeof(ParticleGridInfo) atIndex:3];
+        // Large groups amortize the per-group flush of the threadgroup histogram
+        NSUInteger statsGroup = std::min<NSUInteger>(statsPSO.maxTotalThreadsPerThreadgroup, 1024);
+        [enc dispatchThreads:particleGrid threadsPerThreadgroup:MTLSizeMake(statsGroup, 1, 1)];
+    }
+    [enc endEncoding];
+    
+    _uniforms.particle_step++;
+    
+    if (statsSlot >= 0) {
+        ParticleStats* sink = &_particleStats;
+        uint32_t step = _uniforms.particle_step;
+        float time = (float)step / 60.0f;
+        float innerRadius = _particleInfo.inner_radius;
+        [cmd addCompletedHandler:^(id<MTLCommandBuffer> done) {
+            if (done.status == MTLCommandBufferStatusCompleted) {
+                sink->submit(statsSlot, (const int32_t*)stats.contents, step, time, innerRadius, outerRadius);
+            } else {
+                sink->release(statsSlot);
+            }
+        }];
+    }
+}
 
+bool Renderer::loadParticleSnapshot(const char* path)
+{
+    id<MTLDevice> device = (__bridge id<MTLDevice>)_pDevice;
+    
+    // Frames in flight may still simulate into the old slots
+    waitForFramesInFlight();
+    if (_particleBuffer) {
+        id<MTLBuffer> old = (__bridge_transfer id<MTLBuffer>)_particleBuffer;
+        old = nil;
+        _particleBuffer = nullptr;
+    }
+    _particleSnapshot.close();
+    
+    std::string error;
+    if (!_particleSnapshot.open(path, (size_t)PARTICLE_CAPACITY * sizeof(Particle), sizeof(Particle), error)) {
+        std::snprintf(_particleSnapshotStatus, sizeof(_particleSnapshotStatus), "%s", error.c_str());
+        std::cerr << "Particle snapshot not loaded: " << error << std::endl;
+        return false;
+    }
+    
+    // The mapping covers the full capacity and is page-aligned, so it becomes
+    // the simulation buffer as is; simulated pages are copied on first write
+    id<MTLBuffer> particles = [device newBufferWithBytesNoCopy:_particleSnapshot.particleData()
+                                                        length:_particleSnapshot.particleBytes()
+                                                       options:MTLResourceStorageModeShared
+                                                   deallocator:nil];
+    if (!particles) {
+        _particleSnapshot.close();
+        std::snprintf(_particleSnapshotStatus, sizeof(_particleSnapshotStatus), "Could not wrap snapshot in a GPU buffer");
+        std::cerr << _particleSnapshotStatus << std::endl;
+        return false;
+    }
+    _particleBuffer = (__bridge_retained void*)particles;
+    if (!ensureParticleResources()) {
+        return false;
+    }
+    
+    // Continue the saved run: same slots, seed and step replay the same future
+    const ParticleSnapshotHeader& header = _particleSnapshot.header();
+    std::memcpy(((__bridge id<MTLBuffer>)_particleCounter).contents, &header.spawned, sizeof(uint32_t));
+    _uniforms.max_particles = std::max<uint32_t>(header.slots, 1024);
+    _uniforms.particle_seed = header.seed;
+    _uniforms.particle_step = header.step;
+    _uniforms.particle_lensing = true;
+    _particleRestart = false;
+    std::snprintf(_particleSnapshotStatus, sizeof(_particleSnapshotStatus), "%u slots at step %u (seed %u)",
+                  header.slots, header.step, header.seed);
+    std::cout << "Particle snapshot loaded: " << _particleSnapshotStatus << std::endl;
+    return true;
+}
 
+void Renderer::saveParticleSnapshot(const char* path, void* commandBuffer)
+{
+    if (!_particleBuffer || !_particleCounter) {
+        std::snprintf(_particleSnapshotStatus, sizeof(_particleSnapshotStatus), "No particle simulation to save");
+        return;
+    }
+    if (_snapshotWriter.busy()) {
+        std::snprintf(_particleSnapshotStatus, sizeof(_particleSnapshotStatus), "Previous snapshot still writing");
+        return;
+    }
+    id<MTLDevice> device = (__bridge id<MTLDevice>)_pDevice;
+    id<MTLCommandBuffer> cmd = (__bridge id<MTLCommandBuffer>)commandBuffer;
+    
+    // Copy the slots (and the spawn counter after them) on the GPU ahead of
+    // this frame's simulation step, then write from the copy off the main thread
+    size_t particleBytes = (size_t)_uniforms.max_particles * sizeof(Particle);
+    id<MTLBuffer> staging = [device newBufferWithLength:particleBytes + sizeof(uint32_t)
+                                                options:MTLResourceStorageModeShared];
+    if (!staging) {
+        std::snprintf(_particleSnapshotStatus, sizeof(_particleSnapshotStatus), "Could not allocate snapshot staging");
+        return;
+    }
+    id<MTLBlitCommandEncoder> blit = [cmd blitCommandEncoder];
+    [blit copyFromBuffer:(__bridge id<MTLBuffer>)_particleBuffer sourceOffset:0
+                toBuffer:staging destinationOffset:0 size:particleBytes];
+    [blit copyFromBuffer:(__bridge id<MTLBuffer>)_particleCounter sourceOffset:0
+                toBuffer:staging destinationOffset:particleBytes size:sizeof(uint32_t)];
+    [blit endEncoding];
+    
+    ParticleSnapshotHeader header = {};
+    header.particle_stride = sizeof(Particle);
+    header.slots = _uniforms.max_particles;
+    header.seed = _uniforms.particle_seed;
+    header.step = _uniforms.particle_step;
+    header.disk_radius = _uniforms.disk_radius;
+    header.disk_thickness = _uniforms.disk_thickness;
+    header.gravity = _uniforms.gravity;
+    
+    std::string target = path;
+    ParticleSnapshotWriter* writer = &_snapshotWriter;
+    [cmd addCompletedHandler:^(id<MTLCommandBuffer> done) {
+        if (done.status != MTLCommandBufferStatusCompleted) {
+            std::cerr << "Particle snapshot copy failed" << std::endl;
+            return;
+        }
+        ParticleSnapshotHeader filled = header;
+        std::memcpy(&filled.spawned, (const uint8_t*)staging.contents + particleBytes, sizeof(uint32_t));
+        // The block keeps the staging buffer alive until the write finishes
+        id<MTLBuffer> keep = staging;
+        if (!writer->start(target, filled, keep.contents, nullptr, [keep]() {})) {
+            std::cerr << "Particle snapshot dropped: writer busy" << std::endl;
+        }
+    }];
+    std::snprintf(_particleSnapshotStatus, sizeof(_particleSnapshotStatus), "Saving step %u...", header.step);
+}
 
+bool Renderer::runLightCurve(const LightCurveOptions& options)
+{
+    int method = std::clamp(_uniforms.integration_method, 0, GEODESIC_INTEGRATOR_COUNT - 1);
+    if (!_lightCurvePSOs[method]) {
+        std::cerr << "Light curve: lightCurveShader pipeline unavailable for integrator " << method << std::endl;
+        return false;
+    }
+    std::string error;
+    LightCurveWriter writer;
+    if (!writer.open(options, error)) {
+        std::cerr << "Light curve: " << error << std::endl;
+        return false;
+    }
+    
+    bool ok = true;
+    Uniforms saved = _uniforms;
+    @autoreleasepool {
+        id<MTLDevice> device = (__bridge id<MTLDevice>)_pDevice;
+        id<MTLCommandQueue> queue = (__bridge id<MTLCommandQueue>)_pCommandQueue;
+        id<MTLComputePipelineState> pso = (__bridge id<MTLComputePipelineState>)_lightCurvePSOs[method];
+        
+        // Tile lists and sums for the largest refinement, allocated once
+        LightCurvePlan plan(options);
+        size_t coarseCount = plan.coarse().size();
+        size_t refinedCapacity = std::max<size_t>(plan.maxRefined(), 1);
+        id<MTLBuffer> coarseTiles = [device newBufferWithBytes:plan.coarse().data()
+                                                        length:coarseCount * sizeof(LightCurveTile)
+                                                       options:MTLResourceStorageModeShared];
+        id<MTLBuffer> coarseFlux = [device newBufferWithLength:coarseCount * sizeof(float) * 4
+                                                       options:MTLResourceStorageModeShared];
+        id<MTLBuffer> refinedTiles = [device newBufferWithLength:refinedCapacity * sizeof(LightCurveTile)
+                                                         options:MTLResourceStorageModeShared];
+        id<MTLBuffer> refinedFlux = [device newBufferWithLength:refinedCapacity * sizeof(float) * 4
+                                                        options:MTLResourceStorageModeShared];
+        if (!coarseTiles || !coarseFlux || !refinedTiles || !refinedFlux) {
+            std::cerr << "Light curve: could not allocate tile buffers" << std::endl;
+            return false;
+        }
+        
+        // Source only: no streamed volume, procedural disk instead of particles
+        id<MTLTexture> colorMap = (__bridge id<MTLTexture>)_diskColorMap;
+        id<MTLTexture> placeholder = (__bridge id<MTLTexture>)_volumePlaceholder;
+        id<MTLBuffer> empty = (__bridge id<MTLBuffer>)_emptyBuffer;
+        id<MTLBuffer> starBuffer = (__bridge id<MTLBuffer>)(_starCatalogBuffer ? _starCatalogBuffer : _emptyBuffer);
+        NSUInteger cellsOffset = _starCatalogBuffer ? (NSUInteger)_starCatalog.header().cells_offset : 0;
+        NSUInteger starsOffset = _starCatalogBuffer ? (NSUInteger)_starCatalog.header().stars_offset : 0;
+        VolumeInfo noVolume = {};
+        ParticleGridInfo noParticles = _particleInfo;
+        noParticles.enabled = 0;
+        float skyWeight = options.sky ? 1.0f : 0.0f;
+        
+        auto encode = [&](id<MTLCommandBuffer> cmd, id<MTLBuffer> emitterFrame, id<MTLBuffer> tiles,
+                          id<MTLBuffer> flux, size_t count) {
+            id<MTLComputeCommandEncoder> enc = [cmd computeCommandEncoder];
+            [enc setComputePipelineState:pso];
+            [enc setTexture:colorMap atIndex:1];
+            [enc setBytes:&_uniforms length:sizeof(Uniforms) atIndex:0];
+            [enc setBuffer:(__bridge id<MTLBuffer>)_spectralBasis offset:0 atIndex:1];
+            [enc setBuffer:emitterFrame offset:EmitterSystem::kGridOffset atIndex:2];
+            [enc setBuffer:emitterFrame offset:EmitterSystem::kCellsOffset atIndex:3];
+            [enc setBuffer:emitterFrame offset:EmitterSystem::kRefsOffset atIndex:4];
+            [enc setBuffer:emitterFrame offset:EmitterSystem::kEmittersOffset atIndex:5];
+            [enc setBytes:&_starInfo length:sizeof(StarCatalogInfo) atIndex:6];
+            [enc setBuffer:starBuffer offset:cellsOffset atIndex:7];
+            [enc setBuffer:starBuffer offset:starsOffset atIndex:8];
+            [enc setTexture:placeholder atIndex:2];
+            [enc setTexture:placeholder atIndex:3];
+            [enc setBytes:&noVolume length:sizeof(VolumeInfo) atIndex:9];
+            [enc setBuffer:empty offset:0 atIndex:10];
+            [enc setBuffer:empty offset:0 atIndex:11];
+            [enc setTexture:placeholder atIndex:4];
+            [enc setBytes:&noParticles length:sizeof(ParticleGridInfo) atIndex:12];
+            [enc setBuffer:tiles offset:0 atIndex:13];
+            [enc setBuffer:flux offset:0 atIndex:14];
+            [enc setBytes:&skyWeight length:sizeof(float) atIndex:15];
+            [enc dispatchThreadgroups:MTLSizeMake(count, 1, 1)
+                threadsPerThreadgroup:MTLSizeMake(LIGHT_CURVE_TILE, LIGHT_CURVE_TILE, 1)];
+            [enc endEncoding];
+        };
+        auto finish = [](id<MTLCommandBuffer> cmd) {
+            [cmd commit];
+            [cmd waitUntilCompleted];
+            return cmd.status == MTLCommandBufferStatusCompleted;
+        };
+        
+        // Inclination is measured from the disk axis (+y); the camera basis
+        // needs the observer off the axis itself
+        float distance = simd_length(_uniforms.observer_position) > 0.1f
+            ? simd_length(_uniforms.observer_position) : _uniforms.camera_distance;
+        _uniforms.resolution = {(float)options.width, (float)options.height};
+        
+        std::cout << "Light curve: " << options.epochs << " epochs, " << plan.tilesX() << " x " << plan.tilesY()
+                  << " tiles -> " << options.output << std::endl;
+        auto start = std::chrono::steady_clock::now();
+        int reportEvery = std::max(options.epochs / 20, 1);
+        for (int epoch = 0; epoch < options.epochs && ok; ++epoch) {
+            @autoreleasepool {
+                TRACE_SCOPE_ARG("lightcurve", "epoch", epoch);
+                float t = options.epochs > 1 ? (float)epoch / (float)(options.epochs - 1) : 0.0f;
+                float value = options.from + (options.to - options.from) * t;
+                float time = options.sweep == LightCurveOptions::Time ? value : options.time;
+                float inclination = options.sweep == LightCurveOptions::Inclination ? value : options.inclination;
+                float angle = std::clamp(inclination, 0.5f, 179.5f) * (float)M_PI / 180.0f;
+                _uniforms.time = time;
+                _uniforms.observer_position = simd_make_float3(0.0f, distance * std::cos(angle), distance * std::sin(angle));
+                
+                // Coarse pass: one sample per pixel, one sum per tile
+                id<MTLCommandBuffer> cmd = [queue commandBuffer];
+                id<MTLBuffer> emitterFrame = (__bridge id<MTLBuffer>)updateEmitters((__bridge void*)cmd);
+                encode(cmd, emitterFrame, coarseTiles, coarseFlux, coarseCount);
+                if (!finish(cmd)) {
+                    ok = false;
+                    break;
+                }
+                
+                // Refined pass over the bright tiles; the emitter slot is idle
+                // again and still holds this epoch
+                const std::vector<LightCurveTile>& refined = plan.refine((const float*)coarseFlux.contents);
+                if (!refined.empty()) {
+                    TRACE_SCOPE_ARG("lightcurve", "refine tiles", (int64_t)refined.size());
+                    std::memcpy(refinedTiles.contents, refined.data(), refined.size() * sizeof(LightCurveTile));
+                    id<MTLCommandBuffer> refineCmd = [queue commandBuffer];
+                    encode(refineCmd, emitterFrame, refinedTiles, refinedFlux, refined.size());
+                    if (!finish(refineCmd)) {
+                        ok = false;
+                        break;
+                    }
+                }
+                
+                double flux[4];
+                plan.combine((const float*)coarseFlux.contents, (const float*)refinedFlux.contents, flux);
+                writer.write(epoch, time, inclination, flux, plan.samples(), plan.refinedTiles());
+                
+                if ((epoch + 1) % reportEvery == 0 || epoch + 1 == options.epochs) {
+                    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    std::printf("  %d/%d epochs, %.1f epochs/s, %d tiles refined\n", epoch + 1, options.epochs,
+                                (epoch + 1) / std::max(seconds, 1e-6), plan.refinedTiles());
+                    std::fflush(stdout);
+                }
+            }
+        }
+    }
+    _uniforms = saved;
+    writer.close();
+    if (!ok) {
+        std::cerr << "Light curve: GPU command buffer failed" << std::endl;
+    }
+    return ok;
+}
 
+bool Renderer::runSoak(const SoakOptions& options)
+{
+    SoakReport report(options);
+    std::string error;
+    if (!report.open(error)) {
+        std::cerr << "Soak: " << error << std::endl;
+        return false;
+    }
+    id<MTLDevice> device = (__bridge id<MTLDevice>)_pDevice;
+    SoakScript script(options);
+    
+    // Home configuration: where the run starts, returns to and ends
+    int homeWidth = 0, homeHeight = 0;
+    glfwGetWindowSize(_pWindow, &homeWidth, &homeHeight);
+    int homePreset = _currentVisualPreset;
+    applyVisualPreset(homePreset);
+    
+    using Clock = std::chrono::steady_clock;
+    auto milliseconds = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    
+    // Hitch baseline: median frame interval once the first frames have settled
+    std::vector<double> idle;
+    Clock::time_point previous = Clock::now();
+    for (int i = 0; i < 120 && !glfwWindowShouldClose(_pWindow); ++i) {
+        glfwPollEvents();
+        draw();
+        Clock::time_point now = Clock::now();
+        if (i >= 30) {
+            idle.push_back(milliseconds(now - previous));
+        }
+        previous = now;
+    }
+    std::sort(idle.begin(), idle.end());
+    report.setIdleFrameMs(idle.empty() ? 0.0 : idle[idle.size() / 2]);
+    
+    std::cout << "Soak: " << script.size() << " events, " << options.framesPerEvent << " frames each, idle frame "
+              << report.idleFrameMs() << " ms -> " << options.output << std::endl;
+    size_t reportEvery = std::max<size_t>(script.size() / 20, 1);
+    size_t done = 0;
+    for (; done < script.size() && !glfwWindowShouldClose(_pWindow); ++done) {
+        TRACE_SCOPE_ARG("soak", "event", (int64_t)done);
+        SoakSample sample;
+        sample.step = script[done];
+        double rebuildMs = _ppRebuildMs;
+        uint64_t allocations = _ppAllocations;
+        uint64_t allocatedBytes = _ppAllocatedBytes;
+        
+        previous = Clock::now();
+        switch (sample.step.kind) {
+            case SoakStep::Home:
+                glfwSetWindowSize(_pWindow, homeWidth, homeHeight);
+                applyVisualPreset(homePreset);
+                break;
+            case SoakStep::Resize:
+                glfwSetWindowSize(_pWindow, sample.step.width, sample.step.height);
+                break;
+            case SoakStep::VisualPreset:
+                applyVisualPreset(sample.step.value);
+                break;
+            case SoakStep::BloomIterations:
+                // As the Bloom Iterations slider does
+                _bloomIterations = sample.step.value;
+                _postProcessDirty = true;
+                break;
+            default:
+                break;
+        }
+        
+        // A resize reaches the drawable one frame late, so the rebuild
+        // lands in the second frame
+        for (int frame = 0; frame < options.framesPerEvent; ++frame) {
+            glfwPollEvents();
+            draw();
+            Clock::time_point now = Clock::now();
+            sample.frameMs = std::max(sample.frameMs, milliseconds(now - previous));
+            previous = now;
+        }
+        
+        // Frames in flight still hold the resources this event replaced
+        waitForFramesInFlight();
+        glfwGetFramebufferSize(_pWindow, &sample.framebufferWidth, &sample.framebufferHeight);
+        sample.rebuildMs = _ppRebuildMs - rebuildMs;
+        sample.allocations = (uint32_t)(_ppAllocations - allocations);
+        sample.allocatedBytes = _ppAllocatedBytes - allocatedBytes;
+        sample.residentBytes = processResidentBytes();
+        sample.gpuBytes = device.currentAllocatedSize;
+        report.add((int)done, sample);
+        
+        if ((done + 1) % reportEvery == 0 || done + 1 == script.size()) {
+            std::printf("  %zu/%zu events, resident %.1f MB, GPU %.1f MB\n", done + 1, script.size(),
+                        (double)sample.residentBytes / (1024.0 * 1024.0), (double)sample.gpuBytes / (1024.0 * 1024.0));
+            std::fflush(stdout);
+        }
+    }
+    
+    glfwSetWindowSize(_pWindow, homeWidth, homeHeight);
+    applyVisualPreset(homePreset);
+    bool ok = report.finish(processPeakResidentBytes());
+    if (done < script.size()) {
+        std::cerr << "Soak: window closed after " << done << " of " << script.size() << " events" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
@@ -25,7 +25,7 @@
  *    - camera_distance: Orbital radius of camera/observer
  * 
  * 3. Simulation Settings:
- *    - integration_method: 0=Verlet, 1=RK4 (Runge-Kutta 4th order)
+ *    - integration_method: 0=Verlet, 1=RK4, 2=Yoshida4, 3=Yoshida6 (Geodesic.h)
  *    - orbit_type: Reserved for different orbital configurations
  * 
  * 4. Visual Effects Toggles:
@@ -80,13 +80,15 @@ typedef struct
     float disk_noise_speed;         // Turbulence rotation speed
     int   disk_noise_octaves;       // Number of noise octaves
     float disk_emission_strength;   // Brightness multiplier for disk emission
-    float disk_alpha_falloff;       // Opacity falloff factor per step
+    float disk_alpha_falloff;       // Opacity falloff factor per 0.1 of path (step-independent)
     float disk_inner_multiplier;    // Inner radius multiplier relative to Rs
     float disk_inner_softness;      // Width of inner falloff region
     float disk_color_mix;           // Blend factor between warm tint and blackbody color
+    float disk_noise_lod_bias;      // Pixel footprint multiplier for noise octave culling (<=0 disables)
+    bool  spectral_mode;            // Shade disk emission through the spectral basis (see SpectralBasis)
     
     // Scientific parameters
-    int integration_method;         // Geodesic integration: 0=Verlet, 1=RK4
+    int integration_method;         // Geodesic integration: 0=Verlet, 1=RK4, 2=Yoshida4, 3=Yoshida6
     int orbit_type;                 // Orbital configuration (reserved for future use)
     bool disk_enabled;              // Toggle accretion disk rendering
     bool doppler_enabled;           // Toggle Doppler shift effects
@@ -114,6 +116,264 @@ typedef struct
     int max_iterations;             // Maximum ray marching steps (64-1024)
     float step_size;                // Integration step size (0.05-0.2)
     bool adaptive_stepping;         // Use adaptive step size based on curvature
+    int render_tier;                // RENDER_TIER_PREVIEW, _STANDARD or _REFERENCE
+    int critical_samples;           // Rays per axis near the critical curve (1 = off)
+    float critical_band;            // Half-width of that band as a fraction of b_c
+    
+    // Particle system (ParticleSystem.metal, ParticleTrails.metal)
+    bool particle_lensing;          // Simulate particles and trace them through the lensed grid
+    bool particle_spawning;         // Refill inactive slots each frame
+    bool particle_trails;           // Record motion trails
+    uint32_t max_particles;         // Live particle slots (<= PARTICLE_CAPACITY)
+    float particle_emission_rate;   // Spawns per slot per second
+    float particle_lifetime;        // Mean lifetime in seconds
+    float particle_size;            // Base particle radius
+    float particle_turbulence;      // Curl-noise turbulence strength
+    float particle_magnetism;       // Dipole field strength
+    float particle_collision_damping; // Velocity damping per second
+    float spawning_radius_min;      // Inner radius of the spawn annulus
+    float spawning_radius_max;      // Outer radius of the spawn annulus
+    float trail_length;             // Trail lifetime in seconds
+    uint32_t particle_seed;         // Philox key for spawn, turbulence and collisions (Philox.h)
+    uint32_t particle_step;         // Simulation steps since the last restart (Philox counter)
 } Uniforms;
 
+/**
+ * Render Tiers
+ * 
+ * Preview bends each ray once by the analytic weak-field deflection and
+ * shades only where it crosses the disk (no integration). Standard is the
+ * RK4 march. Reference splits every march step into RK4 substeps no longer
+ * than a fixed fraction of the radius; it is the baseline for the tier
+ * error map.
+ */
+#define RENDER_TIER_PREVIEW 0
+#define RENDER_TIER_STANDARD 1
+#define RENDER_TIER_REFERENCE 2
+
+/**
+ * Spectral Basis
+ * 
+ * Low-dimensional representation of disk emission for spectral mode. The
+ * natural log of spectral radiance is a degree-7 polynomial in normalized
+ * log-wavelength u = (ln λ - center) * inv_half_width, tabulated for
+ * SPECTRAL_TEMPERATURES blackbody temperatures (log-spaced).
+ * 
+ * A frequency shift g (Doppler × gravitational) maps the observed spectrum
+ * to I_obs(λ) = g⁵ I_emit(gλ), i.e. a translation by ln g in u (exact in
+ * this basis) plus a constant factor. The shifted spectrum is evaluated at
+ * SPECTRAL_NODES wavelengths and projected to linear sRGB with precomputed
+ * colour-matching weights. The shader keeps the resulting colour at unit
+ * luminance and applies the bolometric g⁴ through its beaming term.
+ * 
+ * Built on the CPU by buildSpectralBasis() (Spectral.hpp); the layout is
+ * mirrored in BlackHole.metal.
+ */
+#define SPECTRAL_COEFFS 8
+#define SPECTRAL_NODES 16
+#define SPECTRAL_TEMPERATURES 64
+
+typedef struct
+{
+    vector_float4 coefficients[SPECTRAL_TEMPERATURES][2];   // c0..c3, c4..c7 per temperature
+    vector_float4 nodes[SPECTRAL_NODES / 4];                // Node positions in u
+    vector_float4 weights[3][SPECTRAL_NODES / 4];           // R, G, B projection weights per node
+    float log_temp_min;             // ln of the first tabulated temperature
+    float inv_log_temp_step;        // 1 / ln-temperature spacing of the table
+    float inv_half_width;           // Converts ln λ offsets to u
+    float max_log_shift;            // |ln g| covered by the fit domain
+} SpectralBasis;
+
+/**
+ * Orbiting Emitters
+ * 
+ * Compact light sources (hot spots, stars, flares) tested against every
+ * integration segment of the curved ray, so they are lensed and show their
+ * secondary and tertiary images. Positions are advanced on the CPU each
+ * frame and binned into a uniform grid over their bounding box; the shader
+ * looks up the single cell containing each segment midpoint. Spheres are
+ * inserted with a margin of half the maximum segment length, which makes
+ * that one lookup conservative.
+ * 
+ * Per-frame buffer layout (EmitterSystem::build in Emitters.hpp):
+ *   EmitterGrid | uint2 cells[DIM³] (first ref, count) | uint refs[] | Emitter[]
+ * Mirrored in BlackHole.metal.
+ */
+#define EMITTER_GRID_DIM 16
+#define MAX_EMITTERS 1024
+#define MAX_EMITTER_REFS 65536
+
+typedef struct
+{
+    vector_float4 position_radius;  // xyz centre, w radius
+    vector_float4 velocity;         // xyz orbital velocity in units of c, w unused
+    vector_float4 emission;         // rgb colour × brightness, w blackbody temperature (K, spectral mode)
+} Emitter;
+
+typedef struct
+{
+    vector_float4 origin;           // xyz minimum corner of the grid
+    vector_float4 inv_cell_size;    // xyz cells per unit length
+    uint32_t emitter_count;         // 0 disables emitter tests
+    uint32_t ref_count;             // Entries used in the reference list
+    float max_blur;                 // Footprint blur cap as a multiple of radius (grid margin assumes it)
+    float pad;
+} EmitterGrid;
+
+/**
+ * Star Catalog
+ * 
+ * Background stars from a catalog file (StarCatalog.hpp), bucketed by
+ * HEALPix pixel in the NESTED scheme at order k (nside = 2^k, 12·4^k
+ * pixels). Each pixel's stars are contiguous and sorted brightest first;
+ * cells[p]..cells[p + 1] is the range of pixel p. Escaped rays look up the
+ * few pixels under their footprint and splat each star through the local
+ * lensing Jacobian, scaled by the magnification. Mirrored in
+ * BlackHole.metal.
+ */
+typedef struct
+{
+    vector_float4 direction_flux;   // xyz unit direction (y = celestial north), w flux relative to magnitude 0
+    vector_float4 color;            // rgb linear colour at unit luminance, w unused
+} CatalogStar;
+
+typedef struct
+{
+    uint32_t order;                 // HEALPix order k
+    uint32_t star_count;            // 0 selects the procedural starfield
+    uint32_t max_per_cell;          // Brightest stars visited per pixel
+    float splat_sigma;              // Gaussian splat width in screen pixels
+    float brightness;               // Flux multiplier
+    float max_magnification;        // Caps the point-source magnification near caustics
+    float pad[2];
+} StarCatalogInfo;
+
+/**
+ * Volumetric Data
+ * 
+ * External density/temperature grids streamed through VolumeCache.hpp.
+ * Resident bricks live in a 3D atlas of (B+2)³ slots (one-voxel apron so
+ * trilinear filtering never crosses into a neighbouring slot); a page table
+ * maps each brick to its slot. Bricks that are not resident fall back to
+ * the coarse texture (one voxel per brick), and the shader records every
+ * brick it touches in a feedback buffer (1 = hit, 2 = miss) that drives
+ * the next loads. Mirrored in BlackHole.metal.
+ */
+#define VOLUME_NOT_RESIDENT 0xFFFFFFFFu
+#define VOLUME_EMPTY_BRICK 0xFFFFFFFEu
+
+typedef struct
+{
+    vector_float4 box_min;          // xyz world-space minimum corner of the grid
+    vector_float4 inv_box_size;     // xyz 1 / world-space extent
+    vector_uint4 dims;              // xyz voxels per axis, w 1 if a volume is bound
+    vector_uint4 brick_grid;        // xyz bricks per axis
+    vector_uint4 atlas_slots;       // xyz slots per atlas axis
+    uint32_t brick_size;            // Voxels per brick edge, apron excluded
+    float density_scale;            // Absorption per unit length per stored density unit
+    float emission_scale;           // Source function brightness
+    float temperature_scale;        // Kelvin per stored temperature unit
+} VolumeInfo;
+
+/**
+ * Particles
+ * 
+ * State of one simulated disk particle (ParticleSystem.metal). Particles
+ * are not drawn directly: depositParticles scatters their emission into a
+ * cylindrical grid around the hole (log-spaced radius × azimuth × height)
+ * which the geodesic tracer samples like the disk, so particles are lensed
+ * and tracing cost does not depend on the particle count.
+ * 
+ * Deposits are cloud-in-cell weights accumulated as 24.8 fixed point with
+ * integer atomics into PARTICLE_GRID_COPIES private copies of the grid;
+ * each threadgroup adds into one copy, which divides atomic contention in
+ * the crowded inner bins, and integer sums do not depend on thread order.
+ * resolveParticleGrid sums the copies into an RG16F texture (emissivity,
+ * emission-weighted temperature in kK) and clears them. The grid texture
+ * is mirrored in BlackHole.metal through ParticleGridInfo.
+ */
+#define PARTICLE_CAPACITY 262144
+#define PARTICLE_GRID_PHI 256
+#define PARTICLE_GRID_R 64
+#define PARTICLE_GRID_Z 16
+#define PARTICLE_GRID_COPIES 4
+#define PARTICLE_GRID_FIXED_SCALE 256.0f
+
+typedef struct
+{
+    vector_float3 position;
+    vector_float3 velocity;
+    vector_float3 acceleration;
+    vector_float3 color;            // Display colour from temperature
+    vector_float3 magnetic_field;
+    float mass;
+    float age;                      // Seconds since spawn
+    float lifetime;                 // Seconds until the slot is freed
+    float temperature;              // Kelvin
+    float luminosity;               // Emission weight deposited into the grid
+    float size;
+    float angular_momentum;         // Specific, (v × r)·ŷ
+    float radial_velocity;          // Cylindrical, positive outwards
+    uint32_t material_type;         // 0 gas, 1 dust, 2 plasma, 3 debris
+    bool is_active;
+} Particle;
+
+typedef struct
+{
+    float inner_radius;             // Radius of the first radial bin edge
+    float inv_log_span;             // 1 / ln(outer / inner)
+    float half_height;              // Grid covers |y| <= half_height
+    float emission_scale;           // Emissivity multiplier when tracing
+    float absorption;               // Extinction per unit emissivity and length
+    uint32_t enabled;               // 0 keeps the procedural disk
+    float pad[2];
+} ParticleGridInfo;
+
+/**
+ * Particle Statistics
+ * 
+ * reduceParticleStats histograms live particles into log-spaced radius ×
+ * azimuth bins over the grid's radial span (ParticleGridInfo). Each
+ * threadgroup reduces into threadgroup memory and adds its non-empty bins
+ * to the output once, so device atomics scale with bins touched rather
+ * than particles. Sums are fixed point (PARTICLE_STATS_SCALE, counts are
+ * plain integers) and therefore exact and order-independent. Values are
+ * clamped to ±PARTICLE_STATS_LIMIT first, which bounds a bin at
+ * PARTICLE_CAPACITY × 127 × 64 = 2 130 706 432 < INT32_MAX even with every
+ * particle in it. The channels stay far inside the limit: mass ≤ 5,
+ * temperature tens of kK, angular momentum and radial velocity O(1-10).
+ * 
+ * Output layout: int32 [channel][r * PARTICLE_STATS_PHI + phi].
+ */
+#define PARTICLE_STATS_R 32
+#define PARTICLE_STATS_PHI 16
+#define PARTICLE_STATS_BINS (PARTICLE_STATS_R * PARTICLE_STATS_PHI)
+#define PARTICLE_STATS_SCALE 64.0f
+#define PARTICLE_STATS_LIMIT 127.0f         // Per-particle clamp; see below
+
+#define PARTICLE_STATS_COUNT 0              // Particles
+#define PARTICLE_STATS_MASS 1               // Σ mass
+#define PARTICLE_STATS_TEMPERATURE 2        // Σ temperature in kK
+#define PARTICLE_STATS_ANGULAR_MOMENTUM 3   // Σ specific angular momentum (v × r)·ŷ, positive prograde
+#define PARTICLE_STATS_RADIAL_VELOCITY 4    // Σ cylindrical radial velocity
+#define PARTICLE_STATS_CHANNELS 5
+
+/**
+ * Light Curve Tiles
+ * 
+ * lightCurveShader traces one LIGHT_CURVE_TILE² block of samples per
+ * threadgroup and reduces it to a single flux sum (see LightCurve.hpp).
+ * A tile starts at origin in base-image pixels with samples step pixels
+ * apart: 1 in the coarse pass, 1/2^level where a tile is refined. Mirrored
+ * in BlackHole.metal.
+ */
+#define LIGHT_CURVE_TILE 8
+
+typedef struct
+{
+    vector_float2 origin;           // Corner of the first sample, in base-image pixels
+    float step;                     // Pixels between samples
+    uint32_t tile;                  // Coarse tile the sum belongs to
+} LightCurveTile;
+
 #endif
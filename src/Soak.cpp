@@ -0,0 +1,295 @@
+/**
+ * Soak.cpp
+ *
+ * Option parsing, event script, CSV log and verdict for the soak test.
+ */
+
+#include "Soak.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+
+bool parseDouble(const char* text, double& value)
+{
+    char* end = nullptr;
+    value = std::strtod(text, &end);
+    return end != text && *end == '\0';
+}
+
+bool parseInt(const char* text, int& value)
+{
+    char* end = nullptr;
+    long parsed = std::strtol(text, &end, 10);
+    value = (int)parsed;
+    return end != text && *end == '\0';
+}
+
+double percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = std::min(values.size() - 1, (size_t)(p * (double)(values.size() - 1) + 0.5));
+    return values[index];
+}
+
+const double kMB = 1024.0 * 1024.0;
+
+} // namespace
+
+const char* soakUsage()
+{
+    return "Usage: BlackHole --soak [options]\n"
+           "  --events N                 Scripted events (default 2000)\n"
+           "  --frames N                 Frames drawn after each event (default 3)\n"
+           "  --home-every N             Return to the starting configuration every N events (default 50)\n"
+           "  --warmup N                 Events before the leak fit starts (default 200)\n"
+           "  --min-size WxH             Smallest window size in points (default 320x180)\n"
+           "  --max-size WxH             Largest window size in points (default 1920x1080)\n"
+           "  --resident-slack MB        Allowed resident growth over the run (default 64)\n"
+           "  --gpu-slack MB             Allowed GPU allocation growth over the run (default 16)\n"
+           "  --hitch-budget MS          Fail when any hitch exceeds MS (default 0 = report only)\n"
+           "  --seed N                   Script seed (default 1)\n"
+           "  --out PATH                 Per-event CSV (default soak.csv)\n";
+}
+
+bool parseSoakArgs(int argc, char** argv, SoakOptions& options, std::string& error)
+{
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto need = [&]() {
+            if (!value) {
+                error = arg + " needs a value";
+                return false;
+            }
+            ++i;
+            return true;
+        };
+        bool ok = true;
+        int seed = 0;
+        if (arg == "--events") {
+            ok = need() && parseInt(value, options.events) && options.events > 0;
+        } else if (arg == "--frames") {
+            ok = need() && parseInt(value, options.framesPerEvent) && options.framesPerEvent >= 2;
+        } else if (arg == "--home-every") {
+            ok = need() && parseInt(value, options.homeEvery) && options.homeEvery >= 2;
+        } else if (arg == "--warmup") {
+            ok = need() && parseInt(value, options.warmupEvents) && options.warmupEvents >= 0;
+        } else if (arg == "--min-size") {
+            ok = need() && std::sscanf(value, "%dx%d", &options.minWidth, &options.minHeight) == 2 &&
+                 options.minWidth >= 16 && options.minHeight >= 16;
+        } else if (arg == "--max-size") {
+            ok = need() && std::sscanf(value, "%dx%d", &options.maxWidth, &options.maxHeight) == 2;
+        } else if (arg == "--resident-slack") {
+            ok = need() && parseDouble(value, options.residentSlackMB) && options.residentSlackMB >= 0.0;
+        } else if (arg == "--gpu-slack") {
+            ok = need() && parseDouble(value, options.gpuSlackMB) && options.gpuSlackMB >= 0.0;
+        } else if (arg == "--hitch-budget") {
+            ok = need() && parseDouble(value, options.hitchBudgetMs) && options.hitchBudgetMs >= 0.0;
+        } else if (arg == "--seed") {
+            ok = need() && parseInt(value, seed);
+            options.seed = (uint32_t)seed;
+        } else if (arg == "--out") {
+            ok = need();
+            if (ok) {
+                options.output = value;
+            }
+        } else {
+            error = "unknown option " + arg;
+            return false;
+        }
+        if (!ok) {
+            error = "bad value for " + arg;
+            return false;
+        }
+    }
+    if (options.maxWidth < options.minWidth || options.maxHeight < options.minHeight) {
+        error = "--max-size is smaller than --min-size";
+        return false;
+    }
+    return true;
+}
+
+const char* soakStepName(SoakStep::Kind kind)
+{
+    switch (kind) {
+        case SoakStep::Idle: return "idle";
+        case SoakStep::Home: return "home";
+        case SoakStep::Resize: return "resize";
+        case SoakStep::VisualPreset: return "visual_preset";
+        case SoakStep::BloomIterations: return "bloom_iterations";
+        default: return "?";
+    }
+}
+
+SoakScript::SoakScript(const SoakOptions& options)
+{
+    std::mt19937 rng(options.seed);
+    std::uniform_int_distribution<int> width(options.minWidth, options.maxWidth);
+    std::uniform_int_distribution<int> height(options.minHeight, options.maxHeight);
+    std::uniform_int_distribution<int> preset(0, kVisualPresets - 1);
+    std::uniform_int_distribution<int> levels(1, 8);
+    std::uniform_int_distribution<int> pick(0, 9);
+
+    _steps.resize(options.events);
+    for (int i = 0; i < options.events; ++i) {
+        SoakStep& step = _steps[i];
+        if (i % options.homeEvery == 0 || i == options.events - 1) {
+            step.kind = SoakStep::Home;
+            continue;
+        }
+        // One event in ten leaves everything alone, as a control
+        int p = pick(rng);
+        if (p == 0) {
+            step.kind = SoakStep::Idle;
+        } else if (p <= 3) {
+            step.kind = SoakStep::Resize;
+            step.width = width(rng);
+            step.height = height(rng);
+        } else if (p <= 6) {
+            step.kind = SoakStep::VisualPreset;
+            step.value = preset(rng);
+        } else {
+            step.kind = SoakStep::BloomIterations;
+            step.value = levels(rng);
+        }
+    }
+}
+
+SoakReport::SoakReport(const SoakOptions& options) : _options(options)
+{
+}
+
+SoakReport::~SoakReport()
+{
+    if (_file) {
+        std::fclose(_file);
+    }
+}
+
+bool SoakReport::open(std::string& error)
+{
+    _file = std::fopen(_options.output.c_str(), "w");
+    if (!_file) {
+        error = "cannot create " + _options.output + ": " + std::strerror(errno);
+        return false;
+    }
+    std::fprintf(_file, "event,kind,width,height,value,fb_width,fb_height,frame_ms,hitch_ms,rebuild_ms,"
+                        "allocations,allocated_bytes,resident_bytes,gpu_bytes\n");
+    return true;
+}
+
+void SoakReport::add(int index, SoakSample& sample)
+{
+    sample.hitchMs = std::max(sample.frameMs - _idleFrameMs, 0.0);
+    _hitches[sample.step.kind].push_back(sample.hitchMs);
+    if (sample.allocations > 0) {
+        _rebuilds.push_back(sample.rebuildMs);
+    }
+    _allocations += sample.allocations;
+    _allocatedBytes += sample.allocatedBytes;
+    _peakGpu = std::max(_peakGpu, sample.gpuBytes);
+    if (sample.step.kind == SoakStep::Home) {
+        _homes.push_back({ index, sample.residentBytes, sample.gpuBytes });
+    }
+
+    if (_file) {
+        const SoakStep& s = sample.step;
+        std::fprintf(_file, "%d,%s,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%u,%llu,%llu,%llu\n", index, soakStepName(s.kind),
+                     s.width, s.height, s.value, sample.framebufferWidth, sample.framebufferHeight, sample.frameMs,
+                     sample.hitchMs, sample.rebuildMs, sample.allocations, (unsigned long long)sample.allocatedBytes,
+                     (unsigned long long)sample.residentBytes, (unsigned long long)sample.gpuBytes);
+    }
+}
+
+double SoakReport::projectedGrowth(bool gpu) const
+{
+    // Least-squares slope in bytes per event, over the events after warm-up
+    double n = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    int first = -1, last = -1;
+    for (const Home& home : _homes) {
+        if (home.index < _options.warmupEvents) {
+            continue;
+        }
+        double x = (double)home.index;
+        double y = (double)(gpu ? home.gpu : home.resident);
+        n += 1.0;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+        first = first < 0 ? home.index : first;
+        last = home.index;
+    }
+    double denominator = n * sxx - sx * sx;
+    if (n < 3.0 || denominator <= 0.0) {
+        return 0.0;
+    }
+    double slope = (n * sxy - sx * sy) / denominator;
+    return slope * (double)(last - first);
+}
+
+bool SoakReport::finish(uint64_t peakResidentBytes)
+{
+    if (_file) {
+        std::fclose(_file);
+        _file = nullptr;
+    }
+
+    std::printf("\nSoak: idle frame %.2f ms, %zu rebuilds, %llu allocations (%.1f MB allocated in total)\n",
+                _idleFrameMs, _rebuilds.size(), (unsigned long long)_allocations, (double)_allocatedBytes / kMB);
+    std::printf("  Rebuild CPU time: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", percentile(_rebuilds, 0.5),
+                percentile(_rebuilds, 0.99), percentile(_rebuilds, 1.0));
+
+    bool ok = true;
+    double worstHitch = 0.0;
+    for (int kind = 0; kind < SoakStep::KindCount; ++kind) {
+        const std::vector<double>& hitches = _hitches[kind];
+        if (hitches.empty()) {
+            continue;
+        }
+        double worst = percentile(hitches, 1.0);
+        worstHitch = std::max(worstHitch, worst);
+        std::printf("  Hitch %-17s %5zu events: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+                    soakStepName((SoakStep::Kind)kind), hitches.size(), percentile(hitches, 0.5),
+                    percentile(hitches, 0.99), worst);
+    }
+    if (_options.hitchBudgetMs > 0.0 && worstHitch > _options.hitchBudgetMs) {
+        std::printf("  FAIL: worst hitch %.2f ms exceeds the %.2f ms budget\n", worstHitch, _options.hitchBudgetMs);
+        ok = false;
+    }
+
+    double residentGrowth = projectedGrowth(false) / kMB;
+    double gpuGrowth = projectedGrowth(true) / kMB;
+    std::printf("  Peak resident %.1f MB, peak GPU %.1f MB\n", (double)peakResidentBytes / kMB, (double)_peakGpu / kMB);
+    if (!_homes.empty()) {
+        std::printf("  Home configuration: resident %.1f -> %.1f MB, GPU %.1f -> %.1f MB (%zu samples)\n",
+                    (double)_homes.front().resident / kMB, (double)_homes.back().resident / kMB,
+                    (double)_homes.front().gpu / kMB, (double)_homes.back().gpu / kMB, _homes.size());
+    }
+    std::printf("  Growth after warm-up (fit): resident %+.2f MB (slack %.0f), GPU %+.2f MB (slack %.0f)\n",
+                residentGrowth, _options.residentSlackMB, gpuGrowth, _options.gpuSlackMB);
+    size_t fitted = (size_t)std::count_if(_homes.begin(), _homes.end(),
+                                          [&](const Home& home) { return home.index >= _options.warmupEvents; });
+    if (fitted < 3) {
+        std::printf("  FAIL: %zu home samples after warm-up; the leak check needs 3 (more --events or less --warmup)\n",
+                    fitted);
+        ok = false;
+    }
+    if (residentGrowth > _options.residentSlackMB) {
+        std::printf("  FAIL: resident memory grows across home visits (leak)\n");
+        ok = false;
+    }
+    if (gpuGrowth > _options.gpuSlackMB) {
+        std::printf("  FAIL: GPU allocations grow across home visits (leak)\n");
+        ok = false;
+    }
+    std::printf("Soak %s; per-event log in %s\n", ok ? "passed" : "FAILED", _options.output.c_str());
+    return ok;
+}
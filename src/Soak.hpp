@@ -0,0 +1,147 @@
+/**
+ * Soak.hpp
+ *
+ * Resource-churn soak test: scripted resizes, visual preset switches and
+ * bloom-iteration changes, with memory and hitch tracking
+ *
+ * Each of these sets _postProcessDirty, and the next frame frees and
+ * reallocates every post-processing texture. The soak applies thousands of
+ * such events, draws a few frames after each, and records per event the
+ * longest frame interval, the rebuild time, the objects and bytes the
+ * rebuild allocated, and resident and GPU memory.
+ *
+ * Leaks are judged at a fixed home configuration (the starting window
+ * size, preset and bloom levels) that the script returns to every
+ * homeEvery events, so the memory samples compare like with like. A
+ * least-squares line through the home samples after warm-up gives the
+ * growth over the run. The soak fails if that growth exceeds the slack
+ * for resident or GPU memory, or, when a budget is set, if any event's
+ * hitch exceeds it.
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct SoakOptions
+{
+    int events = 2000;
+    int framesPerEvent = 3;         // Frames drawn after each event (a resize lands one frame late)
+    int homeEvery = 50;             // Return to the home configuration this often
+    int warmupEvents = 200;         // Home samples before this are left out of the leak fit
+    int minWidth = 320;             // Resize range in window points
+    int minHeight = 180;
+    int maxWidth = 1920;
+    int maxHeight = 1080;
+    double residentSlackMB = 64.0;  // Allowed resident growth over the run
+    double gpuSlackMB = 16.0;       // Allowed GPU allocation growth over the run
+    double hitchBudgetMs = 0.0;     // Fail when any hitch exceeds this (0 = report only)
+    uint32_t seed = 1;
+    std::string output = "soak.csv";
+};
+
+/**
+ * Parse the arguments following --soak
+ *
+ * @return false with a message on unknown options or bad values
+ */
+bool parseSoakArgs(int argc, char** argv, SoakOptions& options, std::string& error);
+
+// Command-line help for --soak
+const char* soakUsage();
+
+struct SoakStep
+{
+    enum Kind { Idle, Home, Resize, VisualPreset, BloomIterations, KindCount };
+
+    Kind kind = Idle;
+    int width = 0;                  // Resize: window size in points
+    int height = 0;
+    int value = 0;                  // VisualPreset: preset; BloomIterations: levels
+};
+
+const char* soakStepName(SoakStep::Kind kind);
+
+/**
+ * Deterministic event sequence (same seed, same script)
+ *
+ * Resizes, preset switches and bloom changes in equal shares, plus a Home
+ * step every homeEvery events.
+ */
+class SoakScript
+{
+public:
+    static constexpr int kVisualPresets = 3;
+
+    explicit SoakScript(const SoakOptions& options);
+
+    size_t size() const { return _steps.size(); }
+    const SoakStep& operator[](size_t i) const { return _steps[i]; }
+
+private:
+    std::vector<SoakStep> _steps;
+};
+
+struct SoakSample
+{
+    SoakStep step;
+    int framebufferWidth = 0;       // Drawable size after the event
+    int framebufferHeight = 0;
+    double frameMs = 0.0;           // Longest frame interval after the event
+    double hitchMs = 0.0;           // frameMs above the idle median
+    double rebuildMs = 0.0;         // CPU time of the post-processing rebuild (0 if none)
+    uint32_t allocations = 0;       // Textures and buffers the rebuild created
+    uint64_t allocatedBytes = 0;    // Their GPU size
+    uint64_t residentBytes = 0;     // Process resident set after the event
+    uint64_t gpuBytes = 0;          // Device allocated size after the event
+};
+
+/**
+ * Per-event log, CSV output and pass/fail verdict
+ */
+class SoakReport
+{
+public:
+    explicit SoakReport(const SoakOptions& options);
+    ~SoakReport();
+
+    bool open(std::string& error);
+
+    // Median frame interval of undisturbed frames, the hitch baseline
+    void setIdleFrameMs(double ms) { _idleFrameMs = ms; }
+    double idleFrameMs() const { return _idleFrameMs; }
+
+    // Fills sample.hitchMs, appends a CSV row and keeps the totals
+    void add(int index, SoakSample& sample);
+
+    /**
+     * Print the summary and decide
+     *
+     * @param peakResidentBytes High-water mark of the process (0 if unknown)
+     * @return false when memory grew past the slack or a hitch broke the budget
+     */
+    bool finish(uint64_t peakResidentBytes);
+
+private:
+    struct Home
+    {
+        int index;
+        uint64_t resident;
+        uint64_t gpu;
+    };
+
+    // Growth over the run projected from the home samples after warm-up
+    double projectedGrowth(bool gpu) const;
+
+    SoakOptions _options;
+    FILE* _file = nullptr;
+    double _idleFrameMs = 0.0;
+    std::vector<double> _hitches[SoakStep::KindCount];
+    std::vector<double> _rebuilds;
+    std::vector<Home> _homes;
+    uint64_t _allocations = 0;
+    uint64_t _allocatedBytes = 0;
+    uint64_t _peakGpu = 0;
+};
@@ -0,0 +1,269 @@
+/**
+ * Spectral.cpp
+ *
+ * Blackbody fitting and colour projection for the spectral emission basis.
+ */
+
+#include "Spectral.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Physical constants (SI)
+constexpr double kPlanck = 6.62607015e-34;
+constexpr double kLightSpeed = 2.99792458e8;
+constexpr double kBoltzmann = 1.380649e-23;
+
+constexpr int kFitSamples = 256;
+
+/**
+ * Natural log of Planck's law B_λ(T), λ in nm
+ *
+ * Evaluated in log form so the deep Wien tail stays finite.
+ */
+double logPlanck(double wavelengthNm, double temperature)
+{
+    double lambda = wavelengthNm * 1e-9;
+    double a = kPlanck * kLightSpeed / (lambda * kBoltzmann * temperature);
+    double logExpm1 = (a > 30.0) ? a + std::log1p(-std::exp(-a)) : std::log(std::expm1(a));
+    return std::log(2.0 * kPlanck * kLightSpeed * kLightSpeed) - 5.0 * std::log(lambda) - logExpm1;
+}
+
+// Piecewise Gaussian lobe used by the CIE fit
+double lobe(double lambda, double mu, double sigmaLow, double sigmaHigh)
+{
+    double t = (lambda - mu) / (lambda < mu ? sigmaLow : sigmaHigh);
+    return std::exp(-0.5 * t * t);
+}
+
+// CIE 1931 2° colour matching functions, multi-lobe fit (Wyman et al. 2013)
+void colorMatching(double lambda, double xyz[3])
+{
+    xyz[0] = 1.056 * lobe(lambda, 599.8, 37.9, 31.0)
+           + 0.362 * lobe(lambda, 442.0, 16.0, 26.7)
+           - 0.065 * lobe(lambda, 501.1, 20.4, 26.2);
+    xyz[1] = 0.821 * lobe(lambda, 568.8, 46.9, 40.5)
+           + 0.286 * lobe(lambda, 530.9, 16.3, 31.1);
+    xyz[2] = 1.217 * lobe(lambda, 437.0, 11.8, 36.0)
+           + 0.681 * lobe(lambda, 459.0, 26.0, 13.8);
+}
+
+// Solve the normal equations in place (Gaussian elimination, partial pivoting)
+void solve(double a[SPECTRAL_COEFFS][SPECTRAL_COEFFS], double b[SPECTRAL_COEFFS], double x[SPECTRAL_COEFFS])
+{
+    const int n = SPECTRAL_COEFFS;
+    for (int col = 0; col < n; ++col) {
+        int pivot = col;
+        for (int row = col + 1; row < n; ++row) {
+            if (std::fabs(a[row][col]) > std::fabs(a[pivot][col])) {
+                pivot = row;
+            }
+        }
+        std::swap(a[col], a[pivot]);
+        std::swap(b[col], b[pivot]);
+        for (int row = col + 1; row < n; ++row) {
+            double f = a[row][col] / a[col][col];
+            for (int k = col; k < n; ++k) {
+                a[row][k] -= f * a[col][k];
+            }
+            b[row] -= f * b[col];
+        }
+    }
+    for (int row = n - 1; row >= 0; --row) {
+        double sum = b[row];
+        for (int k = row + 1; k < n; ++k) {
+            sum -= a[row][k] * x[k];
+        }
+        x[row] = sum / a[row][row];
+    }
+}
+
+// Legendre polynomials P_0..P_{n-1} at u
+void legendre(double u, double p[SPECTRAL_COEFFS])
+{
+    p[0] = 1.0;
+    p[1] = u;
+    for (int k = 1; k < SPECTRAL_COEFFS - 1; ++k) {
+        p[k + 1] = ((2.0 * k + 1.0) * u * p[k] - k * p[k - 1]) / (k + 1.0);
+    }
+}
+
+// Monomial coefficients of each Legendre polynomial: mono[k][j] = [u^j] P_k
+void legendreToMonomial(double mono[SPECTRAL_COEFFS][SPECTRAL_COEFFS])
+{
+    for (int k = 0; k < SPECTRAL_COEFFS; ++k) {
+        for (int j = 0; j < SPECTRAL_COEFFS; ++j) {
+            mono[k][j] = 0.0;
+        }
+    }
+    mono[0][0] = 1.0;
+    mono[1][1] = 1.0;
+    for (int k = 1; k < SPECTRAL_COEFFS - 1; ++k) {
+        for (int j = 0; j < SPECTRAL_COEFFS; ++j) {
+            double v = -k * mono[k - 1][j];
+            if (j > 0) {
+                v += (2.0 * k + 1.0) * mono[k][j - 1];
+            }
+            mono[k + 1][j] = v / (k + 1.0);
+        }
+    }
+}
+
+double horner(const double c[SPECTRAL_COEFFS], double u)
+{
+    double v = c[SPECTRAL_COEFFS - 1];
+    for (int k = SPECTRAL_COEFFS - 2; k >= 0; --k) {
+        v = v * u + c[k];
+    }
+    return v;
+}
+
+} // namespace
+
+namespace Spectral {
+
+void buildSpectralBasis(SpectralBasis& basis)
+{
+    // Fit domain: every emitted wavelength g·λ an observed visible λ can map to
+    const double xLow = std::log(kMinWavelength / kMaxShift);
+    const double xHigh = std::log(kMaxWavelength * kMaxShift);
+    const double center = 0.5 * (xLow + xHigh);
+    const double halfWidth = 0.5 * (xHigh - xLow);
+
+    // Nodes uniformly spaced in log-wavelength across the visible range
+    double nodeX[SPECTRAL_NODES];
+    double nodeU[SPECTRAL_NODES];
+    const double xMin = std::log(kMinWavelength);
+    const double xMax = std::log(kMaxWavelength);
+    const double nodeStep = (xMax - xMin) / (SPECTRAL_NODES - 1);
+    for (int i = 0; i < SPECTRAL_NODES; ++i) {
+        nodeX[i] = xMin + nodeStep * i;
+        nodeU[i] = (nodeX[i] - center) / halfWidth;
+    }
+
+    // Projection weights: integrate the colour matching functions against
+    // hat functions between nodes (radiance assumed piecewise linear in ln λ)
+    double weightXYZ[3][SPECTRAL_NODES] = {};
+    for (double lambda = 360.0; lambda <= 830.0; lambda += 1.0) {
+        double t = (std::log(lambda) - xMin) / nodeStep;
+        if (t < 0.0 || t > SPECTRAL_NODES - 1) {
+            continue;
+        }
+        int i = std::min((int)t, SPECTRAL_NODES - 2);
+        double f = t - i;
+        double xyz[3];
+        colorMatching(lambda, xyz);
+        for (int ch = 0; ch < 3; ++ch) {
+            weightXYZ[ch][i] += xyz[ch] * (1.0 - f);
+            weightXYZ[ch][i + 1] += xyz[ch] * f;
+        }
+    }
+
+    // XYZ to linear sRGB (D65)
+    const double toRGB[3][3] = {
+        {  3.2406, -1.5372, -0.4986 },
+        { -0.9689,  1.8758,  0.0415 },
+        {  0.0557, -0.2040,  1.0570 },
+    };
+    for (int ch = 0; ch < 3; ++ch) {
+        for (int i = 0; i < SPECTRAL_NODES; ++i) {
+            double w = toRGB[ch][0] * weightXYZ[0][i] + toRGB[ch][1] * weightXYZ[1][i] + toRGB[ch][2] * weightXYZ[2][i];
+            basis.weights[ch][i / 4][i % 4] = (float)w;
+        }
+    }
+    for (int i = 0; i < SPECTRAL_NODES; ++i) {
+        basis.nodes[i / 4][i % 4] = (float)nodeU[i];
+    }
+
+    double mono[SPECTRAL_COEFFS][SPECTRAL_COEFFS];
+    legendreToMonomial(mono);
+
+    const double logTMin = std::log(kMinTemperature);
+    const double logTStep = (std::log(kMaxTemperature) - logTMin) / (SPECTRAL_TEMPERATURES - 1);
+
+    for (int t = 0; t < SPECTRAL_TEMPERATURES; ++t) {
+        double temperature = std::exp(logTMin + logTStep * t);
+
+        // Least squares in the Legendre basis (well conditioned on [-1, 1])
+        double ata[SPECTRAL_COEFFS][SPECTRAL_COEFFS] = {};
+        double atb[SPECTRAL_COEFFS] = {};
+        for (int s = 0; s < kFitSamples; ++s) {
+            double u = -1.0 + 2.0 * (s + 0.5) / kFitSamples;
+            double y = logPlanck(std::exp(center + halfWidth * u), temperature);
+            double p[SPECTRAL_COEFFS];
+            legendre(u, p);
+            for (int a = 0; a < SPECTRAL_COEFFS; ++a) {
+                atb[a] += p[a] * y;
+                for (int b = 0; b < SPECTRAL_COEFFS; ++b) {
+                    ata[a][b] += p[a] * p[b];
+                }
+            }
+        }
+        double legendreCoeffs[SPECTRAL_COEFFS];
+        solve(ata, atb, legendreCoeffs);
+
+        double coeffs[SPECTRAL_COEFFS] = {};
+        for (int k = 0; k < SPECTRAL_COEFFS; ++k) {
+            for (int j = 0; j < SPECTRAL_COEFFS; ++j) {
+                coeffs[j] += legendreCoeffs[k] * mono[k][j];
+            }
+        }
+
+        // Normalize: unshifted emission projects to luminance 1
+        double luminance = 0.0;
+        for (int i = 0; i < SPECTRAL_NODES; ++i) {
+            luminance += weightXYZ[1][i] * std::exp(horner(coeffs, nodeU[i]));
+        }
+        coeffs[0] -= std::log(luminance);
+
+        for (int k = 0; k < SPECTRAL_COEFFS; ++k) {
+            basis.coefficients[t][k / 4][k % 4] = (float)coeffs[k];
+        }
+    }
+
+    basis.log_temp_min = (float)logTMin;
+    basis.inv_log_temp_step = (float)(1.0 / logTStep);
+    basis.inv_half_width = (float)(1.0 / halfWidth);
+    basis.max_log_shift = (float)std::log(kMaxShift);
+}
+
+vector_float3 evaluate(const SpectralBasis& basis, float temperature, float shift)
+{
+    float t = (std::log(temperature) - basis.log_temp_min) * basis.inv_log_temp_step;
+    t = std::clamp(t, 0.0f, (float)(SPECTRAL_TEMPERATURES - 1));
+    int i0 = std::min((int)t, SPECTRAL_TEMPERATURES - 2);
+    float f = t - (float)i0;
+
+    float coeffs[SPECTRAL_COEFFS];
+    for (int k = 0; k < SPECTRAL_COEFFS; ++k) {
+        float a = basis.coefficients[i0][k / 4][k % 4];
+        float b = basis.coefficients[i0 + 1][k / 4][k % 4];
+        coeffs[k] = a + (b - a) * f;
+    }
+
+    // The g⁵ factor of the shift cancels in the luminance normalization
+    float logShift = std::clamp(std::log(shift), -basis.max_log_shift, basis.max_log_shift);
+    float delta = logShift * basis.inv_half_width;
+
+    vector_float3 rgb = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < SPECTRAL_NODES; ++i) {
+        float u = basis.nodes[i / 4][i % 4] + delta;
+        float v = coeffs[SPECTRAL_COEFFS - 1];
+        for (int k = SPECTRAL_COEFFS - 2; k >= 0; --k) {
+            v = v * u + coeffs[k];
+        }
+        float radiance = std::exp(v);
+        for (int ch = 0; ch < 3; ++ch) {
+            rgb[ch] += basis.weights[ch][i / 4][i % 4] * radiance;
+        }
+    }
+    float luminance = 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+    float scale = 1.0f / std::max(luminance, 1e-30f);
+    for (int ch = 0; ch < 3; ++ch) {
+        rgb[ch] = std::max(rgb[ch] * scale, 0.0f);
+    }
+    return rgb;
+}
+
+} // namespace Spectral
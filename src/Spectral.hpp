@@ -0,0 +1,52 @@
+/**
+ * Spectral.hpp
+ *
+ * Host-side construction of the spectral emission basis
+ *
+ * Fits blackbody spectra in the low-dimensional basis described in
+ * ShaderTypes.h (SpectralBasis) and precomputes the projection from node
+ * radiances to linear sRGB. Pure C++; the result is uploaded once to the
+ * GPU and used by the disk shader in spectral mode.
+ *
+ * Colour matching uses the analytic multi-lobe fit of the CIE 1931 2°
+ * observer (Wyman, Sloan & Shirley 2013), so no tabulated data is needed.
+ */
+
+#pragma once
+#include "ShaderTypes.h"
+
+namespace Spectral {
+
+// Observed wavelength range and frequency shifts covered by the fit
+constexpr double kMinWavelength = 380.0;   // nm
+constexpr double kMaxWavelength = 780.0;   // nm
+constexpr double kMaxShift = 3.0;          // g in [1/kMaxShift, kMaxShift]
+
+// Tabulated blackbody temperatures (log-spaced)
+constexpr double kMinTemperature = 1000.0;
+constexpr double kMaxTemperature = 40000.0;
+
+/**
+ * Fill the spectral basis
+ *
+ * For every tabulated temperature the log-radiance polynomial is fitted by
+ * least squares over the emitted wavelengths reachable under the shift
+ * range, then offset so the unshifted spectrum projects to luminance 1.
+ *
+ * @param[out] basis Basis ready for upload
+ */
+void buildSpectralBasis(SpectralBasis& basis);
+
+/**
+ * Linear sRGB colour of a shifted blackbody, at unit luminance
+ *
+ * CPU reference of the shader evaluation (same table, nodes and weights).
+ * Components may be zero where the colour lies outside the sRGB gamut.
+ *
+ * @param basis Basis from buildSpectralBasis()
+ * @param temperature Emitter temperature in Kelvin
+ * @param shift Frequency ratio g = ν_observed / ν_emitted
+ */
+vector_float3 evaluate(const SpectralBasis& basis, float temperature, float shift);
+
+} // namespace Spectral
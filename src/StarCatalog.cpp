@@ -0,0 +1,98 @@
+/**
+ * StarCatalog.cpp
+ *
+ * Catalog mapping and validation.
+ */
+
+#include "StarCatalog.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+StarCatalog::~StarCatalog()
+{
+    close();
+}
+
+void StarCatalog::close()
+{
+    if (_data) {
+        munmap(_data, _mappedBytes);
+        _data = nullptr;
+        _mappedBytes = 0;
+    }
+}
+
+bool StarCatalog::open(const char* path, std::string& error)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        error = std::string("cannot open ") + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(StarCatalogHeader)) {
+        ::close(fd);
+        error = "file too small for a catalog header";
+        return false;
+    }
+    size_t fileBytes = (size_t)st.st_size;
+    size_t page = (size_t)getpagesize();
+    size_t mappedBytes = (fileBytes + page - 1) / page * page;
+
+    // Private writable mapping: never written, so no pages are copied, but
+    // the GPU may wrap it without requiring read-only buffer support
+    void* data = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        error = std::string("mmap failed: ") + std::strerror(errno);
+        return false;
+    }
+    _data = data;
+    _mappedBytes = mappedBytes;
+
+    auto fail = [&](const char* reason) {
+        close();
+        error = reason;
+        return false;
+    };
+
+    const StarCatalogHeader& h = header();
+    if (std::memcmp(h.magic, "BHSTARS", 8) != 0) {
+        return fail("not a star catalog (bad magic)");
+    }
+    if (h.version != kStarCatalogVersion) {
+        return fail("unsupported catalog version");
+    }
+    if (h.order > kStarCatalogMaxOrder) {
+        return fail("HEALPix order out of range");
+    }
+    if (h.cells_offset % 256 != 0 || h.stars_offset % 256 != 0) {
+        return fail("catalog sections are not 256-byte aligned");
+    }
+
+    uint64_t cells = cellCount();
+    if (h.cells_offset + (cells + 1) * sizeof(uint32_t) > fileBytes ||
+        h.stars_offset + (uint64_t)h.star_count * sizeof(CatalogStar) > fileBytes) {
+        return fail("catalog is truncated");
+    }
+
+    // The shader trusts these ranges, so check every one
+    const uint32_t* prefix = reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(_data) + h.cells_offset);
+    if (prefix[0] != 0 || prefix[cells] != h.star_count) {
+        return fail("cell index does not cover the star array");
+    }
+    for (uint64_t i = 0; i < cells; ++i) {
+        if (prefix[i + 1] < prefix[i]) {
+            return fail("cell index is not monotonic");
+        }
+    }
+
+    madvise(_data, _mappedBytes, MADV_WILLNEED);
+    return true;
+}
@@ -0,0 +1,70 @@
+/**
+ * StarCatalog.hpp
+ *
+ * Memory-mapped HEALPix star catalog
+ *
+ * Maps a catalog file written by tools/build_star_catalog.py read-only into
+ * the address space and validates it. The mapping is page-aligned and
+ * page-padded, so the renderer wraps it in a GPU buffer without copying;
+ * the buffer must be released before the catalog is closed.
+ *
+ * File layout (little-endian, sections 256-byte aligned):
+ *   StarCatalogHeader
+ *   uint32_t cells[12·4^order + 1]   prefix offsets into the star array
+ *   CatalogStar stars[star_count]    grouped by NESTED pixel, brightest first
+ */
+
+#pragma once
+#include "ShaderTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct StarCatalogHeader
+{
+    char magic[8];                  // "BHSTARS\0"
+    uint32_t version;               // kStarCatalogVersion
+    uint32_t order;                 // HEALPix order k (nside = 2^k)
+    uint32_t star_count;            // Stars in the file
+    uint32_t max_cell_stars;        // Stars in the densest pixel
+    uint64_t cells_offset;          // Byte offset of the cell prefix array
+    uint64_t stars_offset;          // Byte offset of the star array
+    float mag_min;                  // Brightest magnitude in the file
+    float mag_max;                  // Faintest magnitude in the file
+    uint32_t reserved[6];
+};
+
+constexpr uint32_t kStarCatalogVersion = 1;
+constexpr uint32_t kStarCatalogMaxOrder = 10;
+
+class StarCatalog
+{
+public:
+    StarCatalog() = default;
+    ~StarCatalog();
+    StarCatalog(const StarCatalog&) = delete;
+    StarCatalog& operator=(const StarCatalog&) = delete;
+
+    /**
+     * Map and validate a catalog file, replacing any open one
+     *
+     * @param path Catalog file
+     * @param[out] error Reason on failure
+     * @return false if the file is missing, truncated or inconsistent
+     */
+    bool open(const char* path, std::string& error);
+    void close();
+
+    bool isOpen() const { return _data != nullptr; }
+    const StarCatalogHeader& header() const { return *static_cast<const StarCatalogHeader*>(_data); }
+
+    // Whole mapping, rounded up to a page (suitable for a no-copy GPU buffer)
+    void* mappedData() const { return _data; }
+    size_t mappedBytes() const { return _mappedBytes; }
+
+    uint32_t cellCount() const { return 12u << (2 * header().order); }
+
+private:
+    void* _data = nullptr;
+    size_t _mappedBytes = 0;
+};
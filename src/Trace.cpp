@@ -0,0 +1,376 @@
+/**
+ * Trace.cpp
+ *
+ * Trace-event timeline (Chrome / Perfetto JSON)
+ */
+
+#include "Trace.hpp"
+
+#ifdef BLACKHOLE_TRACE
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+std::atomic<bool> trace_detail::enabled{ false };
+
+namespace {
+
+struct Event
+{
+    const char* category;
+    const char* name;
+    int64_t begin;
+    int64_t duration;
+    int64_t arg;
+    int32_t track;
+};
+
+const uint32_t kFirstChunkEvents = 64;     // 3 KB, so idle threads stay cheap
+const uint32_t kMaxChunkEvents = 4096;      // Chunks double up to this size
+const size_t kMaxEventsPerThread = 1 << 20; // 48 MB per thread
+const size_t kMaxBufferedEvents = 1 << 22;  // 192 MB across threads, exited ones included
+const int kTrackTidBase = 1000000;
+
+struct Chunk
+{
+    explicit Chunk(uint32_t capacity) : events(new Event[capacity]), capacity(capacity) {}
+    ~Chunk() { delete[] events; }
+
+    Event* events;
+    uint32_t capacity;
+    std::atomic<uint32_t> count{ 0 };       // Published with release by the owner
+    std::atomic<Chunk*> next{ nullptr };
+};
+
+// Written only by its thread; the dumper follows head → next → ...
+struct ThreadBuffer
+{
+    enum State { Active, Exited, Free };
+
+    std::atomic<Chunk*> head{ nullptr };    // Allocated on the first span
+    Chunk* tail = nullptr;
+    size_t capacity = 0;                    // Events across all chunks
+    int tid = 0;
+    std::atomic<const char*> name{ nullptr };
+    std::atomic<uint64_t> dropped{ 0 };
+    std::atomic<int> state{ Active };       // Exited is stored with release by the owner
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::mutex dumpMutex;                   // One dump at a time: dumps free exited buffers
+    std::vector<ThreadBuffer*> threads;
+    std::atomic<size_t> bufferedEvents{ 0 }; // Chunk capacity held by all buffers
+    std::vector<const char*> tracks;
+    std::string output;
+    int64_t origin = 0;
+    int nextTid = 1;
+};
+
+// Never destroyed: threads may still record while statics are torn down
+Registry& registry()
+{
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+// Trivially destructible, so still readable after ThreadExit has run
+thread_local ThreadBuffer* tlsBuffer = nullptr;
+thread_local bool tlsExited = false;
+
+void releaseBuffer(ThreadBuffer* buffer);
+
+// Hands the thread's buffer back when the thread exits: straight to reuse
+// if it holds no events and no dump is reading it, else once a dump has
+// written it
+struct ThreadExit
+{
+    ~ThreadExit()
+    {
+        if (tlsBuffer) {
+            Registry& r = registry();
+            std::unique_lock<std::mutex> dumpLock(r.dumpMutex, std::try_to_lock);
+            if (dumpLock && !tlsBuffer->head.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(r.mutex);
+                releaseBuffer(tlsBuffer);
+            } else {
+                tlsBuffer->state.store(ThreadBuffer::Exited, std::memory_order_release);
+            }
+            tlsBuffer = nullptr;
+        }
+        tlsExited = true;
+    }
+};
+
+thread_local ThreadExit tlsExit;
+
+// The calling thread's buffer, reusing one whose thread exited and was dumped
+ThreadBuffer* threadBuffer()
+{
+    if (!tlsBuffer && !tlsExited) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        ThreadBuffer* buffer = nullptr;
+        for (ThreadBuffer* candidate : r.threads) {
+            if (candidate->state.load(std::memory_order_relaxed) == ThreadBuffer::Free) {
+                buffer = candidate;
+                break;
+            }
+        }
+        if (!buffer) {
+            buffer = new ThreadBuffer();
+            r.threads.push_back(buffer);
+        }
+        buffer->name.store(nullptr, std::memory_order_relaxed);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+        buffer->tid = r.nextTid++;
+        buffer->state.store(ThreadBuffer::Active, std::memory_order_relaxed);
+        (void)&tlsExit;                     // Registers the exit hook for this thread
+        tlsBuffer = buffer;
+    }
+    return tlsBuffer;
+}
+
+// Drop the events of a buffer whose thread exited, making it reusable.
+// Called with the registry mutex held
+void releaseBuffer(ThreadBuffer* buffer)
+{
+    Chunk* chunk = buffer->head.load(std::memory_order_relaxed);
+    while (chunk) {
+        Chunk* next = chunk->next.load(std::memory_order_relaxed);
+        delete chunk;
+        chunk = next;
+    }
+    buffer->head.store(nullptr, std::memory_order_relaxed);
+    buffer->tail = nullptr;
+    registry().bufferedEvents.fetch_sub(buffer->capacity, std::memory_order_relaxed);
+    buffer->capacity = 0;
+    buffer->state.store(ThreadBuffer::Free, std::memory_order_relaxed);
+}
+
+// Claim room for a chunk under the cap across threads. Exited threads keep
+// their share until a dump writes and frees their events
+bool reserveEvents(size_t size)
+{
+    std::atomic<size_t>& buffered = registry().bufferedEvents;
+    if (buffered.fetch_add(size, std::memory_order_relaxed) + size > kMaxBufferedEvents) {
+        buffered.fetch_sub(size, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void writeString(FILE* file, const char* text)
+{
+    std::fputc('"', file);
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            std::fputc('\\', file);
+        }
+        std::fputc(*c, file);
+    }
+    std::fputc('"', file);
+}
+
+void writeThreadName(FILE* file, int tid, const char* name)
+{
+    std::fprintf(file, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", tid);
+    writeString(file, name);
+    std::fprintf(file, "}}");
+}
+
+// BLACKHOLE_TRACE=path records from startup and writes path at exit
+struct AutoTrace
+{
+    AutoTrace()
+    {
+        const char* path = std::getenv("BLACKHOLE_TRACE");
+        if (path && *path) {
+            traceStart(path);
+        }
+    }
+
+    ~AutoTrace()
+    {
+        std::string output;
+        {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            output = r.output;
+        }
+        if (!output.empty()) {
+            traceStop();
+            if (traceDump(output.c_str())) {
+                std::fprintf(stderr, "Trace written to %s\n", output.c_str());
+            }
+        }
+    }
+};
+
+AutoTrace autoTrace;
+
+} // namespace
+
+void traceStart(const char* outputPath)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (outputPath) {
+        r.output = outputPath;
+    }
+    if (r.origin == 0) {
+        r.origin = traceNow();
+    }
+    trace_detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void traceStop()
+{
+    trace_detail::enabled.store(false, std::memory_order_relaxed);
+}
+
+int64_t traceNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void traceThreadName(const char* name)
+{
+    if (ThreadBuffer* buffer = threadBuffer()) {
+        buffer->name.store(name, std::memory_order_release);
+    }
+}
+
+int traceTrack(const char* name)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (size_t i = 0; i < r.tracks.size(); ++i) {
+        if (r.tracks[i] == name) {
+            return (int)i + 1;
+        }
+    }
+    r.tracks.push_back(name);
+    return (int)r.tracks.size();
+}
+
+void traceSpan(const char* category, const char* name, int64_t beginNs, int64_t endNs, int64_t arg, int track)
+{
+    if (!traceEnabled()) {
+        return;
+    }
+    ThreadBuffer* buffer = threadBuffer();
+    if (!buffer) {
+        return;                             // Thread is exiting
+    }
+    Chunk* chunk = buffer->tail;
+    uint32_t n = chunk ? chunk->count.load(std::memory_order_relaxed) : 0;
+    if (!chunk || n == chunk->capacity) {
+        uint32_t size = chunk ? std::min(chunk->capacity * 2, kMaxChunkEvents) : kFirstChunkEvents;
+        if (buffer->capacity + size > kMaxEventsPerThread || !reserveEvents(size)) {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Chunk* fresh = new Chunk(size);
+        if (chunk) {
+            chunk->next.store(fresh, std::memory_order_release);
+        } else {
+            buffer->head.store(fresh, std::memory_order_release);
+        }
+        buffer->tail = fresh;
+        buffer->capacity += size;
+        chunk = fresh;
+        n = 0;
+    }
+    chunk->events[n] = { category, name, beginNs, endNs - beginNs, arg, track };
+    chunk->count.store(n + 1, std::memory_order_release);
+}
+
+bool traceDump(const char* path)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> dumpLock(r.dumpMutex);
+    std::vector<ThreadBuffer*> threads;
+    std::vector<ThreadBuffer*> exited;
+    std::vector<const char*> tracks;
+    int64_t origin;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (ThreadBuffer* buffer : r.threads) {
+            int state = buffer->state.load(std::memory_order_acquire);
+            if (state == ThreadBuffer::Free) {
+                continue;
+            }
+            threads.push_back(buffer);
+            if (state == ThreadBuffer::Exited) {
+                exited.push_back(buffer);
+            }
+        }
+        tracks = r.tracks;
+        origin = r.origin;
+    }
+
+    FILE* file = std::fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    std::fprintf(file, "\n{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"BlackHoleGPU\"}}");
+
+    uint64_t dropped = 0;
+    char fallback[32];
+    for (ThreadBuffer* buffer : threads) {
+        const char* name = buffer->name.load(std::memory_order_acquire);
+        if (!name) {
+            std::snprintf(fallback, sizeof(fallback), "thread %d", buffer->tid);
+            name = fallback;
+        }
+        writeThreadName(file, buffer->tid, name);
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        writeThreadName(file, kTrackTidBase + (int)i + 1, tracks[i]);
+    }
+
+    for (ThreadBuffer* buffer : threads) {
+        for (Chunk* chunk = buffer->head.load(std::memory_order_acquire); chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            uint32_t count = chunk->count.load(std::memory_order_acquire);
+            for (uint32_t i = 0; i < count; ++i) {
+                const Event& e = chunk->events[i];
+                int tid = e.track > 0 ? kTrackTidBase + e.track : buffer->tid;
+                std::fprintf(file, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"cat\":", tid,
+                             (double)(e.begin - origin) * 1e-3, (double)e.duration * 1e-3);
+                writeString(file, e.category);
+                std::fprintf(file, ",\"name\":");
+                writeString(file, e.name);
+                if (e.arg >= 0) {
+                    std::fprintf(file, ",\"args\":{\"n\":%lld}", (long long)e.arg);
+                }
+                std::fputc('}', file);
+            }
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    if (dropped > 0) {
+        std::fprintf(stderr, "Trace: %llu events dropped (trace buffers full)\n", (unsigned long long)dropped);
+    }
+    bool written = std::fclose(file) == 0;
+
+    // Exited threads are in this dump; later dumps leave them out
+    if (written) {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (ThreadBuffer* buffer : exited) {
+            releaseBuffer(buffer);
+        }
+    }
+    return written;
+}
+
+#endif
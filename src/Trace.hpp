@@ -0,0 +1,123 @@
+/**
+ * Trace.hpp
+ *
+ * Trace-event timeline (Chrome / Perfetto JSON)
+ *
+ * Records spans per thread, for example a tracer row, a brick decode, a
+ * bloom level on the GPU or a frame encode. Load the dump in
+ * ui.perfetto.dev or chrome://tracing to see load imbalance that averaged
+ * timers hide.
+ *
+ * Each thread appends to its own chunked buffer with no locks: only the
+ * owning thread writes, and it publishes its event count with a release
+ * store, so traceDump() can read while recording continues. Chunks start
+ * at 64 events and double, and a thread gets none until its first span.
+ * When a thread exits, the next traceDump() writes its events, frees them
+ * and hands the buffer to the next new thread; a thread that recorded
+ * nothing hands it over at exit. Buffered events are capped at 48 MB per
+ * thread and 192 MB in all, so short-lived threads (a Python caller, a GCD
+ * worker) cannot grow memory without bound between dumps; spans past a
+ * cap are dropped and counted. A span costs
+ * two clock reads and one 48-byte store; spans are meant for work of tens
+ * of microseconds or more (rows, tiles, passes), never single rays.
+ *
+ * Recording starts with traceStart() or the BLACKHOLE_TRACE environment
+ * variable (a path that is written at exit). Built without the
+ * BLACKHOLE_TRACE CMake option, the macros expand to nothing and the
+ * functions are empty inlines, so call sites need no #ifdef.
+ *
+ * Names and categories must be string literals (only the pointer is kept).
+ */
+
+#pragma once
+#include <cstdint>
+
+#ifdef BLACKHOLE_TRACE
+
+#include <atomic>
+
+namespace trace_detail {
+extern std::atomic<bool> enabled;
+}
+
+// Start recording; a non-null outputPath is written by traceDump at exit
+void traceStart(const char* outputPath = nullptr);
+
+// Stop recording (events so far are kept)
+void traceStop();
+
+inline bool traceEnabled()
+{
+    return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * Write every event recorded so far as Chrome trace JSON
+ *
+ * @return false if the file cannot be written
+ */
+bool traceDump(const char* path);
+
+// Name the calling thread in the timeline
+void traceThreadName(const char* name);
+
+// A named timeline row not tied to a thread (e.g. "GPU"); returns its id
+int traceTrack(const char* name);
+
+// Nanoseconds on the trace clock (steady_clock)
+int64_t traceNow();
+
+/**
+ * Record a finished span on the calling thread, or on track when non-zero
+ *
+ * @param arg Shown as args.n in the viewer when >= 0 (row, level, brick...)
+ */
+void traceSpan(const char* category, const char* name, int64_t beginNs, int64_t endNs, int64_t arg = -1,
+               int track = 0);
+
+// Records its lifetime as a span when tracing was on at construction
+class TraceScope
+{
+public:
+    TraceScope(const char* category, const char* name, int64_t arg = -1)
+        : _category(category), _name(name), _arg(arg), _begin(traceEnabled() ? traceNow() : -1)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (_begin >= 0) {
+            traceSpan(_category, _name, _begin, traceNow(), _arg);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* _category;
+    const char* _name;
+    int64_t _arg;
+    int64_t _begin;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(category, name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(category, name)
+#define TRACE_SCOPE_ARG(category, name, arg) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(category, name, arg)
+
+#else
+
+inline void traceStart(const char* = nullptr) {}
+inline void traceStop() {}
+inline bool traceEnabled() { return false; }
+inline bool traceDump(const char*) { return false; }
+inline void traceThreadName(const char*) {}
+inline int traceTrack(const char*) { return 0; }
+inline int64_t traceNow() { return 0; }
+inline void traceSpan(const char*, const char*, int64_t, int64_t, int64_t = -1, int = 0) {}
+
+#define TRACE_SCOPE(category, name) ((void)0)
+#define TRACE_SCOPE_ARG(category, name, arg) ((void)0)
+
+#endif
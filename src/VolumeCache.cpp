@@ -0,0 +1,560 @@
+/**
+ * VolumeCache.cpp
+ *
+ * Source mapping, brick decoding and LRU residency for streamed volumes.
+ */
+
+#include "VolumeCache.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace {
+
+// Decoded bricks waiting for a slot; bounds CPU memory on top of the mappings
+constexpr size_t kMaxReady = 64;
+
+// float -> IEEE half bits, round to nearest even
+uint16_t toHalf(float value)
+{
+    uint32_t f;
+    std::memcpy(&f, &value, sizeof(f));
+    uint32_t sign = (f >> 16) & 0x8000u;
+    uint32_t absBits = f & 0x7FFFFFFFu;
+    if (absBits >= 0x7F800000u) {
+        return (uint16_t)(sign | 0x7C00u | (absBits > 0x7F800000u ? 0x200u : 0u));
+    }
+    if (absBits >= 0x477FF000u) {
+        return (uint16_t)(sign | 0x7C00u);   // Overflow to infinity
+    }
+    if (absBits < 0x38800000u) {
+        // Subnormal half (or zero)
+        if (absBits < 0x33000000u) {
+            return (uint16_t)sign;
+        }
+        uint32_t mantissa = (absBits & 0x7FFFFFu) | 0x800000u;
+        int shift = 126 - (int)(absBits >> 23);
+        uint32_t half = mantissa >> (shift + 1);
+        uint32_t rest = mantissa & ((1u << (shift + 1)) - 1);
+        uint32_t halfway = 1u << shift;
+        if (rest > halfway || (rest == halfway && (half & 1u))) {
+            ++half;
+        }
+        return (uint16_t)(sign | half);
+    }
+    uint32_t half = ((absBits - 0x38000000u) >> 13);
+    uint32_t rest = absBits & 0x1FFFu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) {
+        ++half;
+    }
+    return (uint16_t)(sign | half);
+}
+
+uint32_t clampCoord(int64_t v, uint32_t size)
+{
+    return (uint32_t)std::clamp<int64_t>(v, 0, (int64_t)size - 1);
+}
+
+} // namespace
+
+VolumeCache::VolumeCache(int decoderThreads)
+    : _workerCount(std::max(decoderThreads, 1))
+{
+}
+
+VolumeCache::~VolumeCache()
+{
+    close();
+}
+
+bool VolumeCache::mapFile(const char* path, void*& data, size_t& bytes, std::string& error)
+{
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        error = std::string("cannot open ") + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        error = std::string(path) + " is empty";
+        return false;
+    }
+    bytes = (size_t)st.st_size;
+    data = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        data = nullptr;
+        error = std::string("mmap failed: ") + std::strerror(errno);
+        return false;
+    }
+    // Bricks are read in view order, not file order
+    madvise(data, bytes, MADV_RANDOM);
+    return true;
+}
+
+bool VolumeCache::openBricked(const char* path, uint32_t slotCount, uint32_t framesInFlight, std::string& error)
+{
+    close();
+    if (!mapFile(path, _file, _fileBytes, error)) {
+        return false;
+    }
+    auto fail = [&](const char* reason) {
+        close();
+        error = reason;
+        return false;
+    };
+
+    if (_fileBytes < sizeof(VolumeFileHeader)) {
+        return fail("file too small for a volume header");
+    }
+    const VolumeFileHeader& h = *static_cast<const VolumeFileHeader*>(_file);
+    if (std::memcmp(h.magic, "BHVOLUM", 8) != 0) {
+        return fail("not a bricked volume (bad magic)");
+    }
+    if (h.version != kVolumeFileVersion || h.channels != 2) {
+        return fail("unsupported volume version or channel count");
+    }
+    if (h.brick_size < 4 || h.brick_size > 126 || h.dims[0] == 0 || h.dims[1] == 0 || h.dims[2] == 0) {
+        return fail("invalid volume dimensions");
+    }
+    _brickSize = h.brick_size;
+    std::memcpy(_dims, h.dims, sizeof(_dims));
+    for (int a = 0; a < 3; ++a) {
+        _brickGrid[a] = (_dims[a] + _brickSize - 1) / _brickSize;
+    }
+
+    uint64_t bricks = brickCount();
+    if (h.table_offset % alignof(VolumeBrickEntry) != 0 ||
+        h.table_offset + bricks * sizeof(VolumeBrickEntry) > _fileBytes) {
+        return fail("brick table is truncated");
+    }
+    _table = reinterpret_cast<const VolumeBrickEntry*>(static_cast<const uint8_t*>(_file) + h.table_offset);
+
+    uint64_t rawBytes = (uint64_t)paddedBrickSize() * paddedBrickSize() * paddedBrickSize() * 2 * sizeof(uint16_t);
+    for (uint64_t b = 0; b < bricks; ++b) {
+        const VolumeBrickEntry& e = _table[b];
+        if (e.max_density <= 0.0f) {
+            continue;
+        }
+        if (e.offset + e.bytes > _fileBytes || e.codec > 1 || (e.codec == 0 && e.bytes != rawBytes)) {
+            return fail("brick table entry out of range");
+        }
+    }
+
+    _raw = false;
+    setup(slotCount, framesInFlight);
+    for (uint32_t b = 0; b < bricks; ++b) {
+        _coarse[2 * b] = toHalf(_table[b].mean[0]);
+        _coarse[2 * b + 1] = toHalf(_table[b].mean[1]);
+        if (_table[b].max_density <= 0.0f) {
+            _state[b] = BrickState::Empty;
+            _pageTable[b] = kEmptyBrick;
+        }
+    }
+    return true;
+}
+
+bool VolumeCache::openRaw(const char* densityPath, const char* temperaturePath, const uint32_t dims[3],
+                          uint32_t brickSize, float defaultTemperature,
+                          uint32_t slotCount, uint32_t framesInFlight, std::string& error)
+{
+    close();
+    if (dims[0] == 0 || dims[1] == 0 || dims[2] == 0 || brickSize < 4 || brickSize > 126) {
+        error = "invalid volume dimensions";
+        return false;
+    }
+    uint64_t voxels = (uint64_t)dims[0] * dims[1] * dims[2];
+    if (!mapFile(densityPath, _file, _fileBytes, error)) {
+        return false;
+    }
+    if (_fileBytes < voxels * sizeof(float)) {
+        close();
+        error = "density file is smaller than the given dimensions";
+        return false;
+    }
+    if (temperaturePath && temperaturePath[0] != '\0') {
+        if (!mapFile(temperaturePath, _temperatureFile, _temperatureBytes, error)) {
+            close();
+            return false;
+        }
+        if (_temperatureBytes < voxels * sizeof(float)) {
+            close();
+            error = "temperature file is smaller than the given dimensions";
+            return false;
+        }
+    }
+
+    std::memcpy(_dims, dims, sizeof(_dims));
+    _brickSize = brickSize;
+    _defaultTemperature = defaultTemperature;
+    for (int a = 0; a < 3; ++a) {
+        _brickGrid[a] = (_dims[a] + _brickSize - 1) / _brickSize;
+    }
+
+    _raw = true;
+    setup(slotCount, framesInFlight);
+
+    // Coarse level from one voxel per brick: cheap, and never reads the whole grid
+    const float* density = static_cast<const float*>(_file);
+    const float* temperature = static_cast<const float*>(_temperatureFile);
+    for (uint32_t z = 0; z < _brickGrid[2]; ++z) {
+        for (uint32_t y = 0; y < _brickGrid[1]; ++y) {
+            for (uint32_t x = 0; x < _brickGrid[0]; ++x) {
+                uint32_t b = (z * _brickGrid[1] + y) * _brickGrid[0] + x;
+                uint64_t vx = std::min(x * _brickSize + _brickSize / 2, _dims[0] - 1);
+                uint64_t vy = std::min(y * _brickSize + _brickSize / 2, _dims[1] - 1);
+                uint64_t vz = std::min(z * _brickSize + _brickSize / 2, _dims[2] - 1);
+                uint64_t index = (vz * _dims[1] + vy) * _dims[0] + vx;
+                _coarse[2 * b] = toHalf(density[index]);
+                _coarse[2 * b + 1] = toHalf((temperature ? temperature[index] : _defaultTemperature) / kVolumeTemperatureUnit);
+            }
+        }
+    }
+    return true;
+}
+
+void VolumeCache::setup(uint32_t slotCount, uint32_t framesInFlight)
+{
+    uint32_t bricks = brickCount();
+    _slotCount = slotCount;
+    _framesInFlight = framesInFlight;
+    _frame = 0;
+    _state.assign(bricks, BrickState::Absent);
+    _pageTable.assign(bricks, kNotResident);
+    _coarse.assign((size_t)bricks * 2, 0);
+    _lastUsed.assign(bricks, 0);
+    _lruPos.assign(bricks, _lru.end());
+    _slotBrick.assign(slotCount, kNotResident);
+    _freeSlots.clear();
+    for (uint32_t s = 0; s < slotCount; ++s) {
+        _freeSlots.emplace_back(s, 0);
+    }
+    _stats = Stats();
+    _loads = 0;
+    _bytesRead = 0;
+    _stopping = false;
+    _open = true;
+
+    for (int i = 0; i < _workerCount; ++i) {
+        _workers.emplace_back(&VolumeCache::workerLoop, this);
+    }
+}
+
+void VolumeCache::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for (std::thread& worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+    _queue.clear();
+    _ready.clear();
+    _spare.clear();
+    _lru.clear();
+
+    if (_file) {
+        munmap(_file, _fileBytes);
+        _file = nullptr;
+        _fileBytes = 0;
+    }
+    if (_temperatureFile) {
+        munmap(_temperatureFile, _temperatureBytes);
+        _temperatureFile = nullptr;
+        _temperatureBytes = 0;
+    }
+    _table = nullptr;
+    _open = false;
+}
+
+void VolumeCache::enqueue(uint32_t brick)
+{
+    if (_state[brick] == BrickState::Absent) {
+        _state[brick] = BrickState::Queued;
+        _queue.push_back(brick);
+    }
+}
+
+void VolumeCache::processFeedback(const uint32_t* feedback, const float cameraBrick[3])
+{
+    ++_frame;
+    uint32_t bricks = brickCount();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Requests not yet started are stale; this frame's view replaces them
+    for (uint32_t brick : _queue) {
+        if (_state[brick] == BrickState::Queued) {
+            _state[brick] = BrickState::Absent;
+        }
+    }
+    _queue.clear();
+
+    std::vector<std::pair<float, uint32_t>> misses;
+    for (uint32_t b = 0; b < bricks; ++b) {
+        uint32_t value = feedback[b];
+        if (value == 0) {
+            continue;
+        }
+        _lastUsed[b] = _frame;
+        if (value == kFeedbackHit) {
+            ++_stats.hits;
+        } else {
+            ++_stats.misses;
+        }
+        if (_state[b] == BrickState::Resident) {
+            _lru.splice(_lru.begin(), _lru, _lruPos[b]);
+        } else if (_state[b] == BrickState::Empty) {
+            _pageTable[b] = kEmptyBrick;    // A decoder rejected it
+        } else if (_state[b] == BrickState::Absent) {
+            uint32_t x = b % _brickGrid[0];
+            uint32_t y = (b / _brickGrid[0]) % _brickGrid[1];
+            uint32_t z = b / (_brickGrid[0] * _brickGrid[1]);
+            float dx = x + 0.5f - cameraBrick[0];
+            float dy = y + 0.5f - cameraBrick[1];
+            float dz = z + 0.5f - cameraBrick[2];
+            misses.emplace_back(dx * dx + dy * dy + dz * dz, b);
+        }
+    }
+
+    // Nearest first: they occlude the rest
+    std::sort(misses.begin(), misses.end());
+    size_t limit = (size_t)_slotCount * 2;
+    for (const auto& miss : misses) {
+        if (_queue.size() >= limit) {
+            break;
+        }
+        enqueue(miss.second);
+    }
+
+    // Prefetch the next brick along each miss's view direction. Rays bend
+    // near the hole, so the straight camera direction is only a local guess.
+    for (const auto& miss : misses) {
+        if (_queue.size() >= limit) {
+            break;
+        }
+        uint32_t b = miss.second;
+        int32_t c[3] = { (int32_t)(b % _brickGrid[0]),
+                         (int32_t)((b / _brickGrid[0]) % _brickGrid[1]),
+                         (int32_t)(b / (_brickGrid[0] * _brickGrid[1])) };
+        float inv = 1.0f / std::max(std::sqrt(miss.first), 1e-3f);
+        bool inside = true;
+        for (int a = 0; a < 3; ++a) {
+            float d = (c[a] + 0.5f - cameraBrick[a]) * inv;
+            c[a] += (int32_t)std::lround(d);
+            inside = inside && c[a] >= 0 && c[a] < (int32_t)_brickGrid[a];
+        }
+        if (!inside) {
+            continue;
+        }
+        uint32_t next = ((uint32_t)c[2] * _brickGrid[1] + (uint32_t)c[1]) * _brickGrid[0] + (uint32_t)c[0];
+        if (_state[next] == BrickState::Absent) {
+            enqueue(next);
+            ++_stats.prefetches;
+        }
+    }
+
+    if (!_queue.empty()) {
+        _wake.notify_all();
+    }
+}
+
+uint32_t VolumeCache::commit(uint32_t maxBricks, const std::function<void(uint32_t slot, const uint16_t* voxels)>& upload)
+{
+    std::vector<Decoded> ready;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ready.swap(_ready);
+    }
+    size_t wanted = std::min<size_t>(ready.size(), maxBricks);
+
+    // Release slots for what is ready, oldest first, but never a brick the
+    // latest feedback saw in use. Released slots age for framesInFlight
+    // frames because submitted page tables may still point at them.
+    std::vector<uint32_t> evicted;
+    while (_freeSlots.size() < wanted && !_lru.empty()) {
+        uint32_t victim = _lru.back();
+        if (_lastUsed[victim] >= _frame) {
+            break;
+        }
+        _lru.pop_back();
+        _lruPos[victim] = _lru.end();
+        uint32_t slot = _pageTable[victim];
+        _pageTable[victim] = kNotResident;
+        _slotBrick[slot] = kNotResident;
+        _freeSlots.emplace_back(slot, _frame);
+        evicted.push_back(victim);
+        ++_stats.evictions;
+    }
+
+    uint32_t committed = 0;
+    std::vector<uint32_t> resident, dropped;
+    std::vector<Decoded> keep;
+    std::vector<std::vector<uint16_t>> recycled;
+    for (Decoded& d : ready) {
+        bool slotReady = !_freeSlots.empty() &&
+            (_freeSlots.front().second == 0 || _freeSlots.front().second + _framesInFlight <= _frame);
+        if (committed < maxBricks && slotReady) {
+            uint32_t slot = _freeSlots.front().first;
+            _freeSlots.pop_front();
+            upload(slot, d.voxels.data());
+            _pageTable[d.brick] = slot;
+            _slotBrick[slot] = d.brick;
+            _lru.push_front(d.brick);
+            _lruPos[d.brick] = _lru.begin();
+            resident.push_back(d.brick);
+            recycled.push_back(std::move(d.voxels));
+            ++committed;
+        } else if (_lastUsed[d.brick] + 2 * (uint64_t)_framesInFlight < _frame) {
+            // Out of view and still no room: the working set exceeds the atlas
+            ++_stats.deferred;
+            dropped.push_back(d.brick);
+            recycled.push_back(std::move(d.voxels));
+        } else {
+            keep.push_back(std::move(d));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (uint32_t victim : evicted) {
+        _state[victim] = BrickState::Absent;
+    }
+    for (uint32_t brick : resident) {
+        _state[brick] = BrickState::Resident;
+    }
+    for (uint32_t brick : dropped) {
+        _state[brick] = BrickState::Absent;
+    }
+    for (auto& voxels : recycled) {
+        _spare.push_back(std::move(voxels));
+    }
+    for (Decoded& d : keep) {
+        _ready.push_back(std::move(d));
+    }
+    return committed;
+}
+
+VolumeCache::Stats VolumeCache::stats() const
+{
+    Stats s = _stats;
+    s.loads = _loads.load(std::memory_order_relaxed);
+    s.bytesRead = _bytesRead.load(std::memory_order_relaxed);
+    s.resident = (uint32_t)_lru.size();
+    std::lock_guard<std::mutex> lock(_mutex);
+    s.queued = (uint32_t)_queue.size();
+    return s;
+}
+
+void VolumeCache::workerLoop()
+{
+    traceThreadName("Volume decoder");
+    for (;;) {
+        uint32_t brick;
+        std::vector<uint16_t> voxels;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return _stopping || (!_queue.empty() && _ready.size() < kMaxReady); });
+            if (_stopping) {
+                return;
+            }
+            brick = _queue.front();
+            _queue.pop_front();
+            _state[brick] = BrickState::Loading;
+            if (!_spare.empty()) {
+                voxels = std::move(_spare.back());
+                _spare.pop_back();
+            }
+        }
+
+        bool ok;
+        {
+            TRACE_SCOPE_ARG("volume", "decode brick", brick);
+            ok = decode(brick, voxels);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (ok) {
+                _state[brick] = BrickState::Ready;
+                _ready.push_back({ brick, std::move(voxels) });
+            } else {
+                // Corrupt payload: never retry it, the coarse level stays
+                _state[brick] = BrickState::Empty;
+            }
+        }
+    }
+}
+
+bool VolumeCache::decode(uint32_t brick, std::vector<uint16_t>& voxels)
+{
+    size_t p = paddedBrickSize();
+    voxels.resize(p * p * p * 2);
+    _loads.fetch_add(1, std::memory_order_relaxed);
+    if (_raw) {
+        return decodeRaw(brick, voxels);
+    }
+
+    const VolumeBrickEntry& e = _table[brick];
+    const uint8_t* src = static_cast<const uint8_t*>(_file) + e.offset;
+    size_t expected = voxels.size() * sizeof(uint16_t);
+    bool ok;
+    if (e.codec == 0) {
+        std::memcpy(voxels.data(), src, expected);
+        ok = true;
+    } else {
+        uLongf length = (uLongf)expected;
+        ok = uncompress(reinterpret_cast<Bytef*>(voxels.data()), &length, src, e.bytes) == Z_OK && length == expected;
+    }
+    _bytesRead.fetch_add(e.bytes, std::memory_order_relaxed);
+
+    // Drop the source pages again so datasets larger than RAM only cost
+    // page cache for bricks being decoded right now
+    size_t page = (size_t)getpagesize();
+    uintptr_t begin = ((uintptr_t)src + page - 1) / page * page;
+    uintptr_t end = ((uintptr_t)src + e.bytes) / page * page;
+    if (end > begin) {
+        madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+    }
+    return ok;
+}
+
+bool VolumeCache::decodeRaw(uint32_t brick, std::vector<uint16_t>& voxels)
+{
+    const float* density = static_cast<const float*>(_file);
+    const float* temperature = static_cast<const float*>(_temperatureFile);
+    uint32_t p = paddedBrickSize();
+    int64_t origin[3] = {
+        (int64_t)(brick % _brickGrid[0]) * _brickSize - 1,
+        (int64_t)((brick / _brickGrid[0]) % _brickGrid[1]) * _brickSize - 1,
+        (int64_t)(brick / (_brickGrid[0] * _brickGrid[1])) * _brickSize - 1,
+    };
+
+    // Gather with clamped coordinates: the apron and any partial brick
+    // replicate the boundary voxels
+    size_t out = 0;
+    for (uint32_t z = 0; z < p; ++z) {
+        uint64_t vz = clampCoord(origin[2] + z, _dims[2]);
+        for (uint32_t y = 0; y < p; ++y) {
+            uint64_t vy = clampCoord(origin[1] + y, _dims[1]);
+            uint64_t row = (vz * _dims[1] + vy) * _dims[0];
+            for (uint32_t x = 0; x < p; ++x) {
+                uint64_t index = row + clampCoord(origin[0] + x, _dims[0]);
+                voxels[out++] = toHalf(density[index]);
+                voxels[out++] = toHalf((temperature ? temperature[index] : _defaultTemperature) / kVolumeTemperatureUnit);
+            }
+        }
+    }
+    _bytesRead.fetch_add((uint64_t)p * p * p * sizeof(float) * (temperature ? 2 : 1), std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,208 @@
+/**
+ * VolumeCache.hpp
+ *
+ * Out-of-core volumetric data with a bricked LRU cache
+ *
+ * Streams density/temperature grids from external simulations (larger
+ * than RAM if need be) into a fixed-size GPU brick atlas. Sources are
+ * memory-mapped, so only the bricks actually decoded are paged in:
+ *
+ * - Bricked files (.bhvol, written by tools/brick_volume.py): bricks of
+ *   (B+2)³ half-float RG voxels with a one-voxel apron, stored raw or
+ *   zlib-compressed, plus a table with per-brick mean and max density.
+ * - Raw files: float32 grids, x fastest, one file per channel. Bricks are
+ *   gathered on demand; nothing is preprocessed.
+ *
+ * The shader marks every brick it samples in a feedback buffer (1 = hit,
+ * 2 = miss). Each frame the renderer hands that feedback back here: hits
+ * refresh the LRU order, misses are queued for the decoder threads along
+ * with the next brick towards the camera's view direction (prefetch).
+ * Decoded bricks are committed into free slots or into the least recently
+ * used slot that no frame in flight can still reference. When every slot
+ * is in active use the load is deferred rather than evicting the working
+ * set, so an oversized view degrades to the coarse level instead of
+ * thrashing. Misses always fall back to the resident coarse level (one
+ * mean value per brick), and bricks whose max density is zero are never
+ * loaded at all.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct VolumeFileHeader
+{
+    char magic[8];                  // "BHVOLUM\0"
+    uint32_t version;               // kVolumeFileVersion
+    uint32_t brick_size;            // Voxels per brick edge, apron excluded
+    uint32_t dims[3];               // Voxels per axis
+    uint32_t channels;              // Always 2 (density, temperature)
+    uint64_t table_offset;          // Byte offset of VolumeBrickEntry[bricks]
+    uint32_t reserved[4];
+};
+
+struct VolumeBrickEntry
+{
+    uint64_t offset;                // Byte offset of the payload
+    uint32_t bytes;                 // Stored payload size
+    uint32_t codec;                 // 0 = raw half floats, 1 = zlib
+    float mean[2];                  // Mean density and temperature (coarse level)
+    float max_density;              // 0 marks an empty brick
+    uint32_t reserved;
+};
+
+constexpr uint32_t kVolumeFileVersion = 1;
+
+// Temperatures are stored in kK so that they fit the half-float range
+constexpr float kVolumeTemperatureUnit = 1000.0f;
+
+class VolumeCache
+{
+public:
+    // Page table entries that are not slot indices
+    static constexpr uint32_t kNotResident = 0xFFFFFFFFu;
+    static constexpr uint32_t kEmptyBrick = 0xFFFFFFFEu;
+
+    // Feedback values written by the shader
+    static constexpr uint32_t kFeedbackHit = 1;
+    static constexpr uint32_t kFeedbackMiss = 2;
+
+    struct Stats
+    {
+        uint64_t hits = 0;          // Brick-frames sampled while resident
+        uint64_t misses = 0;        // Brick-frames sampled while absent
+        uint64_t loads = 0;         // Bricks decoded
+        uint64_t prefetches = 0;    // Bricks queued ahead of a miss
+        uint64_t evictions = 0;     // Resident bricks replaced
+        uint64_t deferred = 0;      // Decoded bricks dropped for lack of an idle slot
+        uint64_t bytesRead = 0;     // Source bytes touched by the decoders
+        uint32_t resident = 0;      // Bricks currently in the atlas
+        uint32_t queued = 0;        // Requests waiting for a decoder
+        double hitRate() const { return hits + misses ? (double)hits / (double)(hits + misses) : 0.0; }
+    };
+
+    explicit VolumeCache(int decoderThreads = 2);
+    ~VolumeCache();
+    VolumeCache(const VolumeCache&) = delete;
+    VolumeCache& operator=(const VolumeCache&) = delete;
+
+    /**
+     * Open a bricked .bhvol file
+     *
+     * @param slotCount Bricks the GPU atlas holds
+     * @param framesInFlight Frames that may still read a slot after it is unmapped
+     */
+    bool openBricked(const char* path, uint32_t slotCount, uint32_t framesInFlight, std::string& error);
+
+    /**
+     * Open raw float32 grids (x fastest)
+     *
+     * @param temperaturePath Optional second channel (nullptr or "" for a constant)
+     * @param defaultTemperature Temperature in K used without a temperature file
+     */
+    bool openRaw(const char* densityPath, const char* temperaturePath, const uint32_t dims[3],
+                 uint32_t brickSize, float defaultTemperature,
+                 uint32_t slotCount, uint32_t framesInFlight, std::string& error);
+
+    void close();
+    bool isOpen() const { return _open; }
+
+    const uint32_t* dims() const { return _dims; }
+    const uint32_t* brickGrid() const { return _brickGrid; }
+    uint32_t brickSize() const { return _brickSize; }
+    uint32_t paddedBrickSize() const { return _brickSize + 2; }
+    uint32_t brickCount() const { return _brickGrid[0] * _brickGrid[1] * _brickGrid[2]; }
+    uint32_t slotCount() const { return _slotCount; }
+
+    // Coarse level: RG half floats, one voxel per brick, x fastest
+    const std::vector<uint16_t>& coarse() const { return _coarse; }
+
+    /**
+     * Consume one frame's feedback (one value per brick)
+     *
+     * Replaces the pending request queue with this frame's misses and
+     * their prefetch neighbours, most recent first.
+     *
+     * @param cameraBrick Camera position in brick-grid coordinates
+     */
+    void processFeedback(const uint32_t* feedback, const float cameraBrick[3]);
+
+    /**
+     * Move up to maxBricks decoded bricks into atlas slots
+     *
+     * @param upload Copies (B+2)³ RG half voxels into the given slot
+     * @return Bricks committed
+     */
+    uint32_t commit(uint32_t maxBricks, const std::function<void(uint32_t slot, const uint16_t* voxels)>& upload);
+
+    // Slot per brick, or kNotResident / kEmptyBrick
+    const std::vector<uint32_t>& pageTable() const { return _pageTable; }
+
+    Stats stats() const;
+
+private:
+    enum class BrickState : uint8_t { Absent, Queued, Loading, Ready, Resident, Empty };
+
+    struct Decoded
+    {
+        uint32_t brick;
+        std::vector<uint16_t> voxels;
+    };
+
+    bool mapFile(const char* path, void*& data, size_t& bytes, std::string& error);
+    void setup(uint32_t slotCount, uint32_t framesInFlight);
+    bool decode(uint32_t brick, std::vector<uint16_t>& voxels);
+    bool decodeRaw(uint32_t brick, std::vector<uint16_t>& voxels);
+    void workerLoop();
+    void enqueue(uint32_t brick);
+
+    bool _open = false;
+    bool _raw = false;
+    uint32_t _dims[3] = {};
+    uint32_t _brickGrid[3] = {};
+    uint32_t _brickSize = 0;
+    uint32_t _slotCount = 0;
+    uint32_t _framesInFlight = 0;
+    uint64_t _frame = 0;
+    float _defaultTemperature = 0.0f;
+
+    // Mapped sources
+    void* _file = nullptr;          // .bhvol or raw density
+    size_t _fileBytes = 0;
+    void* _temperatureFile = nullptr;
+    size_t _temperatureBytes = 0;
+    const VolumeBrickEntry* _table = nullptr;
+
+    // Residency (main thread, except _state which decoders also update)
+    std::vector<BrickState> _state;
+    std::vector<uint32_t> _pageTable;
+    std::vector<uint16_t> _coarse;
+    std::vector<uint64_t> _lastUsed;               // Frame each brick was last sampled
+    std::vector<uint32_t> _slotBrick;              // Brick in each slot, kNotResident if free
+    std::deque<std::pair<uint32_t, uint64_t>> _freeSlots; // Slot and frame it was released
+    std::list<uint32_t> _lru;                      // Resident bricks, most recent first
+    std::vector<std::list<uint32_t>::iterator> _lruPos;
+
+    // Decoder threads
+    std::vector<std::thread> _workers;
+    int _workerCount;
+    mutable std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<uint32_t> _queue;
+    std::vector<Decoded> _ready;
+    std::vector<std::vector<uint16_t>> _spare;     // Recycled brick buffers
+    bool _stopping = false;
+
+    Stats _stats;
+    std::atomic<uint64_t> _loads{0};
+    std::atomic<uint64_t> _bytesRead{0};
+};
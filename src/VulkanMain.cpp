@@ -0,0 +1,211 @@
+/**
+ * VulkanMain.cpp
+ *
+ * Headless Vulkan renderer: writes frames as binary PPM files
+ *
+ *   BlackHoleVK [--size WxH] [--frames N] [--fps F] [--quality 0-3]
+ *               [--integrator 0-3] [--device any|gpu|cpu] [--validation]
+ *               [--shaders DIR] [--out PREFIX] [--trace FILE]
+ *               [--metrics-port PORT] [--metrics-file PATH]
+ *               [--metrics-interval SECONDS]
+ *
+ * Frame N is submitted before frame N-1 is read back and written, so the
+ * device renders while the host encodes. Point VK_ICD_FILENAMES at a CPU
+ * implementation (lavapipe, SwiftShader) to run without a GPU.
+ *
+ * For render farms, --metrics-port serves Prometheus metrics on
+ * 127.0.0.1:PORT/metrics and --metrics-file rewrites a snapshot in the
+ * same format every interval (see Metrics.hpp).
+ */
+
+#include "Metrics.hpp"
+#include "Trace.hpp"
+#include "VulkanRenderer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#ifndef BLACKHOLE_SPIRV_DIR
+#define BLACKHOLE_SPIRV_DIR "spirv"
+#endif
+
+namespace {
+
+const char* kUsage =
+    "Usage: BlackHoleVK [--size WxH] [--frames N] [--fps F] [--quality 0-3]\n"
+    "                   [--integrator 0-3] [--device any|gpu|cpu] [--validation]\n"
+    "                   [--shaders DIR] [--out PREFIX] [--trace FILE]\n"
+    "                   [--metrics-port PORT] [--metrics-file PATH]\n"
+    "                   [--metrics-interval SECONDS]\n";
+
+bool writePpm(const std::string& path, int width, int height, const std::vector<uint8_t>& rgba)
+{
+    TRACE_SCOPE("io", "write ppm");
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<uint8_t> rgb((size_t)width * height * 3);
+    for (size_t i = 0, n = (size_t)width * height; i < n; ++i) {
+        rgb[i * 3 + 0] = rgba[i * 4 + 0];
+        rgb[i * 3 + 1] = rgba[i * 4 + 1];
+        rgb[i * 3 + 2] = rgba[i * 4 + 2];
+    }
+    bool ok = std::fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+// Series the farm scheduler watches; rates are over the last frame
+struct RenderMetrics
+{
+    explicit RenderMetrics(MetricsRegistry& registry)
+        : frames(registry.counter("blackhole_frames_total", "Frames rendered and written")),
+          tiles(registry.counter("blackhole_tiles_total", "8x8 scene tiles traced")),
+          rays(registry.counter("blackhole_rays_total", "Camera rays traced")),
+          raySteps(registry.counter("blackhole_ray_steps_total", "Geodesic steps over all rays")),
+          framesRequested(registry.gauge("blackhole_frames_requested", "Frames this job renders")),
+          tilesPerSecond(registry.gauge("blackhole_tiles_per_second", "Scene tiles per second, last frame")),
+          raysPerSecond(registry.gauge("blackhole_rays_per_second", "Rays per second, last frame")),
+          meanSteps(registry.gauge("blackhole_mean_steps_per_ray", "Mean geodesic steps per ray, last frame")),
+          framesInFlight(registry.gauge("blackhole_frames_in_flight", "Frames submitted and not yet read back")),
+          deviceMemory(registry.gauge("blackhole_device_memory_bytes", "Vulkan device memory allocated")),
+          residentMemory(registry.gauge("blackhole_resident_memory_bytes", "Process resident set size"))
+    {
+    }
+
+    MetricCounter& frames;
+    MetricCounter& tiles;
+    MetricCounter& rays;
+    MetricCounter& raySteps;
+    MetricGauge& framesRequested;
+    MetricGauge& tilesPerSecond;
+    MetricGauge& raysPerSecond;
+    MetricGauge& meanSteps;
+    MetricGauge& framesInFlight;
+    MetricGauge& deviceMemory;
+    MetricGauge& residentMemory;
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    VulkanOptions options;
+    options.shaderDir = BLACKHOLE_SPIRV_DIR;
+    int frames = 1;
+    float fps = 30.0f;
+    std::string prefix = "frame";
+    MetricsExporterOptions metricsOptions;
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--size") == 0 && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2) {
+                std::cerr << "--size expects WxH\n" << kUsage;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+            frames = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--fps") == 0 && hasValue) {
+            fps = std::max((float)std::atof(argv[++i]), 1.0f);
+        } else if (std::strcmp(argv[i], "--quality") == 0 && hasValue) {
+            options.quality = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--integrator") == 0 && hasValue) {
+            options.integrator = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--device") == 0 && hasValue) {
+            std::string device = argv[++i];
+            if (device == "any") {
+                options.device = VulkanOptions::AnyDevice;
+            } else if (device == "gpu") {
+                options.device = VulkanOptions::GpuDevice;
+            } else if (device == "cpu") {
+                options.device = VulkanOptions::CpuDevice;
+            } else {
+                std::cerr << "--device expects any, gpu or cpu\n" << kUsage;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--validation") == 0) {
+            options.validation = true;
+        } else if (std::strcmp(argv[i], "--shaders") == 0 && hasValue) {
+            options.shaderDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--out") == 0 && hasValue) {
+            prefix = argv[++i];
+        } else if (std::strcmp(argv[i], "--metrics-port") == 0 && hasValue) {
+            metricsOptions.port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--metrics-file") == 0 && hasValue) {
+            metricsOptions.path = argv[++i];
+        } else if (std::strcmp(argv[i], "--metrics-interval") == 0 && hasValue) {
+            metricsOptions.intervalSeconds = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--trace") == 0 && hasValue) {
+            // Written at exit
+            traceStart(argv[++i]);
+        } else {
+            std::cerr << kUsage;
+            return 1;
+        }
+    }
+
+    traceThreadName("Main");
+    try {
+        // Registered before the exporter starts; it outlives the renderer
+        MetricsRegistry registry;
+        RenderMetrics metrics(registry);
+        metrics.framesRequested.set(frames);
+        metrics.residentMemory.set((double)processResidentBytes());
+        std::unique_ptr<MetricsExporter> exporter;
+        if (metricsOptions.port > 0 || !metricsOptions.path.empty()) {
+            exporter = std::make_unique<MetricsExporter>(registry, metricsOptions);
+        }
+
+        VulkanRenderer renderer(options);
+        std::cout << "Vulkan device: " << renderer.deviceName()
+                  << (renderer.asyncCompute() ? " (compute-only queue)" : "") << std::endl;
+        metrics.deviceMemory.set((double)renderer.deviceMemoryBytes());
+
+        std::vector<uint8_t> pixels;
+        VulkanFrameStats stats;
+        char path[1024];
+        auto start = std::chrono::steady_clock::now();
+        auto lastFrame = start;
+        int previous = -1;
+        for (int frame = 0; frame <= frames; ++frame) {
+            int slot = frame < frames ? renderer.submitFrame((float)frame / fps) : -1;
+            if (previous >= 0) {
+                renderer.readFrame(previous, pixels, &stats);
+                std::snprintf(path, sizeof(path), "%s_%04d.ppm", prefix.c_str(), frame - 1);
+                if (!writePpm(path, renderer.width(), renderer.height(), pixels)) {
+                    std::cerr << "Failed to write " << path << std::endl;
+                    return 1;
+                }
+
+                auto now = std::chrono::steady_clock::now();
+                double frameSeconds = std::max(std::chrono::duration<double>(now - lastFrame).count(), 1e-9);
+                lastFrame = now;
+                metrics.frames.add();
+                metrics.tiles.add(stats.tiles);
+                metrics.rays.add(stats.rays);
+                metrics.raySteps.add(stats.raySteps);
+                metrics.tilesPerSecond.set((double)stats.tiles / frameSeconds);
+                metrics.raysPerSecond.set((double)stats.rays / frameSeconds);
+                metrics.meanSteps.set((double)stats.raySteps / (double)std::max<uint64_t>(stats.rays, 1));
+                metrics.residentMemory.set((double)processResidentBytes());
+            }
+            metrics.framesInFlight.set(renderer.pendingFrames());
+            previous = slot;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%d frame(s) at %dx%d in %.2f s (%.1f ms/frame)\n", frames, renderer.width(), renderer.height(),
+                    seconds, seconds * 1000.0 / frames);
+    } catch (const std::exception& e) {
+        std::cerr << "Vulkan renderer error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,866 @@
+/**
+ * VulkanRenderer.cpp
+ *
+ * Headless Vulkan compute backend: device setup, resources, pipelines and
+ * per-frame command recording.
+ */
+
+#include "VulkanRenderer.hpp"
+#include "DiskColorMap.h"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+const char* kValidationLayer = "VK_LAYER_KHRONOS_validation";
+const int kColorMapWidth = 256;
+
+const VkDescriptorType kSampled = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+const VkDescriptorType kStorage = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+const VkDescriptorType kUniform = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+const VkDescriptorType kStorageBuffer = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+// Bindings of each kernel (see the headers of shaders/vulkan/*.comp)
+const std::vector<VkDescriptorType> kSceneBindings = { kStorage, kSampled, kUniform, kStorageBuffer };
+const std::vector<VkDescriptorType> kTwoBindings = { kSampled, kStorage };
+const std::vector<VkDescriptorType> kThreeBindings = { kSampled, kSampled, kStorage };
+
+void check(VkResult result, const char* what)
+{
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error(std::string(what) + " failed (VkResult " + std::to_string((int)result) + ")");
+    }
+}
+
+// Workgroups for an 8 x 8 kernel over size pixels
+uint32_t groups(int size)
+{
+    return (uint32_t)((size + 7) / 8);
+}
+
+void memoryBarrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                   VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+// Compute pass output feeding the next compute pass
+void computeBarrier(VkCommandBuffer cmd)
+{
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+} // namespace
+
+VulkanRenderer::VulkanRenderer(const VulkanOptions& options)
+    : _width(options.width), _height(options.height), _shaderDir(options.shaderDir)
+{
+    if (_width < 8 || _height < 8) {
+        throw std::runtime_error("Vulkan: image must be at least 8 x 8");
+    }
+
+    // Defaults of the Metal renderer (Gargantua-like disk)
+    _uniforms = {};
+    _uniforms.gravity = 2.5f;
+    _uniforms.disk_radius = 5.0f;
+    _uniforms.disk_thickness = 0.2f;
+    _uniforms.black_hole_size = 0.12f;
+    _uniforms.camera_distance = 8.0f;
+    _uniforms.disk_density_vertical = 2.0f;
+    _uniforms.disk_density_horizontal = 4.0f;
+    _uniforms.disk_density_gain = 16000.0f;
+    _uniforms.disk_density_clamp = 12.0f;
+    _uniforms.disk_noise_scale = 0.8f;
+    _uniforms.disk_noise_speed = 0.5f;
+    _uniforms.disk_noise_octaves = 5;
+    _uniforms.disk_emission_strength = 0.25f;
+    _uniforms.disk_alpha_falloff = 0.55f;
+    _uniforms.disk_inner_multiplier = 25.0f;
+    _uniforms.disk_inner_softness = 1.1f;
+    _uniforms.disk_color_mix = 0.65f;
+    _uniforms.disk_noise_lod_bias = 1.0f;
+    _uniforms.observer_position[2] = 8.0f;
+    _uniforms.sky_weight = 1.0f;
+    applyQualityPreset(options.quality);
+
+    _bloom = { options.bloomThreshold, options.bloomStrength, 1.0f, 0.0f };
+    _tone = { options.gamma, options.exposure, options.tonemapping ? 1 : 0, 0 };
+
+    try {
+        createInstance(options.validation);
+        pickDevice(options.device);
+        createDevice();
+        createResources(options);
+        createKernels(options);
+        createDescriptors();
+        uploadColorMap();
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+VulkanRenderer::~VulkanRenderer()
+{
+    release();
+}
+
+void VulkanRenderer::release()
+{
+    if (_device) {
+        vkDeviceWaitIdle(_device);
+        destroyKernel(_scene);
+        destroyKernel(_brightness);
+        destroyKernel(_downsample);
+        destroyKernel(_upsample);
+        destroyKernel(_composite);
+        destroyKernel(_tonemap);
+        for (Frame& frame : _frames) {
+            destroyBuffer(frame.uniforms);
+            destroyBuffer(frame.readback);
+            destroyBuffer(frame.tileSteps);
+            if (frame.fence) {
+                vkDestroyFence(_device, frame.fence, nullptr);
+                frame.fence = VK_NULL_HANDLE;
+            }
+        }
+        destroyImage(_colorMap);
+        destroyImage(_sceneImage);
+        destroyImage(_brightImage);
+        for (int i = 0; i < kMaxBloomLevels; ++i) {
+            destroyImage(_bloomDown[i]);
+            destroyImage(_bloomUp[i]);
+        }
+        destroyImage(_compositeImage);
+        destroyImage(_outputImage);
+        if (_linearSampler) {
+            vkDestroySampler(_device, _linearSampler, nullptr);
+        }
+        // Sets and command buffers go with their pools
+        if (_descriptorPool) {
+            vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+        }
+        if (_commandPool) {
+            vkDestroyCommandPool(_device, _commandPool, nullptr);
+        }
+        vkDestroyDevice(_device, nullptr);
+        _device = VK_NULL_HANDLE;
+    }
+    if (_instance) {
+        vkDestroyInstance(_instance, nullptr);
+        _instance = VK_NULL_HANDLE;
+    }
+}
+
+void VulkanRenderer::applyQualityPreset(int preset)
+{
+    switch (preset) {
+        case 0: // Low
+            _uniforms.max_iterations = 128;
+            _uniforms.step_size = 0.15f;
+            _uniforms.adaptive_stepping = 0;
+            break;
+        case 1: // Medium
+            _uniforms.max_iterations = 192;
+            _uniforms.step_size = 0.12f;
+            _uniforms.adaptive_stepping = 1;
+            break;
+        case 3: // Ultra
+            _uniforms.max_iterations = 512;
+            _uniforms.step_size = 0.08f;
+            _uniforms.adaptive_stepping = 1;
+            break;
+        default: // High
+            _uniforms.max_iterations = 256;
+            _uniforms.step_size = 0.1f;
+            _uniforms.adaptive_stepping = 1;
+            break;
+    }
+}
+
+void VulkanRenderer::createInstance(bool validation)
+{
+    VkApplicationInfo app = { VK_STRUCTURE_TYPE_APPLICATION_INFO };
+    app.pApplicationName = "BlackHoleGPU";
+    app.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    app.pEngineName = "BlackHoleGPU";
+    app.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    app.apiVersion = VK_API_VERSION_1_1;
+
+    std::vector<const char*> layers;
+    if (validation) {
+        uint32_t count = 0;
+        vkEnumerateInstanceLayerProperties(&count, nullptr);
+        std::vector<VkLayerProperties> available(count);
+        vkEnumerateInstanceLayerProperties(&count, available.data());
+        bool found = std::any_of(available.begin(), available.end(), [](const VkLayerProperties& layer) {
+            return std::strcmp(layer.layerName, kValidationLayer) == 0;
+        });
+        if (found) {
+            layers.push_back(kValidationLayer);
+        } else {
+            std::cerr << "Vulkan: " << kValidationLayer << " not installed, continuing without validation" << std::endl;
+        }
+    }
+
+    VkInstanceCreateInfo info = { VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO };
+    info.pApplicationInfo = &app;
+    info.enabledLayerCount = (uint32_t)layers.size();
+    info.ppEnabledLayerNames = layers.data();
+    check(vkCreateInstance(&info, nullptr, &_instance), "vkCreateInstance");
+}
+
+void VulkanRenderer::pickDevice(VulkanOptions::DeviceType type)
+{
+    uint32_t count = 0;
+    check(vkEnumeratePhysicalDevices(_instance, &count, nullptr), "vkEnumeratePhysicalDevices");
+    std::vector<VkPhysicalDevice> devices(count);
+    check(vkEnumeratePhysicalDevices(_instance, &count, devices.data()), "vkEnumeratePhysicalDevices");
+
+    // Higher is better; 0 excludes the device
+    auto rank = [type](VkPhysicalDeviceType deviceType) {
+        switch (type) {
+            case VulkanOptions::CpuDevice:
+                return deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU ? 1 : 0;
+            case VulkanOptions::GpuDevice:
+                return deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ? 3
+                     : deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ? 2
+                     : deviceType == VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU ? 1 : 0;
+            default:
+                return deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ? 4
+                     : deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ? 3
+                     : deviceType == VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU ? 2 : 1;
+        }
+    };
+
+    int best = 0;
+    for (VkPhysicalDevice device : devices) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_1) {
+            continue;
+        }
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, families.data());
+        bool compute = std::any_of(families.begin(), families.end(), [](const VkQueueFamilyProperties& family) {
+            return (family.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+        });
+        int score = compute ? rank(properties.deviceType) : 0;
+        if (score > best) {
+            best = score;
+            _physicalDevice = device;
+            _deviceName = properties.deviceName;
+        }
+    }
+    if (!_physicalDevice) {
+        throw std::runtime_error(type == VulkanOptions::CpuDevice
+            ? "Vulkan: no CPU device (install lavapipe or SwiftShader, or point VK_ICD_FILENAMES at one)"
+            : "Vulkan: no device with compute support");
+    }
+    vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &_memoryProperties);
+
+    // A compute-only family runs beside graphics work (async compute)
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &familyCount, families.data());
+    int dedicated = -1;
+    int any = -1;
+    for (uint32_t i = 0; i < familyCount; ++i) {
+        if (!(families[i].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+            continue;
+        }
+        if (!(families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && dedicated < 0) {
+            dedicated = (int)i;
+        }
+        if (any < 0) {
+            any = (int)i;
+        }
+    }
+    _asyncCompute = dedicated >= 0;
+    _queueFamily = (uint32_t)(_asyncCompute ? dedicated : any);
+}
+
+void VulkanRenderer::createDevice()
+{
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queueInfo = { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
+    queueInfo.queueFamilyIndex = _queueFamily;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &priority;
+
+    VkDeviceCreateInfo info = { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
+    info.queueCreateInfoCount = 1;
+    info.pQueueCreateInfos = &queueInfo;
+    check(vkCreateDevice(_physicalDevice, &info, nullptr, &_device), "vkCreateDevice");
+    vkGetDeviceQueue(_device, _queueFamily, 0, &_queue);
+
+    VkCommandPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = _queueFamily;
+    check(vkCreateCommandPool(_device, &poolInfo, nullptr, &_commandPool), "vkCreateCommandPool");
+}
+
+uint32_t VulkanRenderer::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; ++i) {
+        if ((typeBits & (1u << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    return UINT32_MAX;
+}
+
+VulkanRenderer::Image VulkanRenderer::createImage(int width, int height, VkFormat format, VkImageUsageFlags usage)
+{
+    Image image;
+    image.width = width;
+    image.height = height;
+
+    // A failed step releases what the earlier steps created
+    try {
+        VkImageCreateInfo info = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+        info.imageType = VK_IMAGE_TYPE_2D;
+        info.format = format;
+        info.extent = { (uint32_t)width, (uint32_t)height, 1 };
+        info.mipLevels = 1;
+        info.arrayLayers = 1;
+        info.samples = VK_SAMPLE_COUNT_1_BIT;
+        info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        info.usage = usage;
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        check(vkCreateImage(_device, &info, nullptr, &image.image), "vkCreateImage");
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(_device, image.image, &requirements);
+        VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (allocInfo.memoryTypeIndex == UINT32_MAX) {
+            allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, 0);
+        }
+        check(vkAllocateMemory(_device, &allocInfo, nullptr, &image.memory), "vkAllocateMemory (image)");
+        image.size = requirements.size;
+        _deviceMemoryBytes += image.size;
+        check(vkBindImageMemory(_device, image.image, image.memory, 0), "vkBindImageMemory");
+
+        VkImageViewCreateInfo viewInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+        viewInfo.image = image.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        check(vkCreateImageView(_device, &viewInfo, nullptr, &image.view), "vkCreateImageView");
+    } catch (...) {
+        destroyImage(image);
+        throw;
+    }
+    return image;
+}
+
+VulkanRenderer::Buffer VulkanRenderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+    Buffer buffer;
+    try {
+        VkBufferCreateInfo info = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+        info.size = size;
+        info.usage = usage;
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        check(vkCreateBuffer(_device, &info, nullptr, &buffer.buffer), "vkCreateBuffer");
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(_device, buffer.buffer, &requirements);
+        VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+        if (allocInfo.memoryTypeIndex == UINT32_MAX) {
+            // Cached host memory is a preference, not a requirement
+            allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits,
+                                                       properties & ~VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        }
+        if (allocInfo.memoryTypeIndex == UINT32_MAX) {
+            throw std::runtime_error("Vulkan: no suitable memory type for a buffer");
+        }
+        check(vkAllocateMemory(_device, &allocInfo, nullptr, &buffer.memory), "vkAllocateMemory (buffer)");
+        buffer.size = requirements.size;
+        _deviceMemoryBytes += buffer.size;
+        check(vkBindBufferMemory(_device, buffer.buffer, buffer.memory, 0), "vkBindBufferMemory");
+        if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            check(vkMapMemory(_device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.mapped), "vkMapMemory");
+        }
+    } catch (...) {
+        destroyBuffer(buffer);
+        throw;
+    }
+    return buffer;
+}
+
+void VulkanRenderer::createResources(const VulkanOptions& options)
+{
+    const VkImageUsageFlags hdrUsage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    const VkFormat hdrFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+    _colorMap = createImage(kColorMapWidth, 1, VK_FORMAT_R8G8B8A8_UNORM,
+                            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+    _sceneImage = createImage(_width, _height, hdrFormat, hdrUsage);
+    _brightImage = createImage(_width, _height, hdrFormat, hdrUsage);
+    _compositeImage = createImage(_width, _height, hdrFormat, hdrUsage);
+    _outputImage = createImage(_width, _height, VK_FORMAT_R8G8B8A8_UNORM,
+                               VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+
+    // Bloom pyramid as in Renderer::createPostProcessingTextures
+    int requested = std::max(1, std::min(options.bloomLevels, kMaxBloomLevels));
+    _bloomLevels = 0;
+    for (int i = 0; i < requested; ++i) {
+        int mipWidth = _width >> (i + 1);
+        int mipHeight = _height >> (i + 1);
+        if (mipWidth < 2 || mipHeight < 2) {
+            break;
+        }
+        _bloomDown[i] = createImage(mipWidth, mipHeight, hdrFormat, hdrUsage);
+        _bloomUp[i] = createImage(_width >> i, _height >> i, hdrFormat, hdrUsage);
+        _bloomLevels++;
+    }
+
+    VkSamplerCreateInfo samplerInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 0.0f;
+    check(vkCreateSampler(_device, &samplerInfo, nullptr, &_linearSampler), "vkCreateSampler");
+
+    // Per-frame ring: uniforms written by the host, pixels read by the host
+    VkCommandBuffer commands[kFramesInFlight];
+    VkCommandBufferAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+    allocInfo.commandPool = _commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = kFramesInFlight;
+    check(vkAllocateCommandBuffers(_device, &allocInfo, commands), "vkAllocateCommandBuffers");
+    for (int i = 0; i < kFramesInFlight; ++i) {
+        Frame& frame = _frames[i];
+        frame.commands = commands[i];
+        frame.uniforms = createBuffer(sizeof(VulkanSceneUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        frame.readback = createBuffer((VkDeviceSize)_width * _height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                      VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        frame.tileSteps = createBuffer((VkDeviceSize)groups(_width) * groups(_height) * sizeof(uint32_t),
+                                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                       VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        VkFenceCreateInfo fenceInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        check(vkCreateFence(_device, &fenceInfo, nullptr, &frame.fence), "vkCreateFence");
+    }
+}
+
+std::vector<uint32_t> VulkanRenderer::loadSpirv(const char* name) const
+{
+    std::string path = _shaderDir + "/" + name + ".spv";
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Vulkan: cannot open " + path);
+    }
+    std::streamsize size = file.tellg();
+    if (size <= 0 || size % 4 != 0) {
+        throw std::runtime_error("Vulkan: " + path + " is not SPIR-V");
+    }
+    std::vector<uint32_t> code((size_t)size / 4);
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), size);
+    return code;
+}
+
+VulkanRenderer::Kernel VulkanRenderer::createKernel(const char* name, const std::vector<VkDescriptorType>& bindings,
+                                                    uint32_t pushConstantSize, const VkSpecializationInfo* specialization)
+{
+    Kernel kernel;
+    // A missing or rejected shader releases the layouts already created
+    try {
+        std::vector<VkDescriptorSetLayoutBinding> layoutBindings(bindings.size());
+        for (size_t i = 0; i < bindings.size(); ++i) {
+            layoutBindings[i] = {};
+            layoutBindings[i].binding = (uint32_t)i;
+            layoutBindings[i].descriptorType = bindings[i];
+            layoutBindings[i].descriptorCount = 1;
+            layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        VkDescriptorSetLayoutCreateInfo setInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+        setInfo.bindingCount = (uint32_t)layoutBindings.size();
+        setInfo.pBindings = layoutBindings.data();
+        check(vkCreateDescriptorSetLayout(_device, &setInfo, nullptr, &kernel.setLayout),
+              "vkCreateDescriptorSetLayout");
+
+        VkPushConstantRange range = { VK_SHADER_STAGE_COMPUTE_BIT, 0, pushConstantSize };
+        VkPipelineLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+        layoutInfo.setLayoutCount = 1;
+        layoutInfo.pSetLayouts = &kernel.setLayout;
+        layoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+        layoutInfo.pPushConstantRanges = pushConstantSize > 0 ? &range : nullptr;
+        check(vkCreatePipelineLayout(_device, &layoutInfo, nullptr, &kernel.layout), "vkCreatePipelineLayout");
+
+        std::vector<uint32_t> code = loadSpirv(name);
+        VkShaderModuleCreateInfo moduleInfo = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+        moduleInfo.codeSize = code.size() * sizeof(uint32_t);
+        moduleInfo.pCode = code.data();
+        VkShaderModule module = VK_NULL_HANDLE;
+        check(vkCreateShaderModule(_device, &moduleInfo, nullptr, &module), "vkCreateShaderModule");
+
+        VkComputePipelineCreateInfo pipelineInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = module;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.stage.pSpecializationInfo = specialization;
+        pipelineInfo.layout = kernel.layout;
+        VkResult result = vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
+                                                   &kernel.pipeline);
+        vkDestroyShaderModule(_device, module, nullptr);
+        check(result, name);
+    } catch (...) {
+        destroyKernel(kernel);
+        throw;
+    }
+    return kernel;
+}
+
+void VulkanRenderer::createKernels(const VulkanOptions& options)
+{
+    // The integrator is a specialization constant, like the Metal function constant
+    int32_t method = std::clamp(options.integrator, 0, GEODESIC_INTEGRATOR_COUNT - 1);
+    VkSpecializationMapEntry entry = { 0, 0, sizeof(int32_t) };
+    VkSpecializationInfo specialization = { 1, &entry, sizeof(method), &method };
+
+    _scene = createKernel("scene", kSceneBindings, 0, &specialization);
+    _brightness = createKernel("bloom_brightness", kTwoBindings, sizeof(VulkanBloomParams), nullptr);
+    _downsample = createKernel("bloom_downsample", kTwoBindings, 0, nullptr);
+    _upsample = createKernel("bloom_upsample", kThreeBindings, 0, nullptr);
+    _composite = createKernel("bloom_composite", kThreeBindings, sizeof(VulkanBloomParams), nullptr);
+    _tonemap = createKernel("tonemapping", kTwoBindings, sizeof(VulkanToneParams), nullptr);
+}
+
+VkDescriptorSet VulkanRenderer::allocateSet(VkDescriptorSetLayout layout)
+{
+    VkDescriptorSetAllocateInfo info = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    info.descriptorPool = _descriptorPool;
+    info.descriptorSetCount = 1;
+    info.pSetLayouts = &layout;
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    check(vkAllocateDescriptorSets(_device, &info, &set), "vkAllocateDescriptorSets");
+    return set;
+}
+
+void VulkanRenderer::writeSet(VkDescriptorSet set, const std::vector<VkImageView>& views,
+                              const std::vector<VkDescriptorType>& types, const Buffer* uniformBuffer,
+                              const Buffer* storageBuffer)
+{
+    // Every image stays in GENERAL, so sampled and storage views share a layout
+    std::vector<VkDescriptorImageInfo> imageInfos(types.size());
+    std::vector<VkDescriptorBufferInfo> bufferInfos(types.size());
+    std::vector<VkWriteDescriptorSet> writes(types.size());
+    for (size_t i = 0; i < types.size(); ++i) {
+        VkWriteDescriptorSet& write = writes[i];
+        write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+        write.dstSet = set;
+        write.dstBinding = (uint32_t)i;
+        write.descriptorCount = 1;
+        write.descriptorType = types[i];
+        if (types[i] == kUniform) {
+            bufferInfos[i] = { uniformBuffer->buffer, 0, sizeof(VulkanSceneUniforms) };
+            write.pBufferInfo = &bufferInfos[i];
+        } else if (types[i] == kStorageBuffer) {
+            bufferInfos[i] = { storageBuffer->buffer, 0, VK_WHOLE_SIZE };
+            write.pBufferInfo = &bufferInfos[i];
+        } else {
+            imageInfos[i].sampler = types[i] == kSampled ? _linearSampler : VK_NULL_HANDLE;
+            imageInfos[i].imageView = views[i];
+            imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            write.pImageInfo = &imageInfos[i];
+        }
+    }
+    vkUpdateDescriptorSets(_device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+}
+
+void VulkanRenderer::createDescriptors()
+{
+    uint32_t levels = (uint32_t)_bloomLevels;
+    uint32_t sets = kFramesInFlight + 3 + 2 * levels;
+    VkDescriptorPoolSize sizes[] = {
+        { kSampled, kFramesInFlight + 1 + levels + 2 * levels + 2 + 1 },
+        { kStorage, kFramesInFlight + 1 + levels + levels + 1 + 1 },
+        { kUniform, kFramesInFlight },
+        { kStorageBuffer, kFramesInFlight },
+    };
+    VkDescriptorPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    poolInfo.maxSets = sets;
+    poolInfo.poolSizeCount = 4;
+    poolInfo.pPoolSizes = sizes;
+    check(vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_descriptorPool), "vkCreateDescriptorPool");
+
+    for (Frame& frame : _frames) {
+        frame.sceneSet = allocateSet(_scene.setLayout);
+        writeSet(frame.sceneSet, { _sceneImage.view, _colorMap.view, VK_NULL_HANDLE, VK_NULL_HANDLE }, kSceneBindings,
+                 &frame.uniforms, &frame.tileSteps);
+    }
+
+    _brightnessSet = allocateSet(_brightness.setLayout);
+    writeSet(_brightnessSet, { _sceneImage.view, _brightImage.view }, kTwoBindings, nullptr);
+
+    for (int i = 0; i < _bloomLevels; ++i) {
+        VkImageView larger = i == 0 ? _brightImage.view : _bloomDown[i - 1].view;
+        _downsampleSets[i] = allocateSet(_downsample.setLayout);
+        writeSet(_downsampleSets[i], { larger, _bloomDown[i].view }, kTwoBindings, nullptr);
+
+        // Level i adds the next smaller result (the smallest downsample at the bottom)
+        VkImageView smaller = i == _bloomLevels - 1 ? _bloomDown[i].view : _bloomUp[i + 1].view;
+        _upsampleSets[i] = allocateSet(_upsample.setLayout);
+        writeSet(_upsampleSets[i], { smaller, _bloomDown[i].view, _bloomUp[i].view }, kThreeBindings, nullptr);
+    }
+
+    VkImageView bloomTop = _bloomLevels > 0 ? _bloomUp[0].view : _brightImage.view;
+    _compositeSet = allocateSet(_composite.setLayout);
+    writeSet(_compositeSet, { _sceneImage.view, bloomTop, _compositeImage.view }, kThreeBindings, nullptr);
+
+    _tonemapSet = allocateSet(_tonemap.setLayout);
+    writeSet(_tonemapSet, { _compositeImage.view, _outputImage.view }, kTwoBindings, nullptr);
+}
+
+void VulkanRenderer::uploadColorMap()
+{
+    Buffer staging = createBuffer(kColorMapWidth * 4, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    try {
+        fillDiskColorMap(static_cast<uint8_t*>(staging.mapped), kColorMapWidth);
+
+        VkCommandBuffer cmd = _frames[0].commands;
+        VkCommandBufferBeginInfo begin = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+        begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        check(vkBeginCommandBuffer(cmd, &begin), "vkBeginCommandBuffer");
+
+        // Every image moves to GENERAL once; the colour map after its copy
+        std::vector<VkImageMemoryBarrier> barriers;
+        auto toLayout = [&](const Image& image, VkImageLayout layout, VkAccessFlags access) {
+            if (!image.image) {
+                return;
+            }
+            VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+            barrier.dstAccessMask = access;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = layout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image.image;
+            barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+            barriers.push_back(barrier);
+        };
+        toLayout(_colorMap, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT);
+        const VkAccessFlags shaderAccess = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        toLayout(_sceneImage, VK_IMAGE_LAYOUT_GENERAL, shaderAccess);
+        toLayout(_brightImage, VK_IMAGE_LAYOUT_GENERAL, shaderAccess);
+        toLayout(_compositeImage, VK_IMAGE_LAYOUT_GENERAL, shaderAccess);
+        toLayout(_outputImage, VK_IMAGE_LAYOUT_GENERAL, shaderAccess);
+        for (int i = 0; i < _bloomLevels; ++i) {
+            toLayout(_bloomDown[i], VK_IMAGE_LAYOUT_GENERAL, shaderAccess);
+            toLayout(_bloomUp[i], VK_IMAGE_LAYOUT_GENERAL, shaderAccess);
+        }
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+
+        VkBufferImageCopy region = {};
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageExtent = { (uint32_t)kColorMapWidth, 1, 1 };
+        vkCmdCopyBufferToImage(cmd, staging.buffer, _colorMap.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        VkImageMemoryBarrier ready = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+        ready.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        ready.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        ready.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        ready.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        ready.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        ready.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        ready.image = _colorMap.image;
+        ready.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &ready);
+        check(vkEndCommandBuffer(cmd), "vkEndCommandBuffer");
+
+        VkSubmitInfo submit = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+        submit.commandBufferCount = 1;
+        submit.pCommandBuffers = &cmd;
+        VkResult result = vkQueueSubmit(_queue, 1, &submit, VK_NULL_HANDLE);
+        if (result == VK_SUCCESS) {
+            result = vkQueueWaitIdle(_queue);
+        }
+        check(result, "Vulkan colour map upload");
+    } catch (...) {
+        destroyBuffer(staging);
+        throw;
+    }
+    destroyBuffer(staging);
+}
+
+void VulkanRenderer::recordFrame(Frame& frame)
+{
+    VkCommandBuffer cmd = frame.commands;
+    VkCommandBufferBeginInfo begin = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    check(vkBeginCommandBuffer(cmd, &begin), "vkBeginCommandBuffer");
+
+    // The images are shared by both slots: wait for the previous frame's
+    // passes and readback copy on this queue before overwriting them
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                  VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    auto dispatch = [&](const Kernel& kernel, VkDescriptorSet set, const void* push, uint32_t pushSize, int width, int height) {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, kernel.pipeline);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, kernel.layout, 0, 1, &set, 0, nullptr);
+        if (pushSize > 0) {
+            vkCmdPushConstants(cmd, kernel.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, pushSize, push);
+        }
+        vkCmdDispatch(cmd, groups(width), groups(height), 1);
+        computeBarrier(cmd);
+    };
+
+    // 1) Scene
+    dispatch(_scene, frame.sceneSet, nullptr, 0, _width, _height);
+
+    // 2) Bloom: bright pass, downsample pyramid, upsample and combine, composite
+    dispatch(_brightness, _brightnessSet, &_bloom, sizeof(_bloom), _width, _height);
+    for (int i = 0; i < _bloomLevels; ++i) {
+        dispatch(_downsample, _downsampleSets[i], nullptr, 0, _bloomDown[i].width, _bloomDown[i].height);
+    }
+    for (int i = _bloomLevels - 1; i >= 0; --i) {
+        dispatch(_upsample, _upsampleSets[i], nullptr, 0, _bloomUp[i].width, _bloomUp[i].height);
+    }
+    dispatch(_composite, _compositeSet, &_bloom, sizeof(_bloom), _width, _height);
+
+    // 3) Tone mapping into the 8-bit output
+    dispatch(_tonemap, _tonemapSet, &_tone, sizeof(_tone), _width, _height);
+
+    // 4) Readback into this slot's host buffer
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    VkBufferImageCopy region = {};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { (uint32_t)_width, (uint32_t)_height, 1 };
+    vkCmdCopyImageToBuffer(cmd, _outputImage.image, VK_IMAGE_LAYOUT_GENERAL, frame.readback.buffer, 1, &region);
+    // Pixels and the scene pass's step counts
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                  VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+
+    check(vkEndCommandBuffer(cmd), "vkEndCommandBuffer");
+}
+
+int VulkanRenderer::submitFrame(float time)
+{
+    TRACE_SCOPE("vulkan", "submit frame");
+    int slot = (int)(_frameIndex++ % kFramesInFlight);
+    Frame& frame = _frames[slot];
+    check(vkWaitForFences(_device, 1, &frame.fence, VK_TRUE, UINT64_MAX), "vkWaitForFences");
+    check(vkResetFences(_device, 1, &frame.fence), "vkResetFences");
+
+    _uniforms.resolution[0] = (float)_width;
+    _uniforms.resolution[1] = (float)_height;
+    _uniforms.time = time;
+    std::memcpy(frame.uniforms.mapped, &_uniforms, sizeof(_uniforms));
+
+    check(vkResetCommandBuffer(frame.commands, 0), "vkResetCommandBuffer");
+    recordFrame(frame);
+
+    VkSubmitInfo submit = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &frame.commands;
+    check(vkQueueSubmit(_queue, 1, &submit, frame.fence), "vkQueueSubmit");
+    frame.pending = true;
+    return slot;
+}
+
+void VulkanRenderer::readFrame(int slot, std::vector<uint8_t>& rgba, VulkanFrameStats* stats)
+{
+    TRACE_SCOPE_ARG("vulkan", "wait and read back", slot);
+    Frame& frame = _frames[slot];
+    if (!frame.pending) {
+        throw std::runtime_error("Vulkan: no frame pending in slot " + std::to_string(slot));
+    }
+    check(vkWaitForFences(_device, 1, &frame.fence, VK_TRUE, UINT64_MAX), "vkWaitForFences");
+    rgba.resize((size_t)_width * _height * 4);
+    std::memcpy(rgba.data(), frame.readback.mapped, rgba.size());
+    if (stats) {
+        const uint32_t* tileSteps = static_cast<const uint32_t*>(frame.tileSteps.mapped);
+        stats->rays = (uint64_t)_width * _height;
+        stats->tiles = (uint64_t)groups(_width) * groups(_height);
+        stats->raySteps = 0;
+        for (uint64_t i = 0; i < stats->tiles; ++i) {
+            stats->raySteps += tileSteps[i];
+        }
+    }
+    frame.pending = false;
+}
+
+int VulkanRenderer::pendingFrames() const
+{
+    int pending = 0;
+    for (const Frame& frame : _frames) {
+        pending += frame.pending ? 1 : 0;
+    }
+    return pending;
+}
+
+void VulkanRenderer::destroyImage(Image& image)
+{
+    if (image.view) {
+        vkDestroyImageView(_device, image.view, nullptr);
+    }
+    if (image.image) {
+        vkDestroyImage(_device, image.image, nullptr);
+    }
+    if (image.memory) {
+        vkFreeMemory(_device, image.memory, nullptr);
+        _deviceMemoryBytes -= image.size;
+    }
+    image = Image();
+}
+
+void VulkanRenderer::destroyBuffer(Buffer& buffer)
+{
+    if (buffer.buffer) {
+        vkDestroyBuffer(_device, buffer.buffer, nullptr);
+    }
+    if (buffer.memory) {
+        // Freeing implicitly unmaps
+        vkFreeMemory(_device, buffer.memory, nullptr);
+        _deviceMemoryBytes -= buffer.size;
+    }
+    buffer = Buffer();
+}
+
+void VulkanRenderer::destroyKernel(Kernel& kernel)
+{
+    if (kernel.pipeline) {
+        vkDestroyPipeline(_device, kernel.pipeline, nullptr);
+    }
+    if (kernel.layout) {
+        vkDestroyPipelineLayout(_device, kernel.layout, nullptr);
+    }
+    if (kernel.setLayout) {
+        vkDestroyDescriptorSetLayout(_device, kernel.setLayout, nullptr);
+    }
+    kernel = Kernel();
+}
@@ -0,0 +1,211 @@
+/**
+ * VulkanRenderer.hpp
+ *
+ * Headless Vulkan compute backend
+ *
+ * Renders the black hole on hosts without Metal: the scene kernel (Standard
+ * tier of computeShader), the bloom chain and tone mapping run as SPIR-V
+ * compute pipelines (shaders/vulkan), and every frame is read back as
+ * 8-bit RGBA. No window or swapchain is involved, so any Vulkan 1.1
+ * implementation works, including CPU ones (lavapipe, SwiftShader).
+ *
+ * Frames are double buffered: each slot owns a command buffer, fence,
+ * uniform buffer and readback buffer, so the host fills one slot's
+ * uniforms and consumes the previous frame's pixels while the device works
+ * on the other. Work goes to a compute-only queue family when the device
+ * has one (async compute), otherwise to any family with compute.
+ */
+
+#pragma once
+#include "Geodesic.h"
+#include "VulkanTypes.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct VulkanOptions
+{
+    enum DeviceType { AnyDevice, GpuDevice, CpuDevice };
+
+    int width = 1280;
+    int height = 720;
+    DeviceType device = AnyDevice;  // CpuDevice selects lavapipe/SwiftShader style devices
+    int quality = 2;                // 0=Low, 1=Medium, 2=High, 3=Ultra (as Renderer)
+    int integrator = GEODESIC_RK4;  // Geodesic.h method, baked into the scene pipeline
+    int bloomLevels = 3;
+    float bloomThreshold = 1.2f;
+    float bloomStrength = 0.08f;
+    float gamma = 2.2f;
+    float exposure = 1.0f;
+    bool tonemapping = true;
+    bool validation = false;        // Enable VK_LAYER_KHRONOS_validation when installed
+    std::string shaderDir;          // Directory holding the .spv files
+};
+
+// Work done by one frame's scene pass (read back with its pixels)
+struct VulkanFrameStats
+{
+    uint64_t rays = 0;              // One per pixel
+    uint64_t tiles = 0;             // 8 x 8 workgroups
+    uint64_t raySteps = 0;          // Geodesic steps summed over all rays
+};
+
+class VulkanRenderer
+{
+public:
+    static constexpr int kFramesInFlight = 2;
+    static constexpr int kMaxBloomLevels = 8;
+
+    /**
+     * Create the device, resources and pipelines
+     *
+     * @throws std::runtime_error when no suitable device exists or a
+     *         Vulkan call or shader load fails
+     */
+    explicit VulkanRenderer(const VulkanOptions& options);
+    ~VulkanRenderer();
+
+    VulkanRenderer(const VulkanRenderer&) = delete;
+    VulkanRenderer& operator=(const VulkanRenderer&) = delete;
+
+    // Scene parameters used by the next submitFrame()
+    VulkanSceneUniforms& uniforms() { return _uniforms; }
+
+    // Iterations, step size and adaptive stepping as Renderer::applyQualityPreset
+    void applyQualityPreset(int preset);
+
+    /**
+     * Record and submit one frame at the given time
+     *
+     * Waits for the slot's previous frame to finish on the device.
+     *
+     * @return Slot to pass to readFrame()
+     */
+    int submitFrame(float time);
+
+    /**
+     * Wait for a submitted frame and copy its pixels
+     *
+     * @param[out] rgba width × height × 4 bytes, top row first
+     * @param[out] stats Scene pass counts when not null
+     */
+    void readFrame(int slot, std::vector<uint8_t>& rgba, VulkanFrameStats* stats = nullptr);
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+    const std::string& deviceName() const { return _deviceName; }
+    bool asyncCompute() const { return _asyncCompute; }
+
+    // Device memory held by images and buffers
+    uint64_t deviceMemoryBytes() const { return _deviceMemoryBytes; }
+
+    // Frames submitted and not yet read back (0 to kFramesInFlight)
+    int pendingFrames() const;
+
+private:
+    struct Image
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        int width = 0;
+        int height = 0;
+        VkDeviceSize size = 0;      // Bytes allocated
+    };
+
+    struct Buffer
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;     // Persistently mapped (host-visible buffers only)
+        VkDeviceSize size = 0;      // Bytes allocated
+    };
+
+    // One compute kernel: its set layout, pipeline layout and pipeline
+    struct Kernel
+    {
+        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+    };
+
+    struct Frame
+    {
+        VkCommandBuffer commands = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkDescriptorSet sceneSet = VK_NULL_HANDLE;
+        Buffer uniforms;            // VulkanSceneUniforms for this frame
+        Buffer readback;            // Tone-mapped RGBA8 pixels
+        Buffer tileSteps;           // Scene march steps per workgroup
+        bool pending = false;       // Submitted and not yet read back
+    };
+
+    void createInstance(bool validation);
+    void pickDevice(VulkanOptions::DeviceType type);
+    void createDevice();
+    void createResources(const VulkanOptions& options);
+    void createKernels(const VulkanOptions& options);
+    void createDescriptors();
+    void uploadColorMap();
+    void release();
+
+    Image createImage(int width, int height, VkFormat format, VkImageUsageFlags usage);
+    Buffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+    uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+    Kernel createKernel(const char* name, const std::vector<VkDescriptorType>& bindings,
+                        uint32_t pushConstantSize, const VkSpecializationInfo* specialization);
+    std::vector<uint32_t> loadSpirv(const char* name) const;
+    VkDescriptorSet allocateSet(VkDescriptorSetLayout layout);
+    void writeSet(VkDescriptorSet set, const std::vector<VkImageView>& views, const std::vector<VkDescriptorType>& types,
+                  const Buffer* uniformBuffer, const Buffer* storageBuffer = nullptr);
+    void destroyImage(Image& image);
+    void destroyBuffer(Buffer& buffer);
+    void destroyKernel(Kernel& kernel);
+    void recordFrame(Frame& frame);
+
+    int _width;
+    int _height;
+    VulkanSceneUniforms _uniforms;
+    VulkanBloomParams _bloom;
+    VulkanToneParams _tone;
+    std::string _shaderDir;
+    std::string _deviceName;
+    bool _asyncCompute = false;
+    uint64_t _deviceMemoryBytes = 0;
+
+    VkInstance _instance = VK_NULL_HANDLE;
+    VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties _memoryProperties = {};
+    uint32_t _queueFamily = 0;
+    VkDevice _device = VK_NULL_HANDLE;
+    VkQueue _queue = VK_NULL_HANDLE;
+    VkCommandPool _commandPool = VK_NULL_HANDLE;
+    VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
+    VkSampler _linearSampler = VK_NULL_HANDLE;
+
+    Image _colorMap;                // Disk colour map, 256 x 1 RGBA8
+    Image _sceneImage;              // HDR scene (rgba16f)
+    Image _brightImage;             // Bright pass
+    Image _bloomDown[kMaxBloomLevels];  // width >> (i + 1)
+    Image _bloomUp[kMaxBloomLevels];    // width >> i
+    Image _compositeImage;          // Scene + bloom
+    Image _outputImage;             // Tone-mapped RGBA8
+    int _bloomLevels = 0;
+
+    Kernel _scene;
+    Kernel _brightness;
+    Kernel _downsample;
+    Kernel _upsample;
+    Kernel _composite;
+    Kernel _tonemap;
+
+    VkDescriptorSet _brightnessSet = VK_NULL_HANDLE;
+    VkDescriptorSet _downsampleSets[kMaxBloomLevels] = {};
+    VkDescriptorSet _upsampleSets[kMaxBloomLevels] = {};
+    VkDescriptorSet _compositeSet = VK_NULL_HANDLE;
+    VkDescriptorSet _tonemapSet = VK_NULL_HANDLE;
+
+    Frame _frames[kFramesInFlight];
+    uint64_t _frameIndex = 0;
+};
@@ -0,0 +1,74 @@
+/**
+ * VulkanTypes.h
+ *
+ * Data shared between the Vulkan backend and its GLSL kernels
+ *
+ * Uniforms (ShaderTypes.h) holds bools and simd vectors, and its layout
+ * only matches Metal. The Vulkan scene kernel reads the subset it needs
+ * from a std140 block instead, packed from the same settings on the host.
+ * shaders/vulkan/common.glsl mirrors these structs; keep both in sync.
+ */
+
+#ifndef VulkanTypes_h
+#define VulkanTypes_h
+
+#include <cstdint>
+
+// Scene parameters, std140 (one uniform buffer per frame in flight)
+struct VulkanSceneUniforms
+{
+    float resolution[2];            // Image width and height in pixels
+    float time;                     // Animation time
+    float gravity;                  // Gravitational field strength multiplier
+
+    float disk_radius;              // Accretion disk outer radius
+    float disk_thickness;           // Half-height of the disk slab
+    float black_hole_size;          // Schwarzschild radius (inner edge scale)
+    float camera_distance;          // Observer distance when observer_position is unset
+
+    float disk_density_vertical;
+    float disk_density_horizontal;
+    float disk_density_gain;
+    float disk_density_clamp;
+
+    float disk_noise_scale;
+    float disk_noise_speed;
+    int32_t disk_noise_octaves;
+    float disk_emission_strength;
+
+    float disk_alpha_falloff;       // Opacity per 0.1 of path
+    float disk_inner_multiplier;
+    float disk_inner_softness;
+    float disk_color_mix;
+
+    float disk_noise_lod_bias;
+    int32_t max_iterations;
+    float step_size;
+    int32_t adaptive_stepping;      // 0 or 1
+
+    float observer_position[4];     // xyz used when longer than 0.1, w unused
+
+    float sky_weight;               // 0 leaves the background sky out
+    float pad[3];
+};
+
+static_assert(sizeof(VulkanSceneUniforms) == 128, "VulkanSceneUniforms must match the std140 block");
+
+// Push constants of the post-processing kernels
+struct VulkanBloomParams
+{
+    float threshold;                // Bright pass threshold
+    float strength;                 // Composite bloom strength
+    float tone;                     // Composite scene multiplier
+    float pad;
+};
+
+struct VulkanToneParams
+{
+    float gamma;
+    float exposure;                 // Fixed exposure (no auto exposure here)
+    int32_t tonemapping_enabled;
+    int32_t pad;
+};
+
+#endif
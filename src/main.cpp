@@ -13,11 +13,35 @@
  */
 
 #include <iostream>
+#include <cstring>
+#include <string>
 #define GLFW_INCLUDE_NONE // IMPORTANT: This prevents GLFW from including graphics headers
 #include <GLFW/glfw3.h>
 #include "Renderer.hpp"   // This should be the ONLY local include
 
-int main() {
+int main(int argc, char** argv) {
+    // Headless light curve: --lightcurve [options]
+    bool lightCurve = argc > 1 && std::strcmp(argv[1], "--lightcurve") == 0;
+    LightCurveOptions lightCurveOptions;
+    if (lightCurve) {
+        std::string error;
+        if (!parseLightCurveArgs(argc - 2, argv + 2, lightCurveOptions, error)) {
+            std::cerr << error << "\n" << lightCurveUsage();
+            return -1;
+        }
+    }
+
+    // Resource-churn soak: --soak [options]
+    bool soak = argc > 1 && std::strcmp(argv[1], "--soak") == 0;
+    SoakOptions soakOptions;
+    if (soak) {
+        std::string error;
+        if (!parseSoakArgs(argc - 2, argv + 2, soakOptions, error)) {
+            std::cerr << error << "\n" << soakUsage();
+            return -1;
+        }
+    }
+
     // Initialize the GLFW windowing system
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -26,6 +50,10 @@ int main() {
 
     // Configure window for Metal rendering (no OpenGL)
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    if (lightCurve) {
+        // The renderer still wants a window; keep it off screen
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
     
     // Create application window
     GLFWwindow* window = glfwCreateWindow(1280, 720, "Black Hole GPU - Scientific Ray Tracer", nullptr, nullptr);
@@ -35,12 +63,19 @@ int main() {
         return -1;
     }
 
+    int status = 0;
     try {
         // Initialize the Metal renderer
         Renderer renderer(window);
 
+        if (lightCurve) {
+            status = renderer.runLightCurve(lightCurveOptions) ? 0 : -1;
+        } else if (soak) {
+            status = renderer.runSoak(soakOptions) ? 0 : -1;
+        }
+
         // Main render loop
-        while (!glfwWindowShouldClose(window)) {
+        while (!lightCurve && !soak && !glfwWindowShouldClose(window)) {
             // Process window events (keyboard, mouse, etc.)
             glfwPollEvents();
             
@@ -58,5 +93,5 @@ int main() {
     glfwDestroyWindow(window);
     glfwTerminate();
     
-    return 0;
+    return status;
 }
@@ -0,0 +1,46 @@
+"""Checks of the blackhole Python module (ctest -R python_module)
+
+ctest puts the built module on PYTHONPATH. By hand:
+    PYTHONPATH=build python3 tests/test_python_module.py
+"""
+
+import unittest
+
+import blackhole
+
+
+class ObserverPositionTest(unittest.TestCase):
+    def setUp(self):
+        self.tracer = blackhole.Tracer(16, 8)
+
+    def test_tuple(self):
+        self.tracer.observer_position = (1.0, 2.0, 8.0)
+        self.assertEqual(self.tracer.observer_position, (1.0, 2.0, 8.0))
+
+    def test_list(self):
+        self.tracer.observer_position = [0, 0, 8]
+        self.assertEqual(self.tracer.observer_position, (0.0, 0.0, 8.0))
+
+    def test_wrong_length(self):
+        for value in ([0, 8], (0, 0, 8, 1), []):
+            with self.assertRaises(TypeError):
+                self.tracer.observer_position = value
+
+    def test_not_numbers(self):
+        for value in (None, 8.0, "xyz", [0, "0", 8]):
+            with self.assertRaises(TypeError):
+                self.tracer.observer_position = value
+
+    def test_failed_assignment_keeps_value(self):
+        self.tracer.observer_position = (1.0, 2.0, 3.0)
+        with self.assertRaises(TypeError):
+            self.tracer.observer_position = [4, 5, "6"]
+        self.assertEqual(self.tracer.observer_position, (1.0, 2.0, 3.0))
+
+    def test_delete(self):
+        with self.assertRaises(TypeError):
+            del self.tracer.observer_position
+
+
+if __name__ == "__main__":
+    unittest.main()
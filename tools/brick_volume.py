@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Convert raw float32 grids into a bricked volume for the Black Hole GPU renderer.
+
+Writes the .bhvol layout described in src/VolumeCache.hpp: the grid is cut
+into bricks of B³ voxels, each stored with a one-voxel apron as (B+2)³
+half-float (density, temperature) pairs, zlib-compressed, followed by a
+table with each brick's offset, mean and max density. Bricks whose max
+density is zero are not stored at all.
+
+Usage:
+    brick_volume.py rho.raw 256 256 128 flow.bhvol --temperature T.raw
+    brick_volume.py rho.raw 512 512 512 flow.bhvol --brick 32 --density-scale 1e15
+
+Inputs are little-endian float32, x fastest. Inputs are memory-mapped and
+read one row at a time, so grids larger than RAM convert fine (slowly).
+Temperatures are stored in kK to fit the half-float range.
+"""
+
+import argparse
+import mmap
+import struct
+import sys
+import zlib
+
+MAGIC = b"BHVOLUM\0"
+VERSION = 1
+HEADER_FORMAT = "<8sIIIIIIQ16x"    # must match VolumeFileHeader (56 bytes)
+ENTRY_FORMAT = "<QIIfffI"           # must match VolumeBrickEntry (32 bytes)
+HALF_MAX = 65504.0
+TEMPERATURE_UNIT = 1000.0           # kVolumeTemperatureUnit
+
+
+def map_grid(path, voxels):
+    f = open(path, "rb")
+    data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    if len(data) < voxels * 4:
+        sys.exit("%s holds %d floats, expected %d" % (path, len(data) // 4, voxels))
+    return memoryview(data).cast("f")
+
+
+def clamp(v, hi):
+    return 0 if v < 0 else (hi - 1 if v >= hi else v)
+
+
+def to_half(v):
+    # Non-finite and out-of-range values would make struct raise
+    if v != v:
+        return 0.0
+    return max(-HALF_MAX, min(HALF_MAX, v))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("density", help="raw float32 density grid")
+    parser.add_argument("nx", type=int)
+    parser.add_argument("ny", type=int)
+    parser.add_argument("nz", type=int)
+    parser.add_argument("output", help="bricked volume to write (.bhvol)")
+    parser.add_argument("--temperature", help="raw float32 temperature grid in K")
+    parser.add_argument("--default-temperature", type=float, default=10000.0,
+                        help="temperature in K without a temperature grid")
+    parser.add_argument("--brick", type=int, default=32, help="brick edge in voxels (apron excluded)")
+    parser.add_argument("--density-scale", type=float, default=1.0,
+                        help="multiply densities before storing (bring them into half range)")
+    parser.add_argument("--level", type=int, default=6, help="zlib level")
+    args = parser.parse_args()
+
+    dims = (args.nx, args.ny, args.nz)
+    if min(dims) < 1 or not 4 <= args.brick <= 126:
+        sys.exit("invalid dimensions or brick size")
+    nx, ny, nz = dims
+    b = args.brick
+    p = b + 2
+    density = map_grid(args.density, nx * ny * nz)
+    temperature = map_grid(args.temperature, nx * ny * nz) if args.temperature else None
+    default_t = to_half(args.default_temperature / TEMPERATURE_UNIT)
+    grid = [(n + b - 1) // b for n in dims]
+    bricks = grid[0] * grid[1] * grid[2]
+    pack = struct.Struct("<%de" % (2 * p)).pack
+
+    header_size = struct.calcsize(HEADER_FORMAT)
+    entries = []
+    stored = empty = 0
+    raw_bytes = total_bytes = 0
+    with open(args.output, "wb") as f:
+        f.write(b"\0" * header_size)
+        for bz in range(grid[2]):
+            for by in range(grid[1]):
+                for bx in range(grid[0]):
+                    xs = [clamp(bx * b - 1 + i, nx) for i in range(p)]
+                    contiguous = xs[-1] - xs[0] == p - 1
+                    payload = bytearray()
+                    total = t_total = peak = 0.0
+                    for z in range(p):
+                        vz = clamp(bz * b - 1 + z, nz)
+                        for y in range(p):
+                            vy = clamp(by * b - 1 + y, ny)
+                            row = (vz * ny + vy) * nx
+                            if contiguous:
+                                d = density[row + xs[0]:row + xs[0] + p].tolist()
+                                t = temperature[row + xs[0]:row + xs[0] + p].tolist() if temperature else None
+                            else:
+                                d = [density[row + x] for x in xs]
+                                t = [temperature[row + x] for x in xs] if temperature else None
+                            d = [to_half(v * args.density_scale) for v in d]
+                            t = [to_half(v / TEMPERATURE_UNIT) for v in t] if t else [default_t] * p
+                            pair = [0.0] * (2 * p)
+                            pair[0::2] = d
+                            pair[1::2] = t
+                            payload += pack(*pair)
+                            peak = max(peak, max(d))
+                            # Means over the interior only
+                            if 0 < z < p - 1 and 0 < y < p - 1:
+                                total += sum(d[1:-1])
+                                t_total += sum(t[1:-1])
+                    count = b * b * b
+                    mean = (total / count, t_total / count)
+                    if peak <= 0.0:
+                        entries.append((0, 0, 0, mean[0], mean[1], 0.0, 0))
+                        empty += 1
+                        continue
+                    data = zlib.compress(bytes(payload), args.level)
+                    codec = 1
+                    if len(data) >= len(payload):
+                        data, codec = bytes(payload), 0
+                    entries.append((f.tell(), len(data), codec, mean[0], mean[1], peak, 0))
+                    f.write(data)
+                    stored += 1
+                    raw_bytes += len(payload)
+                    total_bytes += len(data)
+        f.write(b"\0" * ((-f.tell()) % 8))
+        table_offset = f.tell()
+        for entry in entries:
+            f.write(struct.pack(ENTRY_FORMAT, *entry))
+        f.seek(0)
+        f.write(struct.pack(HEADER_FORMAT, MAGIC, VERSION, b, nx, ny, nz, 2, table_offset))
+
+    print("%dx%dx%d voxels, %d bricks of %d (%d stored, %d empty), %.1f MB -> %.1f MB -> %s"
+          % (nx, ny, nz, bricks, b, stored, empty, raw_bytes / 1e6, total_bytes / 1e6, args.output))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""
+Build a HEALPix-indexed star catalog for the Black Hole GPU renderer.
+
+Reads a CSV star list (e.g. HYG, Yale Bright Star, Gaia extracts) and
+writes the memory-mappable binary described in src/StarCatalog.hpp:
+stars bucketed by NESTED HEALPix pixel, brightest first within a pixel,
+with a prefix-offset index so the shader finds a pixel's stars in O(1).
+
+Usage:
+    build_star_catalog.py hyg.csv stars.bhcat --ra-hours --mag-limit 8
+    build_star_catalog.py --random 100000 stars.bhcat
+
+Directions use the renderer's frame: y towards the celestial north pole,
+x towards RA 0h. Colour comes from B-V through a blackbody temperature,
+projected with the same CIE fit as src/Spectral.cpp.
+"""
+
+import argparse
+import csv
+import math
+import random
+import struct
+import sys
+
+MAGIC = b"BHSTARS\0"
+VERSION = 1
+MAX_ORDER = 10
+HEADER_FORMAT = "<8sIIIIQQff24x"   # must match StarCatalogHeader (72 bytes)
+STAR_FORMAT = "<8f"                 # CatalogStar: direction_flux, color
+ALIGN = 256
+
+
+def ang2pix_nest(order, x, y, z):
+    """NESTED pixel of a unit vector; mirrors healpixNest() in BlackHole.metal"""
+    nside = 1 << order
+    zc = y                                  # HEALPix z axis is the renderer's y
+    za = abs(zc)
+    phi = math.atan2(z, x)
+    tt = (phi * (2.0 / math.pi)) % 4.0      # [0, 4)
+
+    if za <= 2.0 / 3.0:
+        temp1 = nside * (0.5 + tt)
+        temp2 = nside * zc * 0.75
+        jp = int(temp1 - temp2)
+        jm = int(temp1 + temp2)
+        ifp = jp >> order
+        ifm = jm >> order
+        if ifp == ifm:
+            face = ifp | 4
+        elif ifp < ifm:
+            face = ifp
+        else:
+            face = ifm + 8
+        ix = jm & (nside - 1)
+        iy = nside - (jp & (nside - 1)) - 1
+    else:
+        ntt = min(3, int(tt))
+        tp = tt - ntt
+        # sqrt(3(1 - |z|)) written via sin θ to stay accurate at the poles
+        sth2 = x * x + z * z
+        tmp = nside * math.sqrt(3.0 * sth2 / (1.0 + za))
+        jp = min(int(tp * tmp), nside - 1)
+        jm = min(int((1.0 - tp) * tmp), nside - 1)
+        if zc >= 0.0:
+            face = ntt
+            ix = nside - jm - 1
+            iy = nside - jp - 1
+        else:
+            face = ntt + 8
+            ix = jp
+            iy = jm
+    return face * nside * nside + spread_bits(ix) + (spread_bits(iy) << 1)
+
+
+def spread_bits(v):
+    """Interleave zeros between the low 16 bits of v"""
+    v &= 0xFFFF
+    v = (v | (v << 8)) & 0x00FF00FF
+    v = (v | (v << 4)) & 0x0F0F0F0F
+    v = (v | (v << 2)) & 0x33333333
+    v = (v | (v << 1)) & 0x55555555
+    return v
+
+
+def lobe(lam, mu, sigma_low, sigma_high):
+    t = (lam - mu) / (sigma_low if lam < mu else sigma_high)
+    return math.exp(-0.5 * t * t)
+
+
+def blackbody_rgb(temperature):
+    """Linear sRGB of a blackbody at unit luminance (Wyman et al. 2013 CIE fit)"""
+    X = Y = Z = 0.0
+    for lam in range(380, 781, 5):
+        a = 1.4387769e7 / (lam * temperature)   # hc / (λ k T), λ in nm
+        radiance = 1.0 / (lam ** 5 * math.expm1(min(a, 700.0)))
+        X += radiance * (1.056 * lobe(lam, 599.8, 37.9, 31.0) + 0.362 * lobe(lam, 442.0, 16.0, 26.7)
+                         - 0.065 * lobe(lam, 501.1, 20.4, 26.2))
+        Y += radiance * (0.821 * lobe(lam, 568.8, 46.9, 40.5) + 0.286 * lobe(lam, 530.9, 16.3, 31.1))
+        Z += radiance * (1.217 * lobe(lam, 437.0, 11.8, 36.0) + 0.681 * lobe(lam, 459.0, 26.0, 13.8))
+    r = 3.2406 * X - 1.5372 * Y - 0.4986 * Z
+    g = -0.9689 * X + 1.8758 * Y + 0.0415 * Z
+    b = 0.0557 * X - 0.2040 * Y + 1.0570 * Z
+    rgb = [max(c, 0.0) for c in (r, g, b)]
+    lum = 0.2126 * rgb[0] + 0.7152 * rgb[1] + 0.0722 * rgb[2]
+    return [c / max(lum, 1e-30) for c in rgb]
+
+
+def bv_temperature(bv):
+    """Effective temperature from B-V colour index (Ballesteros 2012)"""
+    bv = min(max(bv, -0.4), 2.0)
+    return 4600.0 * (1.0 / (0.92 * bv + 1.7) + 1.0 / (0.92 * bv + 0.62))
+
+
+def read_csv(path, args):
+    stars = []
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            try:
+                ra = float(row[args.ra_column])
+                dec = float(row[args.dec_column])
+                mag = float(row[args.mag_column])
+            except (KeyError, ValueError):
+                continue
+            try:
+                bv = float(row.get(args.bv_column) or 0.65)
+            except ValueError:
+                bv = 0.65
+            if args.ra_hours:
+                ra *= 15.0
+            # Skip the Sun and anything fainter than the limit
+            if mag > args.mag_limit or mag < -5.0:
+                continue
+            stars.append((math.radians(ra), math.radians(dec), mag, bv))
+    return stars
+
+
+def random_stars(count, seed):
+    rng = random.Random(seed)
+    stars = []
+    for _ in range(count):
+        ra = rng.uniform(0.0, 2.0 * math.pi)
+        dec = math.asin(rng.uniform(-1.0, 1.0))
+        # Roughly the real magnitude distribution: counts grow ~3x per magnitude
+        mag = max(9.0 + math.log(1.0 - rng.random()) / math.log(3.0), -1.5)
+        stars.append((ra, dec, mag, rng.gauss(0.65, 0.4)))
+    return stars
+
+
+def choose_order(count, per_cell):
+    for order in range(MAX_ORDER + 1):
+        if count / (12 << (2 * order)) <= per_cell:
+            return order
+    return MAX_ORDER
+
+
+def pad_to(f, alignment):
+    pos = f.tell()
+    f.write(b"\0" * ((-pos) % alignment))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", help="CSV star list")
+    parser.add_argument("output", help="catalog file to write (.bhcat)")
+    parser.add_argument("--random", type=int, metavar="N", help="generate N random stars instead of reading a CSV")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--order", type=int, help="HEALPix order (default: ~4 stars per pixel)")
+    parser.add_argument("--mag-limit", type=float, default=9.0)
+    parser.add_argument("--ra-column", default="ra")
+    parser.add_argument("--dec-column", default="dec")
+    parser.add_argument("--mag-column", default="mag")
+    parser.add_argument("--bv-column", default="ci")
+    parser.add_argument("--ra-hours", action="store_true", help="RA column is in hours (HYG)")
+    args = parser.parse_args()
+
+    if args.random:
+        stars = random_stars(args.random, args.seed)
+    elif args.input:
+        stars = read_csv(args.input, args)
+    else:
+        parser.error("give an input CSV or --random N")
+    if not stars:
+        sys.exit("no stars selected")
+
+    order = args.order if args.order is not None else choose_order(len(stars), 4.0)
+    if not 0 <= order <= MAX_ORDER:
+        sys.exit("order must be in [0, %d]" % MAX_ORDER)
+    cells = 12 << (2 * order)
+
+    records = []
+    color_cache = {}
+    for ra, dec, mag, bv in stars:
+        x = math.cos(dec) * math.cos(ra)
+        y = math.sin(dec)
+        z = math.cos(dec) * math.sin(ra)
+        key = round(bv, 2)
+        if key not in color_cache:
+            color_cache[key] = blackbody_rgb(bv_temperature(key))
+        flux = 10.0 ** (-0.4 * mag)
+        records.append((ang2pix_nest(order, x, y, z), mag, x, y, z, flux, color_cache[key]))
+    records.sort(key=lambda r: (r[0], r[1]))
+
+    counts = [0] * cells
+    for r in records:
+        counts[r[0]] += 1
+    prefix = [0] * (cells + 1)
+    for i in range(cells):
+        prefix[i + 1] = prefix[i] + counts[i]
+
+    header_size = struct.calcsize(HEADER_FORMAT)
+    cells_offset = (header_size + ALIGN - 1) // ALIGN * ALIGN
+    stars_offset = (cells_offset + 4 * (cells + 1) + ALIGN - 1) // ALIGN * ALIGN
+    mags = [r[1] for r in records]
+
+    with open(args.output, "wb") as f:
+        f.write(struct.pack(HEADER_FORMAT, MAGIC, VERSION, order, len(records), max(counts),
+                            cells_offset, stars_offset, min(mags), max(mags)))
+        pad_to(f, ALIGN)
+        f.write(struct.pack("<%dI" % (cells + 1), *prefix))
+        pad_to(f, ALIGN)
+        for _, _, x, y, z, flux, rgb in records:
+            f.write(struct.pack(STAR_FORMAT, x, y, z, flux, rgb[0], rgb[1], rgb[2], 0.0))
+
+    print("%d stars, order %d (%d pixels), densest pixel %d, magnitudes %.2f..%.2f -> %s"
+          % (len(records), order, cells, max(counts), min(mags), max(mags), args.output))
+
+
+if __name__ == "__main__":
+    main()
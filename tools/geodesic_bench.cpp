@@ -0,0 +1,250 @@
+/**
+ * geodesic_bench.cpp
+ *
+ * Cost and accuracy of the photon integrators in Geodesic.h
+ *
+ * Traces a fan of camera rays through the shader's equation of motion with
+ * each integrator at each quality preset's step size, in float like the
+ * GPU, and compares every ray's direction where it leaves r = 25 (outside
+ * any disk) with a double-precision reference. Errors are reported in
+ * pixels of a 720-line image (2/720 rad per pixel at the screen centre).
+ * For each preset the cheapest integrator (in force evaluations) whose
+ * 95th-percentile error is within that preset's budget, with at most 1% of
+ * rays captured or escaped wrongly, is marked; applyQualityPreset uses the
+ * result for the default scene. Timings need an optimized build.
+ *
+ * --counters adds a per-kernel table of hardware counters (perf_counters.h,
+ * Linux perf_event_open, user space only): cycles, instructions, last-level
+ * cache misses, branch misses and, on Intel, retired scalar and packed
+ * single-precision FP instructions. The kernels are each integrator alone
+ * and the full LensingTracer march (integration plus disk-crossing and
+ * escape bookkeeping). Counters the host does not expose (containers, VMs
+ * without a virtual PMU, perf_event_paranoid > 2) print as n/a.
+ *
+ *   geodesic_bench [--gravity G] [--distance D] [--rays N] [--counters]
+ *
+ * Defaults match the renderer: gravity 2.5, camera distance 8.
+ */
+
+#include "Geodesic.h"
+#include "LensingTracer.hpp"
+#include "perf_counters.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+template <typename S>
+struct Vec3
+{
+    S x, y, z;
+};
+
+template <typename S>
+inline Vec3<S> operator+(Vec3<S> a, Vec3<S> b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+template <typename S>
+inline Vec3<S> operator-(Vec3<S> a, Vec3<S> b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+template <typename S>
+inline Vec3<S> operator*(Vec3<S> a, S s) { return { a.x * s, a.y * s, a.z * s }; }
+template <typename S>
+inline S dot(Vec3<S> a, Vec3<S> b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+template <typename S>
+inline Vec3<S> cross(Vec3<S> a, Vec3<S> b)
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+namespace {
+
+const double kExitRadius = 25.0;
+const double kRadiansPerPixel = 2.0 / 720.0;
+const char* kMethodNames[GEODESIC_INTEGRATOR_COUNT] = { "Verlet", "RK4", "Yoshida4", "Yoshida6" };
+const int kEvaluations[GEODESIC_INTEGRATOR_COUNT] = { 2, 4, 4, 8 };
+
+struct Preset
+{
+    const char* name;
+    float stepSize;
+    bool adaptive;
+    double budgetPixels;    // 95th-percentile direction error allowed
+};
+
+// Matches applyQualityPreset
+const Preset kPresets[] = {
+    { "Low", 0.15f, false, 1.0 },
+    { "Medium", 0.12f, true, 0.5 },
+    { "High", 0.1f, true, 0.25 },
+    { "Ultra", 0.08f, true, 0.1 },
+};
+
+struct RayResult
+{
+    bool escaped;
+    Vec3<double> dir;
+    long steps;
+};
+
+// The march of rayMarch without shading: same adaptive rule, no step cap
+template <typename S>
+RayResult trace(int method, Vec3<S> pos, Vec3<S> dir, S stepSize, bool adaptive, S gravity)
+{
+    Vec3<S> h = cross(pos, dir);
+    S h2 = dot(h, h);
+    const long maxSteps = 2000000;
+    for (long i = 0; i < maxSteps; ++i) {
+        S r = geodesicSqrt(dot(pos, pos));
+        S dt = (adaptive && r < S(3.0)) ? stepSize * (r / S(3.0)) : stepSize;
+        geodesicStep(method, pos, dir, h2, dt, gravity);
+        S r2 = dot(pos, pos);
+        if (r2 < S(1.0)) {
+            return { false, {}, i + 1 };
+        }
+        if (r2 > S(kExitRadius * kExitRadius) && dot(pos, dir) > S(0.0)) {
+            return { true, { (double)dir.x, (double)dir.y, (double)dir.z }, i + 1 };
+        }
+    }
+    return { false, {}, maxSteps };
+}
+
+double angle(Vec3<double> a, Vec3<double> b)
+{
+    Vec3<double> c = cross(a, b);
+    return std::atan2(std::sqrt(dot(c, c)), dot(a, b));
+}
+
+double percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = std::min(values.size() - 1, (size_t)(p * (double)(values.size() - 1) + 0.5));
+    return values[index];
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    double gravity = 2.5;
+    double distance = 8.0;
+    int rays = 512;
+    bool counters = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--gravity") == 0 && i + 1 < argc) {
+            gravity = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--distance") == 0 && i + 1 < argc) {
+            distance = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--rays") == 0 && i + 1 < argc) {
+            rays = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--counters") == 0) {
+            counters = true;
+        } else {
+            std::fprintf(stderr, "Usage: geodesic_bench [--gravity G] [--distance D] [--rays N] [--counters]\n");
+            return 1;
+        }
+    }
+
+    // Camera on +z looking at the hole; a fan of screen offsets along x,
+    // covering the shadow edge, the photon rings and the weak-field region
+    std::vector<Vec3<double>> starts(rays);
+    for (int i = 0; i < rays; ++i) {
+        double u = 1.2 * (i + 0.5) / rays;
+        double length = std::sqrt(u * u + 1.0);
+        starts[i] = { u / length, 0.0, -1.0 / length };
+    }
+    Vec3<double> camera = { 0.0, 0.0, distance };
+
+    // Reference: double precision RK4 at a step far below any preset
+    std::vector<RayResult> reference(rays);
+    for (int i = 0; i < rays; ++i) {
+        reference[i] = trace<double>(GEODESIC_RK4, camera, starts[i], 0.002, true, gravity);
+    }
+
+    std::printf("Gravity %.2f, camera distance %.1f, %d rays; error in pixels at 720 lines\n\n", gravity, distance, rays);
+    std::printf("| Preset | Step | Integrator | Force evals/ray | ns/ray | p95 error | Max error | Misclassified | Budget |\n");
+    std::printf("|--------|------|------------|-----------------|--------|-----------|-----------|---------------|--------|\n");
+
+    for (const Preset& preset : kPresets) {
+        int best = -1;
+        double bestCost = 0.0;
+        double bestError = 0.0;
+        char rows[GEODESIC_INTEGRATOR_COUNT][256];
+        for (int method = 0; method < GEODESIC_INTEGRATOR_COUNT; ++method) {
+            std::vector<double> errors;
+            int misclassified = 0;
+            long steps = 0;
+            auto start = std::chrono::steady_clock::now();
+            std::vector<RayResult> results(rays);
+            for (int i = 0; i < rays; ++i) {
+                Vec3<float> pos = { (float)camera.x, (float)camera.y, (float)camera.z };
+                Vec3<float> dir = { (float)starts[i].x, (float)starts[i].y, (float)starts[i].z };
+                results[i] = trace<float>(method, pos, dir, preset.stepSize, preset.adaptive, (float)gravity);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            for (int i = 0; i < rays; ++i) {
+                steps += results[i].steps;
+                if (results[i].escaped != reference[i].escaped) {
+                    ++misclassified;
+                } else if (results[i].escaped) {
+                    errors.push_back(angle(results[i].dir, reference[i].dir) / kRadiansPerPixel);
+                }
+            }
+            double p95 = percentile(errors, 0.95);
+            double worst = percentile(errors, 1.0);
+            double evals = (double)steps * kEvaluations[method] / rays;
+            double nsPerRay = seconds * 1e9 / rays;
+            bool meets = p95 <= preset.budgetPixels && misclassified <= rays / 100;
+            // Within 2% of the cost counts as a tie, settled by accuracy
+            bool cheaper = best < 0 || evals < 0.98 * bestCost || (evals <= 1.02 * bestCost && p95 < bestError);
+            if (meets && cheaper) {
+                best = method;
+                bestCost = evals;
+                bestError = p95;
+            }
+            std::snprintf(rows[method], sizeof(rows[method]), "| %s | %.3f | %s | %.0f | %.0f | %.3g | %.3g | %d | %s |",
+                          preset.name, preset.stepSize, kMethodNames[method], evals, nsPerRay, p95, worst,
+                          misclassified, meets ? "met" : "missed");
+        }
+        for (int method = 0; method < GEODESIC_INTEGRATOR_COUNT; ++method) {
+            std::printf("%s%s\n", rows[method], method == best ? " **cheapest**" : "");
+        }
+    }
+
+    if (!counters) {
+        return 0;
+    }
+
+    // Per-kernel hardware counters at the High preset's step
+    PerfCounters perf;
+    const Preset& high = kPresets[2];
+    std::printf("\nHardware counters per ray (%s step %.2f)%s%s\n\n", high.name, high.stepSize,
+                perf.available() ? "" : ": ", perf.status().c_str());
+    printKernelHeader("ray");
+    for (int method = 0; method < GEODESIC_INTEGRATOR_COUNT; ++method) {
+        KernelSample sample = measureKernel(perf, rays, [&] {
+            for (int i = 0; i < rays; ++i) {
+                Vec3<float> pos = { (float)camera.x, (float)camera.y, (float)camera.z };
+                Vec3<float> dir = { (float)starts[i].x, (float)starts[i].y, (float)starts[i].z };
+                trace<float>(method, pos, dir, high.stepSize, high.adaptive, (float)gravity);
+            }
+        });
+        std::string name = std::string("Integrate (") + kMethodNames[method] + ")";
+        printKernelRow(name.c_str(), sample);
+    }
+
+    // The CPU tracer on this thread only, so the counters see all its work
+    LensingTracer tracer(160, 90, 1);
+    LensingParams params;
+    params.gravity = (float)gravity;
+    params.camera_distance = (float)distance;
+    params.step_size = high.stepSize;
+    params.adaptive_stepping = high.adaptive;
+    KernelSample sample = measureKernel(perf, (long)tracer.width() * tracer.height(), [&] { tracer.trace(params); });
+    printKernelRow("LensingTracer march (RK4)", sample);
+    return 0;
+}
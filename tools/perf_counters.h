@@ -0,0 +1,224 @@
+/**
+ * perf_counters.h
+ *
+ * Per-kernel hardware counters for the benchmark tools
+ *
+ * Linux perf_event_open, user space only, on the calling thread: cycles,
+ * instructions, last-level cache misses, branch misses and, on Intel,
+ * retired scalar and packed single-precision FP instructions. Counters the
+ * host does not expose (containers, VMs without a virtual PMU,
+ * perf_event_paranoid > 2) read as -1 and print as n/a.
+ *
+ * Used by geodesic_bench (integrators, LensingTracer march) and
+ * shading_bench (the shading functions, scalar and SIMD).
+ */
+
+#ifndef perf_counters_h
+#define perf_counters_h
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters of the calling thread around a measured region
+class PerfCounters
+{
+public:
+    enum Event { Cycles, Instructions, CacheMisses, BranchMisses, ScalarFp, Packed128Fp, Packed256Fp, EventCount };
+
+    PerfCounters()
+    {
+#ifdef __linux__
+        // Counters are opened one by one so a missing event loses only itself
+        open(Cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(Instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(CacheMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        open(BranchMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        // FP_ARITH_INST_RETIRED (event 0xC7) on Broadwell and later; other
+        // vendors have no portable encoding
+        if (isIntel()) {
+            open(ScalarFp, PERF_TYPE_RAW, 0x02C7);
+            open(Packed128Fp, PERF_TYPE_RAW, 0x08C7);
+            open(Packed256Fp, PERF_TYPE_RAW, 0x20C7);
+        }
+        if (_fds[Cycles] < 0) {
+            _status = "perf_event_open failed: " + std::string(std::strerror(_error));
+            if (_error == EACCES || _error == EPERM) {
+                _status += " (lower /proc/sys/kernel/perf_event_paranoid to 2 or less)";
+            } else if (_error == ENOENT || _error == EOPNOTSUPP) {
+                _status += " (no hardware PMU exposed, e.g. a VM)";
+            }
+        }
+#else
+        _status = "hardware counters need Linux perf_event_open";
+#endif
+    }
+
+    ~PerfCounters()
+    {
+#ifdef __linux__
+        for (int fd : _fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return _fds[Cycles] >= 0; }
+    const std::string& status() const { return _status; }
+
+    void start()
+    {
+#ifdef __linux__
+        for (int fd : _fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    // Counts since start(), scaled up when the kernel multiplexed a counter;
+    // -1 for events that are unavailable or never ran
+    void stop(double values[EventCount])
+    {
+        for (int e = 0; e < EventCount; ++e) {
+            values[e] = -1.0;
+#ifdef __linux__
+            if (_fds[e] < 0) {
+                continue;
+            }
+            ioctl(_fds[e], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t data[3] = {};    // value, time enabled, time running
+            if (read(_fds[e], data, sizeof(data)) == (ssize_t)sizeof(data) && data[2] > 0) {
+                values[e] = (double)data[0] * ((double)data[1] / (double)data[2]);
+            }
+#endif
+        }
+    }
+
+private:
+#ifdef __linux__
+    void open(Event event, uint32_t type, uint64_t config)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        _fds[event] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (_fds[event] < 0 && _error == 0) {
+            _error = errno;
+        }
+    }
+
+    static bool isIntel()
+    {
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuinfo, line)) {
+            if (line.compare(0, 9, "vendor_id") == 0) {
+                return line.find("GenuineIntel") != std::string::npos;
+            }
+        }
+        return false;
+    }
+
+    int _error = 0;
+#endif
+    int _fds[EventCount] = { -1, -1, -1, -1, -1, -1, -1 };
+    std::string _status;
+};
+
+struct KernelSample
+{
+    double nsPerItem;
+    double counts[PerfCounters::EventCount];    // Per item, -1 when unavailable
+};
+
+// Repeat run (which processes items items) for at least 0.2 s under the counters
+template <typename Run>
+inline KernelSample measureKernel(PerfCounters& counters, long items, Run run)
+{
+    run();    // Warm caches and page in tables
+    long runs = 0;
+    double seconds = 0.0;
+    double totals[PerfCounters::EventCount];
+    counters.start();
+    auto start = std::chrono::steady_clock::now();
+    while (seconds < 0.2) {
+        run();
+        ++runs;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    counters.stop(totals);
+
+    KernelSample sample;
+    double total = (double)items * runs;
+    sample.nsPerItem = seconds * 1e9 / total;
+    for (int e = 0; e < PerfCounters::EventCount; ++e) {
+        sample.counts[e] = totals[e] < 0.0 ? -1.0 : totals[e] / total;
+    }
+    return sample;
+}
+
+// Table cell: value with the given format, or n/a
+inline std::string counterCell(double value, const char* format)
+{
+    if (value < 0.0) {
+        return "n/a";
+    }
+    char text[32];
+    std::snprintf(text, sizeof(text), format, value);
+    return text;
+}
+
+// Markdown table header; unit names the item ("ray", "call")
+inline void printKernelHeader(const char* unit)
+{
+    std::printf("| Kernel | ns/%s | Cycles | Instructions | IPC | LLC misses | Branch misses | FP instr | Packed FP |\n",
+                unit);
+    std::printf("|--------|--------|--------|--------------|-----|------------|---------------|----------|-----------|\n");
+}
+
+inline void printKernelRow(const char* name, const KernelSample& s)
+{
+    const double* c = s.counts;
+    double ipc = c[PerfCounters::Cycles] > 0.0 && c[PerfCounters::Instructions] >= 0.0
+        ? c[PerfCounters::Instructions] / c[PerfCounters::Cycles]
+        : -1.0;
+    double fp = -1.0, packed = -1.0;
+    if (c[PerfCounters::ScalarFp] >= 0.0 && c[PerfCounters::Packed128Fp] >= 0.0 && c[PerfCounters::Packed256Fp] >= 0.0) {
+        packed = c[PerfCounters::Packed128Fp] + c[PerfCounters::Packed256Fp];
+        fp = c[PerfCounters::ScalarFp] + packed;
+    }
+    std::printf("| %s | %s | %s | %s | %s | %s | %s | %s | %s |\n", name,
+                counterCell(s.nsPerItem, s.nsPerItem < 100.0 ? "%.2f" : "%.0f").c_str(),
+                counterCell(c[PerfCounters::Cycles], "%.0f").c_str(),
+                counterCell(c[PerfCounters::Instructions], "%.0f").c_str(),
+                counterCell(ipc, "%.2f").c_str(), counterCell(c[PerfCounters::CacheMisses], "%.3f").c_str(),
+                counterCell(c[PerfCounters::BranchMisses], "%.2f").c_str(), counterCell(fp, "%.0f").c_str(),
+                counterCell(fp > 0.0 ? 100.0 * packed / fp : -1.0, "%.1f%%").c_str());
+}
+
+#endif
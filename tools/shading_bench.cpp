@@ -0,0 +1,523 @@
+/**
+ * shading_bench.cpp
+ *
+ * Micro-benchmarks of the scene kernel's physics and shading functions
+ *
+ * Times the CPU ports in shading_cpu.h one function at a time, scalar and
+ * kLanes-wide SIMD, on inputs sampled from real ray paths: a grid of
+ * camera rays is marched with RK4 at the High preset (adaptive steps, ray
+ * differentials for the pixel footprint), as rayMarch does. The march
+ * records every integration step (acceleration, rk4, verlet), every disk
+ * slab crossing with the transmittance the ray has left (diskRender), and
+ * the points where diskRender takes a sample inside the annulus (toSpherical,
+ * calculateRedShift, calculateDopplerEffect, getBlackBodyColor at the
+ * sample's temperature, snoise at the octave lattice coordinates).
+ *
+ * Each row gives ns per call for both variants, the speedup and the largest
+ * relative difference between them (float rounding only; the ports agree
+ * branch for branch). Timings need an optimized build; -march=native lets
+ * the lane loops use AVX2 or AVX-512 instead of SSE2.
+ *
+ * --counters adds hardware counters per call for both variants of every
+ * function (perf_counters.h), so each one can be placed as compute-,
+ * latency- or bandwidth-bound, and on Intel the packed FP share shows how
+ * much of the SIMD variant actually ran as vector instructions.
+ *
+ *   shading_bench [--rays N] [--filter NAME] [--counters]
+ *
+ * Defaults: 4096 rays, the renderer's default scene at time 12.5 s.
+ */
+
+#include "perf_counters.h"
+#include "shading_cpu.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace shading;
+
+namespace {
+
+const float kGravity = 2.5f;
+const float kCameraDistance = 8.0f;
+const float kStepSize = 0.1f;       // High preset, adaptive
+const int kMaxIterations = 2000;
+const float kTime = 12.5f;
+const size_t kMaxSamples = 1 << 16;
+
+template <typename F>
+struct StepInput
+{
+    Vec3<F> pos, dir;
+    F h2, dt;
+};
+
+template <typename F>
+struct PointInput
+{
+    Vec3<F> pos, viewDir;
+};
+
+template <typename F>
+struct SegmentInput
+{
+    Vec3<F> a, b, viewDir;
+    F footprint;
+    DiskAccum<F> acc;
+};
+
+// Scalar inputs and the same inputs transposed into kLanes-wide packs
+template <template <typename> class Input>
+struct InputSet
+{
+    std::vector<Input<float>> scalar;
+    std::vector<Input<FloatN>> packed;
+};
+
+void packLane(Vec3<FloatN>& p, int lane, const Vec3<float>& s)
+{
+    p.x.v[lane] = s.x;
+    p.y.v[lane] = s.y;
+    p.z.v[lane] = s.z;
+}
+
+void packLane(StepInput<FloatN>& p, int lane, const StepInput<float>& s)
+{
+    packLane(p.pos, lane, s.pos);
+    packLane(p.dir, lane, s.dir);
+    p.h2.v[lane] = s.h2;
+    p.dt.v[lane] = s.dt;
+}
+
+void packLane(PointInput<FloatN>& p, int lane, const PointInput<float>& s)
+{
+    packLane(p.pos, lane, s.pos);
+    packLane(p.viewDir, lane, s.viewDir);
+}
+
+void packLane(SegmentInput<FloatN>& p, int lane, const SegmentInput<float>& s)
+{
+    packLane(p.a, lane, s.a);
+    packLane(p.b, lane, s.b);
+    packLane(p.viewDir, lane, s.viewDir);
+    p.footprint.v[lane] = s.footprint;
+    packLane(p.acc.color, lane, s.acc.color);
+    p.acc.coverage.v[lane] = s.acc.coverage;
+    p.acc.alpha.v[lane] = s.acc.alpha;
+}
+
+// Thin samples evenly to at most kMaxSamples, pad to whole packs and transpose
+template <template <typename> class Input>
+void finish(InputSet<Input>& set, const std::vector<Input<float>>& all)
+{
+    size_t stride = std::max<size_t>(1, (all.size() + kMaxSamples - 1) / kMaxSamples);
+    set.scalar.clear();
+    for (size_t i = 0; i < all.size(); i += stride) {
+        set.scalar.push_back(all[i]);
+    }
+    for (size_t i = 0; set.scalar.size() % kLanes != 0; ++i) {
+        set.scalar.push_back(set.scalar[i]);
+    }
+    set.packed.resize(set.scalar.size() / kLanes);
+    for (size_t i = 0; i < set.scalar.size(); ++i) {
+        packLane(set.packed[i / kLanes], (int)(i % kLanes), set.scalar[i]);
+    }
+}
+
+// RayDifferential and propagateDifferential of BlackHole.metal
+struct RayDifferential
+{
+    Vec3<float> dPdx, dPdy, dDdx, dDdy;
+};
+
+Vec3<float> accelerationJacobian(float h2, const Vec3<float>& pos, const Vec3<float>& v, float gravity)
+{
+    float r2 = dot(pos, pos);
+    float k = -1.5f * h2 * gravity / std::pow(r2, 2.5f);
+    return (v - pos * (5.0f * dot(pos, v) / r2)) * k;
+}
+
+void propagateDifferential(RayDifferential& rd, const Vec3<float>& midPos, float h2, float dt, float gravity)
+{
+    rd.dDdx += accelerationJacobian(h2, midPos, rd.dPdx, gravity) * dt;
+    rd.dDdy += accelerationJacobian(h2, midPos, rd.dPdy, gravity) * dt;
+    rd.dPdx += rd.dDdx * dt;
+    rd.dPdy += rd.dDdy * dt;
+}
+
+struct PathSamples
+{
+    InputSet<StepInput> steps;
+    InputSet<SegmentInput> segments;
+    InputSet<PointInput> points;
+    std::vector<float> temperatures;
+    std::vector<FloatN> temperaturePacks;
+    std::vector<Vec3<float>> noise;
+    std::vector<Vec3<FloatN>> noisePacks;
+    size_t rays = 0;
+    size_t captured = 0;
+};
+
+// Where diskRender calls diskSample on a → b, for points inside the annulus
+template <typename Visit>
+void forEachDiskSample(const Vec3<float>& a, const Vec3<float>& b, const ShadingParams& uniforms, Visit visit)
+{
+    float halfHeight = std::max(uniforms.disk_thickness, 0.01f);
+    Vec3<float> d = b - a;
+    float t0 = 0.0f, t1 = 1.0f;
+    if (std::fabs(d.y) > 1e-6f) {
+        float ta = (-halfHeight - a.y) / d.y;
+        float tb = (halfHeight - a.y) / d.y;
+        t0 = std::max(t0, std::min(ta, tb));
+        t1 = std::min(t1, std::max(ta, tb));
+    } else if (std::fabs(a.y) > halfHeight) {
+        return;
+    }
+    if (t0 >= t1) {
+        return;
+    }
+    int samples = std::clamp((int)std::ceil(length(d) * (t1 - t0) / diskSampleLength), 1, 8);
+    float innerRadius = uniforms.black_hole_size * std::max(uniforms.disk_inner_multiplier, 1.0f);
+    for (int i = 0; i < samples; ++i) {
+        Vec3<float> p = a + d * (t0 + (t1 - t0) * ((float)i + 0.5f) / (float)samples);
+        float r = std::sqrt(p.x * p.x + p.z * p.z);
+        if (r >= innerRadius && r <= uniforms.disk_radius) {
+            visit(p);
+        }
+    }
+}
+
+// primaryRay and the Standard-tier march of rayMarch over a width x height grid
+PathSamples samplePaths(int width, int height, const ShadingParams& uniforms, const DiskColorMap& colorMap)
+{
+    std::vector<StepInput<float>> steps;
+    std::vector<SegmentInput<float>> segments;
+    std::vector<PointInput<float>> points;
+    PathSamples samples;
+    float halfHeight = std::max(uniforms.disk_thickness, 0.01f);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            float u = (2.0f * ((float)x + 0.5f) - (float)width) / (float)height;
+            float v = (2.0f * ((float)y + 0.5f) - (float)height) / (float)height;
+            Vec3<float> pos = { 0.0f, 0.0f, kCameraDistance };
+            Vec3<float> forward = normalize(-pos);
+            Vec3<float> right = normalize(cross(Vec3<float>{ 0.0f, 1.0f, 0.0f }, forward));
+            Vec3<float> up = cross(forward, right);
+            Vec3<float> rawDir = right * u + up * v + forward;
+            float invLen = 1.0f / length(rawDir);
+            Vec3<float> dir = rawDir * invLen;
+
+            float pixelScale = 2.0f / (float)height;
+            RayDifferential rd = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f },
+                                   (right - dir * dot(dir, right)) * (pixelScale * invLen),
+                                   (up - dir * dot(dir, up)) * (pixelScale * invLen) };
+
+            Vec3<float> h = cross(pos, dir);
+            float h2 = dot(h, h);
+            DiskAccum<float> acc = { { 0.0f, 0.0f, 0.0f }, 0.0f, 1.0f };
+            samples.rays++;
+
+            for (int i = 0; i < kMaxIterations; ++i) {
+                float r = length(pos);
+                float dt = r < 3.0f ? kStepSize * (r / 3.0f) : kStepSize;
+                steps.push_back({ pos, dir, h2, dt });
+
+                Vec3<float> prevPos = pos;
+                geodesicRK4(pos, dir, h2, dt, kGravity);
+                propagateDifferential(rd, (prevPos + pos) * 0.5f, h2, dt, kGravity);
+                if (dot(pos, pos) < 1.0f) {
+                    samples.captured++;
+                    break;
+                }
+
+                float footprint = std::max(length(rd.dPdx), length(rd.dPdy));
+                // Only segments that reach the slab do more than the bounds test
+                if (std::min(prevPos.y, pos.y) <= halfHeight && std::max(prevPos.y, pos.y) >= -halfHeight) {
+                    segments.push_back({ prevPos, pos, dir, footprint, acc });
+                    forEachDiskSample(prevPos, pos, uniforms, [&](const Vec3<float>& p) {
+                        points.push_back({ p, dir });
+                    });
+                    diskRender(prevPos, pos, acc, dir, footprint, kTime, uniforms, colorMap);
+                }
+                if (acc.alpha < 0.01f || length(pos) > 100.0f) {
+                    break;
+                }
+            }
+        }
+    }
+
+    finish(samples.steps, steps);
+    finish(samples.segments, segments);
+    finish(samples.points, points);
+
+    // What diskSample hands to getBlackBodyColor and to the noise octaves
+    float noiseScale = std::max(uniforms.disk_noise_scale, 0.001f);
+    int octaves = std::clamp(uniforms.disk_noise_octaves, 1, 8);
+    for (const PointInput<float>& p : samples.points.scalar) {
+        float doppler = std::max(calculateDopplerEffect(p.pos, p.viewDir), 0.2f);
+        samples.temperatures.push_back(calculateRealisticTemperature(p.pos, 7500.0f) / doppler);
+        Vec3<float> spherical = toSpherical(p.pos);
+        spherical.y *= 2.0f;
+        spherical.z *= 4.0f;
+        for (int i = 0; i < octaves; ++i) {
+            samples.noise.push_back(spherical * (std::pow((float)i + 1.0f, 2.0f) * noiseScale));
+        }
+    }
+    samples.temperaturePacks.resize(samples.temperatures.size() / kLanes);
+    for (size_t i = 0; i < samples.temperatures.size(); ++i) {
+        samples.temperaturePacks[i / kLanes].v[i % kLanes] = samples.temperatures[i];
+    }
+    samples.noisePacks.resize(samples.noise.size() / kLanes);
+    for (size_t i = 0; i < samples.noise.size(); ++i) {
+        packLane(samples.noisePacks[i / kLanes], (int)(i % kLanes), samples.noise[i]);
+    }
+    return samples;
+}
+
+struct KernelResult
+{
+    double scalarNs;    // Per call
+    double simdNs;      // Per call (one lane of a pack)
+    double maxDiff;     // Largest relative difference between the variants
+    KernelSample scalarCounters;    // With --counters only
+    KernelSample simdCounters;
+};
+
+// Repeat run over count calls for at least 0.2 s; ns per call
+template <typename Run>
+double timeCalls(size_t count, Run run)
+{
+    run();    // Warm caches
+    long runs = 0;
+    double seconds = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    while (seconds < 0.2) {
+        run();
+        ++runs;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return seconds * 1e9 / ((double)count * runs);
+}
+
+/**
+ * Time and compare one function
+ *
+ * scalar(i, out) writes Outputs floats for input i; simd(p, out) writes
+ * Outputs packs for pack p. Results land in buffers that are compared
+ * afterwards, so neither variant can be optimized away. With perf, each
+ * variant is run again under the hardware counters.
+ */
+template <int Outputs, typename Scalar, typename Simd>
+KernelResult runKernel(PerfCounters* perf, size_t count, Scalar scalar, Simd simd)
+{
+    size_t packs = count / kLanes;
+    std::vector<float> scalarOut(count * Outputs);
+    std::vector<FloatN> simdOut(packs * Outputs);
+    auto scalarRun = [&] {
+        for (size_t i = 0; i < count; ++i) {
+            scalar(i, &scalarOut[i * Outputs]);
+        }
+    };
+    auto simdRun = [&] {
+        for (size_t p = 0; p < packs; ++p) {
+            simd(p, &simdOut[p * Outputs]);
+        }
+    };
+
+    KernelResult result;
+    result.scalarNs = timeCalls(count, scalarRun);
+    result.simdNs = timeCalls(count, simdRun);
+    if (perf) {
+        result.scalarCounters = measureKernel(*perf, (long)count, scalarRun);
+        result.simdCounters = measureKernel(*perf, (long)(packs * kLanes), simdRun);
+    }
+
+    result.maxDiff = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        for (int k = 0; k < Outputs; ++k) {
+            double a = scalarOut[i * Outputs + k];
+            double b = simdOut[(i / kLanes) * Outputs + k].v[i % kLanes];
+            double diff = std::fabs(a - b) / std::max(1.0, std::fabs(a));
+            if (diff > result.maxDiff || diff != diff) {
+                result.maxDiff = diff;
+            }
+        }
+    }
+    return result;
+}
+
+void writeVec(float* out, const Vec3<float>& v)
+{
+    out[0] = v.x;
+    out[1] = v.y;
+    out[2] = v.z;
+}
+
+void writeVec(FloatN* out, const Vec3<FloatN>& v)
+{
+    out[0] = v.x;
+    out[1] = v.y;
+    out[2] = v.z;
+}
+
+void printRow(const char* name, size_t count, const KernelResult& r)
+{
+    std::printf("| %s | %zu | %.2f | %.2f | %.2fx | %.2g |\n", name, count, r.scalarNs, r.simdNs,
+                r.scalarNs / r.simdNs, r.maxDiff);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int rays = 4096;
+    std::string filter;
+    bool counters = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--rays") == 0 && i + 1 < argc) {
+            rays = std::max(std::atoi(argv[++i]), 16);
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--counters") == 0) {
+            counters = true;
+        } else {
+            std::fprintf(stderr, "Usage: shading_bench [--rays N] [--filter NAME] [--counters]\n");
+            return 1;
+        }
+    }
+
+    // 16:9 grid of about rays pixels
+    int height = std::max(1, (int)std::lround(std::sqrt(rays * 9.0 / 16.0)));
+    int width = std::max(1, rays / height);
+
+    ShadingParams uniforms;
+    DiskColorMap colorMap;
+    PathSamples s = samplePaths(width, height, uniforms, colorMap);
+    if (s.segments.scalar.empty() || s.points.scalar.empty()) {
+        std::fprintf(stderr, "No ray reached the disk; nothing to sample\n");
+        return 1;
+    }
+
+    std::printf("%zu rays (%dx%d, %zu captured), RK4 step %.2f adaptive, gravity %.1f, %d lanes\n", s.rays, width,
+                height, s.captured, kStepSize, kGravity, kLanes);
+    std::printf("Samples: %zu steps, %zu slab crossings, %zu disk points, %zu noise points\n\n",
+                s.steps.scalar.size(), s.segments.scalar.size(), s.points.scalar.size(), s.noise.size());
+    std::printf("| Function | Inputs | Scalar ns/call | SIMD ns/call | Speedup | Max rel. diff |\n");
+    std::printf("|----------|--------|----------------|--------------|---------|---------------|\n");
+
+    std::unique_ptr<PerfCounters> perf(counters ? new PerfCounters() : nullptr);
+    std::vector<std::pair<const char*, KernelResult>> counted;
+    auto selected = [&](const char* name) { return filter.empty() || filter == name; };
+    auto report = [&](const char* name, size_t count, const KernelResult& result) {
+        printRow(name, count, result);
+        if (perf) {
+            counted.push_back({ name, result });
+        }
+    };
+    const std::vector<StepInput<float>>& steps = s.steps.scalar;
+    const std::vector<StepInput<FloatN>>& stepPacks = s.steps.packed;
+    const std::vector<PointInput<float>>& points = s.points.scalar;
+    const std::vector<PointInput<FloatN>>& pointPacks = s.points.packed;
+
+    if (selected("acceleration")) {
+        report("acceleration", steps.size(), runKernel<3>(perf.get(), steps.size(),
+            [&](size_t i, float* out) { writeVec(out, geodesicAcceleration(steps[i].pos, steps[i].h2, kGravity)); },
+            [&](size_t p, FloatN* out) {
+                writeVec(out, geodesicAcceleration(stepPacks[p].pos, stepPacks[p].h2, FloatN(kGravity)));
+            }));
+    }
+    if (selected("rk4")) {
+        report("rk4", steps.size(), runKernel<6>(perf.get(), steps.size(),
+            [&](size_t i, float* out) {
+                StepInput<float> st = steps[i];
+                geodesicRK4(st.pos, st.dir, st.h2, st.dt, kGravity);
+                writeVec(out, st.pos);
+                writeVec(out + 3, st.dir);
+            },
+            [&](size_t p, FloatN* out) {
+                StepInput<FloatN> st = stepPacks[p];
+                geodesicRK4(st.pos, st.dir, st.h2, st.dt, FloatN(kGravity));
+                writeVec(out, st.pos);
+                writeVec(out + 3, st.dir);
+            }));
+    }
+    if (selected("verlet")) {
+        report("verlet", steps.size(), runKernel<6>(perf.get(), steps.size(),
+            [&](size_t i, float* out) {
+                StepInput<float> st = steps[i];
+                geodesicVerlet(st.pos, st.dir, st.h2, st.dt, kGravity);
+                writeVec(out, st.pos);
+                writeVec(out + 3, st.dir);
+            },
+            [&](size_t p, FloatN* out) {
+                StepInput<FloatN> st = stepPacks[p];
+                geodesicVerlet(st.pos, st.dir, st.h2, st.dt, FloatN(kGravity));
+                writeVec(out, st.pos);
+                writeVec(out + 3, st.dir);
+            }));
+    }
+    if (selected("snoise")) {
+        report("snoise", s.noise.size(), runKernel<1>(perf.get(), s.noise.size(),
+            [&](size_t i, float* out) { out[0] = snoise(s.noise[i]); },
+            [&](size_t p, FloatN* out) { out[0] = snoise(s.noisePacks[p]); }));
+    }
+    if (selected("toSpherical")) {
+        report("toSpherical", points.size(), runKernel<3>(perf.get(), points.size(),
+            [&](size_t i, float* out) { writeVec(out, toSpherical(points[i].pos)); },
+            [&](size_t p, FloatN* out) { writeVec(out, toSpherical(pointPacks[p].pos)); }));
+    }
+    if (selected("getBlackBodyColor")) {
+        report("getBlackBodyColor", s.temperatures.size(), runKernel<3>(perf.get(), s.temperatures.size(),
+            [&](size_t i, float* out) { writeVec(out, getBlackBodyColor(s.temperatures[i])); },
+            [&](size_t p, FloatN* out) { writeVec(out, getBlackBodyColor(s.temperaturePacks[p])); }));
+    }
+    if (selected("calculateDopplerEffect")) {
+        report("calculateDopplerEffect", points.size(), runKernel<1>(perf.get(), points.size(),
+            [&](size_t i, float* out) { out[0] = calculateDopplerEffect(points[i].pos, points[i].viewDir); },
+            [&](size_t p, FloatN* out) { out[0] = calculateDopplerEffect(pointPacks[p].pos, pointPacks[p].viewDir); }));
+    }
+    if (selected("calculateRedShift")) {
+        report("calculateRedShift", points.size(), runKernel<1>(perf.get(), points.size(),
+            [&](size_t i, float* out) { out[0] = calculateRedShift(points[i].pos); },
+            [&](size_t p, FloatN* out) { out[0] = calculateRedShift(pointPacks[p].pos); }));
+    }
+    if (selected("diskRender")) {
+        const std::vector<SegmentInput<float>>& segs = s.segments.scalar;
+        const std::vector<SegmentInput<FloatN>>& segPacks = s.segments.packed;
+        report("diskRender", segs.size(), runKernel<5>(perf.get(), segs.size(),
+            [&](size_t i, float* out) {
+                const SegmentInput<float>& g = segs[i];
+                DiskAccum<float> acc = g.acc;
+                diskRender(g.a, g.b, acc, g.viewDir, g.footprint, kTime, uniforms, colorMap);
+                writeVec(out, acc.color);
+                out[3] = acc.coverage;
+                out[4] = acc.alpha;
+            },
+            [&](size_t p, FloatN* out) {
+                const SegmentInput<FloatN>& g = segPacks[p];
+                DiskAccum<FloatN> acc = g.acc;
+                diskRender(g.a, g.b, acc, g.viewDir, g.footprint, kTime, uniforms, colorMap);
+                writeVec(out, acc.color);
+                out[3] = acc.coverage;
+                out[4] = acc.alpha;
+            }));
+    }
+
+    if (perf) {
+        std::printf("\nHardware counters per call%s%s\n\n", perf->available() ? "" : ": ", perf->status().c_str());
+        printKernelHeader("call");
+        for (const auto& row : counted) {
+            std::string name = row.first;
+            printKernelRow((name + " (scalar)").c_str(), row.second.scalarCounters);
+            printKernelRow((name + " (SIMD)").c_str(), row.second.simdCounters);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,962 @@
+/**
+ * shading_cpu.h
+ *
+ * CPU ports of the scene kernel's building blocks (shaders/BlackHole.metal)
+ *
+ * The scalar ports follow the Metal code line by line. They cover the
+ * Standard tier with spectral mode off: toSpherical, getBlackBodyColor,
+ * calculateRedShift, calculateDopplerEffect, snoise (the scalar reference
+ * in Noise.h), diskSample and diskRender. acceleration, rk4 and verlet are
+ * the Geodesic.h templates themselves.
+ *
+ * The SIMD variants evaluate kLanes independent inputs per call in
+ * structure-of-arrays form (FloatN holds one float per lane, as a GCC/Clang
+ * vector type). Branches become per-lane selects, and loops run to the
+ * longest lane with the others masked off, so the results equal the scalar
+ * ports to float rounding. Transcendentals (sin, atan2, pow, exp, log)
+ * still call libm once per lane, so the benchmark shows where a vector
+ * approximation would pay off.
+ *
+ * min, max and clamp follow Metal (fmin/fmax: a NaN operand loses), which
+ * the disk code relies on where calculateDopplerEffect goes NaN inside
+ * r = 3.
+ *
+ * Only tools/shading_bench.cpp uses these ports; nothing here runs in the
+ * renderer.
+ */
+
+#ifndef shading_cpu_h
+#define shading_cpu_h
+
+#include "DiskColorMap.h"
+#include "Geodesic.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace shading {
+
+//==============================================================================
+// LANES
+//==============================================================================
+
+// One hardware register: AVX (build with -march=native), else SSE2 or NEON
+#ifdef __AVX__
+constexpr int kLanes = 8;
+#else
+constexpr int kLanes = 4;
+#endif
+
+// GCC/Clang vector extensions: each operator becomes whole-register
+// instructions, which per-lane loops do not reliably do
+typedef float LaneFloats __attribute__((vector_size(kLanes * 4)));
+typedef uint32_t LaneUints __attribute__((vector_size(kLanes * 4)));
+typedef int32_t LaneInts __attribute__((vector_size(kLanes * 4)));
+
+// Per-lane boolean: all bits set where true (as SIMD compares produce)
+struct MaskN
+{
+    LaneInts v;
+
+    MaskN() = default;
+    explicit MaskN(LaneInts lanes) : v(lanes) {}
+};
+
+struct FloatN
+{
+    LaneFloats v;
+
+    FloatN() = default;
+    FloatN(float s) : v(LaneFloats{} + s) {}
+    explicit FloatN(LaneFloats lanes) : v(lanes) {}
+};
+
+struct UintN
+{
+    LaneUints v;
+
+    UintN() = default;
+    UintN(uint32_t s) : v(LaneUints{} + s) {}
+    explicit UintN(LaneUints lanes) : v(lanes) {}
+};
+
+#define SHADING_LANE_BINARY(Type, op)                           \
+    inline Type operator op(const Type& a, const Type& b)       \
+    {                                                           \
+        return Type(a.v op b.v);                                \
+    }
+
+#define SHADING_LANE_COMPARE(Type, op)                          \
+    inline MaskN operator op(const Type& a, const Type& b)      \
+    {                                                           \
+        return MaskN((LaneInts)(a.v op b.v));                   \
+    }
+
+#define SHADING_LANE_ASSIGN(Type, op)                           \
+    inline Type& operator op##=(Type& a, const Type& b)         \
+    {                                                           \
+        return a = a op b;                                      \
+    }
+
+SHADING_LANE_BINARY(FloatN, +)
+SHADING_LANE_BINARY(FloatN, -)
+SHADING_LANE_BINARY(FloatN, *)
+SHADING_LANE_BINARY(FloatN, /)
+SHADING_LANE_ASSIGN(FloatN, +)
+SHADING_LANE_ASSIGN(FloatN, -)
+SHADING_LANE_ASSIGN(FloatN, *)
+SHADING_LANE_ASSIGN(FloatN, /)
+SHADING_LANE_COMPARE(FloatN, <)
+SHADING_LANE_COMPARE(FloatN, <=)
+SHADING_LANE_COMPARE(FloatN, >)
+SHADING_LANE_COMPARE(FloatN, >=)
+SHADING_LANE_COMPARE(FloatN, !=)
+
+SHADING_LANE_BINARY(UintN, +)
+SHADING_LANE_BINARY(UintN, *)
+SHADING_LANE_BINARY(UintN, ^)
+SHADING_LANE_BINARY(UintN, &)
+SHADING_LANE_BINARY(UintN, |)
+SHADING_LANE_ASSIGN(UintN, ^)
+SHADING_LANE_ASSIGN(UintN, *)
+SHADING_LANE_COMPARE(UintN, <)
+SHADING_LANE_COMPARE(UintN, ==)
+SHADING_LANE_COMPARE(UintN, !=)
+
+SHADING_LANE_BINARY(MaskN, &)
+SHADING_LANE_BINARY(MaskN, |)
+
+#undef SHADING_LANE_BINARY
+#undef SHADING_LANE_COMPARE
+#undef SHADING_LANE_ASSIGN
+
+inline FloatN operator-(const FloatN& a) { return FloatN(-a.v); }
+inline UintN operator>>(const UintN& a, int shift) { return UintN(a.v >> shift); }
+inline MaskN operator!(const MaskN& a) { return MaskN(~a.v); }
+
+inline bool any(const MaskN& m)
+{
+    int32_t bits = 0;
+    for (int i = 0; i < kLanes; ++i) {
+        bits |= m.v[i];
+    }
+    return bits != 0;
+}
+
+inline bool any(bool m) { return m; }
+
+// Metal's select: c ? b : a
+inline float select(float a, float b, bool c) { return c ? b : a; }
+inline uint32_t select(uint32_t a, uint32_t b, bool c) { return c ? b : a; }
+
+// Bitwise blend, so it needs no per-lane branch
+inline FloatN select(const FloatN& a, const FloatN& b, const MaskN& c)
+{
+    return FloatN((LaneFloats)(((LaneInts)b.v & c.v) | ((LaneInts)a.v & ~c.v)));
+}
+
+//==============================================================================
+// MATH (Metal semantics for float and FloatN)
+//==============================================================================
+
+// fmax/fmin as a compare and blend: a NaN operand loses
+inline float max(float a, float b) { return (a > b || b != b) ? a : b; }
+inline float min(float a, float b) { return (a < b || b != b) ? a : b; }
+inline float clamp(float x, float lo, float hi) { return min(max(x, lo), hi); }
+inline float mix(float a, float b, float t) { return a + (b - a) * t; }
+inline float step(float edge, float x) { return x < edge ? 0.0f : 1.0f; }
+inline float abs(float x) { return std::fabs(x); }
+inline float sqrt(float x) { return std::sqrt(x); }
+inline float floor(float x) { return std::floor(x); }
+inline float ceil(float x) { return std::ceil(x); }
+inline float sin(float x) { return std::sin(x); }
+inline float cos(float x) { return std::cos(x); }
+inline float atan2(float y, float x) { return std::atan2(y, x); }
+inline float asin(float x) { return std::asin(x); }
+inline float pow(float x, float y) { return std::pow(x, y); }
+inline float exp(float x) { return std::exp(x); }
+inline float log(float x) { return std::log(x); }
+
+inline float smoothstep(float e0, float e1, float x)
+{
+    float t = clamp((x - e0) / (e1 - e0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+inline FloatN max(const FloatN& a, const FloatN& b) { return select(b, a, (a > b) | (b != b)); }
+inline FloatN min(const FloatN& a, const FloatN& b) { return select(b, a, (a < b) | (b != b)); }
+inline FloatN clamp(const FloatN& x, const FloatN& lo, const FloatN& hi) { return min(max(x, lo), hi); }
+inline FloatN mix(const FloatN& a, const FloatN& b, const FloatN& t) { return a + (b - a) * t; }
+inline FloatN step(const FloatN& edge, const FloatN& x) { return select(FloatN(1.0f), FloatN(0.0f), x < edge); }
+inline FloatN abs(const FloatN& a) { return FloatN((LaneFloats)((LaneInts)a.v & 0x7fffffff)); }
+
+inline FloatN smoothstep(const FloatN& e0, const FloatN& e1, const FloatN& x)
+{
+    FloatN t = clamp((x - e0) / (e1 - e0), 0.0f, 1.0f);
+    return t * t * (FloatN(3.0f) - FloatN(2.0f) * t);
+}
+
+// Truncate and correct; exact for |x| < 2^31, which covers the noise lattice
+inline FloatN floor(const FloatN& a)
+{
+    FloatN t(__builtin_convertvector(__builtin_convertvector(a.v, LaneInts), LaneFloats));
+    return select(t, t - 1.0f, t > a);
+}
+
+inline FloatN ceil(const FloatN& a)
+{
+    FloatN t(__builtin_convertvector(__builtin_convertvector(a.v, LaneInts), LaneFloats));
+    return select(t, t + 1.0f, t < a);
+}
+
+// Per-lane libm; with -fno-math-errno the compiler turns sqrt into one
+// vector instruction, the rest stay calls
+#define SHADING_LANE_UNARY(name, expr)                          \
+    inline FloatN name(const FloatN& a)                         \
+    {                                                           \
+        FloatN r;                                               \
+        for (int i = 0; i < kLanes; ++i) {                      \
+            float x = a.v[i];                                   \
+            r.v[i] = expr;                                      \
+        }                                                       \
+        return r;                                               \
+    }
+
+#define SHADING_LANE_BINARY_FN(name, expr)                      \
+    inline FloatN name(const FloatN& a, const FloatN& b)        \
+    {                                                           \
+        FloatN r;                                               \
+        for (int i = 0; i < kLanes; ++i) {                      \
+            float x = a.v[i];                                   \
+            float y = b.v[i];                                   \
+            r.v[i] = expr;                                      \
+        }                                                       \
+        return r;                                               \
+    }
+
+SHADING_LANE_UNARY(sqrt, std::sqrt(x))
+SHADING_LANE_UNARY(sin, std::sin(x))
+SHADING_LANE_UNARY(cos, std::cos(x))
+SHADING_LANE_UNARY(asin, std::asin(x))
+SHADING_LANE_UNARY(exp, std::exp(x))
+SHADING_LANE_UNARY(log, std::log(x))
+SHADING_LANE_BINARY_FN(atan2, std::atan2(x, y))
+SHADING_LANE_BINARY_FN(pow, std::pow(x, y))
+
+#undef SHADING_LANE_UNARY
+#undef SHADING_LANE_BINARY_FN
+
+// uint(int(x)) as in uint4(int4(x)); x must fit in int32
+inline uint32_t toUint(float x) { return (uint32_t)(int32_t)x; }
+inline UintN toUint(const FloatN& a) { return UintN((LaneUints)__builtin_convertvector(a.v, LaneInts)); }
+
+// Geodesic.h's square root, found by argument lookup for FloatN
+inline FloatN geodesicSqrt(const FloatN& x) { return sqrt(x); }
+
+//==============================================================================
+// VECTORS
+//==============================================================================
+
+template <typename F>
+struct Vec3
+{
+    F x, y, z;
+};
+
+// Scalar operands of a Vec3<F> take part in deduction only through the vector
+template <typename T>
+struct NoDeduce
+{
+    using type = T;
+};
+
+template <typename F>
+inline Vec3<F> operator+(const Vec3<F>& a, const Vec3<F>& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+template <typename F>
+inline Vec3<F> operator-(const Vec3<F>& a, const Vec3<F>& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+template <typename F>
+inline Vec3<F> operator-(const Vec3<F>& a) { return { -a.x, -a.y, -a.z }; }
+template <typename F>
+inline Vec3<F> operator*(const Vec3<F>& a, const typename NoDeduce<F>::type& s) { return { a.x * s, a.y * s, a.z * s }; }
+template <typename F>
+inline Vec3<F> operator/(const Vec3<F>& a, const typename NoDeduce<F>::type& s) { return { a.x / s, a.y / s, a.z / s }; }
+template <typename F>
+inline Vec3<F> operator+(const Vec3<F>& a, const typename NoDeduce<F>::type& s) { return { a.x + s, a.y + s, a.z + s }; }
+template <typename F>
+inline Vec3<F>& operator+=(Vec3<F>& a, const Vec3<F>& b) { return a = a + b; }
+template <typename F>
+inline F dot(const Vec3<F>& a, const Vec3<F>& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+template <typename F>
+inline Vec3<F> cross(const Vec3<F>& a, const Vec3<F>& b)
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+template <typename F>
+inline F length(const Vec3<F>& a) { return sqrt(dot(a, a)); }
+template <typename F>
+inline Vec3<F> normalize(const Vec3<F>& a) { return a * (F(1.0f) / length(a)); }
+template <typename F>
+inline Vec3<F> mix(const Vec3<F>& a, const Vec3<F>& b, const typename NoDeduce<F>::type& t)
+{
+    return { mix(a.x, b.x, t), mix(a.y, b.y, t), mix(a.z, b.z, t) };
+}
+
+template <typename F>
+inline Vec3<F> select(const Vec3<F>& a, const Vec3<F>& b, const MaskN& c)
+{
+    return { select(a.x, b.x, c), select(a.y, b.y, c), select(a.z, b.z, c) };
+}
+
+//==============================================================================
+// SCENE PARAMETERS
+//==============================================================================
+
+// The Uniforms fields the disk reads, at the renderer's defaults
+struct ShadingParams
+{
+    float disk_radius = 5.0f;
+    float disk_thickness = 0.2f;
+    float black_hole_size = 0.12f;
+    float disk_density_vertical = 2.0f;
+    float disk_density_horizontal = 4.0f;
+    float disk_density_gain = 16000.0f;
+    float disk_density_clamp = 12.0f;
+    float disk_noise_scale = 0.8f;
+    float disk_noise_speed = 0.5f;
+    int disk_noise_octaves = 5;
+    float disk_emission_strength = 0.25f;
+    float disk_alpha_falloff = 0.55f;
+    float disk_inner_multiplier = 25.0f;
+    float disk_inner_softness = 1.1f;
+    float disk_color_mix = 0.65f;
+    float disk_noise_lod_bias = 1.0f;
+};
+
+// diskColorMap with linear filtering and clamp-to-edge, as the Metal sampler
+class DiskColorMap
+{
+public:
+    static constexpr int kWidth = 256;
+
+    DiskColorMap()
+    {
+        uint8_t rgba[kWidth * 4];
+        fillDiskColorMap(rgba, kWidth);
+        for (int i = 0; i < kWidth; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                _rgb[i][c] = rgba[i * 4 + c] / 255.0f;
+            }
+        }
+    }
+
+    Vec3<float> sample(float u) const
+    {
+        float x = u * kWidth - 0.5f;
+        float f = x - std::floor(x);
+        int i0 = std::clamp((int)std::floor(x), 0, kWidth - 1);
+        int i1 = std::clamp((int)std::floor(x) + 1, 0, kWidth - 1);
+        return { _rgb[i0][0] + (_rgb[i1][0] - _rgb[i0][0]) * f, _rgb[i0][1] + (_rgb[i1][1] - _rgb[i0][1]) * f,
+                 _rgb[i0][2] + (_rgb[i1][2] - _rgb[i0][2]) * f };
+    }
+
+    // One gather per lane
+    Vec3<FloatN> sample(const FloatN& u) const
+    {
+        Vec3<FloatN> r;
+        for (int i = 0; i < kLanes; ++i) {
+            Vec3<float> c = sample(u.v[i]);
+            r.x.v[i] = c.x;
+            r.y.v[i] = c.y;
+            r.z.v[i] = c.z;
+        }
+        return r;
+    }
+
+private:
+    float _rgb[kWidth][3];
+};
+
+// color (rgb and coverage a) and remaining transmittance alpha of rayMarch
+template <typename F>
+struct DiskAccum
+{
+    Vec3<F> color;
+    F coverage;
+    F alpha;
+};
+
+//==============================================================================
+// PHYSICS HELPERS
+//==============================================================================
+
+// Natural units (G = M = c = 1)
+const float G = 1.0f;
+const float M = 1.0f;
+const float c = 1.0f;
+
+// Branch-free, so one template serves both variants
+template <typename F>
+inline Vec3<F> toSpherical(const Vec3<F>& pos)
+{
+    F rho = sqrt((pos.x * pos.x) + (pos.y * pos.y) + (pos.z * pos.z));
+    F theta = atan2(pos.z, pos.x);
+    F phi = asin(pos.y / rho);
+    return { rho, theta, phi };
+}
+
+// RGB; the Metal version's alpha is always 1
+inline Vec3<float> getBlackBodyColor(float temp)
+{
+    temp = clamp(temp, 1000.0f, 40000.0f);
+
+    Vec3<float> color;
+    if (temp < 3500.0f) {
+        color = { 1.0f, 0.3f + 0.7f * (temp - 1000.0f) / 2500.0f, 0.0f };
+    } else if (temp < 5000.0f) {
+        color = { 1.0f, 0.8f + 0.2f * (temp - 3500.0f) / 1500.0f, 0.1f + 0.4f * (temp - 3500.0f) / 1500.0f };
+    } else {
+        float t = (temp - 5000.0f) / 35000.0f;
+        color = { 1.0f - 0.3f * t, 1.0f - 0.2f * t, 1.0f };
+    }
+    return color;
+}
+
+inline Vec3<FloatN> getBlackBodyColor(FloatN temp)
+{
+    temp = clamp(temp, 1000.0f, 40000.0f);
+    MaskN cool = temp < FloatN(3500.0f);
+    MaskN warm = temp < FloatN(5000.0f);
+    FloatN t = (temp - 5000.0f) / 35000.0f;
+    FloatN warmT = (temp - 3500.0f) / 1500.0f;
+
+    Vec3<FloatN> hot = { FloatN(1.0f) - FloatN(0.3f) * t, FloatN(1.0f) - FloatN(0.2f) * t, FloatN(1.0f) };
+    Vec3<FloatN> mid = { FloatN(1.0f), FloatN(0.8f) + FloatN(0.2f) * warmT, FloatN(0.1f) + FloatN(0.4f) * warmT };
+    Vec3<FloatN> low = { FloatN(1.0f), FloatN(0.3f) + FloatN(0.7f) * (temp - 1000.0f) / 2500.0f, FloatN(0.0f) };
+    return select(select(hot, mid, warm), low, cool);
+}
+
+inline float calculateRedShift(const Vec3<float>& pos)
+{
+    float dist = sqrt(dot(pos, pos));
+    if (dist < 1.0f) {
+        return 0.0f;  // Inside event horizon, infinite redshift
+    }
+    float redshift = sqrt(1.0f - 1.0f / dist) - 1.0f;
+    redshift = (1.0f / (1.0f + redshift));
+    return redshift;
+}
+
+inline FloatN calculateRedShift(const Vec3<FloatN>& pos)
+{
+    FloatN dist = sqrt(dot(pos, pos));
+    FloatN redshift = sqrt(FloatN(1.0f) - FloatN(1.0f) / dist) - 1.0f;
+    redshift = FloatN(1.0f) / (FloatN(1.0f) + redshift);
+    return select(redshift, FloatN(0.0f), dist < FloatN(1.0f));
+}
+
+inline float calculateDopplerEffect(const Vec3<float>& pos, const Vec3<float>& viewDir)
+{
+    float r = length(pos);
+    if (r < 1.0f) {
+        return 1.0f;  // Inside event horizon
+    }
+
+    // Relativistic orbital velocity (circular orbit)
+    float velMag = -sqrt((G * M / r) * (1.0f - 3.0f * G * M / (r * c * c)));
+    Vec3<float> velDir = normalize(cross(Vec3<float>{ 0.0f, 1.0f, 0.0f }, pos));
+    Vec3<float> vel = velDir * velMag;
+
+    // Relativistic Doppler formula
+    Vec3<float> beta_s = vel / c;
+    float gamma = 1.0f / sqrt(1.0f - dot(beta_s, beta_s));
+    return gamma * (1.0f + dot(vel, normalize(viewDir)));
+}
+
+inline FloatN calculateDopplerEffect(const Vec3<FloatN>& pos, const Vec3<FloatN>& viewDir)
+{
+    FloatN r = length(pos);
+    FloatN velMag = -sqrt((FloatN(G * M) / r) * (FloatN(1.0f) - FloatN(3.0f * G * M) / (r * (c * c))));
+    Vec3<FloatN> up = { FloatN(0.0f), FloatN(1.0f), FloatN(0.0f) };
+    Vec3<FloatN> vel = normalize(cross(up, pos)) * velMag;
+    Vec3<FloatN> beta_s = vel / FloatN(c);
+    FloatN gamma = FloatN(1.0f) / sqrt(FloatN(1.0f) - dot(beta_s, beta_s));
+    FloatN doppler = gamma * (FloatN(1.0f) + dot(vel, normalize(viewDir)));
+    return select(doppler, FloatN(1.0f), r < FloatN(1.0f));
+}
+
+template <typename F>
+inline F calculateRealisticTemperature(const Vec3<F>& pos, float baseTemp)
+{
+    return F(baseTemp) * pow(length(pos), F(-0.75f));
+}
+
+//==============================================================================
+// NOISE (shaders/Noise.h)
+//==============================================================================
+
+const float NOISE_F3 = 1.0f / 3.0f;
+const float NOISE_G3 = 1.0f / 6.0f;
+const float NOISE_SCALE = 32.0f;
+
+template <typename U>
+inline U noiseHash(U x, U y, U z)
+{
+    U h = x * U(0x8da6b343u) ^ y * U(0xd8163841u) ^ z * U(0xcb1ab31fu);
+    h ^= h >> 16;
+    h *= U(0x7feb352du);
+    h ^= h >> 15;
+    h *= U(0x846ca68bu);
+    h ^= h >> 16;
+    return h;
+}
+
+template <typename T, typename U>
+inline T noiseGradDot(U h, T x, T y, T z)
+{
+    U g = h & U(15u);
+    T u = select(y, x, g < U(8u));
+    T v = select(select(z, x, (g | U(2u)) == U(14u)), y, g < U(4u));
+    return select(u, -u, (g & U(1u)) != U(0u)) + select(v, -v, (g & U(2u)) != U(0u));
+}
+
+// Scalar reference, one point
+inline float snoise(const Vec3<float>& v)
+{
+    // Skew to find the simplex cell
+    float s = (v.x + v.y + v.z) * NOISE_F3;
+    Vec3<float> i = { floor(v.x + s), floor(v.y + s), floor(v.z + s) };
+    float t = (i.x + i.y + i.z) * NOISE_G3;
+    Vec3<float> x0 = { v.x - i.x + t, v.y - i.y + t, v.z - i.z + t };
+
+    // Rank the offsets: g = step(x0.yzx, x0.xyz), l = 1 - g
+    Vec3<float> g = { step(x0.y, x0.x), step(x0.z, x0.y), step(x0.x, x0.z) };
+    Vec3<float> l = { 1.0f - g.x, 1.0f - g.y, 1.0f - g.z };
+    Vec3<float> i1 = { min(g.x, l.z), min(g.y, l.x), min(g.z, l.y) };
+    Vec3<float> i2 = { max(g.x, l.z), max(g.y, l.x), max(g.z, l.y) };
+
+    Vec3<float> x1 = x0 - i1 + NOISE_G3;
+    Vec3<float> x2 = x0 - i2 + 2.0f * NOISE_G3;
+    Vec3<float> x3 = x0 + (-1.0f + 3.0f * NOISE_G3);
+
+    uint32_t cx = toUint(i.x), cy = toUint(i.y), cz = toUint(i.z);
+    float n = 0.0f;
+    const Vec3<float>* corners[4] = { &x0, &x1, &x2, &x3 };
+    uint32_t lattice[4][3] = {
+        { cx, cy, cz },
+        { cx + toUint(i1.x), cy + toUint(i1.y), cz + toUint(i1.z) },
+        { cx + toUint(i2.x), cy + toUint(i2.y), cz + toUint(i2.z) },
+        { cx + 1u, cy + 1u, cz + 1u },
+    };
+    for (int k = 0; k < 4; ++k) {
+        const Vec3<float>& x = *corners[k];
+        float tk = max(0.6f - dot(x, x), 0.0f);
+        tk *= tk;
+        tk *= tk;
+        n += tk * noiseGradDot(noiseHash(lattice[k][0], lattice[k][1], lattice[k][2]), x.x, x.y, x.z);
+    }
+    return NOISE_SCALE * n;
+}
+
+inline FloatN snoiseCorner(const UintN& cx, const UintN& cy, const UintN& cz, const FloatN& dx, const FloatN& dy,
+                           const FloatN& dz)
+{
+    FloatN t = max(FloatN(0.6f) - (dx * dx + dy * dy + dz * dz), FloatN(0.0f));
+    t *= t;
+    return t * t * noiseGradDot(noiseHash(cx, cy, cz), dx, dy, dz);
+}
+
+// snoise4 of Noise.h widened to kLanes points (structure of arrays)
+inline FloatN snoise(const FloatN& x, const FloatN& y, const FloatN& z)
+{
+    FloatN s = (x + y + z) * NOISE_F3;
+    FloatN ix = floor(x + s);
+    FloatN iy = floor(y + s);
+    FloatN iz = floor(z + s);
+    FloatN t = (ix + iy + iz) * NOISE_G3;
+    FloatN x0 = x - ix + t;
+    FloatN y0 = y - iy + t;
+    FloatN z0 = z - iz + t;
+
+    FloatN gx = step(y0, x0);
+    FloatN gy = step(z0, y0);
+    FloatN gz = step(x0, z0);
+    FloatN one(1.0f);
+    FloatN i1x = min(gx, one - gz);
+    FloatN i1y = min(gy, one - gx);
+    FloatN i1z = min(gz, one - gy);
+    FloatN i2x = max(gx, one - gz);
+    FloatN i2y = max(gy, one - gx);
+    FloatN i2z = max(gz, one - gy);
+
+    UintN cx = toUint(ix);
+    UintN cy = toUint(iy);
+    UintN cz = toUint(iz);
+
+    FloatN g1(NOISE_G3), g2(2.0f * NOISE_G3), g3(-1.0f + 3.0f * NOISE_G3);
+    FloatN n = snoiseCorner(cx, cy, cz, x0, y0, z0);
+    n += snoiseCorner(cx + toUint(i1x), cy + toUint(i1y), cz + toUint(i1z), x0 - i1x + g1, y0 - i1y + g1, z0 - i1z + g1);
+    n += snoiseCorner(cx + toUint(i2x), cy + toUint(i2y), cz + toUint(i2z), x0 - i2x + g2, y0 - i2y + g2, z0 - i2z + g2);
+    n += snoiseCorner(cx + UintN(1u), cy + UintN(1u), cz + UintN(1u), x0 + g3, y0 + g3, z0 + g3);
+    return n * NOISE_SCALE;
+}
+
+inline FloatN snoise(const Vec3<FloatN>& p) { return snoise(p.x, p.y, p.z); }
+
+//==============================================================================
+// ACCRETION DISK
+//==============================================================================
+
+const float diskSampleLength = 0.1f;
+
+// diskSample of BlackHole.metal (Standard tier, spectral mode off)
+inline void diskSample(const Vec3<float>& pos, float ds, DiskAccum<float>& acc, const Vec3<float>& viewDir,
+                       float footprint, float time, const ShadingParams& uniforms, const DiskColorMap& diskColorMap)
+{
+    float innerMultiplier = max(uniforms.disk_inner_multiplier, 1.0f);
+    float innerRadius = uniforms.black_hole_size * innerMultiplier;
+    float outerRadius = uniforms.disk_radius;
+    float innerSoftness = max(uniforms.disk_inner_softness, 1.01f);
+
+    // Disk is in XZ plane at y=0
+    float diskThickness = max(uniforms.disk_thickness, 0.01f);
+    float yDisk = abs(pos.y);
+    float rDisk = std::sqrt(pos.x * pos.x + pos.z * pos.z);
+
+    float radiusSpan = max(outerRadius - innerRadius, 0.0001f);
+    float radialNorm = clamp((rDisk - innerRadius) / radiusSpan, 0.0f, 1.0f);
+
+    if (yDisk > diskThickness || rDisk < innerRadius || rDisk > outerRadius) {
+        return;
+    }
+
+    float keplerFactor = pow(max(innerRadius / max(rDisk, innerRadius + 0.001f), 0.001f), 1.5f);
+    float rotationRate = max(uniforms.disk_noise_speed * 2.2f, 0.0f);
+    float rotationAngle = time * rotationRate * keplerFactor;
+    float sA = sin(rotationAngle);
+    float cA = cos(rotationAngle);
+    float rotatedX = pos.x * cA - pos.z * sA;
+    float rotatedZ = pos.x * sA + pos.z * cA;
+    Vec3<float> advectedPos = { rotatedX, pos.y, rotatedZ };
+    float angularPos = atan2(rotatedZ, rotatedX);
+
+    float density = 1.0f - smoothstep(innerRadius, outerRadius, rDisk);
+    float verticalNorm = clamp(1.0f - yDisk / diskThickness, 0.0f, 0.999f);
+    float verticalExp = max(uniforms.disk_density_vertical, 0.1f);
+    density *= pow(verticalNorm, verticalExp);
+    density *= smoothstep(innerRadius, innerRadius * innerSoftness, rDisk);
+
+    if (density <= 0.0f) {
+        return;
+    }
+
+    Vec3<float> sphericalCoord = toSpherical(advectedPos);
+    sphericalCoord.y *= 2.0f;
+    sphericalCoord.z *= 4.0f;
+
+    float radialExp = max(uniforms.disk_density_horizontal, 0.1f);
+    density *= 1.0f / pow(max(sphericalCoord.x, 0.001f), radialExp);
+    density *= uniforms.disk_density_gain;
+    if (uniforms.disk_density_clamp > 0.0f) {
+        density = clamp(density, 0.0f, uniforms.disk_density_clamp);
+    }
+
+    float bandMix = clamp(radialNorm, 0.0f, 1.0f);
+    float primaryFreq = mix(12.0f, 24.0f, 1.0f - bandMix);
+    float secondaryFreq = mix(5.0f, 11.0f, 1.0f - bandMix);
+    float primaryPhase = angularPos * primaryFreq - rotationAngle * 1.6f + bandMix * 2.5f;
+    float secondaryPhase = angularPos * secondaryFreq + rotationAngle * 0.85f +
+                           snoise(Vec3<float>{ rDisk * 0.1f, pos.y * 3.0f, time * 0.05f }) * 2.0f;
+    float ridge = sin(primaryPhase);
+    float valley = sin(secondaryPhase);
+    float laneMask = clamp(0.55f + 0.45f * ridge, 0.05f, 1.0f) * clamp(0.6f + 0.4f * valley, 0.05f, 1.0f);
+    laneMask = pow(laneMask, mix(1.5f, 0.8f, bandMix));
+    float bandNoise = 0.5f + 0.5f * snoise(Vec3<float>{ angularPos * 0.5f, bandMix * 3.0f, time * 0.15f });
+    density *= mix(0.35f, 1.25f, laneMask * bandNoise);
+
+    float noise = 1.0f;
+    int noiseOctaves = std::clamp(uniforms.disk_noise_octaves, 1, 8);
+    float noiseScale = max(uniforms.disk_noise_scale, 0.001f);
+    float noiseSpeed = uniforms.disk_noise_speed;
+
+    float lodBias = uniforms.disk_noise_lod_bias;
+    float latticeFootprint = (lodBias > 0.0f) ? footprint * lodBias * max(1.0f, 4.0f / max(rDisk, 0.001f)) * noiseScale
+                                              : 0.0f;
+
+    // Culled octaves are skipped (the Metal code batches the rest by four)
+    int culled = 0;
+    for (int i = 0; i < noiseOctaves; ++i) {
+        float octave = pow(float(i) + 1.0f, 2.0f);
+        float octaveSpeed = noiseSpeed * (1.0f + 0.18f * float(i));
+        float octaveWeight = 1.0f - smoothstep(0.5f, 1.0f, latticeFootprint * octave);
+        if (octaveWeight > 0.0f) {
+            float value = snoise(sphericalCoord * (octave * noiseScale));
+            noise *= mix(0.45f, 0.55f * value + 0.45f, octaveWeight);
+        } else {
+            culled++;
+        }
+        float direction = (i % 2 == 0) ? -1.0f : 1.0f;
+        sphericalCoord.y += direction * time * octaveSpeed * keplerFactor;
+    }
+    // Culled octaves contribute their mean factor
+    noise *= pow(0.45f, float(culled));
+
+    float microWeight = 1.0f - smoothstep(0.5f, 1.0f, latticeFootprint * 18.0f);
+    if (microWeight > 0.0f) {
+        float microDetail = 0.5f + 0.5f * snoise(sphericalCoord * (18.0f * noiseScale) + time * 0.3f);
+        noise *= mix(1.0f, mix(0.85f, 1.15f, microDetail), microWeight);
+    }
+
+    Vec3<float> tangentDir = normalize(Vec3<float>{ -advectedPos.z, 0.0f, advectedPos.x });
+    float viewDot = clamp(dot(tangentDir, -normalize(viewDir)), -1.0f, 1.0f);
+    float relativisticLane = pow(clamp(1.0f + viewDot * 0.75f, 0.25f, 2.5f), 3.0f);
+
+    float redshift = calculateRedShift(pos);
+    float doppler = calculateDopplerEffect(pos, viewDir);
+    doppler = max(doppler, 0.2f);
+
+    Vec3<float> sampledColor = diskColorMap.sample(radialNorm);
+
+    float accretionTempMod = calculateRealisticTemperature(pos, 7500.0f);
+    accretionTempMod /= doppler;
+    accretionTempMod /= redshift;
+
+    Vec3<float> dustColor = getBlackBodyColor(accretionTempMod * redshift);
+    Vec3<float> baseColor = mix(dustColor, sampledColor, clamp(uniforms.disk_color_mix, 0.0f, 1.0f));
+
+    float beaming = pow(doppler, 3.0f);
+
+    float photonProximity = smoothstep(innerRadius * 1.5f, innerRadius * 1.05f, rDisk);
+    float lensingFlare = 1.0f + 1.8f * photonProximity * pow(clamp(viewDot * 0.5f + 0.5f, 0.0f, 1.0f), 2.0f);
+
+    float turbulent = clamp(abs(noise), 0.22f, 1.7f);
+    float beamingBoost = clamp(0.6f + (beaming - 1.0f) * 0.65f, 0.35f, 1.95f) * relativisticLane * lensingFlare;
+    float innerGlow = 1.0f + 2.8f * pow(1.0f - radialNorm, 2.6f);
+    float rawDeposit = clamp(density * turbulent * uniforms.disk_emission_strength * beamingBoost * innerGlow, 0.0f, 2.8f);
+
+    if (rawDeposit <= 1e-4f) {
+        return;
+    }
+
+    Vec3<float> warmTint = { 1.08f + 0.05f * viewDot, 0.92f + 0.06f * viewDot, 0.78f - 0.1f * viewDot };
+    Vec3<float> hotCore = { 1.18f, 1.1f, 1.08f };
+    float photonMix = smoothstep(0.0f, 0.45f, 1.0f - radialNorm);
+    Vec3<float> tintedColor = mix(hotCore, warmTint, 1.0f - photonMix);
+    Vec3<float> diskColor = mix(tintedColor, baseColor, 0.75f);
+
+    float alphaFalloff = clamp(uniforms.disk_alpha_falloff, 0.0f, 1.0f);
+    float attenuation = clamp(rawDeposit * alphaFalloff * (0.75f + 0.45f * (1.0f - radialNorm)), 0.0f, 0.95f);
+    float transmittance = exp(log(1.0f - attenuation) * (ds / diskSampleLength));
+    float emitted = attenuation > 1e-4f ? rawDeposit * (1.0f - transmittance) / attenuation
+                                        : rawDeposit * (ds / diskSampleLength);
+
+    float deposit = emitted * acc.alpha;
+    acc.color += diskColor * deposit;
+    acc.coverage = min(acc.coverage + acc.alpha * (1.0f - transmittance), 1.0f);
+    acc.alpha *= transmittance;
+}
+
+// diskRender of BlackHole.metal: the segment a → b inside the slab
+inline void diskRender(const Vec3<float>& a, const Vec3<float>& b, DiskAccum<float>& acc, const Vec3<float>& viewDir,
+                       float footprint, float time, const ShadingParams& uniforms, const DiskColorMap& diskColorMap)
+{
+    float halfHeight = max(uniforms.disk_thickness, 0.01f);
+    Vec3<float> d = b - a;
+    float t0 = 0.0f;
+    float t1 = 1.0f;
+    if (abs(d.y) > 1e-6f) {
+        float ta = (-halfHeight - a.y) / d.y;
+        float tb = (halfHeight - a.y) / d.y;
+        t0 = max(t0, min(ta, tb));
+        t1 = min(t1, max(ta, tb));
+    } else if (abs(a.y) > halfHeight) {
+        return;
+    }
+    if (t0 >= t1) {
+        return;
+    }
+
+    float inside = length(d) * (t1 - t0);
+    int samples = std::clamp(int(ceil(inside / diskSampleLength)), 1, 8);
+    float ds = inside / float(samples);
+    for (int i = 0; i < samples; ++i) {
+        float t = t0 + (t1 - t0) * (float(i) + 0.5f) / float(samples);
+        diskSample(a + d * t, ds, acc, viewDir, footprint, time, uniforms, diskColorMap);
+        if (acc.alpha < 0.01f) {
+            return;
+        }
+    }
+}
+
+/**
+ * diskSample for kLanes samples; lanes outside active are left untouched
+ *
+ * Every octave is evaluated for every lane. A culled octave has weight 0,
+ * so its factor mix(0.45, n, 0) is exactly the mean 0.45 the scalar code
+ * multiplies in, and the lanes agree without divergent branches.
+ */
+inline void diskSample(const Vec3<FloatN>& pos, const FloatN& ds, DiskAccum<FloatN>& acc, const Vec3<FloatN>& viewDir,
+                       const FloatN& footprint, float time, const ShadingParams& uniforms,
+                       const DiskColorMap& diskColorMap, MaskN active)
+{
+    float innerRadius = uniforms.black_hole_size * max(uniforms.disk_inner_multiplier, 1.0f);
+    float outerRadius = uniforms.disk_radius;
+    float innerSoftness = max(uniforms.disk_inner_softness, 1.01f);
+    float diskThickness = max(uniforms.disk_thickness, 0.01f);
+
+    FloatN yDisk = abs(pos.y);
+    FloatN rDisk = sqrt(pos.x * pos.x + pos.z * pos.z);
+    FloatN radialNorm = clamp((rDisk - innerRadius) / max(outerRadius - innerRadius, 0.0001f), 0.0f, 1.0f);
+
+    active = active & (yDisk <= FloatN(diskThickness)) & (rDisk >= FloatN(innerRadius)) & (rDisk <= FloatN(outerRadius));
+    if (!any(active)) {
+        return;
+    }
+
+    FloatN keplerFactor = pow(max(FloatN(innerRadius) / max(rDisk, FloatN(innerRadius + 0.001f)), FloatN(0.001f)),
+                              FloatN(1.5f));
+    FloatN rotationAngle = keplerFactor * (time * max(uniforms.disk_noise_speed * 2.2f, 0.0f));
+    FloatN sA = sin(rotationAngle);
+    FloatN cA = cos(rotationAngle);
+    FloatN rotatedX = pos.x * cA - pos.z * sA;
+    FloatN rotatedZ = pos.x * sA + pos.z * cA;
+    Vec3<FloatN> advectedPos = { rotatedX, pos.y, rotatedZ };
+    FloatN angularPos = atan2(rotatedZ, rotatedX);
+
+    FloatN density = FloatN(1.0f) - smoothstep(innerRadius, outerRadius, rDisk);
+    FloatN verticalNorm = clamp(FloatN(1.0f) - yDisk / diskThickness, 0.0f, 0.999f);
+    density *= pow(verticalNorm, FloatN(max(uniforms.disk_density_vertical, 0.1f)));
+    density *= smoothstep(innerRadius, innerRadius * innerSoftness, rDisk);
+    active = active & (density > FloatN(0.0f));
+
+    Vec3<FloatN> sphericalCoord = toSpherical(advectedPos);
+    sphericalCoord.y *= 2.0f;
+    sphericalCoord.z *= 4.0f;
+
+    density *= FloatN(1.0f) /
+               pow(max(sphericalCoord.x, FloatN(0.001f)), FloatN(max(uniforms.disk_density_horizontal, 0.1f)));
+    density *= uniforms.disk_density_gain;
+    if (uniforms.disk_density_clamp > 0.0f) {
+        density = clamp(density, 0.0f, uniforms.disk_density_clamp);
+    }
+
+    FloatN bandMix = clamp(radialNorm, 0.0f, 1.0f);
+    FloatN primaryFreq = mix(12.0f, 24.0f, FloatN(1.0f) - bandMix);
+    FloatN secondaryFreq = mix(5.0f, 11.0f, FloatN(1.0f) - bandMix);
+    FloatN primaryPhase = angularPos * primaryFreq - rotationAngle * 1.6f + bandMix * 2.5f;
+    FloatN secondaryPhase = angularPos * secondaryFreq + rotationAngle * 0.85f +
+                            snoise(rDisk * 0.1f, pos.y * 3.0f, FloatN(time * 0.05f)) * 2.0f;
+    FloatN laneMask = clamp(FloatN(0.55f) + FloatN(0.45f) * sin(primaryPhase), 0.05f, 1.0f) *
+                      clamp(FloatN(0.6f) + FloatN(0.4f) * sin(secondaryPhase), 0.05f, 1.0f);
+    laneMask = pow(laneMask, mix(1.5f, 0.8f, bandMix));
+    FloatN bandNoise = FloatN(0.5f) + FloatN(0.5f) * snoise(angularPos * 0.5f, bandMix * 3.0f, FloatN(time * 0.15f));
+    density *= mix(0.35f, 1.25f, laneMask * bandNoise);
+
+    FloatN noise(1.0f);
+    int noiseOctaves = std::clamp(uniforms.disk_noise_octaves, 1, 8);
+    float noiseScale = max(uniforms.disk_noise_scale, 0.001f);
+    float noiseSpeed = uniforms.disk_noise_speed;
+    float lodBias = uniforms.disk_noise_lod_bias;
+    FloatN latticeFootprint = lodBias > 0.0f
+        ? footprint * lodBias * max(FloatN(1.0f), FloatN(4.0f) / max(rDisk, FloatN(0.001f))) * noiseScale
+        : FloatN(0.0f);
+
+    for (int i = 0; i < noiseOctaves; ++i) {
+        float octave = pow(float(i) + 1.0f, 2.0f);
+        float octaveSpeed = noiseSpeed * (1.0f + 0.18f * float(i));
+        FloatN octaveWeight = FloatN(1.0f) - smoothstep(0.5f, 1.0f, latticeFootprint * octave);
+        FloatN value = snoise(sphericalCoord * FloatN(octave * noiseScale));
+        noise *= mix(FloatN(0.45f), FloatN(0.55f) * value + 0.45f, max(octaveWeight, FloatN(0.0f)));
+        float direction = (i % 2 == 0) ? -1.0f : 1.0f;
+        sphericalCoord.y += keplerFactor * (direction * time * octaveSpeed);
+    }
+    FloatN microWeight = FloatN(1.0f) - smoothstep(0.5f, 1.0f, latticeFootprint * 18.0f);
+    FloatN microDetail = FloatN(0.5f) + FloatN(0.5f) * snoise(sphericalCoord * FloatN(18.0f * noiseScale) + FloatN(time * 0.3f));
+    noise *= mix(FloatN(1.0f), mix(0.85f, 1.15f, microDetail), max(microWeight, FloatN(0.0f)));
+
+    Vec3<FloatN> tangentDir = normalize(Vec3<FloatN>{ -advectedPos.z, FloatN(0.0f), advectedPos.x });
+    FloatN viewDot = clamp(dot(tangentDir, -normalize(viewDir)), -1.0f, 1.0f);
+    FloatN relativisticLane = pow(clamp(FloatN(1.0f) + viewDot * 0.75f, 0.25f, 2.5f), FloatN(3.0f));
+
+    FloatN redshift = calculateRedShift(pos);
+    FloatN doppler = max(calculateDopplerEffect(pos, viewDir), FloatN(0.2f));
+
+    Vec3<FloatN> sampledColor = diskColorMap.sample(radialNorm);
+    FloatN accretionTempMod = calculateRealisticTemperature(pos, 7500.0f);
+    accretionTempMod /= doppler;
+    accretionTempMod /= redshift;
+    Vec3<FloatN> dustColor = getBlackBodyColor(accretionTempMod * redshift);
+    Vec3<FloatN> baseColor = mix(dustColor, sampledColor, FloatN(clamp(uniforms.disk_color_mix, 0.0f, 1.0f)));
+
+    FloatN beaming = pow(doppler, FloatN(3.0f));
+    FloatN photonProximity = smoothstep(innerRadius * 1.5f, innerRadius * 1.05f, rDisk);
+    FloatN lensingFlare = FloatN(1.0f) + FloatN(1.8f) * photonProximity *
+                                             pow(clamp(viewDot * 0.5f + 0.5f, 0.0f, 1.0f), FloatN(2.0f));
+
+    FloatN turbulent = clamp(abs(noise), 0.22f, 1.7f);
+    FloatN beamingBoost = clamp(FloatN(0.6f) + (beaming - 1.0f) * 0.65f, 0.35f, 1.95f) * relativisticLane * lensingFlare;
+    FloatN innerGlow = FloatN(1.0f) + FloatN(2.8f) * pow(FloatN(1.0f) - radialNorm, FloatN(2.6f));
+    FloatN rawDeposit = clamp(density * turbulent * uniforms.disk_emission_strength * beamingBoost * innerGlow, 0.0f, 2.8f);
+    active = active & (rawDeposit > FloatN(1e-4f));
+    if (!any(active)) {
+        return;
+    }
+
+    Vec3<FloatN> warmTint = { FloatN(1.08f) + FloatN(0.05f) * viewDot, FloatN(0.92f) + FloatN(0.06f) * viewDot,
+                              FloatN(0.78f) - FloatN(0.1f) * viewDot };
+    Vec3<FloatN> hotCore = { FloatN(1.18f), FloatN(1.1f), FloatN(1.08f) };
+    FloatN photonMix = smoothstep(0.0f, 0.45f, FloatN(1.0f) - radialNorm);
+    Vec3<FloatN> tintedColor = mix(hotCore, warmTint, FloatN(1.0f) - photonMix);
+    Vec3<FloatN> diskColor = mix(tintedColor, baseColor, FloatN(0.75f));
+
+    FloatN attenuation = clamp(rawDeposit * clamp(uniforms.disk_alpha_falloff, 0.0f, 1.0f) *
+                                   (FloatN(0.75f) + FloatN(0.45f) * (FloatN(1.0f) - radialNorm)),
+                               0.0f, 0.95f);
+    FloatN transmittance = exp(log(FloatN(1.0f) - attenuation) * (ds / diskSampleLength));
+    FloatN emitted = select(rawDeposit * (ds / diskSampleLength),
+                            rawDeposit * (FloatN(1.0f) - transmittance) / attenuation,
+                            attenuation > FloatN(1e-4f));
+
+    FloatN deposit = emitted * acc.alpha;
+    acc.color = select(acc.color, acc.color + diskColor * deposit, active);
+    acc.coverage = select(acc.coverage, min(acc.coverage + acc.alpha * (FloatN(1.0f) - transmittance), FloatN(1.0f)),
+                          active);
+    acc.alpha = select(acc.alpha, acc.alpha * transmittance, active);
+}
+
+// diskRender for kLanes segments; each lane runs its own sample count
+inline void diskRender(const Vec3<FloatN>& a, const Vec3<FloatN>& b, DiskAccum<FloatN>& acc,
+                       const Vec3<FloatN>& viewDir, const FloatN& footprint, float time, const ShadingParams& uniforms,
+                       const DiskColorMap& diskColorMap)
+{
+    FloatN halfHeight(max(uniforms.disk_thickness, 0.01f));
+    Vec3<FloatN> d = b - a;
+    FloatN ta = (-halfHeight - a.y) / d.y;
+    FloatN tb = (halfHeight - a.y) / d.y;
+    MaskN crossing = abs(d.y) > FloatN(1e-6f);
+    FloatN t0 = select(FloatN(0.0f), max(FloatN(0.0f), min(ta, tb)), crossing);
+    FloatN t1 = select(FloatN(1.0f), min(FloatN(1.0f), max(ta, tb)), crossing);
+    MaskN active = (crossing | (abs(a.y) <= halfHeight)) & (t0 < t1);
+    if (!any(active)) {
+        return;
+    }
+
+    FloatN inside = length(d) * (t1 - t0);
+    FloatN samples = clamp(ceil(inside / diskSampleLength), 1.0f, 8.0f);
+    FloatN ds = inside / samples;
+    for (int i = 0; i < 8; ++i) {
+        // The scalar loop checks alpha after each sample, so from the second on
+        MaskN run = active & (FloatN(float(i)) < samples);
+        if (i > 0) {
+            run = run & (acc.alpha >= FloatN(0.01f));
+        }
+        if (!any(run)) {
+            return;
+        }
+        FloatN t = t0 + (t1 - t0) * (FloatN(float(i) + 0.5f) / samples);
+        diskSample(a + d * t, ds, acc, viewDir, footprint, time, uniforms, diskColorMap, run);
+    }
+}
+
+} // namespace shading
+
+#endif